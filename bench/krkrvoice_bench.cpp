@@ -0,0 +1,2452 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_bench.cpp   ―  擬似エンジンを使った性能計測
+//
+//   KrkrVoiceBench [--quick] [--filter=名前の一部] [--json=出力先] [--trace=出力先]
+//
+//   結果は JSON（既定は標準出力）。各ベンチは name と metrics を持つ。
+//   stages には全ベンチを通した区間計測（krkrvoice_trace）の集計が入る。
+//   metrics.pass が false のベンチがあれば終了コード 1。
+// -----------------------------------------------------------------------------
+#include "krkrvoice.hpp"
+#include "krkrvoice_balance.hpp"
+#include "krkrvoice_batch.hpp"
+#include "krkrvoice_cache.hpp"
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_cmdq.hpp"
+#include "krkrvoice_codec.hpp"
+#include "krkrvoice_dict.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_json.hpp"
+#include "krkrvoice_markup.hpp"
+#include "krkrvoice_memory.hpp"
+#include "krkrvoice_mixer.hpp"
+#include "krkrvoice_mock.hpp"
+#include "krkrvoice_prefetch.hpp"
+#include "krkrvoice_sched.hpp"
+#include "krkrvoice_stream.hpp"
+#include "krkrvoice_stretch.hpp"
+#include "krkrvoice_trace.hpp"
+#include "krkrvoice_vox.hpp"
+#include "krkrvoice_standin.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace krkrvoice;
+using Clock = std::chrono::steady_clock;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+struct BenchConfig {
+    bool        quick = false;
+    std::string filter;
+    std::string jsonPath;
+    std::string tracePath;
+};
+
+static double Ms(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static double Us(Clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// 昇順に並べて百分位を取る
+static double Percentile(std::vector<double> v, double p)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(p / 100.0 * static_cast<double>(v.size() - 1) + 0.5);
+    return v[std::min(i, v.size() - 1)];
+}
+
+static void AddLatency(JsonValue& m, const std::string& prefix, const std::vector<double>& v)
+{
+    m.Set(prefix + "_p50", JsonValue(Percentile(v, 50)));
+    m.Set(prefix + "_p95", JsonValue(Percentile(v, 95)));
+    m.Set(prefix + "_p99", JsonValue(Percentile(v, 99)));
+    m.Set(prefix + "_max", JsonValue(v.empty() ? 0.0 : *std::max_element(v.begin(), v.end())));
+}
+
+// 再生開始時刻を記録する層（擬似エンジンの直上に置く）
+//  Watch した行は、その行（の先頭の片）を合成したスレッドが次に始めた再生の時刻も記録する
+class ProbeTTSService final : public ForwardingTTSService {
+public:
+    explicit ProbeTTSService(std::shared_ptr<ITTSService> inner) : ForwardingTTSService(std::move(inner)) {}
+
+    bool SpeakText(const VoiceInfo& voice, const std::wstring& text, int speed, bool sync, bool overlap,
+                   std::function<void()> onFinish = {}, const CancelToken& cancel = {}) override
+    {
+        auto clip = std::make_shared<AudioClip>();
+        if (!Synthesize(voice, text, speed, *clip, cancel)) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        return PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+    }
+
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override
+    {
+        if (!inner_->Synthesize(voice, text, speed, out, cancel)) return false;
+        std::lock_guard<std::mutex> lk(mtx_);
+        watchedHere_ = !watch_.empty() && watch_.compare(0, text.size(), text) == 0;
+        return true;
+    }
+
+    bool PlayAudio(std::shared_ptr<const AudioClip> clip, bool sync, bool overlap,
+                   std::function<void()> onFinish = {}) override
+    {
+        Mark();
+        return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+    }
+
+    bool PlayStream(std::shared_ptr<PcmStream> stream, bool sync, bool overlap,
+                    std::function<void()> onFinish = {}) override
+    {
+        Mark();
+        return inner_->PlayStream(std::move(stream), sync, overlap, std::move(onFinish));
+    }
+
+    // Reset 後最初の再生開始時刻（未再生なら false）
+    bool FirstAudio(Clock::time_point& t)
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!has_) return false;
+        t = first_;
+        return true;
+    }
+
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        has_ = false;
+    }
+
+    void Watch(const std::wstring& line)
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        watch_      = line;
+        watchedHas_ = false;
+    }
+
+    // Watch した行の再生開始時刻（未再生なら false）
+    bool WatchedAudio(Clock::time_point& t)
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!watchedHas_) return false;
+        t = watched_;
+        return true;
+    }
+
+private:
+    void Mark()
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        const auto now = Clock::now();
+        if (!has_) { first_ = now; has_ = true; }
+        if (watchedHere_ && !watchedHas_) { watched_ = now; watchedHas_ = true; }
+        watchedHere_ = false;
+    }
+
+    static thread_local bool watchedHere_;   // このスレッドが直前に合成したのが Watch した行
+
+    std::mutex        mtx_;
+    bool              has_ = false;
+    Clock::time_point first_;
+    std::wstring      watch_;
+    bool              watchedHas_ = false;
+    Clock::time_point watched_;
+};
+thread_local bool ProbeTTSService::watchedHere_ = false;
+
+// TTSBridge と同じ層構成
+struct Stack {
+    std::shared_ptr<MockTTSService>      mock;
+    std::shared_ptr<ProbeTTSService>     probe;
+    std::shared_ptr<CachedTTSService>    cache;
+    std::shared_ptr<TimeStretchTTSService> stretch;
+    std::shared_ptr<PrefetchTTSService>  prefetch;
+    std::shared_ptr<ScheduledTTSService> sched;
+};
+
+static Stack MakeStack(const MockTTSOptions& mo)
+{
+    Stack s;
+    s.mock     = std::make_shared<MockTTSService>(mo);
+    s.probe    = std::make_shared<ProbeTTSService>(s.mock);
+    s.cache    = std::make_shared<CachedTTSService>(s.probe);
+    s.stretch  = std::make_shared<TimeStretchTTSService>(s.cache);
+    s.prefetch = std::make_shared<PrefetchTTSService>(std::make_shared<StreamingTTSService>(s.stretch));
+    s.sched    = std::make_shared<ScheduledTTSService>(s.prefetch);
+    std::weak_ptr<ScheduledTTSService> weak = s.sched;
+    s.prefetch->SetSubmitter([weak](SynthScheduler::Task run, std::function<void()> dropped) {
+        if (auto p = weak.lock()) p->Submit(SynthPriority::Prefetch, std::move(run), std::move(dropped));
+        else if (dropped)         dropped();
+    });
+    return s;
+}
+
+static std::wstring SampleLine(std::mt19937& rng, size_t minChars, size_t maxChars)
+{
+    static const std::wstring kSyllables =
+        L"あいうえおかきくけこさしすせそたちつてとなにぬねのはひふへほまみむめもやゆよらりるれろわん";
+    std::uniform_int_distribution<size_t> len(minChars, maxChars);
+    std::uniform_int_distribution<size_t> pick(0, kSyllables.size() - 1);
+    std::wstring s;
+    size_t n = len(rng);
+    for (size_t i = 0; i < n; ++i) {
+        s += kSyllables[pick(rng)];
+        if (i % 11 == 10) s += L'、';
+    }
+    s += L'。';
+    return s;
+}
+
+// このスレッドでの確保回数（「確保しない」経路の確認用）
+thread_local std::uint64_t t_allocs = 0;
+
+// 置き換えた operator new / delete の実体。全ての形をここに集める
+//  インライン展開させない（呼び出し元の new 式と free が直接向き合うと GCC が組み違いと誤検知する）
+#if defined(_MSC_VER)
+#define KRKRVOICE_BENCH_NOINLINE __declspec(noinline)
+#else
+#define KRKRVOICE_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+KRKRVOICE_BENCH_NOINLINE void* CountedAlloc(std::size_t n, std::size_t align) noexcept
+{
+    ++t_allocs;
+    if (n == 0) n = 1;
+    if (align <= alignof(std::max_align_t)) return std::malloc(n);
+#ifdef _WIN32
+    return ::_aligned_malloc(n, align);
+#else
+    return std::aligned_alloc(align, (n + align - 1) / align * align);
+#endif
+}
+
+KRKRVOICE_BENCH_NOINLINE void CountedFree(void* p, std::size_t align) noexcept
+{
+#ifdef _WIN32
+    if (align > alignof(std::max_align_t)) { ::_aligned_free(p); return; }
+#endif
+    (void)align;
+    std::free(p);
+}
+
+void* CountedNew(std::size_t n, std::size_t align)
+{
+    if (void* p = CountedAlloc(n, align)) return p;
+    throw std::bad_alloc();
+}
+
+constexpr std::size_t kDefaultAlign = alignof(std::max_align_t);
+
+} // unnamed namespace
+
+void* operator new(std::size_t n)                                   { return CountedNew(n, kDefaultAlign); }
+void* operator new[](std::size_t n)                                 { return CountedNew(n, kDefaultAlign); }
+void* operator new(std::size_t n, std::align_val_t a)               { return CountedNew(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a)             { return CountedNew(n, static_cast<std::size_t>(a)); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept   { return CountedAlloc(n, kDefaultAlign); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return CountedAlloc(n, kDefaultAlign); }
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{ return CountedAlloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{ return CountedAlloc(n, static_cast<std::size_t>(a)); }
+
+void operator delete(void* p) noexcept                                   { CountedFree(p, kDefaultAlign); }
+void operator delete[](void* p) noexcept                                 { CountedFree(p, kDefaultAlign); }
+void operator delete(void* p, std::size_t) noexcept                      { CountedFree(p, kDefaultAlign); }
+void operator delete[](void* p, std::size_t) noexcept                    { CountedFree(p, kDefaultAlign); }
+void operator delete(void* p, const std::nothrow_t&) noexcept            { CountedFree(p, kDefaultAlign); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept          { CountedFree(p, kDefaultAlign); }
+void operator delete(void* p, std::align_val_t a) noexcept               { CountedFree(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a) noexcept             { CountedFree(p, static_cast<std::size_t>(a)); }
+void operator delete(void* p, std::size_t, std::align_val_t a) noexcept  { CountedFree(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::size_t, std::align_val_t a) noexcept { CountedFree(p, static_cast<std::size_t>(a)); }
+void operator delete(void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{ CountedFree(p, static_cast<std::size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{ CountedFree(p, static_cast<std::size_t>(a)); }
+
+// -----------------------------------------------------------------------------
+// 各ベンチ
+// -----------------------------------------------------------------------------
+
+// 辞書適用（リテラル主体 + 少数の正規表現）
+//  5000 エントリの辞書で、エントリごとに regex_replace を繰り返す従来の方式と比べ、出力が一致することも確かめる
+static JsonValue BenchDictionary(const BenchConfig& cfg)
+{
+    std::mt19937 rng(42);
+    const size_t entries  = 5000;
+    const size_t lines    = cfg.quick ? 2000 : 20000;
+    const size_t oldLines = cfg.quick ? 40 : 400;   // 従来方式は 1 行に数 ms かかるので一部だけ
+
+    std::vector<DictEntry> dict;
+    for (size_t i = 0; i < entries; ++i)
+        dict.push_back(DictEntry{ SampleLine(rng, 2, 4).substr(0, 3), L"〈" + std::to_wstring(i) + L"〉" });
+    dict.push_back(DictEntry{ L"[0-9]+円", L"えん" });
+    dict.push_back(DictEntry{ L"(わ|ん)+", L"$1" });
+
+    std::vector<std::wstring> text;
+    size_t chars = 0;
+    for (size_t i = 0; i < lines; ++i) { text.push_back(SampleLine(rng, 20, 60)); chars += text.back().size(); }
+
+    auto t0 = Clock::now();
+    CompiledDictionary cd(dict);
+    auto compile = Clock::now() - t0;
+
+    size_t sink = 0;
+    t0 = Clock::now();
+    for (const auto& l : text) sink += cd.Apply(l).size();
+    auto apply = Clock::now() - t0;
+
+    // 従来方式：エントリを先頭から順に regex_replace（行ごとに文字列全体をコピーし直す）
+    t0 = Clock::now();
+    std::vector<std::pair<std::wregex, std::wstring>> chain;
+    for (const auto& e : dict) chain.emplace_back(std::wregex(e.pattern), e.replacement);
+    auto oldCompile = Clock::now() - t0;
+
+    size_t mismatches = 0;
+    std::chrono::steady_clock::duration oldApply{};
+    for (size_t i = 0; i < std::min(oldLines, text.size()); ++i) {
+        auto t1 = Clock::now();
+        std::wstring r = text[i];
+        for (const auto& [pattern, replacement] : chain) r = std::regex_replace(r, pattern, replacement);
+        oldApply += Clock::now() - t1;
+        if (r != cd.Apply(text[i])) ++mismatches;
+    }
+    const double oldUs = Us(oldApply) / static_cast<double>(std::min(oldLines, text.size()));
+    const double newUs = Us(apply) / static_cast<double>(lines);
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("entries",        JsonValue(static_cast<double>(dict.size())));
+    m.Set("lines",          JsonValue(static_cast<double>(lines)));
+    m.Set("compile_ms",     JsonValue(Ms(compile)));
+    m.Set("us_per_line",    JsonValue(newUs));
+    m.Set("mchars_per_sec", JsonValue(static_cast<double>(chars) / Us(apply)));
+    m.Set("output_chars",   JsonValue(static_cast<double>(sink)));
+    m.Set("old_compile_ms",  JsonValue(Ms(oldCompile)));
+    m.Set("old_us_per_line", JsonValue(oldUs));
+    m.Set("old_lines",       JsonValue(static_cast<double>(std::min(oldLines, text.size()))));
+    m.Set("speedup",         JsonValue(newUs > 0 ? oldUs / newUs : 0.0));
+    m.Set("mismatches",      JsonValue(static_cast<double>(mismatches)));
+    m.Set("pass",            JsonValue(mismatches == 0 && newUs < oldUs));
+    return m;
+}
+
+// シナリオタグの除去：シナリオ 1 本ぶん程度の行数で、タグなし / タグありの行ごとの時間と、
+// スクリプト側で正規表現を使って除去していた場合との比較。タグなしの行で確保が起きないことも見る
+static JsonValue BenchMarkup(const BenchConfig& cfg)
+{
+    std::mt19937 rng(19);
+    const size_t lines = cfg.quick ? 5000 : 40000;
+
+    // 4 割ほどがタグを含む行（改行・クリック待ち・ルビ・埋め込み・ウェイト）
+    static const wchar_t* kTags[] = {
+        L"[r]", L"[l]", L"[l][r]", L"[emb exp=\"f.name\"]", L"[wait time=200]", L"[font size=30]",
+    };
+    std::vector<std::wstring> plain, tagged;
+    size_t chars = 0;
+    for (size_t i = 0; i < lines; ++i) {
+        std::wstring s = SampleLine(rng, 15, 50);
+        if (i % 5 < 3) {
+            chars += s.size();
+            plain.push_back(std::move(s));
+            continue;
+        }
+        std::wstring t;
+        for (size_t c = 0; c < s.size(); ++c) {
+            if (rng() % 9 == 0) t += L"[ruby text=\"かんじ\"]";
+            t += s[c];
+            if (rng() % 13 == 0) t += kTags[rng() % std::size(kTags)];
+        }
+        t += L"[p]";
+        chars += t.size();
+        tagged.push_back(std::move(t));
+    }
+
+    MarkupOptions opt;
+    std::wstring out;
+    size_t sink = 0;
+    const size_t plainAllocs0 = t_allocs;
+    auto t0 = Clock::now();
+    for (const auto& l : plain) sink += StripScenarioMarkup(l, out, opt);
+    auto plainTime = Clock::now() - t0;
+    const size_t plainAllocs = t_allocs - plainAllocs0;
+
+    t0 = Clock::now();
+    for (const auto& l : tagged) {
+        std::wstring o;
+        StripScenarioMarkup(l, o, opt);
+        sink += o.size();
+    }
+    auto taggedTime = Clock::now() - t0;
+
+    // 従来のスクリプト側処理に相当する正規表現での除去（ルビ・休止は扱えない）
+    const std::wregex tagRe(L"\\[[^\\]]*\\]");
+    const size_t regexLines = std::min<size_t>(tagged.size(), cfg.quick ? 500 : 2000);
+    t0 = Clock::now();
+    for (size_t i = 0; i < regexLines; ++i) sink += std::regex_replace(tagged[i], tagRe, L"").size();
+    auto regexTime = Clock::now() - t0;
+
+    // 変換結果
+    auto strip = [&](const std::wstring& in) {
+        std::wstring o;
+        return StripScenarioMarkup(in, o, opt) ? o : in;
+    };
+    std::wstring pause300, pause1000;
+    AppendPause(pause300, 300);
+    AppendPause(pause1000, 1000);
+    const std::pair<std::wstring, std::wstring> cases[] = {
+        { L"こんにちは[r]世界[l]",                    L"こんにちは世界" + pause300 },
+        { L"[ruby text=かん]漢[ruby text=\"じ\"]字",  L"かんじ" },
+        { L"[ruby text=\"&f.yomi\"]漢[emb exp=\"f.name\"]さん", L"漢さん" },
+        { L"[[注]は[ch text=\"あ\"]",                L"[注]はあ" },
+        { L"@bg storage=\"a.png\"\nはい[wait time=1000]", L"はい" + pause1000 },
+        { L"閉じない[r",                            L"閉じない[r" },
+        { L"[L][WAIT TIME=\"1000\"]",                pause300 + pause1000 },
+    };
+    bool correct = true;
+    for (const auto& [in, want] : cases) correct = correct && strip(in) == want;
+
+    // 休止記号は擬似エンジンで無音になり、辞書置換を通しても残る
+    MockTTSService mock;
+    VoiceInfo vi;
+    mock.ResolveVoice(L"", L"", 0, vi);
+    AudioClip withPause, without;
+    mock.Synthesize(vi, L"あい", 0, without);
+    mock.Synthesize(vi, strip(L"あ[l]い"), 0, withPause);
+    const double pauseMs = 1000.0 * static_cast<double>(withPause.Frames() - without.Frames()) /
+                           static_cast<double>(withPause.sampleRate);
+    CompiledDictionary cd(std::vector<DictEntry>{ { L"い", L"イ" } });
+    const bool survives = cd.Apply(strip(L"あ[l]い")) == L"あ" + pause300 + L"イ";
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("lines",                JsonValue(static_cast<double>(lines)));
+    m.Set("tagged_lines",         JsonValue(static_cast<double>(tagged.size())));
+    m.Set("ns_per_plain_line",    JsonValue(Us(plainTime) * 1000.0 / static_cast<double>(plain.size())));
+    m.Set("ns_per_tagged_line",   JsonValue(Us(taggedTime) * 1000.0 / static_cast<double>(tagged.size())));
+    m.Set("ns_per_tagged_line_regex", JsonValue(Us(regexTime) * 1000.0 / static_cast<double>(regexLines)));
+    m.Set("mchars_per_sec",       JsonValue(static_cast<double>(chars) / Us(plainTime + taggedTime)));
+    m.Set("plain_line_allocs",    JsonValue(static_cast<double>(plainAllocs)));
+    m.Set("pause_ms",             JsonValue(pauseMs));
+    m.Set("results_match",        JsonValue(correct));
+    m.Set("output_chars",         JsonValue(static_cast<double>(sink)));
+    m.Set("pass", JsonValue(correct && survives && plainAllocs == 0 && std::fabs(pauseMs - 300) < 1));
+    return m;
+}
+
+// 起動時の辞書読み込み：JSON を解析してコンパイルする経路と .kvdc をマップする経路
+//  （TJS 配列を辿る registerDictionary の代わりに同等の JSON 読み込みで測る）
+static JsonValue BenchDictionaryLoad(const BenchConfig& cfg)
+{
+    namespace fs = std::filesystem;
+    std::mt19937 rng(5);
+    const size_t entries = 10000;
+    const size_t regexes = 200;
+    const size_t reps    = cfg.quick ? 3 : 10;
+
+    JsonValue arr = JsonValue::MakeArray();
+    for (size_t i = 0; i < entries; ++i) {
+        JsonValue e = JsonValue::MakeObject();
+        if (i % (entries / regexes) == 0) {
+            e.Set("pattern",     JsonValue(ToUtf8(L"(" + SampleLine(rng, 2, 3).substr(0, 2) + L")[ー〜]+")));
+            e.Set("replacement", JsonValue(ToUtf8(L"$1")));
+        } else {
+            e.Set("pattern",     JsonValue(ToUtf8(SampleLine(rng, 3, 6).substr(0, 4))));
+            e.Set("replacement", JsonValue(ToUtf8(L"〈" + std::to_wstring(i) + L"〉")));
+        }
+        arr.Push(std::move(e));
+    }
+    fs::path dir  = fs::temp_directory_path() / "krkrvoice-bench";
+    fs::create_directories(dir);
+    fs::path json = dir / "reading.json";
+    fs::path bin  = dir / "reading.kvdc";
+    { std::ofstream f(json, std::ios::binary | std::ios::trunc); f << arr.Dump(); }
+
+    std::vector<double> jsonMs, compileMs, loadMs;
+    CompiledDictionary fromSource;
+    for (size_t r = 0; r < reps; ++r) {
+        std::map<std::wstring, std::vector<DictEntry>> dicts;
+        std::wstring err;
+        auto t0 = Clock::now();
+        LoadDictionaryFile(json, dicts, err);
+        auto t1 = Clock::now();
+        fromSource = CompiledDictionary(dicts.begin()->second);
+        auto t2 = Clock::now();
+        jsonMs.push_back(Ms(t2 - t0));
+        compileMs.push_back(Ms(t2 - t1));
+    }
+    fromSource.Save(bin);
+
+    CompiledDictionary loaded;
+    for (size_t r = 0; r < reps; ++r) {
+        auto t0 = Clock::now();
+        CompiledDictionary::Load(bin, loaded);
+        loadMs.push_back(Ms(Clock::now() - t0));
+    }
+
+    // 初回適用（遅延コンパイルされる正規表現を含む）と、結果が一致すること
+    std::vector<std::wstring> lines;
+    for (size_t i = 0; i < 500; ++i) lines.push_back(SampleLine(rng, 20, 60));
+    auto t0 = Clock::now();
+    auto first = loaded.Apply(lines[0]);
+    double firstApply = Ms(Clock::now() - t0);
+    bool same = first == fromSource.Apply(lines[0]);
+    for (const auto& l : lines) same = same && loaded.Apply(l) == fromSource.Apply(l);
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("entries",            JsonValue(static_cast<double>(entries)));
+    m.Set("regex_entries",      JsonValue(static_cast<double>(regexes)));
+    m.Set("stages",             JsonValue(static_cast<double>(loaded.StageCount())));
+    m.Set("file_bytes",         JsonValue(static_cast<double>(fs::file_size(bin))));
+    m.Set("json_and_compile_ms", JsonValue(Percentile(jsonMs, 50)));
+    m.Set("compile_ms",         JsonValue(Percentile(compileMs, 50)));
+    m.Set("load_ms",            JsonValue(Percentile(loadMs, 50)));
+    m.Set("first_apply_ms",     JsonValue(firstApply));
+    m.Set("results_match",      JsonValue(same));
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return m;
+}
+
+// 音声解決（初回列挙 + 以降のフィルタ付き解決）と、ハンドルからの解決
+static JsonValue BenchVoiceResolution(const BenchConfig& cfg)
+{
+    MockTTSOptions mo;
+    mo.voices = 400;
+    mo.enumMs = 20;
+    MockTTSService svc(mo);
+    const size_t iters = cfg.quick ? 20000 : 200000;
+
+    VoiceInfo vi;
+    auto t0 = Clock::now();
+    svc.ResolveVoice(L"", L"", 0, vi);
+    auto first = Clock::now() - t0;
+
+    static const wchar_t* kGenders[] = { L"", L"Female", L"male", L"Other" };
+    size_t ok = 0;
+    t0 = Clock::now();
+    for (size_t i = 0; i < iters; ++i)
+        ok += svc.ResolveVoice(L"ja-JP", kGenders[i % 4], i % 150, vi);
+    auto rest = Clock::now() - t0;
+
+    // 同じ音声をハンドルで引く
+    std::vector<VoiceHandle> handles;
+    std::vector<std::wstring> names;
+    for (size_t i = 0; i < 600; ++i)
+        if (svc.ResolveVoice(L"ja-JP", kGenders[i % 4], i % 150, vi)) {
+            handles.push_back(vi.handle);
+            names.push_back(vi.displayName);
+        }
+    size_t found = 0;
+    t0 = Clock::now();
+    for (size_t i = 0; i < iters; ++i)
+        found += svc.FindVoice(handles[i % handles.size()], vi);
+    auto byHandle = Clock::now() - t0;
+
+    // 層を重ねた状態（TTSBridge と同じ）での 1 回あたり
+    auto s = MakeStack(mo);
+    s.sched->ResolveVoice(L"", L"", 0, vi);
+    t0 = Clock::now();
+    for (size_t i = 0; i < iters; ++i) s.sched->ResolveVoice(L"ja-JP", kGenders[i % 4], i % 150, vi);
+    auto stackResolve = Clock::now() - t0;
+    t0 = Clock::now();
+    for (size_t i = 0; i < iters; ++i) s.sched->FindVoice(handles[i % handles.size()], vi);
+    auto stackFind = Clock::now() - t0;
+
+    // 再列挙してもハンドルは同じ音声を指す
+    svc.RefreshVoices();
+    bool stable = !handles.empty();
+    for (size_t i = 0; i < handles.size(); ++i)
+        stable = stable && svc.FindVoice(handles[i], vi) && vi.displayName == names[i];
+
+    VoiceCatalogStats st;
+    svc.GetCatalogStats(st);
+
+    const double n = static_cast<double>(iters);
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("voices",          JsonValue(static_cast<double>(mo.voices)));
+    m.Set("first_ms",        JsonValue(Ms(first)));
+    m.Set("ns_per_resolve",  JsonValue(Us(rest) * 1000.0 / n));
+    m.Set("ns_per_handle",   JsonValue(Us(byHandle) * 1000.0 / n));
+    m.Set("stack_ns_per_resolve", JsonValue(Us(stackResolve) * 1000.0 / n));
+    m.Set("stack_ns_per_handle",  JsonValue(Us(stackFind) * 1000.0 / n));
+    m.Set("resolved",        JsonValue(static_cast<double>(ok)));
+    m.Set("found",           JsonValue(static_cast<double>(found)));
+    m.Set("enumerations",    JsonValue(static_cast<double>(st.enumerations)));
+    m.Set("handles_stable",  JsonValue(stable));
+    m.Set("pass",            JsonValue(stable && found == iters));
+    return m;
+}
+
+// 音声一覧のスナップショット：生成から最初の一覧が返るまで（列挙する場合／スナップショットから読む場合）
+static JsonValue BenchCatalogSnapshot(const BenchConfig& cfg)
+{
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "krkrvoice-bench";
+    fs::create_directories(dir);
+    const fs::path snap = dir / "voices.kvvc";
+    std::error_code ec;
+    fs::remove(snap, ec);
+
+    MockTTSOptions mo;
+    mo.voices = 400;
+    mo.enumMs = cfg.quick ? 80 : 250;   // 音声の多い環境での SAPI トークン + WinRT の列挙
+    auto startup = [&](const MockTTSOptions& o, std::unique_ptr<MockTTSService>& svc, std::vector<VoiceInfo>& list) {
+        auto t0 = Clock::now();
+        svc = std::make_unique<MockTTSService>(o);
+        svc->Catalog()->UseSnapshot(snap);
+        list = svc->GetVoiceList();
+        return Ms(Clock::now() - t0);
+    };
+    auto same = [](const std::vector<VoiceInfo>& a, const std::vector<VoiceInfo>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (a[i].handle != b[i].handle || a[i].displayName != b[i].displayName || a[i].gender != b[i].gender)
+                return false;
+        return true;
+    };
+
+    // 1. スナップショットなし（列挙して書き出す）
+    std::unique_ptr<MockTTSService> svc;
+    std::vector<VoiceInfo> cold, warm;
+    const double coldMs = startup(mo, svc, cold);
+    VoiceCatalogStats st;
+    svc->GetCatalogStats(st);
+    const bool written = st.snapshotWrites == 1 && fs::exists(snap);
+    svc.reset();
+
+    // 2. スナップショットから（指紋が一致するので列挙しない）
+    std::vector<double> warmMs;
+    bool identical = true, skipped = true;
+    for (int r = 0; r < (cfg.quick ? 5 : 20); ++r) {
+        warmMs.push_back(startup(mo, svc, warm));
+        identical = identical && same(cold, warm);
+        svc->Catalog()->WaitRevalidated();
+        svc->GetCatalogStats(st);
+        skipped = skipped && st.snapshotLoaded == 1 && st.enumerations == 0 && st.fingerprintMatches == 1;
+        svc.reset();
+    }
+
+    // 3. 音声が増えた：まずスナップショットの一覧を返し、裏で列挙して差し替える（既存のハンドルは変わらない）
+    MockTTSOptions more = mo;
+    more.voices = mo.voices + 1;
+    std::vector<VoiceInfo> stale, fresh;
+    const double staleMs = startup(more, svc, stale);
+    svc->Catalog()->WaitRevalidated();
+    fresh = svc->GetVoiceList();
+    svc->GetCatalogStats(st);
+    bool updated = stale.size() == mo.voices && fresh.size() == more.voices && st.enumerations == 1 &&
+                   st.snapshotWrites == 1;
+    for (size_t i = 0; updated && i < cold.size(); ++i)
+        updated = fresh[i].handle == cold[i].handle && fresh[i].displayName == cold[i].displayName;
+    svc.reset();
+
+    // 4. 壊れたファイルは使わずに列挙して書き直す
+    {
+        std::ofstream f(snap, std::ios::binary | std::ios::trunc);
+        f << "KVVC\x01garbage";
+    }
+    std::vector<VoiceInfo> recovered;
+    startup(mo, svc, recovered);
+    svc->GetCatalogStats(st);
+    const bool corruptOk = st.snapshotLoaded == 0 && st.enumerations == 1 && recovered.size() == mo.voices &&
+                           st.snapshotWrites == 1;
+    svc.reset();
+    fs::remove(snap, ec);
+
+    // 5. VOICEVOX：/speakers の往復（遠隔のエンジンを想定して遅らせる）を起動時に待たない
+    double voxColdMs = 0, voxWarmMs = 0;
+    bool voxOk = false;
+    {
+        StandInOptions so;
+        so.requestMs = 40;
+        VoxStandIn engine(so);
+        const fs::path voxSnap = dir / "voicevox.kvvc";
+        fs::remove(voxSnap, ec);
+        auto voxStartup = [&](std::unique_ptr<VoiceVoxService>& vox, std::vector<VoiceInfo>& list) {
+            auto t0 = Clock::now();
+            vox = std::make_unique<VoiceVoxService>(L"http://127.0.0.1", engine.Port());
+            vox->Catalog()->UseSnapshot(voxSnap);
+            list = vox->GetVoiceList();
+            return Ms(Clock::now() - t0);
+        };
+        if (engine.Ok()) {
+            std::unique_ptr<VoiceVoxService> vox;
+            std::vector<VoiceInfo> a, b;
+            voxColdMs = voxStartup(vox, a);
+            vox.reset();
+            voxWarmMs = voxStartup(vox, b);
+            AudioClip clip;
+            voxOk = same(a, b) && !b.empty() && vox->Synthesize(b[0], L"スナップショットから", 0, clip) &&
+                    clip.Frames() > 0;
+            vox.reset();
+        }
+        fs::remove(voxSnap, ec);
+    }
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("voices",              JsonValue(static_cast<double>(mo.voices)));
+    m.Set("startup_ms_enumerate", JsonValue(coldMs));
+    m.Set("startup_ms_snapshot",  JsonValue(Percentile(warmMs, 50)));
+    m.Set("startup_ms_stale",     JsonValue(staleMs));
+    m.Set("voicevox_startup_ms_enumerate", JsonValue(voxColdMs));
+    m.Set("voicevox_startup_ms_snapshot",  JsonValue(voxWarmMs));
+    m.Set("identical",           JsonValue(identical));
+    m.Set("enumeration_skipped", JsonValue(skipped));
+    m.Set("change_detected",     JsonValue(updated));
+    m.Set("corrupt_recovered",   JsonValue(corruptOk));
+    m.Set("voicevox_ok",         JsonValue(voxOk));
+    m.Set("pass", JsonValue(written && identical && skipped && updated && corruptOk && voxOk &&
+                            Percentile(warmMs, 50) * 10 < coldMs && voxWarmMs * 4 < voxColdMs));
+    return m;
+}
+
+// speakAsync の一斉投入（overlap の有無）。最後の行が鳴るまでの時間を見る
+static JsonValue BenchFanOut(const BenchConfig& cfg, bool overlap)
+{
+    MockTTSOptions mo;
+    mo.baseMs    = 4;
+    mo.perCharMs = 0.2;
+    mo.jitterMs  = 2;
+    auto s = MakeStack(mo);
+    const size_t n = cfg.quick ? 200 : 1000;
+
+    VoiceInfo vi;
+    s.sched->ResolveVoice(L"", L"", 0, vi);
+    std::mt19937 rng(7);
+    std::vector<std::wstring> lines;
+    for (size_t i = 0; i < n; ++i) lines.push_back(SampleLine(rng, 8, 30));
+
+    // 最後の行が鳴り始めた時刻（完了ではなく再生開始）
+    s.probe->Watch(lines.back());
+    std::atomic<size_t> finished{ 0 };
+    Completion allDone;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i)
+        s.sched->SpeakText(vi, lines[i], 0, false, overlap, [&] { if (++finished == n) allDone.Signal(); });
+    auto submitted = Clock::now() - t0;
+    const bool done = allDone.WaitFor(std::chrono::seconds(60));
+    auto total = Clock::now() - t0;
+    Clock::time_point lastAt;
+    const bool heard = s.probe->WatchedAudio(lastAt);
+    const double lastMs = heard ? Ms(lastAt - t0) : 0.0;
+
+    auto st = s.sched->Scheduler().Stats();
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("lines",           JsonValue(static_cast<double>(n)));
+    m.Set("submit_ms",       JsonValue(Ms(submitted)));
+    m.Set("last_line_ms",    JsonValue(lastMs));
+    m.Set("all_finished_ms", JsonValue(Ms(total)));
+    m.Set("started",         JsonValue(static_cast<double>(st.started)));
+    m.Set("dropped",         JsonValue(static_cast<double>(st.dropped)));
+    // 置き換え：前の行を取り消すので、最後の行は投入し終えてすぐ（合成数回分のうちに）鳴る
+    // 重ね：全行を合成するが、ワーカーが並行するので 1 行ずつ直列に合成するより早く鳴る
+    const double perLine = mo.baseMs + mo.perCharMs * 30 + mo.jitterMs;
+    const double bound   = overlap ? perLine * double(n) : Ms(submitted) + 100;
+    m.Set("last_line_bound_ms", JsonValue(bound));
+    m.Set("pass",            JsonValue(done && heard && lastMs < bound));
+    return m;
+}
+
+// 発話要求から再生開始までの時間（分割ストリーミング・キャッシュ・先読み・分割なし）
+static JsonValue BenchTimeToFirstAudio(const BenchConfig& cfg)
+{
+    MockTTSOptions mo;
+    mo.baseMs    = 8;
+    mo.perCharMs = 1.0;
+    const size_t reps = cfg.quick ? 10 : 40;
+
+    std::mt19937 rng(11);
+    std::vector<std::wstring> lines;
+    for (size_t i = 0; i < reps; ++i) lines.push_back(SampleLine(rng, 60, 90));
+
+    auto measure = [&](const char* mode) {
+        auto s = MakeStack(mo);
+        VoiceInfo vi;
+        s.sched->ResolveVoice(L"", L"", 0, vi);
+        std::vector<double> v;
+        for (size_t i = 0; i < reps; ++i) {
+            const auto& text = lines[i];
+            std::string md = mode;
+            if (md == "cached") {
+                s.sched->SpeakText(vi, text, 0, true, false);   // 分割単位でキャッシュに載せる
+            } else if (md == "prefetched") {
+                s.prefetch->Prefetch(vi, text, 0);
+                std::this_thread::sleep_for(std::chrono::milliseconds(150));
+            }
+            s.probe->Reset();
+            Completion done;
+            auto t0 = Clock::now();
+            if (md == "unsplit") s.probe->SpeakText(vi, text, 0, false, false, [&] { done.Signal(); });
+            else                 s.sched->SpeakText(vi, text, 0, false, false, [&] { done.Signal(); });
+            done.Wait();
+            Clock::time_point first;
+            if (s.probe->FirstAudio(first)) v.push_back(Ms(first - t0));
+        }
+        return v;
+    };
+
+    JsonValue m = JsonValue::MakeObject();
+    AddLatency(m, "unsplit_ms",    measure("unsplit"));
+    AddLatency(m, "streamed_ms",   measure("streamed"));
+    AddLatency(m, "cached_ms",     measure("cached"));
+    AddLatency(m, "prefetched_ms", measure("prefetched"));
+    return m;
+}
+
+// speakAsync の呼び出し側の所要時間（合成 200ms のエンジンで、上限を検査する）
+//  queued : TTSBridge と同じく要求をコマンドスレッドに積むだけ
+//  direct : 音声解決・辞書適用・スケジューラ投入まで呼び出し側で行う（従来の経路）
+static JsonValue BenchSpeakCallLatency(const BenchConfig& cfg)
+{
+    constexpr double kBoundUs = 1000;   // 呼び出し 1 回の上限
+    MockTTSOptions mo;
+    mo.baseMs = 200;
+    mo.enumMs = 50;
+    const size_t calls = cfg.quick ? 300 : 2000;
+
+    std::mt19937 rng(9);
+    std::vector<DictEntry> entries;
+    for (size_t i = 0; i < 2000; ++i)
+        entries.push_back(DictEntry{ SampleLine(rng, 3, 5).substr(0, 3), L"〈" + std::to_wstring(i) + L"〉" });
+    auto dict = std::make_shared<const CompiledDictionary>(entries);
+    std::vector<std::wstring> lines;
+    for (size_t i = 0; i < calls; ++i) lines.push_back(SampleLine(rng, 20, 50));
+
+    auto run = [&](bool queued) {
+        auto s = MakeStack(mo);
+        auto cmdq = std::make_unique<CommandThread>();
+        std::vector<double> v;
+        std::atomic<size_t> finished{ 0 };
+        Completion all;
+        for (size_t i = 0; i < calls; ++i) {
+            auto onFinish = [&] { if (++finished == calls) all.Signal(); };
+            std::wstring lang = L"ja-JP";
+            auto t0 = Clock::now();
+            if (queued) {
+                cmdq->Post([&s, dict, lang, text = lines[i], onFinish] {
+                    VoiceInfo vi;
+                    if (!s.sched->ResolveVoice(lang, L"", 0, vi)) { onFinish(); return; }
+                    s.sched->SpeakText(vi, dict->Apply(text), 0, false, false, onFinish);
+                });
+            } else {
+                VoiceInfo vi;
+                s.sched->ResolveVoice(lang, L"", 0, vi);
+                s.sched->SpeakText(vi, dict->Apply(lines[i]), 0, false, false, onFinish);
+            }
+            v.push_back(Us(Clock::now() - t0));
+            std::this_thread::sleep_for(std::chrono::microseconds(200));   // ゲームのフレーム間隔の代わり
+        }
+        all.Wait();
+        return v;
+    };
+
+    auto queued = run(true);
+    auto direct = run(false);
+    double maxQueued = *std::max_element(queued.begin(), queued.end());
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("calls",    JsonValue(static_cast<double>(calls)));
+    m.Set("bound_us", JsonValue(kBoundUs));
+    AddLatency(m, "queued_us", queued);
+    AddLatency(m, "direct_us", direct);
+    m.Set("pass", JsonValue(maxQueued <= kBoundUs));
+    return m;
+}
+
+// エンジンの完了イベント（Windows は SAPI と同じ自動リセットのイベント、それ以外は EventDispatcher::Event）
+struct BenchEngineEvent {
+#ifdef _WIN32
+    HANDLE h = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    ~BenchEngineEvent() { ::CloseHandle(h); }
+    EventDispatcher::Handle Handle() { return h; }
+    void Set() { ::SetEvent(h); }
+#else
+    EventDispatcher::Event ev;
+    EventDispatcher::Handle Handle() { return &ev; }
+    void Set() { ev.Set(); }
+#endif
+};
+
+// 完了通知の伝達遅延：エンジンがイベントを立ててから、SapiNotifier と同じディスパッチャを経て
+// 発話の完了待ちが起きるまで。他の発話 32 本を待機させたまま測る。
+// Speak 失敗時に外した登録の onDone が呼ばれないことも確かめる
+static JsonValue BenchCompletionLatency(const BenchConfig& cfg)
+{
+    const size_t reps       = cfg.quick ? 200 : 2000;
+    const size_t background = 32;
+    std::deque<BenchEngineEvent> events;   // ディスパッチャより長生きさせる
+    EventDispatcher dispatcher;
+    for (size_t i = 0; i < background; ++i) {
+        events.emplace_back();
+        dispatcher.Watch(events.back().Handle(), [] { return true; }, [] {});
+    }
+
+    std::vector<double> v;
+    for (size_t i = 0; i < reps; ++i) {
+        auto& ev = events.emplace_back();
+        Completion c;
+        dispatcher.Watch(ev.Handle(), [] { return true; }, [&] { c.Signal(); });
+        Clock::time_point fired;
+        std::thread t([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            fired = Clock::now();
+            ev.Set();
+        });
+        c.Wait();
+        auto woke = Clock::now();
+        t.join();
+        v.push_back(Us(woke - fired));
+    }
+
+    // Speak が失敗した発話：外せば onDone は呼ばれず、二度目は false
+    std::atomic<size_t> stray{ 0 };
+    auto& failed = events.emplace_back();
+    const auto id = dispatcher.Watch(failed.Handle(), [] { return true; }, [&] { ++stray; });
+    const bool unwatched = dispatcher.Unwatch(id);
+    failed.Set();
+    // 完了済みの登録は外せない
+    auto& done = events.emplace_back();
+    Completion doneSignal;
+    const auto doneId = dispatcher.Watch(done.Handle(), [] { return true; }, [&] { doneSignal.Signal(); });
+    done.Set();
+    doneSignal.Wait();
+    const bool unwatchOk = unwatched && !dispatcher.Unwatch(id) && !dispatcher.Unwatch(doneId) && stray == 0 &&
+                           dispatcher.Watched() == background;
+
+    JsonValue m = JsonValue::MakeObject();
+    AddLatency(m, "wake_us", v);
+    m.Set("watched_background", JsonValue(static_cast<double>(background)));
+    m.Set("unwatch_ok",         JsonValue(unwatchOk));
+    m.Set("pass",               JsonValue(unwatchOk && v.size() == reps));
+    return m;
+}
+
+// 失敗率を持つエンジンでの一括合成（失敗時も全行の完了通知が届くこと）
+static JsonValue BenchFailureResilience(const BenchConfig& cfg)
+{
+    MockTTSOptions mo;
+    mo.baseMs   = 1;
+    mo.failRate = 0.2;
+    auto s = MakeStack(mo);
+    const size_t n = cfg.quick ? 100 : 500;
+
+    VoiceInfo vi;
+    s.sched->ResolveVoice(L"", L"", 0, vi);
+    std::mt19937 rng(3);
+    std::atomic<size_t> finished{ 0 };
+    Completion all;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i)
+        s.sched->SpeakText(vi, SampleLine(rng, 5, 20), 0, false, true,
+                           [&] { if (++finished == n) all.Signal(); });
+    bool ok = all.WaitFor(std::chrono::seconds(60));
+    const double elapsed = Ms(Clock::now() - t0);
+
+    // onFinish を呼ばずに false を返すエンジンでも、スケジューラ越しの完了待ちは残らない
+    struct SilentFailService final : ITTSService {
+        std::vector<VoiceInfo> GetVoiceList(const std::wstring&, const std::wstring&) override { return {}; }
+        bool SpeakText(const VoiceInfo&, const std::wstring&, int, bool, bool,
+                       std::function<void()>, const CancelToken&) override { return false; }
+    };
+    ScheduledTTSService silent(std::make_shared<SilentFailService>());
+    std::atomic<size_t> silentFinished{ 0 };
+    Completion silentAll;
+    const size_t silentN = 20;
+    for (size_t i = 0; i < silentN; ++i)
+        silent.SpeakText(vi, L"失敗", 0, i % 2 == 0, true,
+                         [&] { if (++silentFinished == silentN) silentAll.Signal(); });
+    const bool silentOk = silentAll.WaitFor(std::chrono::seconds(10)) && silentFinished == silentN;
+
+    // 合成に失敗し続けるエンジンでも、各層が SpeakText で合成し直さない（1 行 1 回の試行で終わる）
+    MockTTSOptions down = mo;
+    down.failRate = 1.0;
+    auto d = MakeStack(down);
+    const size_t downN = 10;
+    size_t downFinished = 0;
+    for (size_t i = 0; i < downN; ++i)
+        d.sched->SpeakText(vi, L"届かない行です。" + std::to_wstring(i) + L"もう一文あります。", 50, true, true,
+                           [&] { ++downFinished; });
+    auto ds = d.mock->Synthesizers()->Stats();
+    const std::uint64_t downAttempts = ds.created + ds.reused;
+    const bool downOk = downFinished == downN && downAttempts == downN;
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("lines",       JsonValue(static_cast<double>(n)));
+    m.Set("finished",    JsonValue(static_cast<double>(finished.load())));
+    m.Set("all_notified", JsonValue(ok));
+    m.Set("silent_failures_notified", JsonValue(silentOk));
+    m.Set("down_engine_attempts_per_line", JsonValue(double(downAttempts) / double(downN)));
+    m.Set("elapsed_ms",  JsonValue(elapsed));
+    m.Set("pass",        JsonValue(ok && silentOk && downOk));
+    return m;
+}
+
+// 64 音声を同時にミキシングしたときの 1 ブロックの処理時間（カーネル別）
+//  各カーネルの出力がスカラー版と ±1 LSB 以内で一致すること、WAV 出力が正しく閉じることも確かめる
+static JsonValue BenchMixer(const BenchConfig& cfg)
+{
+    namespace fs = std::filesystem;
+    const int    rate   = 24000;
+    const size_t voices = 64;
+    const size_t block  = 256;
+    const size_t blocks = cfg.quick ? 2000 : 20000;
+
+    std::mt19937 rng(11);
+    std::vector<std::shared_ptr<const AudioClip>> clips;
+    for (size_t v = 0; v < voices; ++v) {
+        auto c = std::make_shared<AudioClip>();
+        c->sampleRate = rate;
+        c->channels   = v % 8 == 7 ? 2 : 1;   // 一部はステレオ
+        c->samples.resize(static_cast<size_t>(rate) * 4 * c->channels);
+        std::uniform_int_distribution<int> noise(-2000, 2000);
+        for (size_t i = 0; i < c->samples.size(); ++i)
+            c->samples[i] = static_cast<int16_t>(8000 * std::sin(0.01 * double(i) * double(v + 1)) + noise(rng));
+        clips.push_back(std::move(c));
+    }
+    auto start = [&](AudioMixer& mx) {
+        std::vector<MixVoiceId> ids;
+        for (size_t v = 0; v < voices; ++v) {
+            MixVoiceParams p;
+            p.gain = 0.12f;
+            p.pan  = -1.0f + 2.0f * float(v) / float(voices - 1);
+            p.duckOthers = v == voices - 1;
+            ids.push_back(mx.Play(clips[v], p, false));
+        }
+        return ids;
+    };
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("voices",       JsonValue(static_cast<double>(voices)));
+    m.Set("block_frames", JsonValue(static_cast<double>(block)));
+    m.Set("best_kernel",  JsonValue(SimdLevelName(AudioMixer::BestKernel())));
+
+    // 一致確認: 途中で音量・定位を変えて補間経路も通す
+    const size_t checkBlocks = 64;
+    std::vector<int16_t> reference;
+    bool   match   = true;
+    int    maxDiff = 0;
+    double bestRealtime = 0;
+    for (int k = 0; k <= static_cast<int>(AudioMixer::BestKernel()); ++k) {
+        AudioMixer mx(rate, voices, block);
+        mx.SetKernel(static_cast<MixKernel>(k));
+        auto ids = start(mx);
+        std::vector<int16_t> out(checkBlocks * block * 2);
+        for (size_t b = 0; b < checkBlocks; ++b) {
+            if (b == checkBlocks / 2)
+                for (size_t v = 0; v < ids.size(); ++v) mx.SetVoiceParams(ids[v], 0.08f, -0.5f + float(v % 3) * 0.5f);
+            mx.Render(out.data() + b * block * 2, block);
+        }
+        if (k == 0) reference = out;
+        for (size_t i = 0; i < out.size(); ++i) maxDiff = std::max(maxDiff, std::abs(out[i] - reference[i]));
+
+        // 計測（素材が尽きる前に鳴らし直し、常に 64 音声が鳴っている状態だけを測る）
+        std::vector<int16_t> buf(block * 2);
+        std::vector<double>  us;
+        us.reserve(blocks);
+        const size_t perRound = clips[0]->Frames() / block - 1;
+        double wall = 0;
+        while (us.size() < blocks) {
+            AudioMixer timed(rate, voices, block);
+            timed.SetKernel(static_cast<MixKernel>(k));
+            start(timed);
+            for (size_t b = 0; b < perRound && us.size() < blocks; ++b) {
+                auto b0 = Clock::now();
+                timed.Render(buf.data(), block);
+                us.push_back(Us(Clock::now() - b0));
+                wall += us.back() / 1e6;
+            }
+        }
+        double realtime = double(blocks * block) / rate / wall;
+        std::string name = SimdLevelName(static_cast<MixKernel>(k));
+        AddLatency(m, name + "_block_us", us);
+        m.Set(name + "_realtime_factor", JsonValue(realtime));
+        bestRealtime = realtime;
+    }
+    match = maxDiff <= 1;
+    m.Set("kernels_max_diff", JsonValue(static_cast<double>(maxDiff)));
+    m.Set("kernels_match",    JsonValue(match));
+
+    // WAV 出力（実時間に合わせず書き出す）
+    fs::path dir = fs::temp_directory_path() / "krkrvoice-bench";
+    fs::create_directories(dir);
+    fs::path wav = dir / "mix.wav";
+    bool wavOk = false;
+    {
+        auto sink = std::make_shared<WavFileAudioSink>(wav, rate);
+        AudioMixer mx(rate, voices, block);
+        mx.StartOutput(sink, false);
+        Completion done;
+        mx.Play(clips[0], MixVoiceParams{}, true, [&] { done.Signal(); });
+        bool finished = done.WaitFor(std::chrono::seconds(10));
+        mx.StopOutput();
+        std::ifstream f(wav, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        AudioClip parsed;
+        wavOk = finished && ParseWav(bytes.data(), bytes.size(), parsed) && parsed.channels == 2 &&
+                parsed.sampleRate == rate && parsed.Frames() >= clips[0]->Frames() &&
+                parsed.Frames() % block == 0;
+        m.Set("wav_frames", JsonValue(static_cast<double>(parsed.Frames())));
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    m.Set("wav_sink_ok", JsonValue(wavOk));
+    m.Set("pass",        JsonValue(match && wavOk && bestRealtime > 1.0));
+    return m;
+}
+
+// ゼロ交差の数から基本周波数を推定する（正弦波の音程確認用）
+static double ZeroCrossingHz(const AudioClip& c)
+{
+    size_t zc = 0;
+    for (size_t i = 1; i < c.samples.size(); ++i)
+        if ((c.samples[i - 1] < 0) != (c.samples[i] < 0)) ++zc;
+    return c.Seconds() > 0 ? static_cast<double>(zc) / 2.0 / c.Seconds() : 0.0;
+}
+
+// 速度変更の伸縮（1 コアあたりの実時間比、カーネル別）と、キャッシュ済み音声の速度変更
+static JsonValue BenchTimeStretch(const BenchConfig& cfg)
+{
+    const int    rate    = 24000;
+    const double seconds = cfg.quick ? 10.0 : 60.0;
+
+    // 音程の揺れる声に近い信号（基音 + 倍音 + 雑音）
+    AudioClip voice;
+    voice.sampleRate = rate;
+    voice.channels   = 1;
+    voice.samples.resize(static_cast<size_t>(seconds * rate));
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    double phase = 0;
+    for (size_t i = 0; i < voice.samples.size(); ++i) {
+        double t  = double(i) / rate;
+        double f0 = 160.0 + 40.0 * std::sin(2.0 * 3.141592653589793 * 0.7 * t);
+        phase += 2.0 * 3.141592653589793 * f0 / rate;
+        double v = std::sin(phase) + 0.5 * std::sin(2 * phase) + 0.25 * std::sin(3 * phase) + 0.05 * noise(rng);
+        voice.samples[i] = static_cast<int16_t>(6000.0 * v);
+    }
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("input_seconds", JsonValue(seconds));
+    m.Set("best_kernel",   JsonValue(SimdLevelName(DetectSimd())));
+
+    const float rates[] = { 0.5f, 0.8f, 1.25f, 2.0f };
+    bool lengthOk = true;
+    double bestRealtime = 0;
+    for (int k = 0; k <= static_cast<int>(DetectSimd()); ++k) {
+        std::string name = SimdLevelName(static_cast<SimdLevel>(k));
+        double inSec = 0, wall = 0;
+        for (float r : rates) {
+            AudioClip out;
+            auto t0 = Clock::now();
+            TimeStretch(voice, r, out, static_cast<SimdLevel>(k));
+            wall  += std::chrono::duration<double>(Clock::now() - t0).count();
+            inSec += seconds;
+            double expect = voice.Frames() / r;
+            lengthOk = lengthOk && std::fabs(double(out.Frames()) - expect) <= 1.0;
+        }
+        double realtime = inSec / wall;
+        m.Set(name + "_realtime_factor", JsonValue(realtime));
+        bestRealtime = std::max(bestRealtime, realtime);
+    }
+    m.Set("length_ok", JsonValue(lengthOk));
+
+    // 音程が保たれること（440Hz の正弦波を 0.5x / 2x にしても 440Hz のまま）
+    AudioClip tone;
+    tone.sampleRate = rate;
+    tone.channels   = 1;
+    tone.samples.resize(rate * 2);
+    for (size_t i = 0; i < tone.samples.size(); ++i)
+        tone.samples[i] = static_cast<int16_t>(8000.0 * std::sin(2.0 * 3.141592653589793 * 440.0 * double(i) / rate));
+    double worstPitch = 0;
+    for (float r : { 0.5f, 2.0f }) {
+        AudioClip out;
+        TimeStretch(tone, r, out);
+        worstPitch = std::max(worstPitch, std::fabs(ZeroCrossingHz(out) / 440.0 - 1.0));
+    }
+    m.Set("pitch_error", JsonValue(worstPitch));
+
+    // キャッシュ済みの台詞を別の速度で: 伸縮と再合成の比較
+    MockTTSOptions mo;
+    mo.baseMs = 30;
+    auto s = MakeStack(mo);
+    VoiceInfo vi;
+    s.cache->ResolveVoice(L"", L"", 0, vi);
+    std::mt19937 lr(4);
+    const size_t lines = cfg.quick ? 10 : 40;
+    std::vector<double> stretchMs, resynthMs;
+    for (size_t i = 0; i < lines; ++i) {
+        std::wstring text = SampleLine(lr, 20, 40);
+        AudioClip out;
+        s.stretch->Synthesize(vi, text, 0, out);            // 等速で合成済み（キャッシュに載る）
+        int speed = 30 + static_cast<int>(i % 60);
+        auto t0 = Clock::now();
+        s.stretch->Synthesize(vi, text, speed, out);
+        stretchMs.push_back(Ms(Clock::now() - t0));
+        t0 = Clock::now();
+        s.cache->Synthesize(vi, text, speed, out);          // 速度ごとに合成し直す従来の経路
+        resynthMs.push_back(Ms(Clock::now() - t0));
+    }
+    m.Set("speed_change_stretch_ms_p50", JsonValue(Percentile(stretchMs, 50)));
+    m.Set("speed_change_resynth_ms_p50", JsonValue(Percentile(resynthMs, 50)));
+
+    m.Set("pass", JsonValue(lengthOk && worstPitch < 0.02 && bestRealtime > 1.0));
+    return m;
+}
+
+// 声に近い試験信号：声門パルス列を 3 つの共振（フォルマント）に通した有声音、雑音の摩擦音、
+// 無音を音節ごとに並べ、全体に小さな背景雑音を足す
+static AudioClip SpeechLikeClip(std::mt19937& rng, double seconds, int rate)
+{
+    const double pi = 3.141592653589793;
+    AudioClip c;
+    c.sampleRate = rate;
+    c.channels   = 1;
+    c.samples.resize(static_cast<size_t>(seconds * rate));
+    std::uniform_real_distribution<double> u(0.0, 1.0), n(-1.0, 1.0);
+    double f0 = 120.0 + 100.0 * u(rng), phase = 0, lastNoise = 0;
+    double y1[3] = {}, y2[3] = {};
+    std::vector<double> seg;
+    for (size_t i = 0; i < c.samples.size();) {
+        const size_t len  = std::min(static_cast<size_t>((0.08 + 0.2 * u(rng)) * rate), c.samples.size() - i);
+        const double kind = u(rng);                    // 有声 65% / 摩擦 15% / 無音
+        const double F[3] = { 300 + 600 * u(rng), 900 + 1500 * u(rng), 2300 + 900 * u(rng) };
+        const double bw[3] = { 80, 120, 180 };
+        const double amp  = 3000 + 7000 * u(rng);
+        const double df0  = (u(rng) - 0.5) * 60.0 / len;   // 音節内の抑揚
+        seg.assign(len, 0.0);
+        for (size_t j = 0; j < len; ++j) {
+            if (kind < 0.65) {
+                f0     = std::clamp(f0 + df0, 90.0, 300.0);
+                phase += f0 / rate;
+                double src = phase >= 1.0 ? 1.0 : 0.0;
+                if (phase >= 1.0) phase -= 1.0;
+                src += 0.02 * n(rng);
+                for (int k = 0; k < 3; ++k) {
+                    double R = std::exp(-pi * bw[k] / rate);
+                    double y = (1 - R) * src + 2 * R * std::cos(2 * pi * F[k] / rate) * y1[k] - R * R * y2[k];
+                    y2[k] = y1[k];
+                    y1[k] = y;
+                    seg[j] += y;
+                }
+            } else if (kind < 0.8) {
+                double w = n(rng);
+                seg[j]    = w - lastNoise;                 // 高域寄りの雑音
+                lastNoise = w;
+            }
+        }
+        double peak = 1e-9;
+        for (double v : seg) peak = std::max(peak, std::fabs(v));
+        const double gain = kind < 0.8 ? (kind < 0.65 ? amp : amp * 0.25) / peak : 0.0;
+        const double ramp = 0.01 * rate;
+        for (size_t j = 0; j < len; ++j) {
+            double env = std::min({ 1.0, j / ramp, (len - j) / ramp });
+            double v   = seg[j] * gain * env + 2.0 * n(rng);
+            c.samples[i + j] = static_cast<int16_t>(std::clamp(v, -32768.0, 32767.0));
+        }
+        i += len;
+    }
+    return c;
+}
+
+// 音声 PCM の圧縮：圧縮率（可逆 / 誤差許容）、復号の実時間比（カーネル別）、
+// 途中からの復号、壊れたデータ、キャッシュのメモリ量とディスク層
+static JsonValue BenchPcmCodec(const BenchConfig& cfg)
+{
+    namespace fs = std::filesystem;
+    const int    rate  = 24000;
+    const size_t lines = cfg.quick ? 100 : 400;
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<double> len(1.5, 4.5);
+    std::vector<AudioClip> clips;
+    size_t pcmBytes = 0;
+    double audioSec = 0;
+    for (size_t i = 0; i < lines; ++i) {
+        clips.push_back(SpeechLikeClip(rng, len(rng), rate));
+        pcmBytes += clips.back().Bytes();
+        audioSec += clips.back().Seconds();
+    }
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("lines",         JsonValue(static_cast<double>(lines)));
+    m.Set("audio_seconds", JsonValue(audioSec));
+    m.Set("pcm_mb",        JsonValue(pcmBytes / 1048576.0));
+    m.Set("best_kernel",   JsonValue(SimdLevelName(DetectSimd())));
+
+    bool   exact = true, bounded = true;
+    double losslessRatio = 1, bestRealtime = 0;
+    std::vector<CompressedClip> lossless;
+    for (int tol : { 0, 2, 8 }) {
+        std::vector<CompressedClip> packed;
+        packed.reserve(lines);
+        auto t0 = Clock::now();
+        for (const auto& c : clips) packed.emplace_back(c, tol);
+        const double encSec = std::chrono::duration<double>(Clock::now() - t0).count();
+        size_t bytes = 0;
+        int    maxErr = 0;
+        for (size_t i = 0; i < lines; ++i) {
+            bytes += packed[i].Bytes();
+            AudioClip out;
+            if (!packed[i].Decode(out) || out.samples.size() != clips[i].samples.size()) {
+                exact = bounded = false;
+                continue;
+            }
+            for (size_t j = 0; j < out.samples.size(); ++j)
+                maxErr = std::max(maxErr, std::abs(out.samples[j] - clips[i].samples[j]));
+        }
+        const double ratio = double(bytes) / pcmBytes;
+        const std::string p = tol == 0 ? "lossless" : "tolerance" + std::to_string(tol);
+        m.Set(p + "_ratio",           JsonValue(ratio));
+        m.Set(p + "_bits_per_sample", JsonValue(16.0 * ratio));
+        m.Set(p + "_max_error",       JsonValue(static_cast<double>(maxErr)));
+        m.Set(p + "_encode_realtime_factor", JsonValue(audioSec / encSec));
+        if (tol == 0) {
+            exact         = exact && maxErr == 0;
+            losslessRatio = ratio;
+            lossless      = std::move(packed);
+        } else {
+            bounded = bounded && maxErr <= tol;
+        }
+    }
+
+    // 復号速度（再生バッファを使い回す）
+    std::vector<AudioClip> outs(lines);
+    const int reps = cfg.quick ? 3 : 10;
+    for (int k = 0; k <= static_cast<int>(DetectSimd()); ++k) {
+        const std::string name = SimdLevelName(static_cast<SimdLevel>(k));
+        auto t0 = Clock::now();
+        for (int r = 0; r < reps; ++r)
+            for (size_t i = 0; i < lines; ++i) lossless[i].Decode(outs[i], static_cast<SimdLevel>(k));
+        const double wall = std::chrono::duration<double>(Clock::now() - t0).count();
+        const double realtime = audioSec * reps / wall;
+        m.Set(name + "_decode_realtime_factor", JsonValue(realtime));
+        m.Set(name + "_decode_mb_per_s",        JsonValue(pcmBytes * reps / 1048576.0 / wall));
+        bestRealtime = std::max(bestRealtime, realtime);
+        for (size_t i = 0; i < lines; ++i) exact = exact && outs[i].samples == clips[i].samples;
+    }
+
+    // 途中のフレームから（ブロック境界をまたぐ）、ステレオ
+    bool rangeOk = true;
+    for (size_t i = 0; i < std::min<size_t>(lines, 20); ++i) {
+        const size_t from = clips[i].Frames() / 3 + i * 37, count = 5000;
+        std::vector<int16_t> part(count);
+        size_t got = lossless[i].Decode(from, part.data(), count);
+        size_t want = std::min(count, clips[i].Frames() - from);
+        rangeOk = rangeOk && got == want &&
+                  std::equal(part.begin(), part.begin() + want, clips[i].samples.begin() + from);
+    }
+    AudioClip stereo;
+    stereo.sampleRate = rate;
+    stereo.channels   = 2;
+    const size_t sf = std::min(clips[0].Frames(), clips[1].Frames());
+    for (size_t f = 0; f < sf; ++f) {
+        stereo.samples.push_back(clips[0].samples[f]);
+        stereo.samples.push_back(clips[1].samples[f]);
+    }
+    AudioClip stereoOut;
+    CompressedClip stereoPacked(stereo);
+    rangeOk = rangeOk && stereoPacked.Decode(stereoOut) && stereoOut.samples == stereo.samples;
+    m.Set("range_decode_ok", JsonValue(rangeOk));
+
+    // 壊れたデータ：ビット反転・切り詰めでも範囲外を読まない（検証で弾くか、ゴミを返すだけ）
+    size_t rejected = 0;
+    std::mt19937 flip(5);
+    for (int t = 0; t < 200; ++t) {
+        std::vector<uint8_t> bad = lossless[t % lines].Data();
+        if (t % 4 == 0) bad.resize(flip() % bad.size());
+        else for (int b = 0; b < 4; ++b) bad[flip() % bad.size()] ^= static_cast<uint8_t>(1u << (flip() % 8));
+        CompressedClip c;
+        AudioClip out;
+        if (!c.Assign(bad.data(), bad.size()) || !c.Decode(out)) ++rejected;
+    }
+    m.Set("corrupt_rejected", JsonValue(static_cast<double>(rejected)));
+
+    // 擬似エンジンの出力（正弦波を並べたもの）
+    {
+        MockTTSService mock(MockTTSOptions{});
+        VoiceInfo vi;
+        mock.ResolveVoice(L"", L"", 0, vi);
+        AudioClip c;
+        mock.Synthesize(vi, L"こんにちは、今日はいい天気ですね。", 0, c);
+        m.Set("mock_lossless_ratio", JsonValue(double(CompressedClip(c).Bytes()) / c.Bytes()));
+    }
+
+    // キャッシュ：メモリ層の量と、ヒット時の復号込みの取り出し時間
+    AudioCache cache(size_t(1) << 30);
+    for (size_t i = 0; i < lines; ++i)
+        cache.Put("line" + std::to_string(i), std::make_shared<const AudioClip>(clips[i]));
+    std::vector<double> getUs;
+    bool cacheOk = true;
+    for (size_t i = 0; i < lines; ++i) {
+        auto t0  = Clock::now();
+        auto hit = cache.Get("line" + std::to_string(i));
+        getUs.push_back(Us(Clock::now() - t0));
+        cacheOk = cacheOk && hit && hit->samples == clips[i].samples;
+    }
+    auto st = cache.Stats();
+    cacheOk = cacheOk && st.memoryPcmBytes == pcmBytes && st.memoryBytes < pcmBytes;
+    m.Set("cache_memory_mb",     JsonValue(st.memoryBytes / 1048576.0));
+    m.Set("cache_memory_pcm_mb", JsonValue(st.memoryPcmBytes / 1048576.0));
+    m.Set("cache_get_us_p50",    JsonValue(Percentile(getUs, 50)));
+    m.Set("cache_get_us_p99",    JsonValue(Percentile(getUs, 99)));
+
+    // ディスク層：書いて、別のキャッシュから読み戻す
+    const fs::path dir = fs::temp_directory_path() / "krkrvoice-bench" / "codec-cache";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    {
+        AudioCache w(0);
+        w.SetDiskStore(dir, uint64_t(1) << 30);
+        for (size_t i = 0; i < 20; ++i) w.Put("line" + std::to_string(i), std::make_shared<const AudioClip>(clips[i]));
+    }
+    AudioCache r;
+    r.SetDiskStore(dir, uint64_t(1) << 30);
+    size_t diskPcm = 0;
+    for (size_t i = 0; i < 20; ++i) {
+        auto hit = r.Get("line" + std::to_string(i));
+        cacheOk  = cacheOk && hit && hit->samples == clips[i].samples;
+        diskPcm += clips[i].Bytes();
+    }
+    m.Set("disk_ratio", JsonValue(double(r.Stats().diskBytes) / diskPcm));
+    cacheOk = cacheOk && r.Stats().diskHits == 20;
+    fs::remove_all(dir, ec);
+    m.Set("cache_ok", JsonValue(cacheOk));
+
+    m.Set("lossless_exact",    JsonValue(exact));
+    m.Set("tolerance_bounded", JsonValue(bounded));
+    m.Set("pass", JsonValue(exact && bounded && rangeOk && cacheOk && losslessRatio < 0.75 && bestRealtime > 1000));
+    return m;
+}
+
+// 現在の常駐メモリ（バイト。取れない環境では 0）
+static size_t ResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream f("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (f >> pages >> resident) return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+// 合成側（擬似）から再生側へ PcmStream で流す。再生側は実時間の speedup 倍で読む
+//  producerPace > 0 なら生産側も実時間の producerPace 倍に抑える（データ切れを起こす用）
+struct RingRun {
+    double         wallSec   = 0;
+    size_t         rssGrowth = 0;   // 開始前からの常駐メモリの増分の最大
+    bool           intact    = true;
+    PcmStreamStats st;
+};
+
+static RingRun RunRing(int rate, double seconds, size_t capacityFrames, double speedup, double producerPace)
+{
+    const size_t total = static_cast<size_t>(rate * seconds);
+    auto sample = [](size_t i) { return static_cast<int16_t>((i * 2654435761u) >> 13); };
+
+    RingRun r;
+    const size_t base = ResidentBytes();
+    std::atomic<bool>   done{false};
+    std::atomic<size_t> peak{base};
+    std::thread sampler([&] {
+        while (!done) {
+            peak = std::max<size_t>(peak, ResidentBytes());
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    auto stream = std::make_shared<PcmStream>(rate, 1, capacityFrames);
+    const auto t0 = Clock::now();
+    std::thread producer([&] {
+        // 0.4〜3 秒の文を合成しては書く
+        std::mt19937 rng(24);
+        std::uniform_real_distribution<double> len(0.4, 3.0);
+        std::vector<int16_t> chunk;
+        for (size_t pos = 0; pos < total;) {
+            const size_t n = std::min(total - pos, static_cast<size_t>(rate * len(rng)));
+            chunk.resize(n);
+            for (size_t i = 0; i < n; ++i) chunk[i] = sample(pos + i);
+            pos += n;
+            if (producerPace > 0)
+                std::this_thread::sleep_until(t0 + std::chrono::microseconds(
+                    static_cast<int64_t>(pos * 1e6 / rate / producerPace)));
+            stream->Append(chunk.data(), n);
+        }
+        stream->Close();
+    });
+
+    // 20ms ずつ読む
+    std::vector<int16_t> buf(static_cast<size_t>(rate) / 50);
+    size_t got = 0;
+    while (!stream->Finished()) {
+        const size_t n = stream->Read(buf.data(), buf.size(), std::chrono::milliseconds(50));
+        for (size_t i = 0; i < n; ++i) r.intact = r.intact && buf[i] == sample(got + i);
+        got += n;
+        std::this_thread::sleep_until(t0 + std::chrono::microseconds(
+            static_cast<int64_t>(got * 1e6 / rate / speedup)));
+    }
+    producer.join();
+    r.wallSec = std::chrono::duration<double>(Clock::now() - t0).count();
+    r.st      = stream->Stats();
+    r.intact  = r.intact && got == total;
+    stream.reset();
+    done = true;
+    sampler.join();
+    r.rssGrowth = base ? peak - base : 0;
+    return r;
+}
+
+// 長文の逐次再生：30 分のストリームを固定長のリングで流したときのメモリ・生産側の待ち・データ切れ
+static JsonValue BenchStreamingRing(const BenchConfig& cfg)
+{
+    const int    rate    = 24000;
+    const double minutes = 30;
+    const double speedup = cfg.quick ? 300 : 120;
+
+    JsonValue m = JsonValue::MakeObject();
+    m.Set("stream_minutes", JsonValue(minutes));
+    m.Set("stream_mb",      JsonValue(rate * minutes * 60 * sizeof(int16_t) / 1048576.0));
+    m.Set("rss_available",  JsonValue(ResidentBytes() != 0));
+
+    // 既定の容量（2 秒）のリング
+    auto ring = RunRing(rate, minutes * 60, 0, speedup, 0);
+    const double capacity = static_cast<double>(ring.st.capacity);
+    m.Set("ring_capacity_ms",       JsonValue(capacity * 1000 / rate));
+    m.Set("ring_wall_s",            JsonValue(ring.wallSec));
+    m.Set("ring_rss_growth_mb",     JsonValue(ring.rssGrowth / 1048576.0));
+    m.Set("ring_peak_fill_ms",      JsonValue(ring.st.peakFill * 1000.0 / rate));
+    m.Set("ring_producer_waits",    JsonValue(static_cast<double>(ring.st.producerWaits)));
+    m.Set("ring_producer_wait_s",   JsonValue(ring.st.producerWaitMs / 1000));
+    m.Set("ring_underruns",         JsonValue(static_cast<double>(ring.st.underruns)));
+    m.Set("ring_intact",            JsonValue(ring.intact));
+
+    // 比較：全体が収まる容量（従来の際限なく溜める動作に相当）
+    auto whole = RunRing(rate, minutes * 60, static_cast<size_t>(rate * minutes * 60), speedup, 0);
+    m.Set("unbounded_rss_growth_mb", JsonValue(whole.rssGrowth / 1048576.0));
+    m.Set("unbounded_peak_fill_mb",  JsonValue(whole.st.peakFill * sizeof(int16_t) / 1048576.0));
+
+    // 合成が再生より遅いとき：文ごとに途切れ、途切れの回数として数える
+    auto slow = RunRing(rate, 20, 0, 40, 20);
+    m.Set("starved_underruns", JsonValue(static_cast<double>(slow.st.underruns)));
+    m.Set("starved_intact",    JsonValue(slow.intact));
+
+    // 実際の経路：先頭の片がリングより長くても詰まらずに最後まで流れる
+    bool pipelineOk = true;
+    {
+        MockTTSOptions mo;
+        mo.baseMs    = 0;
+        mo.perCharMs = 0;
+        auto mock      = std::make_shared<MockTTSService>(mo);
+        auto streaming = std::make_shared<StreamingTTSService>(mock);
+        streaming->SetBufferMs(100);
+        VoiceInfo vi;
+        streaming->ResolveVoice(L"", L"", 0, vi);
+        std::mt19937 rng(24);
+        std::wstring text;
+        for (int i = 0; i < (cfg.quick ? 60 : 240); ++i) text += SampleLine(rng, 20, 60);
+        const auto before = GetPcmStreamStats();
+        const size_t base = ResidentBytes();
+        auto t0 = Clock::now();
+        pipelineOk = streaming->SpeakText(vi, text, 0, true, false);
+        const auto after = GetPcmStreamStats();
+        const double audio = double(after.read - before.read) / rate;
+        pipelineOk = pipelineOk && after.written - before.written == after.read - before.read && audio > 60;
+        m.Set("pipeline_audio_s",       JsonValue(audio));
+        m.Set("pipeline_wall_ms",       JsonValue(Ms(Clock::now() - t0)));
+        m.Set("pipeline_rss_growth_mb", JsonValue(base ? (double(ResidentBytes()) - base) / 1048576.0 : 0.0));
+        m.Set("pipeline_ok",            JsonValue(pipelineOk));
+    }
+
+    // 継ぎ足しのスレッドを残す数を超えて長文を重ねても、どの行も先頭の片の合成だけで鳴り始める
+    //  再生は実時間で読む（継ぎ足しのスレッドは各行の再生が終わるまで手が空かない）。
+    //  破棄すると合流して全て完了し、手の空いたスレッドは残す数まで減る
+    bool producersOk = true;
+    {
+        struct Heard {
+            std::mutex mtx;
+            std::vector<Clock::time_point> started, firstAudio;   // 再生を頼まれた順
+        };
+        struct PacedPlayback final : ForwardingTTSService {
+            using ForwardingTTSService::ForwardingTTSService;
+            bool PlayStream(std::shared_ptr<PcmStream> stream, bool, bool, std::function<void()> onFinish) override
+            {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> lk(heard->mtx);
+                    i = heard->started.size();
+                    heard->started.push_back(Clock::now());
+                    heard->firstAudio.emplace_back();
+                }
+                std::thread([h = heard, i, stream, onFinish] {
+                    std::vector<int16_t> tmp(static_cast<size_t>(stream->SampleRate() / 100) * stream->Channels());
+                    bool first = true;
+                    while (!stream->Finished()) {
+                        if (stream->Read(tmp.data(), tmp.size(), std::chrono::milliseconds(50)) && first) {
+                            std::lock_guard<std::mutex> lk(h->mtx);
+                            h->firstAudio[i] = Clock::now();
+                            first = false;
+                        }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                    if (onFinish) onFinish();
+                }).detach();
+                return true;
+            }
+            std::shared_ptr<Heard> heard = std::make_shared<Heard>();
+        };
+        MockTTSOptions mo;
+        mo.baseMs    = 0;
+        mo.perCharMs = 0;
+        auto paced     = std::make_shared<PacedPlayback>(std::make_shared<MockTTSService>(mo));
+        auto streaming = std::make_shared<StreamingTTSService>(paced);
+        streaming->SetBufferMs(100);
+        VoiceInfo vi;
+        streaming->ResolveVoice(L"", L"", 0, vi);
+        std::mt19937 rng(124);
+        const size_t lines = StreamingTTSService::kIdleProducers + 4;
+        std::atomic<size_t> finished{ 0 };
+        Completion all;
+        for (size_t i = 0; i < lines; ++i) {
+            std::wstring text;
+            for (int k = 0; k < 20; ++k) text += SampleLine(rng, 20, 60);
+            streaming->SpeakText(vi, text, 0, false, true, [&] { if (++finished == lines) all.Signal(); });
+        }
+        // 全行が鳴り始めるまで待つ（鳴らない行があれば打ち切る）
+        std::vector<double> ttfa;
+        for (auto t0 = Clock::now(); Clock::now() - t0 < std::chrono::seconds(5);) {
+            ttfa.clear();
+            {
+                auto& h = *paced->heard;
+                std::lock_guard<std::mutex> lk(h.mtx);
+                for (size_t i = 0; i < h.firstAudio.size(); ++i)
+                    if (h.firstAudio[i] != Clock::time_point{}) ttfa.push_back(Ms(h.firstAudio[i] - h.started[i]));
+            }
+            if (ttfa.size() == lines) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        const size_t threads = streaming->ProducerThreads();
+        auto t0 = Clock::now();
+        streaming.reset();
+        const double joinMs = Ms(Clock::now() - t0);
+        const double worst = ttfa.empty() ? 0.0 : *std::max_element(ttfa.begin(), ttfa.end());
+        producersOk = ttfa.size() == lines && worst < 200 &&
+                      all.WaitFor(std::chrono::seconds(10)) && finished == lines;
+        m.Set("fanout_lines",             JsonValue(static_cast<double>(lines)));
+        m.Set("fanout_first_audio_lines", JsonValue(static_cast<double>(ttfa.size())));
+        m.Set("fanout_first_audio_ms_max", JsonValue(worst));
+        m.Set("fanout_producer_threads",  JsonValue(static_cast<double>(threads)));
+        m.Set("fanout_join_ms",           JsonValue(joinMs));
+        m.Set("fanout_all_finished",      JsonValue(producersOk));
+    }
+
+    // 加速して読むので、生産側の起床が数 ms 遅れるとそれだけで尽きる。稀な途切れは許す
+    const bool bounded = ring.rssGrowth == 0 || ring.rssGrowth < (size_t(16) << 20);
+    m.Set("pass", JsonValue(ring.intact && whole.intact && slow.intact && pipelineOk && producersOk && bounded &&
+                            ring.st.peakFill <= ring.st.capacity && ring.st.producerWaits > 0 &&
+                            ring.st.underruns <= 2 && slow.st.underruns >= 5));
+    return m;
+}
+
+// メモリ予算：手放す順（先読み → キャッシュ → 待機中の合成器）と、負荷をかけ続けても予算を超えないこと
+static JsonValue BenchMemoryBudget(const BenchConfig& cfg)
+{
+    auto& gov = MemoryGovernor::Instance();
+    gov.SetBudget(0);
+    auto cls = [&](MemoryClass c) { return gov.Stats().classes[static_cast<size_t>(c)]; };
+    JsonValue m = JsonValue::MakeObject();
+
+    // --- 手放す順 ---
+    bool order = true;
+    {
+        MockTTSOptions mo;
+        mo.baseMs    = 0;
+        mo.perCharMs = 0;
+        MockTTSService mock(mo);
+        VoiceInfo vi;
+        mock.ResolveVoice(L"", L"", 0, vi);
+        mock.Synthesizers()->SetInstanceBytes(1u << 20);
+        mock.Synthesizers()->Warm(vi, 3);
+
+        std::mt19937 rng(25);
+        AudioCache    cache(size_t(1) << 30);
+        PrefetchStore store(size_t(1) << 30, std::chrono::minutes(10));
+        auto park = [&](const std::string& key) {
+            CancelToken c;
+            auto id = store.Reserve(key, c);
+            store.Start(key, id);
+            store.Complete(key, id, std::make_shared<const AudioClip>(SpeechLikeClip(rng, 3.0, 24000)));
+        };
+        for (int i = 0; i < 20; ++i) {
+            cache.Put("c" + std::to_string(i), std::make_shared<const AudioClip>(SpeechLikeClip(rng, 3.0, 24000)));
+            park("p" + std::to_string(i));
+        }
+
+        const auto filled = gov.Stats();
+        const auto pf0 = cls(MemoryClass::Prefetch), ca0 = cls(MemoryClass::Cache), en0 = cls(MemoryClass::Engines);
+        m.Set("order_prefetch_mb", JsonValue(pf0.bytes / 1048576.0));
+        m.Set("order_cache_mb",    JsonValue(ca0.bytes / 1048576.0));
+        m.Set("order_engines_mb",  JsonValue(en0.bytes / 1048576.0));
+        gov.SetBudget(static_cast<size_t>(filled.bytes));   // ちょうど満杯
+        gov.ResetPeaks();
+
+        // 再生側が先読みの半分を要求 → 先読みだけが減る
+        MemoryAccount play(MemoryClass::Playback);
+        play.Reserve(static_cast<size_t>(pf0.bytes / 2), true);
+        order = order && cls(MemoryClass::Prefetch).reclaimedBytes > pf0.reclaimedBytes &&
+                cls(MemoryClass::Cache).reclaimedBytes == ca0.reclaimedBytes &&
+                cls(MemoryClass::Engines).reclaimedBytes == en0.reclaimedBytes;
+        // 先読みの残りとキャッシュの半分 → 先読みが空になってからキャッシュ
+        play.Reserve(static_cast<size_t>(cls(MemoryClass::Prefetch).bytes + ca0.bytes / 2), true);
+        order = order && cls(MemoryClass::Prefetch).bytes == 0 &&
+                cls(MemoryClass::Cache).reclaimedBytes > ca0.reclaimedBytes &&
+                cls(MemoryClass::Engines).reclaimedBytes == en0.reclaimedBytes;
+        // キャッシュへの追加はキャッシュの古いものと入れ替わり、合成器には手を出さない
+        cache.Put("new", std::make_shared<const AudioClip>(SpeechLikeClip(rng, 3.0, 24000)));
+        order = order && cache.Get("new") && cls(MemoryClass::Engines).reclaimedBytes == en0.reclaimedBytes;
+        // キャッシュの残り + 1MB → 合成器
+        play.Reserve(static_cast<size_t>(cls(MemoryClass::Cache).bytes) + (1u << 20), true);
+        order = order && cls(MemoryClass::Cache).bytes == 0 &&
+                cls(MemoryClass::Engines).reclaimedBytes > en0.reclaimedBytes;
+        // 先読みは他の種類から奪えない → 置かずに捨てる（手放した端数の空きは再生側で埋めておく）
+        play.Reserve(static_cast<size_t>(gov.Stats().budget - gov.Stats().bytes), true);
+        const auto evicted = store.Stats().evicted;
+        park("late");
+        order = order && store.Stats().evicted == evicted + 1 && cls(MemoryClass::Prefetch).denied > pf0.denied;
+
+        const auto st = gov.Stats();
+        order = order && st.peakBytes <= st.budget && st.overBudget == filled.overBudget;
+        m.Set("order_engine_idle_after", JsonValue(static_cast<double>(mock.Synthesizers()->Stats().idle)));
+        gov.SetBudget(0);
+    }
+    m.Set("eviction_order_ok", JsonValue(order));
+
+    // --- 負荷をかけ続ける：発話・先読み・キャッシュが予算を取り合う ---
+    const size_t budget = size_t(12) << 20;
+    MockTTSOptions mo;
+    mo.baseMs    = 1;
+    mo.perCharMs = 0.05;
+    mo.initMs    = 2;
+    auto s = MakeStack(mo);
+    s.mock->Synthesizers()->SetInstanceBytes(512u << 10);
+    s.cache->Cache().SetMemoryBudget(size_t(256) << 20);   // 部品ごとの上限は効かせず、全体の予算だけで抑える
+    s.prefetch->Store().SetLimits(size_t(256) << 20, std::chrono::minutes(10));
+    std::vector<VoiceInfo> voices(4);
+    for (size_t i = 0; i < voices.size(); ++i) s.sched->ResolveVoice(L"", L"", i, voices[i]);
+    std::mt19937 lineRng(26);
+    std::vector<std::wstring> lines;
+    for (int i = 0; i < 400; ++i) lines.push_back(SampleLine(lineRng, 20, 80));
+
+    const auto before = gov.Stats();
+    gov.SetBudget(budget);
+    gov.ResetPeaks();
+
+    std::atomic<bool>     stop{false};
+    std::atomic<size_t>   spoken{0};
+    std::atomic<uint64_t> sampledPeak{0};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < 3; ++t)
+        ts.emplace_back([&, t] {
+            std::mt19937 rng(100 + t);
+            while (!stop) {
+                const auto& vi = voices[rng() % voices.size()];
+                s.sched->SpeakText(vi, lines[rng() % lines.size()], 0, true, true);
+                ++spoken;
+            }
+        });
+    ts.emplace_back([&] {
+        std::mt19937 rng(200);
+        while (!stop) {
+            s.prefetch->Prefetch(voices[rng() % voices.size()], lines[rng() % lines.size()], 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+    ts.emplace_back([&] {
+        while (!stop) {
+            sampledPeak = std::max<uint64_t>(sampledPeak, gov.Stats().bytes);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(cfg.quick ? 4 : 15));
+    stop = true;
+    for (auto& t : ts) t.join();
+    s.sched->CancelAll();
+
+    const auto st = gov.Stats();
+    const auto& pf = st.classes[static_cast<size_t>(MemoryClass::Prefetch)];
+    const auto& ca = st.classes[static_cast<size_t>(MemoryClass::Cache)];
+    const auto& en = st.classes[static_cast<size_t>(MemoryClass::Engines)];
+    const auto& pb = st.classes[static_cast<size_t>(MemoryClass::Playback)];
+    m.Set("soak_budget_mb",         JsonValue(budget / 1048576.0));
+    m.Set("soak_lines_spoken",      JsonValue(static_cast<double>(spoken)));
+    m.Set("soak_peak_mb",           JsonValue(st.peakBytes / 1048576.0));
+    m.Set("soak_sampled_peak_mb",   JsonValue(sampledPeak / 1048576.0));
+    m.Set("soak_prefetch_peak_mb",  JsonValue(pf.peakBytes / 1048576.0));
+    m.Set("soak_cache_peak_mb",     JsonValue(ca.peakBytes / 1048576.0));
+    m.Set("soak_engines_peak_mb",   JsonValue(en.peakBytes / 1048576.0));
+    m.Set("soak_playback_peak_mb",  JsonValue(pb.peakBytes / 1048576.0));
+    m.Set("soak_prefetch_reclaimed_mb", JsonValue((pf.reclaimedBytes - before.classes[0].reclaimedBytes) / 1048576.0));
+    m.Set("soak_cache_reclaimed_mb",    JsonValue((ca.reclaimedBytes - before.classes[1].reclaimedBytes) / 1048576.0));
+    m.Set("soak_reclaims",          JsonValue(static_cast<double>(st.reclaims - before.reclaims)));
+    m.Set("soak_denied",            JsonValue(static_cast<double>(st.denied - before.denied)));
+    m.Set("soak_over_budget",       JsonValue(static_cast<double>(st.overBudget - before.overBudget)));
+    m.Set("prefetch_hits",          JsonValue(static_cast<double>(s.prefetch->Store().Stats().hits)));
+    m.Set("cache_hits",             JsonValue(static_cast<double>(s.cache->Cache().Stats().hits)));
+    gov.SetBudget(0);
+
+    const bool soak = st.peakBytes <= budget && sampledPeak <= budget && st.overBudget == before.overBudget &&
+                      ca.reclaimedBytes > before.classes[1].reclaimedBytes && spoken > 100;
+    m.Set("pass", JsonValue(order && soak));
+    return m;
+}
+
+// 合成器プール：初回の初期化待ち（冷えた状態 / Warm 済み）、同じ音声の重ね合成、
+// メモリ不足時の手放し、期限切れの破棄
+static JsonValue BenchSynthPool(const BenchConfig& cfg)
+{
+    MockTTSOptions mo;
+    mo.initMs    = 40;
+    mo.baseMs    = 10;
+    mo.perCharMs = 0;
+    const size_t threads = 8;
+    const std::wstring text = L"こんにちは";
+    JsonValue m = JsonValue::MakeObject();
+
+    // 初回の 1 行（冷えた状態）と、Warm 済みの 1 行
+    std::vector<double> coldMs, warmMs;
+    for (size_t r = 0; r < (cfg.quick ? 3u : 10u); ++r) {
+        MockTTSService svc(mo);
+        VoiceInfo vi;
+        svc.ResolveVoice(L"", L"", 0, vi);
+        AudioClip out;
+        auto t0 = Clock::now();
+        svc.Synthesize(vi, text, 0, out);
+        coldMs.push_back(Ms(Clock::now() - t0));
+
+        MockTTSService warm(mo);
+        warm.ResolveVoice(L"", L"", 0, vi);
+        warm.Synthesizers()->Warm(vi, 1);
+        t0 = Clock::now();
+        warm.Synthesize(vi, text, 0, out);
+        warmMs.push_back(Ms(Clock::now() - t0));
+    }
+    m.Set("first_line_cold_ms", JsonValue(Percentile(coldMs, 50)));
+    m.Set("first_line_warm_ms", JsonValue(Percentile(warmMs, 50)));
+
+    // 同じ音声で threads 本同時に合成：それぞれ別の合成器を受け取り、直列にならない
+    MockTTSService svc(mo);
+    auto* pool = svc.Synthesizers();
+    VoiceInfo vi;
+    svc.ResolveVoice(L"", L"", 0, vi);
+    pool->Warm(vi, threads);
+    std::vector<std::thread> ts;
+    std::atomic<size_t> ok{ 0 };
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < threads; ++i)
+        ts.emplace_back([&] {
+            AudioClip out;
+            ok += svc.Synthesize(vi, text, 0, out);
+        });
+    for (auto& t : ts) t.join();
+    const double overlapMs = Ms(Clock::now() - t0);
+    auto st = pool->Stats();
+    m.Set("overlap_threads",   JsonValue(static_cast<double>(threads)));
+    m.Set("overlap_wall_ms",   JsonValue(overlapMs));
+    m.Set("overlap_serial_ms", JsonValue(mo.baseMs * threads));
+    m.Set("peak_in_use",       JsonValue(static_cast<double>(st.peakInUse)));
+    m.Set("reused",            JsonValue(static_cast<double>(st.reused)));
+    const bool parallel = ok == threads && st.peakInUse >= threads && st.created == threads &&
+                          overlapMs < mo.baseMs * threads / 2;
+
+    // 返却時は音声あたり上限（既定 4）まで待機させ、メモリ不足中の返却では待機分も手放す
+    const size_t idleBefore = static_cast<size_t>(pool->Stats().idle);
+    std::atomic_bool pressure{ true };
+    pool->SetPressureProbe([&] { return pressure.load(); });
+    {
+        AudioClip out;
+        svc.Synthesize(vi, text, 0, out);
+    }
+    const size_t idleUnderPressure = static_cast<size_t>(pool->Stats().idle);
+    pressure = false;
+
+    // 期限切れ
+    pool->Warm(vi, 3);
+    pool->SetLimits(4, std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const size_t expired = pool->Trim(false);
+    st = pool->Stats();
+    m.Set("idle_before_pressure", JsonValue(static_cast<double>(idleBefore)));
+    m.Set("idle_under_pressure",  JsonValue(static_cast<double>(idleUnderPressure)));
+    m.Set("expired_trimmed",      JsonValue(static_cast<double>(expired)));
+    m.Set("created",              JsonValue(static_cast<double>(st.created)));
+    m.Set("trimmed",              JsonValue(static_cast<double>(st.trimmed)));
+
+    // 取得で待機列が空になった音声があっても、予算からの回収は残りの音声の待機分を手放す
+    bool reclaimOk;
+    {
+        auto& gov = MemoryGovernor::Instance();
+        MockTTSService two(mo);
+        auto* p2 = two.Synthesizers();
+        p2->SetInstanceBytes(1000);
+        VoiceInfo va, vb;
+        two.ResolveVoice(L"", L"", 0, va);
+        two.ResolveVoice(L"", L"", 1, vb);
+        p2->Warm(va, 1);
+        p2->Warm(vb, 1);
+        auto held = p2->Acquire(va);                 // va の待機列はここで空になる
+        gov.SetBudget(gov.Stats().bytes + 500);
+        const bool fits = gov.Reserve(MemoryClass::Playback, 1500, true);
+        auto s2 = p2->Stats();
+        m.Set("reclaim_after_acquire_idle", JsonValue(static_cast<double>(s2.idle)));
+        reclaimOk = fits && va.handle != vb.handle && s2.idle == 0 && s2.inUse == 1 && s2.trimmed == 1;
+        gov.Release(MemoryClass::Playback, 1500);
+        gov.SetBudget(0);
+    }
+
+    m.Set("pass", JsonValue(parallel && Percentile(warmMs, 50) + mo.initMs / 2 < Percentile(coldMs, 50) &&
+                            idleBefore == 4 && idleUnderPressure == 0 &&
+                            expired == 3 && st.idle == 0 && st.inUse == 0 && reclaimOk));
+    return m;
+}
+
+// VOICEVOX：audio_query キャッシュと一括合成。ローカルの代替エンジンでリクエスト数を数える
+static JsonValue BenchVoiceVox(const BenchConfig& cfg)
+{
+    namespace fs = std::filesystem;
+    JsonValue m = JsonValue::MakeObject();
+    StandInOptions so;
+    VoxStandIn engine(so);
+    if (!engine.Ok()) {
+        m.Set("skipped", JsonValue("cannot listen on loopback"));
+        return m;
+    }
+    const size_t lines = cfg.quick ? 8 : 32;
+    std::mt19937 rng(20);
+    auto fresh = [&](size_t n) {
+        std::vector<std::wstring> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(SampleLine(rng, 10, 30));
+        return v;
+    };
+
+    // 1. 初回合成と、速度・音高だけ変えた再合成（audio_query を送り直さない）
+    auto vox = std::make_shared<VoiceVoxService>(L"http://127.0.0.1", engine.Port());
+    VoiceInfo vi;
+    if (!vox->ResolveVoice(L"", L"", 0, vi)) {
+        m.Set("pass", JsonValue(false));
+        return m;
+    }
+    auto texts = fresh(lines);
+    std::vector<double> firstMs, speedMs, prosodyMs;
+    bool lengthOk = true;
+    for (const auto& t : texts) {
+        AudioClip a, b;
+        auto t0 = Clock::now();
+        vox->Synthesize(vi, t, 0, a);
+        firstMs.push_back(Ms(Clock::now() - t0));
+        t0 = Clock::now();
+        vox->Synthesize(vi, t, 100, b);
+        speedMs.push_back(Ms(Clock::now() - t0));
+        lengthOk = lengthOk && b.Frames() > 0 && std::fabs(double(a.Frames()) / double(b.Frames()) - 2.0) < 0.05;
+    }
+    VoxProsody pr;
+    pr.pitchScale = 0.1;
+    vox->SetProsody(pr);
+    for (const auto& t : texts) {
+        AudioClip c;
+        auto t0 = Clock::now();
+        vox->Synthesize(vi, t, 0, c);
+        prosodyMs.push_back(Ms(Clock::now() - t0));
+    }
+    vox->SetProsody(VoxProsody{});
+    auto c1 = engine.Counts();
+    auto vs = vox->GetStats();
+    m.Set("first_line_ms_p50",      JsonValue(Percentile(firstMs, 50)));
+    m.Set("speed_change_ms_p50",    JsonValue(Percentile(speedMs, 50)));
+    m.Set("prosody_change_ms_p50",  JsonValue(Percentile(prosodyMs, 50)));
+    m.Set("engine_queries",         JsonValue(static_cast<double>(c1.queries)));
+    m.Set("engine_syntheses",       JsonValue(static_cast<double>(c1.syntheses)));
+    m.Set("query_cache_hits",       JsonValue(static_cast<double>(vs.queryHits)));
+    const bool cacheOk = c1.queries == lines && c1.syntheses == 3 * lines && lengthOk;
+
+    // 2. 一括合成：行ごとの Synthesize と SynthesizeBatch（multi_synthesis 1 回）
+    engine.ResetCounts();
+    auto single = fresh(lines);
+    auto t0 = Clock::now();
+    for (const auto& t : single) {
+        AudioClip a;
+        vox->Synthesize(vi, t, 0, a);
+    }
+    const double singleMs = Ms(Clock::now() - t0);
+    const auto singleReq = engine.Counts().requests;
+
+    engine.ResetCounts();
+    auto batched = fresh(lines);
+    std::vector<std::shared_ptr<const AudioClip>> clips;
+    t0 = Clock::now();
+    vox->SynthesizeBatch(vi, batched, 0, clips);
+    const double batchMs = Ms(Clock::now() - t0);
+    auto c2 = engine.Counts();
+    size_t got = 0;
+    for (const auto& c : clips) got += c && c->Frames() > 0;
+    m.Set("lines",                JsonValue(static_cast<double>(lines)));
+    m.Set("per_line_ms",          JsonValue(singleMs));
+    m.Set("per_line_requests",    JsonValue(static_cast<double>(singleReq)));
+    m.Set("batch_ms",             JsonValue(batchMs));
+    m.Set("batch_requests",       JsonValue(static_cast<double>(c2.requests)));
+    m.Set("batch_multi_requests", JsonValue(static_cast<double>(c2.multiSyntheses)));
+    const bool batchOk = got == lines && c2.multiSyntheses == 1 && c2.syntheses == 0 && c2.queries == lines;
+
+    // 3. multi_synthesis のない古いエンジンでは synthesis を個別に送る
+    bool fallbackOk = false;
+    {
+        StandInOptions old = so;
+        old.multi = false;
+        VoxStandIn oldEngine(old);
+        VoiceVoxService ov(L"http://127.0.0.1", oldEngine.Port());
+        VoiceInfo ovi;
+        if (ov.ResolveVoice(L"", L"", 0, ovi)) {
+            std::vector<std::shared_ptr<const AudioClip>> oc;
+            ov.SynthesizeBatch(ovi, fresh(4), 0, oc);
+            ov.SynthesizeBatch(ovi, fresh(4), 0, oc);
+            size_t ok = 0;
+            for (const auto& c : oc) ok += c != nullptr;
+            auto oc2 = oldEngine.Counts();
+            fallbackOk = ok == 4 && oc2.syntheses == 8 && oc2.multiSyntheses == 0;
+        }
+    }
+    m.Set("fallback_ok", JsonValue(fallbackOk));
+
+    // 4. 先読み：溜まった同じ音声の行はまとめて multi_synthesis に載る
+    engine.ResetCounts();
+    auto cache    = std::make_shared<CachedTTSService>(vox);
+    auto stretch  = std::make_shared<TimeStretchTTSService>(cache);
+    auto prefetch = std::make_shared<PrefetchTTSService>(std::make_shared<StreamingTTSService>(stretch));
+    auto sched    = std::make_shared<ScheduledTTSService>(prefetch);
+    std::weak_ptr<ScheduledTTSService> weak = sched;
+    prefetch->SetSubmitter([weak](SynthScheduler::Task run, std::function<void()> dropped) {
+        if (auto p = weak.lock()) p->Submit(SynthPriority::Prefetch, std::move(run), std::move(dropped));
+        else if (dropped)         dropped();
+    });
+    auto ahead = fresh(lines * 2);
+    for (const auto& t : ahead) prefetch->Prefetch(vi, t, 0);
+    size_t hits = 0;
+    for (const auto& t : ahead) {
+        AudioClip a;
+        hits += prefetch->Synthesize(vi, t, 0, a) && a.Frames() > 0;
+    }
+    auto c3 = engine.Counts();
+    m.Set("prefetch_lines",         JsonValue(static_cast<double>(ahead.size())));
+    m.Set("prefetch_multi_requests", JsonValue(static_cast<double>(c3.multiSyntheses)));
+    m.Set("prefetch_multi_lines",   JsonValue(static_cast<double>(c3.multiLines)));
+    m.Set("prefetch_syntheses",     JsonValue(static_cast<double>(c3.syntheses)));
+    const bool prefetchOk = hits == ahead.size() && c3.multiLines > 0 &&
+                            c3.multiLines + c3.syntheses == ahead.size();
+
+    // 抑揚を変えたら、同じ行でもキャッシュ・先読みの前の音声を使わずに合成し直す
+    //  （戻せば前の音声がまたヒットする）
+    auto made = [&] { auto c = engine.Counts(); return c.syntheses + c.multiLines; };
+    auto speak = [&](const std::wstring& t) {
+        const auto before = made();
+        sched->SpeakText(vi, t, 0, true, true);
+        return made() - before;
+    };
+    const auto line   = fresh(1)[0];
+    const auto first  = speak(line);
+    const auto again  = speak(line);
+    VoxProsody loud;
+    loud.volumeScale = 1.5;
+    vox->SetProsody(loud);
+    const auto changed = speak(line);
+    vox->SetProsody(VoxProsody{});
+    const auto restored = speak(line);
+    const auto ahead1 = fresh(1)[0];
+    const auto completed = prefetch->Store().Stats().completed;
+    prefetch->Prefetch(vi, ahead1, 0);
+    for (auto t0 = Clock::now(); prefetch->Store().Stats().completed == completed &&
+                                 Clock::now() - t0 < std::chrono::seconds(5);)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    vox->SetProsody(loud);
+    const auto prefetchedChanged = speak(ahead1);
+    vox->SetProsody(VoxProsody{});
+    m.Set("prosody_change_resyntheses", JsonValue(static_cast<double>(changed + prefetchedChanged)));
+    const bool prosodyOk = first > 0 && again == 0 && changed > 0 && restored == 0 && prefetchedChanged > 0;
+
+    // 5. 一括書き出し（ワーカー 1 本、BatchSize 行ずつ multi_synthesis）
+    engine.ResetCounts();
+    fs::path dir = fs::temp_directory_path() / "krkrvoice-bench-vox";
+    fs::create_directories(dir);
+    {
+        std::ofstream f(dir / "lines.txt", std::ios::binary);
+        for (size_t i = 0; i < lines * 2; ++i) f << "line" << i << "\t" << ToUtf8(SampleLine(rng, 10, 30)) << "\n";
+    }
+    BatchOptions bo;
+    bo.service = L"vox";
+    bo.port    = engine.Port();
+    bo.jobs    = 1;
+    bo.lines   = dir / "lines.txt";
+    bo.outDir  = dir / "out";
+    BatchReport rep;
+    std::wstring err;
+    const bool rendered = RunBatch(bo, rep, err) && rep.rendered == lines * 2;
+    auto c4 = engine.Counts();
+    m.Set("batch_render_lines",          JsonValue(static_cast<double>(rep.rendered)));
+    m.Set("batch_render_multi_requests", JsonValue(static_cast<double>(c4.multiSyntheses)));
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    const bool renderOk = rendered && c4.multiSyntheses == (lines * 2 + 7) / 8 && c4.syntheses == 0;
+
+    // 6. keep-alive：新しいクライアントで行を順に合成しても TCP 接続は 1 本のまま
+    engine.ResetCounts();
+    bool keepAliveOk = false;
+    {
+        VoiceVoxService kv(L"http://127.0.0.1", engine.Port());
+        VoiceInfo kvi;
+        if (kv.ResolveVoice(L"", L"", 0, kvi)) {
+            std::vector<double> rtt;
+            size_t ok = 0;
+            for (const auto& t : fresh(lines)) {
+                AudioClip a;
+                auto t1 = Clock::now();
+                ok += kv.Synthesize(kvi, t, 0, a) && a.Frames() > 0;
+                rtt.push_back(Ms(Clock::now() - t1));
+            }
+            const auto hs = kv.GetHttpStats();
+            const auto kc = engine.Counts();
+            m.Set("keepalive_lines",          JsonValue(static_cast<double>(lines)));
+            m.Set("keepalive_connections",    JsonValue(static_cast<double>(kc.connections)));
+            m.Set("keepalive_client_connects", JsonValue(static_cast<double>(hs.connects)));
+            m.Set("keepalive_reuses",         JsonValue(static_cast<double>(hs.reuses)));
+            m.Set("keepalive_line_ms_p50",    JsonValue(Percentile(rtt, 50)));
+            m.Set("keepalive_line_ms_max",    JsonValue(*std::max_element(rtt.begin(), rtt.end())));
+            keepAliveOk = ok == lines && kc.connections == 1 && hs.connects == 1 && hs.reuses >= 2 * lines;
+        }
+    }
+    m.Set("keepalive_ok", JsonValue(keepAliveOk));
+
+    // 7. 非同期発話のパイプライン：先頭の行は後続の synthesis を待たずに鳴り始める
+    //   （エンジンは 1 件ずつ処理するので、鳴り始めは合成 1 件分ずつずれる）
+    bool headOk = false;
+    {
+        VoiceVoxService hv(L"http://127.0.0.1", engine.Port());
+        VoiceInfo hvi;
+        if (hv.ResolveVoice(L"", L"", 0, hvi)) {
+            const size_t n = 8;
+            std::mutex tm;
+            std::vector<Clock::time_point> started;
+            Completion all;
+            for (const auto& t : fresh(n))
+                hv.SpeakText(hvi, t, 0, false, true, [&] {
+                    std::lock_guard<std::mutex> lk(tm);
+                    started.push_back(Clock::now());
+                    if (started.size() == n) all.Signal();
+                });
+            if (all.WaitFor(std::chrono::seconds(30))) {
+                // 先頭の行は単独で流れることが多いので、間隔の中央値で見る（全部届くまで待てば 0 に潰れる）
+                std::vector<double> gaps;
+                for (size_t i = 1; i < started.size(); ++i) gaps.push_back(Ms(started[i] - started[i - 1]));
+                const double gap = Percentile(gaps, 50);
+                m.Set("pipeline_play_gap_ms_p50", JsonValue(gap));
+                headOk = gap >= so.synthMs / 2;
+            }
+        }
+    }
+    m.Set("pipeline_head_ok", JsonValue(headOk));
+
+    m.Set("pass", JsonValue(cacheOk && batchOk && fallbackOk && prefetchOk && prosodyOk && renderOk &&
+                            keepAliveOk && headOk));
+    return m;
+}
+
+// 代替エンジン n 個と、それに振り分ける層
+struct VoxFarm {
+    std::vector<std::unique_ptr<VoxStandIn>> engines;
+    std::shared_ptr<BalancedTTSService>      svc;
+    VoiceInfo                                vi;
+};
+
+static bool MakeVoxFarm(size_t n, const StandInOptions& so, const BalancerOptions& bo, VoxFarm& f)
+{
+    std::vector<BalancedTTSService::Endpoint> eps;
+    for (size_t i = 0; i < n; ++i) {
+        f.engines.push_back(std::make_unique<VoxStandIn>(so));
+        if (!f.engines.back()->Ok()) return false;
+        std::wstring url = L"http://127.0.0.1:" + std::to_wstring(f.engines.back()->Port());
+        eps.push_back({ url, std::make_shared<VoiceVoxService>(url, 0) });
+    }
+    f.svc = std::make_shared<BalancedTTSService>(std::move(eps), bo);
+    return f.svc->ResolveVoice(L"", L"", 0, f.vi);
+}
+
+// threads 本のクライアントで lines を合成し、行ごとの所要時間（ms）を返す
+static std::vector<double> RunVoxClients(ITTSService& svc, const VoiceInfo& vi,
+                                         const std::vector<std::wstring>& lines, size_t threads, size_t& ok)
+{
+    std::vector<double> ms(lines.size(), 0.0);
+    std::atomic<size_t> next{ 0 }, good{ 0 };
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t)
+        pool.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1)) < lines.size();) {
+                AudioClip clip;
+                auto t0 = Clock::now();
+                if (svc.Synthesize(vi, lines[i], 0, clip) && clip.Frames() > 0) ++good;
+                ms[i] = Ms(Clock::now() - t0);
+            }
+        });
+    for (auto& t : pool) t.join();
+    ok = good;
+    return ms;
+}
+
+// 複数エンジンへの振り分け：台数に対するスループット、遅いエンジンの回避、追加送信、切り離しと復帰
+static JsonValue BenchBalance(const BenchConfig& cfg)
+{
+    JsonValue m = JsonValue::MakeObject();
+    std::mt19937 rng(21);
+    auto fresh = [&](size_t n) {
+        std::vector<std::wstring> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(SampleLine(rng, 10, 30));
+        return v;
+    };
+    StandInOptions so;
+    so.queryMs = 10;
+    so.synthMs = 4;
+    const size_t lines = cfg.quick ? 64 : 256;
+    const size_t clients = 8;
+
+    // 1. 台数を増やしたときの合成スループット（追加送信なし）
+    BalancerOptions plain;
+    plain.hedgePercentile = 0;
+    double base = 0, best = 0;
+    bool allOk = true;
+    JsonValue scaling = JsonValue::MakeObject();
+    for (size_t n : { 1, 2, 4 }) {
+        VoxFarm f;
+        if (!MakeVoxFarm(n, so, plain, f)) {
+            m.Set("skipped", JsonValue("cannot start stand-in engines"));
+            return m;
+        }
+        size_t ok = 0;
+        auto t0 = Clock::now();
+        RunVoxClients(*f.svc, f.vi, fresh(lines), clients, ok);
+        const double lps = static_cast<double>(ok) / std::chrono::duration<double>(Clock::now() - t0).count();
+        if (n == 1) base = lps;
+        best = lps;
+        allOk = allOk && ok == lines;
+        scaling.Set(std::to_string(n) + "_engines_lines_per_sec", JsonValue(lps));
+    }
+    const double speedup = base > 0 ? best / base : 0;
+    m.Set("throughput", std::move(scaling));
+    m.Set("speedup_4_engines", JsonValue(speedup));
+
+    // 2. 1 台だけ遅いとき、処理中の件数で振り分けるのでそのエンジンに行く行が減る
+    double slowShare = 1;
+    {
+        VoxFarm f;
+        if (MakeVoxFarm(3, so, plain, f)) {
+            f.engines[2]->SetExtraMs(30);
+            size_t ok = 0;
+            RunVoxClients(*f.svc, f.vi, fresh(lines), clients, ok);
+            auto st = f.svc->Stats();
+            double total = 0;
+            for (const auto& e : st.endpoints) total += static_cast<double>(e.requests);
+            slowShare = total > 0 ? static_cast<double>(st.endpoints[2].requests) / total : 1;
+            allOk = allOk && ok == lines;
+        }
+    }
+    m.Set("slow_engine_share", JsonValue(slowShare));
+
+    // 3. 1 台がときどき詰まるとき、分位を超えた要求を別のエンジンにも送って待ちを切る
+    StandInOptions fast = so;
+    fast.queryMs = 3;
+    fast.synthMs = 3;
+    const size_t seqLines = cfg.quick ? 200 : 600;
+    auto stalled = [](const std::vector<double>& v) {
+        return static_cast<double>(std::count_if(v.begin(), v.end(), [](double x) { return x > 150; }));
+    };
+    double stalledOff = 0, stalledOn = 0, hedgeWins = 0;
+    JsonValue tail = JsonValue::MakeObject();
+    for (bool hedge : { false, true }) {
+        BalancerOptions bo;
+        if (!hedge) bo.hedgePercentile = 0;
+        VoxFarm f;
+        if (!MakeVoxFarm(3, fast, bo, f)) continue;
+        size_t ok = 0;
+        RunVoxClients(*f.svc, f.vi, fresh(32), 1, ok);   // 分位の材料を溜める
+        f.engines[0]->SetStalls(0.09, 250);
+        auto ms = RunVoxClients(*f.svc, f.vi, fresh(seqLines), 1, ok);
+        allOk = allOk && ok == seqLines;
+        const std::string key = hedge ? "hedged" : "unhedged";
+        AddLatency(tail, key, ms);
+        (hedge ? stalledOn : stalledOff) = stalled(ms);
+        if (hedge) {
+            auto st   = f.svc->Stats();
+            hedgeWins = static_cast<double>(st.hedgeWins);
+            tail.Set("hedged_requests", JsonValue(static_cast<double>(st.hedged)));
+            tail.Set("hedge_delay_ms",  JsonValue(st.hedgeDelayMs));
+        }
+    }
+    tail.Set("unhedged_over_150ms", JsonValue(stalledOff));
+    tail.Set("hedged_over_150ms",   JsonValue(stalledOn));
+    tail.Set("hedge_wins",          JsonValue(hedgeWins));
+    m.Set("tail", std::move(tail));
+
+    // 4. 不調なエンジンは外して他で合成し直し、直ったら 1 件試して戻す
+    bool ejectOk = false, readmitOk = false;
+    {
+        BalancerOptions bo = plain;
+        bo.ejectAfterFailures = 3;
+        bo.ejectMs            = 200;
+        VoxFarm f;
+        if (MakeVoxFarm(3, so, bo, f)) {
+            f.engines[1]->SetFailing(true);
+            size_t ok = 0;
+            RunVoxClients(*f.svc, f.vi, fresh(32), 4, ok);
+            auto st = f.svc->Stats();
+            ejectOk = ok == 32 && !st.endpoints[1].healthy && st.ejections == 1 && st.failovers > 0;
+            const auto before = st.endpoints[1].requests;
+            m.Set("failovers", JsonValue(static_cast<double>(st.failovers)));
+
+            f.engines[1]->SetFailing(false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            RunVoxClients(*f.svc, f.vi, fresh(32), 4, ok);
+            st = f.svc->Stats();
+            readmitOk = ok == 32 && st.endpoints[1].healthy && st.readmissions == 1 &&
+                        st.endpoints[1].requests > before + 1;
+        }
+    }
+    m.Set("eject_ok",   JsonValue(ejectOk));
+    m.Set("readmit_ok", JsonValue(readmitOk));
+
+    m.Set("pass", JsonValue(allOk && speedup > 2.5 && slowShare < 0.3 && stalledOn == 0 && hedgeWins > 0 &&
+                            ejectOk && readmitOk));
+    return m;
+}
+
+// -----------------------------------------------------------------------------
+// エントリポイント
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--quick")                    cfg.quick    = true;
+        else if (a.rfind("--filter=", 0) == 0) cfg.filter   = a.substr(9);
+        else if (a.rfind("--json=", 0) == 0)   cfg.jsonPath = a.substr(7);
+        else if (a.rfind("--trace=", 0) == 0)  cfg.tracePath = a.substr(8);
+        else {
+            std::cerr << "usage: KrkrVoiceBench [--quick] [--filter=name] [--json=path] [--trace=path]\n";
+            return 2;
+        }
+    }
+
+    const std::vector<std::pair<std::string, std::function<JsonValue()>>> benches = {
+        { "dictionary",         [&] { return BenchDictionary(cfg); } },
+        { "dictionary_load",    [&] { return BenchDictionaryLoad(cfg); } },
+        { "scenario_markup",    [&] { return BenchMarkup(cfg); } },
+        { "voice_resolution",   [&] { return BenchVoiceResolution(cfg); } },
+        { "catalog_snapshot",   [&] { return BenchCatalogSnapshot(cfg); } },
+        { "fanout_replace",     [&] { return BenchFanOut(cfg, false); } },
+        { "fanout_overlap",     [&] { return BenchFanOut(cfg, true); } },
+        { "time_to_first_audio",[&] { return BenchTimeToFirstAudio(cfg); } },
+        { "speak_call_latency", [&] { return BenchSpeakCallLatency(cfg); } },
+        { "completion_latency", [&] { return BenchCompletionLatency(cfg); } },
+        { "failure_resilience", [&] { return BenchFailureResilience(cfg); } },
+        { "mixer_64_voices",    [&] { return BenchMixer(cfg); } },
+        { "time_stretch",       [&] { return BenchTimeStretch(cfg); } },
+        { "pcm_codec",          [&] { return BenchPcmCodec(cfg); } },
+        { "streaming_ring",     [&] { return BenchStreamingRing(cfg); } },
+        { "memory_budget",      [&] { return BenchMemoryBudget(cfg); } },
+        { "synth_pool",         [&] { return BenchSynthPool(cfg); } },
+        { "voicevox_batch",     [&] { return BenchVoiceVox(cfg); } },
+        { "balance",            [&] { return BenchBalance(cfg); } },
+    };
+
+    SetTraceOptions(true, !cfg.tracePath.empty());
+
+    JsonValue results = JsonValue::MakeArray();
+    bool pass = true;
+    for (const auto& [name, run] : benches) {
+        if (!cfg.filter.empty() && name.find(cfg.filter) == std::string::npos) continue;
+        std::cerr << "running " << name << "...\n";
+        auto t0 = Clock::now();
+        JsonValue b = JsonValue::MakeObject();
+        b.Set("name",       JsonValue(name));
+        JsonValue metrics = run();
+        if (const JsonValue* p = metrics.Find("pass"); p && !p->AsBool(true)) {
+            std::cerr << name << ": FAILED\n";
+            pass = false;
+        }
+        b.Set("metrics",    std::move(metrics));
+        b.Set("elapsed_ms", JsonValue(Ms(Clock::now() - t0)));
+        results.Push(std::move(b));
+    }
+
+    JsonValue root = JsonValue::MakeObject();
+    root.Set("suite",      JsonValue("krkrvoice"));
+    root.Set("quick",      JsonValue(cfg.quick));
+    root.Set("benchmarks", std::move(results));
+
+    JsonValue stages = JsonValue::MakeObject();
+    auto lat = GetStageLatency();
+    for (size_t i = 0; i < lat.size(); ++i) {
+        if (!lat[i].count) continue;
+        JsonValue st = JsonValue::MakeObject();
+        st.Set("count",   JsonValue(static_cast<double>(lat[i].count)));
+        st.Set("mean_us", JsonValue(lat[i].meanUs));
+        st.Set("p50_us",  JsonValue(lat[i].p50Us));
+        st.Set("p95_us",  JsonValue(lat[i].p95Us));
+        st.Set("p99_us",  JsonValue(lat[i].p99Us));
+        st.Set("max_us",  JsonValue(lat[i].maxUs));
+        stages.Set(TraceStageName(static_cast<TraceStage>(i)), std::move(st));
+    }
+    root.Set("stages", std::move(stages));
+    if (!cfg.tracePath.empty() && !DumpChromeTrace(cfg.tracePath))
+        std::cerr << "cannot write " << cfg.tracePath << "\n";
+    std::string out = root.Dump();
+
+    if (cfg.jsonPath.empty()) {
+        std::cout << out << "\n";
+    } else {
+        std::ofstream f(cfg.jsonPath, std::ios::binary | std::ios::trunc);
+        f << out << "\n";
+        if (!f) { std::cerr << "cannot write " << cfg.jsonPath << "\n"; return 1; }
+    }
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_standin.cpp   ―  計測用の VOICEVOX 代替エンジン
+// -----------------------------------------------------------------------------
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "krkrvoice_standin.hpp"
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+static void CloseSocket(std::intptr_t s) { ::closesocket(static_cast<SOCKET>(s)); }
+struct WsaInit {
+    WsaInit()  { WSADATA d; ::WSAStartup(MAKEWORD(2, 2), &d); }
+    ~WsaInit() { ::WSACleanup(); }
+};
+static void EnsureNetwork() { static WsaInit init; }
+#else
+using socket_t = int;
+static void CloseSocket(std::intptr_t s) { ::close(static_cast<int>(s)); }
+static void EnsureNetwork() {}
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+constexpr double kPi = 3.14159265358979323846;
+
+static bool SendAll(std::intptr_t s, const std::string& data)
+{
+    size_t off = 0;
+    while (off < data.size()) {
+        auto n = ::send(static_cast<socket_t>(s), data.data() + off, static_cast<int>(data.size() - off), MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static std::string UrlDecode(std::string_view s)
+{
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size()) {
+            out += static_cast<char>(std::stoi(std::string(s.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            out += s[i] == '+' ? ' ' : s[i];
+        }
+    }
+    return out;
+}
+
+static std::string QueryParam(std::string_view target, std::string_view name)
+{
+    size_t q = target.find('?');
+    while (q != std::string_view::npos) {
+        size_t b = q + 1, e = target.find('&', b);
+        std::string_view kv = target.substr(b, e == std::string_view::npos ? std::string_view::npos : e - b);
+        if (kv.substr(0, name.size()) == name && kv.size() > name.size() && kv[name.size()] == '=')
+            return UrlDecode(kv.substr(name.size() + 1));
+        q = e;
+    }
+    return {};
+}
+
+static size_t Utf8Chars(const std::string& s)
+{
+    size_t n = 0;
+    for (unsigned char c : s) n += (c & 0xC0) != 0x80;
+    return n;
+}
+
+static std::uint32_t Crc32(const std::string& s)
+{
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (unsigned char b : s) {
+        c ^= b;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+    }
+    return ~c;
+}
+
+static void Put16(std::string& o, std::uint32_t v) { o += static_cast<char>(v & 0xFF); o += static_cast<char>((v >> 8) & 0xFF); }
+static void Put32(std::string& o, std::uint32_t v) { Put16(o, v & 0xFFFF); Put16(o, v >> 16); }
+
+// 無圧縮 ZIP（VOICEVOX の multi_synthesis と同じく 001.wav, 002.wav, ...）
+static std::string StoredZip(const std::vector<std::string>& files)
+{
+    std::string zip, central;
+    for (size_t i = 0; i < files.size(); ++i) {
+        char name[32];   // "%03zu" は最大 20 桁になりうる
+        std::snprintf(name, sizeof(name), "%03zu.wav", i + 1);
+        const std::uint32_t crc = Crc32(files[i]), size = static_cast<std::uint32_t>(files[i].size());
+        const std::uint32_t local = static_cast<std::uint32_t>(zip.size());
+        const std::uint32_t nlen = static_cast<std::uint32_t>(std::strlen(name));
+
+        Put32(zip, 0x04034b50); Put16(zip, 20); Put16(zip, 0); Put16(zip, 0); Put16(zip, 0); Put16(zip, 0);
+        Put32(zip, crc); Put32(zip, size); Put32(zip, size); Put16(zip, nlen); Put16(zip, 0);
+        zip += name;
+        zip += files[i];
+
+        Put32(central, 0x02014b50); Put16(central, 20); Put16(central, 20); Put16(central, 0); Put16(central, 0);
+        Put16(central, 0); Put16(central, 0); Put32(central, crc); Put32(central, size); Put32(central, size);
+        Put16(central, nlen); Put16(central, 0); Put16(central, 0); Put16(central, 0); Put16(central, 0);
+        Put32(central, 0); Put32(central, local);
+        central += name;
+    }
+    const std::uint32_t cdOff = static_cast<std::uint32_t>(zip.size());
+    zip += central;
+    Put32(zip, 0x06054b50); Put16(zip, 0); Put16(zip, 0);
+    Put16(zip, static_cast<std::uint32_t>(files.size())); Put16(zip, static_cast<std::uint32_t>(files.size()));
+    Put32(zip, static_cast<std::uint32_t>(central.size())); Put32(zip, cdOff); Put16(zip, 0);
+    return zip;
+}
+
+// クエリ（chars・speedScale・pitchScale）から決まる長さ・音程の WAV
+static std::string RenderQuery(const JsonValue& q)
+{
+    const JsonValue* chars = q.Find("chars");
+    const JsonValue* speed = q.Find("speedScale");
+    const JsonValue* pitch = q.Find("pitchScale");
+    const double n    = chars ? chars->AsNumber() : 1.0;
+    const double rate = speed ? std::max(0.25, speed->AsNumber()) : 1.0;
+    const double freq = 220.0 * std::pow(2.0, (pitch ? pitch->AsNumber() : 0.0) * 4.0);
+    AudioClip clip;
+    clip.sampleRate = 24000;
+    clip.samples.resize(static_cast<size_t>(n * 0.06 / rate * clip.sampleRate));
+    for (size_t i = 0; i < clip.samples.size(); ++i)
+        clip.samples[i] = static_cast<int16_t>(6000.0 * std::sin(2.0 * kPi * freq * static_cast<double>(i) / clip.sampleRate));
+    auto wav = EncodeWav(clip);
+    return std::string(wav.begin(), wav.end());
+}
+
+static std::string Response(int status, const char* contentType, const std::string& body)
+{
+    std::string r = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") + "\r\n";
+    r += "Content-Type: "; r += contentType; r += "\r\n";
+    r += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    r += "Connection: keep-alive\r\n\r\n";
+    r += body;
+    return r;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// VoxStandIn 実装
+// -----------------------------------------------------------------------------
+VoxStandIn::VoxStandIn(StandInOptions opt)
+    : opt_(opt)
+{
+    EnsureNetwork();
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 16) != 0 ||
+        ::getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        CloseSocket(static_cast<std::intptr_t>(s));
+        return;
+    }
+    listen_ = static_cast<std::intptr_t>(s);
+    port_   = ntohs(addr.sin_port);
+    acceptThread_ = std::thread([this] { AcceptLoop(); });
+}
+
+VoxStandIn::~VoxStandIn()
+{
+    stop_ = true;
+    if (listen_ != -1) {
+#ifdef _WIN32
+        ::shutdown(static_cast<socket_t>(listen_), SD_BOTH);
+#else
+        ::shutdown(static_cast<socket_t>(listen_), SHUT_RDWR);
+#endif
+        CloseSocket(listen_);
+    }
+    if (acceptThread_.joinable()) acceptThread_.join();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto s : socks_) {
+#ifdef _WIN32
+            ::shutdown(static_cast<socket_t>(s), SD_BOTH);
+#else
+            ::shutdown(static_cast<socket_t>(s), SHUT_RDWR);
+#endif
+        }
+    }
+    for (auto& t : conns_) t.join();
+    for (auto s : socks_) CloseSocket(s);
+}
+
+StandInCounts
+VoxStandIn::Counts() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return counts_;
+}
+
+void
+VoxStandIn::ResetCounts()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    counts_ = StandInCounts{};
+}
+
+void
+VoxStandIn::SetExtraMs(double ms)
+{
+    extraMs_ = ms;
+}
+
+void
+VoxStandIn::SetStalls(double rate, double ms)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    stallRate_ = rate;
+    stallMs_   = ms;
+}
+
+void
+VoxStandIn::SetFailing(bool failing)
+{
+    failing_ = failing;
+}
+
+double
+VoxStandIn::StallMs()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < stallRate_ ? stallMs_ : 0.0;
+}
+
+void
+VoxStandIn::Spend(double ms, bool engine)
+{
+    std::unique_lock<std::mutex> lk(engineMtx_, std::defer_lock);
+    if (engine) {
+        lk.lock();
+        ms += extraMs_.load();
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(ms * 1000.0)));
+}
+
+void
+VoxStandIn::AcceptLoop()
+{
+    while (!stop_) {
+        socket_t c = ::accept(static_cast<socket_t>(listen_), nullptr, nullptr);
+#ifdef _WIN32
+        if (c == INVALID_SOCKET) break;
+#else
+        if (c < 0) break;
+#endif
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++counts_.connections;
+        socks_.push_back(static_cast<std::intptr_t>(c));
+        conns_.emplace_back([this, c] { Serve(static_cast<std::intptr_t>(c)); });
+    }
+}
+
+// keep-alive の 1 接続。パイプラインで届いたリクエストも順に処理する（ソケットは破棄時に閉じる）
+void
+VoxStandIn::Serve(std::intptr_t sock)
+{
+    std::string buf;
+    char chunk[16384];
+    while (!stop_) {
+        size_t head = buf.find("\r\n\r\n");
+        if (head == std::string::npos) {
+            auto n = ::recv(static_cast<socket_t>(sock), chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buf.append(chunk, static_cast<size_t>(n));
+            continue;
+        }
+        std::string_view h(buf.data(), head);
+        size_t bodyLen = 0;
+        if (size_t cl = h.find("Content-Length:"); cl != std::string_view::npos)
+            bodyLen = static_cast<size_t>(std::stoul(std::string(h.substr(cl + 15, h.find("\r\n", cl) - cl - 15))));
+        if (buf.size() < head + 4 + bodyLen) {
+            auto n = ::recv(static_cast<socket_t>(sock), chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buf.append(chunk, static_cast<size_t>(n));
+            continue;
+        }
+
+        const size_t sp1 = h.find(' '), sp2 = h.find(' ', sp1 + 1);
+        const std::string target(h.substr(sp1 + 1, sp2 - sp1 - 1));
+        const std::string body = buf.substr(head + 4, bodyLen);
+        buf.erase(0, head + 4 + bodyLen);
+        const std::string path = target.substr(0, target.find('?'));
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++counts_.requests;
+        }
+        Spend(opt_.requestMs, false);
+
+        std::string res;
+        const bool engineCall = path == "/audio_query" || path == "/synthesis" || path == "/multi_synthesis";
+        if (engineCall && failing_) {
+            res = Response(503, "application/json", "{\"detail\":\"Service Unavailable\"}");
+        } else if (path == "/speakers") {
+            res = Response(200, "application/json",
+                           R"([{"name":"代替","styles":[{"name":"ノーマル","id":1},{"name":"あまあま","id":2}]}])");
+        } else if (path == "/audio_query") {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                ++counts_.queries;
+            }
+            Spend(opt_.queryMs, true);
+            const size_t chars = Utf8Chars(QueryParam(target, "text"));
+            res = Response(200, "application/json",
+                           "{\"accent_phrases\":[],\"speedScale\":1.0,\"pitchScale\":0.0,\"intonationScale\":1.0,"
+                           "\"volumeScale\":1.0,\"prePhonemeLength\":0.1,\"postPhonemeLength\":0.1,"
+                           "\"outputSamplingRate\":24000,\"outputStereo\":false,\"chars\":" +
+                               std::to_string(chars) + "}");
+        } else if (path == "/synthesis") {
+            JsonValue q;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                ++counts_.syntheses;
+            }
+            Spend(opt_.synthMs + StallMs(), true);
+            res = JsonValue::Parse(body, q) ? Response(200, "audio/wav", RenderQuery(q))
+                                            : Response(422, "application/json", "{}");
+        } else if (path == "/multi_synthesis" && opt_.multi) {
+            JsonValue arr;
+            if (JsonValue::Parse(body, arr) && arr.isArray()) {
+                std::vector<std::string> wavs;
+                for (const auto& q : arr.Items()) wavs.push_back(RenderQuery(q));
+                {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    ++counts_.multiSyntheses;
+                    counts_.multiLines += wavs.size();
+                }
+                Spend(opt_.synthMs * static_cast<double>(wavs.size()), true);
+                res = Response(200, "application/zip", StoredZip(wavs));
+            } else {
+                res = Response(422, "application/json", "{}");
+            }
+        } else {
+            res = Response(404, "application/json", "{\"detail\":\"Not Found\"}");
+        }
+        if (!SendAll(sock, res)) break;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// krkrvoice_standin.hpp   ―  計測用の VOICEVOX 代替エンジン（ローカル HTTP）
+//
+//   /speakers, /audio_query, /synthesis, /multi_synthesis だけを実装し、
+//   リクエスト数を数える。解析・合成のコストは待ち時間で模擬し、本物と同じく
+//   エンジン内部では 1 件ずつ処理する（同時に来ても並列にはならない）
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct StandInOptions {
+    double requestMs = 1.0;    // 1 リクエストあたりの固定コスト（受付・JSON 処理）
+    double queryMs   = 30.0;   // audio_query のテキスト解析・アクセント推定
+    double synthMs   = 8.0;    // 1 行の波形生成
+    bool   multi     = true;   // false なら multi_synthesis に 404 を返す（古いエンジン）
+};
+
+struct StandInCounts {
+    std::uint64_t requests       = 0;
+    std::uint64_t connections    = 0;
+    std::uint64_t queries        = 0;
+    std::uint64_t syntheses      = 0;
+    std::uint64_t multiSyntheses = 0;
+    std::uint64_t multiLines     = 0;
+};
+
+class VoxStandIn {
+public:
+    explicit VoxStandIn(StandInOptions opt = {});
+    ~VoxStandIn();
+
+    VoxStandIn(const VoxStandIn&)            = delete;
+    VoxStandIn& operator=(const VoxStandIn&) = delete;
+
+    bool          Ok()   const { return port_ > 0; }
+    int           Port() const { return port_; }
+    StandInCounts Counts() const;
+    void          ResetCounts();
+
+    // 実行中に変えられる挙動（遅い・不調なエンジンの模擬）
+    void SetExtraMs(double ms);               // 解析・合成ごとに上乗せする時間
+    void SetStalls(double rate, double ms);   // 合成のうち rate の割合をさらに ms 詰まらせる
+    void SetFailing(bool failing);            // 解析・合成に 503 を返す
+
+private:
+    void AcceptLoop();
+    void Serve(std::intptr_t sock);
+    void Spend(double ms, bool engine);
+    double StallMs();
+
+    const StandInOptions opt_;
+    std::intptr_t        listen_ = -1;
+    int                  port_   = 0;
+    std::atomic_bool     stop_{ false };
+    std::atomic<double>  extraMs_{ 0.0 };
+    std::atomic_bool     failing_{ false };
+    std::thread          acceptThread_;
+
+    std::mutex                engineMtx_;   // エンジン内部は 1 件ずつ
+    mutable std::mutex        mtx_;
+    StandInCounts             counts_;
+    double                    stallRate_ = 0.0;
+    double                    stallMs_   = 0.0;
+    std::mt19937              rng_{ 7 };
+    std::vector<std::thread>  conns_;
+    std::vector<std::intptr_t> socks_;
+};
@@ -1,16 +1,41 @@
 #include "krkrvoice.hpp"
+#ifdef _WIN32
 #include "krkrvoice_win.hpp" // WinTTSService 用
+#endif
+#include "krkrvoice_vox.hpp" // VoiceVoxService 用
+#include "krkrvoice_balance.hpp" // BalancedTTSService 用
+#include "krkrvoice_mock.hpp" // MockTTSService 用
+
+#include <algorithm>
 
 namespace krkrvoice {
 
+float NormalizeSpeed(int s) {
+    s = std::clamp(s, 0, 100);
+    return s == 0 ? 1.0f : (0.5f + (s - 1) * (1.5f / 99.0f));
+}
+
+// url に複数のエンドポイント（, か ; 区切り）があれば、起動しているエンジンすべてに振り分ける
+static std::shared_ptr<ITTSService> MakeVoiceVox(const std::wstring& url, int port) {
+    auto urls = SplitEndpointList(url);
+    if (urls.size() <= 1) return std::make_shared<VoiceVoxService>(urls.empty() ? url : urls[0], port);
+    std::vector<BalancedTTSService::Endpoint> endpoints;
+    for (const auto& u : urls)
+        endpoints.push_back({ u, std::make_shared<VoiceVoxService>(u, port) });
+    return std::make_shared<BalancedTTSService>(std::move(endpoints));
+}
+
 // 新しいオーバーロード：TTSService を直接指定する形式
 std::shared_ptr<ITTSService> GetTTSService(TTSService service, const std::wstring& url, int port) {
     switch (service) {
+#ifdef _WIN32
     case TTSService::WinTTS:
         return std::make_shared<WinTTSService>();
+#endif
     case TTSService::VoiceVox:
-        // 将来的に VoiceVoxService を追加する予定
-        return nullptr;
+        return MakeVoiceVox(url, port);
+    case TTSService::Mock:
+        return std::make_shared<MockTTSService>();
     default:
         return nullptr;
     }
@@ -18,13 +43,17 @@ std::shared_ptr<ITTSService> GetTTSService(TTSService service, const std::wstrin
 
 // 既存の name 文字列指定の形式はそのまま保持
 std::shared_ptr<ITTSService> GetTTSService(const std::wstring& name, const std::wstring& url, int port) {
+#ifdef _WIN32
     if (name == L"win" || name == L"wintts") {
         return std::make_shared<WinTTSService>();
     }
-    // 将来 VOICEVOX 対応時:
-    // if (name == L"vox") {
-    //     return std::make_shared<VoiceVoxService>(url, port);
-    // }
+#endif
+    if (name == L"vox" || name == L"voicevox") {
+        return MakeVoiceVox(url, port);
+    }
+    if (name == L"mock") {
+        return std::make_shared<MockTTSService>();
+    }
     return nullptr;
 }
 
@@ -1,4 +1,8 @@
 #pragma once
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_event.hpp"
+
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -9,9 +13,20 @@ namespace krkrvoice {
 // どの TTS サービスで再生するか
 enum class TTSService {
     WinTTS,   // SAPI + WinRT のセット
-    VoiceVox, // 将来追加予定
+    VoiceVox, // VOICEVOX エンジン（HTTP）
+    Mock,     // 擬似エンジン（オフライン実行・計測用）
 };
 
+// 速度 0–100 → 0.5×–2.0×（0 は等速）
+float NormalizeSpeed(int speed);
+
+// 音声カタログ内で安定なハンドル（0 は無効）
+using VoiceHandle = std::uint32_t;
+constexpr VoiceHandle kInvalidVoiceHandle = 0;
+
+class SynthesizerPool;
+class VoiceCatalog;
+
 // 音声 1 件分の情報
 struct VoiceInfo {
     TTSService   service;      // 取得元サービス
@@ -19,6 +34,17 @@ struct VoiceInfo {
     std::wstring displayName;  // UI 表示名
     std::wstring lang;         // "ja-JP" など
     std::wstring gender;       // "Male" / "Female" / "Other"
+    VoiceHandle  handle = kInvalidVoiceHandle;  // カタログ登録時に採番
+};
+
+// 音声カタログの統計
+struct VoiceCatalogStats {
+    std::uint64_t enumerations = 0;  // 実際にエンジンを列挙した回数
+    std::uint64_t avoided      = 0;  // キャッシュで済ませた列挙要求の回数
+    std::uint64_t voices       = 0;  // 現在利用可能な音声数
+    std::uint64_t snapshotLoaded     = 0;  // 起動時にスナップショットから読み込んだか（0/1）
+    std::uint64_t fingerprintMatches = 0;  // 裏での確認で列挙を省けた回数
+    std::uint64_t snapshotWrites     = 0;  // スナップショットを書き出した回数
 };
 
 // サービス共通抽象クラス
@@ -30,14 +56,152 @@ public:
     virtual std::vector<VoiceInfo>
     GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") = 0;
 
+    // フィルタ後の idx 番目の音声を解決（既定は GetVoiceList 経由）
+    virtual bool
+    ResolveVoice(const std::wstring& lang, const std::wstring& gender, size_t idx, VoiceInfo& out)
+    {
+        auto v = GetVoiceList(lang, gender);
+        if (idx >= v.size()) return false;
+        out = v[idx];
+        return true;
+    }
+
+    // ハンドルから音声を引く（TJS 側に渡したハンドルでの発話用。カタログを持たないサービスは false）
+    //  一覧の並びやフィルタが変わっても同じ音声を指す
+    virtual bool FindVoice(VoiceHandle handle, VoiceInfo& out) { (void)handle; (void)out; return false; }
+
+    // 音声ごとの合成器プール（プールを持たないサービスは nullptr）
+    virtual SynthesizerPool* Synthesizers() { return nullptr; }
+
+    // 音声カタログ（スナップショットの設定用。カタログを持たないサービスは nullptr）
+    virtual VoiceCatalog* Catalog() { return nullptr; }
+
+    // 音声一覧を明示的に再列挙（カタログを持たないサービスは何もしない）
+    virtual void RefreshVoices() {}
+
+    // 音声カタログの統計（カタログを持たないサービスは false）
+    virtual bool GetCatalogStats(VoiceCatalogStats& out) const { (void)out; return false; }
+
     // 指定音声で再生（速度 0-100、0 は等速）
+    //  cancel が立つと未着手・合成中の処理を打ち切り、onFinish だけ呼ぶ
+    //  onFinish は成功・失敗（false を返す場合も含む）に関わらずちょうど一度呼ぶ
     virtual bool
     SpeakText(const VoiceInfo& voice,
               const std::wstring& text,
               int speed,
               bool sync,
               bool overlap,
-              std::function<void()> onFinish = {}) = 0;
+              std::function<void()> onFinish = {},
+              const CancelToken& cancel = {}) = 0;
+
+    // この音声で Synthesize（合成単体）に対応するか
+    //  false のサービスは SpeakText で鳴らすしかない。true なら Synthesize の失敗はエンジン側の失敗
+    virtual bool CanSynthesize(const VoiceInfo& voice) const { (void)voice; return false; }
+
+    // 合成結果を変えるエンジン設定（抑揚など）の指紋。既定の設定なら 0
+    //  キャッシュ・先読みのキーに混ぜるので、設定を変えると前の設定の音声は使われなくなる
+    virtual std::uint64_t SynthesisFingerprint() const { return 0; }
+
+    // 再生せずに合成だけ行う（未対応・取り消し時は false）
+    virtual bool
+    Synthesize(const VoiceInfo& voice, const std::wstring& text, int speed, AudioClip& out,
+               const CancelToken& cancel = {})
+    {
+        (void)voice; (void)text; (void)speed; (void)out; (void)cancel;
+        return false;
+    }
+
+    // 同じ音声の複数行をまとめて合成（失敗した行の out[i] は nullptr）。既定は 1 行ずつ Synthesize
+    virtual void
+    SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                    std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {})
+    {
+        out.assign(texts.size(), nullptr);
+        for (size_t i = 0; i < texts.size() && !cancel.Cancelled(); ++i) {
+            auto clip = std::make_shared<AudioClip>();
+            if (Synthesize(voice, texts[i], speed, *clip, cancel)) out[i] = std::move(clip);
+        }
+    }
+
+    // SynthesizeBatch に一度に渡すと得をする行数（エンジンが一括合成に対応しなければ 1）
+    virtual size_t BatchSize() const { return 1; }
+
+    // 合成済み音声を再生（既定は PlayAudioClip）。onFinish は SpeakText と同じく必ず一度呼ぶ
+    virtual bool
+    PlayAudio(std::shared_ptr<const AudioClip> clip,
+              bool sync,
+              bool overlap,
+              std::function<void()> onFinish = {})
+    {
+        return PlayAudioClip(std::move(clip), sync, overlap, std::move(onFinish));
+    }
+
+    // 逐次追加される PCM を途切れなく再生（既定は PlayPcmStream）
+    virtual bool
+    PlayStream(std::shared_ptr<PcmStream> stream,
+               bool sync,
+               bool overlap,
+               std::function<void()> onFinish = {})
+    {
+        return PlayPcmStream(std::move(stream), sync, overlap, std::move(onFinish));
+    }
+};
+
+// 内側のサービスの前段に置く層の基底
+//  すべて内側にそのまま委譲する。各層は振る舞いを変えるものだけ override する
+class ForwardingTTSService : public ITTSService {
+public:
+    explicit ForwardingTTSService(std::shared_ptr<ITTSService> inner) : inner_(std::move(inner)) {}
+
+    std::vector<VoiceInfo>
+    GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") override
+    { return inner_->GetVoiceList(lang, gender); }
+
+    bool ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                      size_t idx, VoiceInfo& out) override
+    { return inner_->ResolveVoice(lang, gender, idx, out); }
+
+    bool FindVoice(VoiceHandle handle, VoiceInfo& out) override { return inner_->FindVoice(handle, out); }
+
+    SynthesizerPool* Synthesizers() override { return inner_->Synthesizers(); }
+    VoiceCatalog*    Catalog() override      { return inner_->Catalog(); }
+
+    void RefreshVoices() override { inner_->RefreshVoices(); }
+    bool GetCatalogStats(VoiceCatalogStats& out) const override { return inner_->GetCatalogStats(out); }
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override
+    { return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel); }
+
+    bool CanSynthesize(const VoiceInfo& voice) const override { return inner_->CanSynthesize(voice); }
+    std::uint64_t SynthesisFingerprint() const override { return inner_->SynthesisFingerprint(); }
+
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override
+    { return inner_->Synthesize(voice, text, speed, out, cancel); }
+
+    void SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                         std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {}) override
+    { inner_->SynthesizeBatch(voice, texts, speed, out, cancel); }
+    size_t BatchSize() const override { return inner_->BatchSize(); }
+
+    bool PlayAudio(std::shared_ptr<const AudioClip> clip, bool sync, bool overlap,
+                   std::function<void()> onFinish = {}) override
+    { return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish)); }
+
+    bool PlayStream(std::shared_ptr<PcmStream> stream, bool sync, bool overlap,
+                    std::function<void()> onFinish = {}) override
+    { return inner_->PlayStream(std::move(stream), sync, overlap, std::move(onFinish)); }
+
+    const std::shared_ptr<ITTSService>& Inner() const { return inner_; }
+
+protected:
+    std::shared_ptr<ITTSService> inner_;
 };
 
 // enum→サービス取得
@@ -0,0 +1,501 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_audio.cpp   ―  PCM / WAV 変換
+// -----------------------------------------------------------------------------
+#include "krkrvoice_audio.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+static uint32_t Rd32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+static uint16_t Rd16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+static void Wr32(std::vector<uint8_t>& v, uint32_t x)
+{
+    for (int i = 0; i < 4; ++i) v.push_back(static_cast<uint8_t>(x >> (8 * i)));
+}
+static void Wr16(std::vector<uint8_t>& v, uint16_t x)
+{
+    v.push_back(static_cast<uint8_t>(x));
+    v.push_back(static_cast<uint8_t>(x >> 8));
+}
+
+constexpr uint16_t kFormatPcm        = 1;
+constexpr uint16_t kFormatFloat      = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// WAV 読み書き
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::ParseWav(const uint8_t* data, size_t size, AudioClip& out)
+{
+    if (!data || size < 12 || std::memcmp(data, "RIFF", 4) || std::memcmp(data + 8, "WAVE", 4))
+        return false;
+
+    uint16_t fmt = 0, ch = 0, bits = 0;
+    uint32_t rate = 0;
+    const uint8_t* pcm = nullptr;
+    size_t pcmSize = 0;
+
+    for (size_t p = 12; p + 8 <= size;) {
+        uint32_t len = Rd32(data + p + 4);
+        const uint8_t* body = data + p + 8;
+        size_t avail = std::min<size_t>(len, size - (p + 8));   // ストリーム出力は長さ未確定のことがある
+        if (!std::memcmp(data + p, "fmt ", 4) && avail >= 16) {
+            fmt  = Rd16(body);
+            ch   = Rd16(body + 2);
+            rate = Rd32(body + 4);
+            bits = Rd16(body + 14);
+            if (fmt == kFormatExtensible && avail >= 26) fmt = Rd16(body + 24);
+        } else if (!std::memcmp(data + p, "data", 4)) {
+            pcm = body;
+            pcmSize = avail;
+            break;
+        }
+        p += 8 + size_t(len) + (len & 1);
+    }
+    if (!pcm || !ch || !rate || !bits) return false;
+
+    size_t bps = bits / 8;
+    if (!bps) return false;
+    size_t n = pcmSize / bps;
+    n -= n % ch;
+
+    out.sampleRate = static_cast<int>(rate);
+    out.channels   = ch;
+    out.samples.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* s = pcm + i * bps;
+        int16_t v;
+        if (fmt == kFormatFloat && bits == 32) {
+            float f;
+            std::memcpy(&f, s, 4);
+            v = static_cast<int16_t>(std::lround(std::clamp(f, -1.0f, 1.0f) * 32767.0f));
+        } else if (fmt == kFormatPcm) {
+            switch (bits) {
+            case 8:  v = static_cast<int16_t>((int(s[0]) - 128) << 8); break;
+            case 16: v = static_cast<int16_t>(Rd16(s));                break;
+            case 24: v = static_cast<int16_t>(Rd16(s + 1));            break;
+            case 32: v = static_cast<int16_t>(Rd16(s + 2));            break;
+            default: return false;
+            }
+        } else {
+            return false;
+        }
+        out.samples[i] = v;
+    }
+    return true;
+}
+
+std::vector<uint8_t>
+krkrvoice::EncodeWav(const AudioClip& clip)
+{
+    uint32_t dataBytes = static_cast<uint32_t>(clip.Bytes());
+    uint16_t align     = static_cast<uint16_t>(clip.channels * 2);
+
+    std::vector<uint8_t> v;
+    v.reserve(44 + dataBytes);
+    v.insert(v.end(), { 'R', 'I', 'F', 'F' });
+    Wr32(v, 36 + dataBytes);
+    v.insert(v.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    Wr32(v, 16);
+    Wr16(v, kFormatPcm);
+    Wr16(v, static_cast<uint16_t>(clip.channels));
+    Wr32(v, static_cast<uint32_t>(clip.sampleRate));
+    Wr32(v, static_cast<uint32_t>(clip.sampleRate) * align);
+    Wr16(v, align);
+    Wr16(v, 16);
+    v.insert(v.end(), { 'd', 'a', 't', 'a' });
+    Wr32(v, dataBytes);
+    for (int16_t s : clip.samples) Wr16(v, static_cast<uint16_t>(s));
+    return v;
+}
+
+// -----------------------------------------------------------------------------
+// 加工
+// -----------------------------------------------------------------------------
+AudioClip
+krkrvoice::ConvertFormat(const AudioClip& in, int sampleRate, int channels)
+{
+    if (in.sampleRate == sampleRate && in.channels == channels) return in;
+
+    AudioClip out;
+    out.sampleRate = sampleRate;
+    out.channels   = channels;
+    size_t inFrames = in.Frames();
+    if (!inFrames || sampleRate <= 0 || channels <= 0) return out;
+
+    size_t outFrames = static_cast<size_t>(double(inFrames) * sampleRate / in.sampleRate);
+    out.samples.resize(outFrames * channels);
+    double step = double(in.sampleRate) / sampleRate;
+    for (size_t f = 0; f < outFrames; ++f) {
+        double pos = f * step;
+        size_t i0  = std::min(static_cast<size_t>(pos), inFrames - 1);
+        size_t i1  = std::min(i0 + 1, inFrames - 1);
+        float  t   = static_cast<float>(pos - double(i0));
+        for (int c = 0; c < channels; ++c) {
+            int sc = std::min(c, in.channels - 1);   // モノ→ステレオは複製
+            float a = in.samples[i0 * in.channels + sc];
+            float b = in.samples[i1 * in.channels + sc];
+            if (channels == 1 && in.channels == 2) {  // ステレオ→モノは平均
+                a = 0.5f * (a + in.samples[i0 * 2 + 1]);
+                b = 0.5f * (b + in.samples[i1 * 2 + 1]);
+            }
+            out.samples[f * channels + c] = static_cast<int16_t>(std::lround(a + (b - a) * t));
+        }
+    }
+    return out;
+}
+
+void
+krkrvoice::TrimSilence(AudioClip& clip, int keepLeadMs, int keepTailMs, int threshold)
+{
+    size_t frames = clip.Frames();
+    int    ch     = clip.channels;
+    if (!frames || ch <= 0) return;
+
+    auto loud = [&](size_t f) {
+        for (int c = 0; c < ch; ++c)
+            if (std::abs(int(clip.samples[f * ch + c])) >= threshold) return true;
+        return false;
+    };
+    size_t first = 0;
+    while (first < frames && !loud(first)) ++first;
+    if (first == frames) { clip.samples.clear(); return; }
+    size_t last = frames;
+    while (last > first && !loud(last - 1)) --last;
+
+    size_t lead = static_cast<size_t>(clip.sampleRate) * keepLeadMs / 1000;
+    size_t tail = static_cast<size_t>(clip.sampleRate) * keepTailMs / 1000;
+    size_t b = first > lead ? first - lead : 0;
+    size_t e = std::min(frames, last + tail);
+    if (b > 0 || e < frames) {
+        clip.samples.erase(clip.samples.begin() + e * ch, clip.samples.end());
+        clip.samples.erase(clip.samples.begin(), clip.samples.begin() + b * ch);
+    }
+
+    // 切り口のクリック防止（3ms）
+    size_t n    = clip.Frames();
+    size_t fade = std::min(n / 2, static_cast<size_t>(clip.sampleRate) * 3 / 1000);
+    for (size_t f = 0; f < fade; ++f) {
+        float g = float(f) / float(fade);
+        for (int c = 0; c < ch; ++c) {
+            if (b > 0)      clip.samples[f * ch + c] = static_cast<int16_t>(clip.samples[f * ch + c] * g);
+            if (e < frames) clip.samples[(n - 1 - f) * ch + c] = static_cast<int16_t>(clip.samples[(n - 1 - f) * ch + c] * g);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// PcmStream 実装
+// -----------------------------------------------------------------------------
+namespace {
+
+// プロセス全体の集計（各イベントで個別の値と一緒に加算）
+struct StreamTotals {
+    std::atomic<std::uint64_t> streams{0};
+    std::atomic<std::uint64_t> active{0};
+    std::atomic<std::uint64_t> ringBytes{0};
+    std::atomic<std::uint64_t> peakRingBytes{0};
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> read{0};
+    std::atomic<std::uint64_t> peakFill{0};
+    std::atomic<std::uint64_t> underruns{0};
+    std::atomic<std::uint64_t> producerWaits{0};
+    std::atomic<std::uint64_t> producerWaitUs{0};
+};
+
+static StreamTotals& Totals()
+{
+    static StreamTotals t;
+    return t;
+}
+
+static void RaiseTo(std::atomic<std::uint64_t>& v, std::uint64_t x)
+{
+    auto cur = v.load(std::memory_order_relaxed);
+    while (cur < x && !v.compare_exchange_weak(cur, x, std::memory_order_relaxed)) {}
+}
+
+// 満杯で待った生産側を起こすのは、容量のこの割合が空いてから（細切れの起床を避ける）
+constexpr std::uint64_t kProducerWakeDiv = 4;
+
+} // namespace
+
+PcmStream::PcmStream(int sampleRate, int channels, size_t capacityFrames)
+    : sampleRate_(sampleRate), channels_(channels)
+{
+    if (capacityFrames == 0)
+        capacityFrames = static_cast<size_t>(std::max(sampleRate, 1)) * kDefaultMs / 1000;
+    const size_t samples = std::max<size_t>(capacityFrames, 1) * std::max(channels, 1);
+    memory_.Reserve(samples * sizeof(int16_t), true);   // 再生に要るので予算を超えても確保する
+    ring_.resize(samples);
+
+    auto& t = Totals();
+    t.streams.fetch_add(1, std::memory_order_relaxed);
+    t.active.fetch_add(1, std::memory_order_relaxed);
+    RaiseTo(t.peakRingBytes, t.ringBytes.fetch_add(ring_.size() * sizeof(int16_t)) + ring_.size() * sizeof(int16_t));
+}
+
+PcmStream::~PcmStream()
+{
+    auto& t = Totals();
+    t.active.fetch_sub(1, std::memory_order_relaxed);
+    t.ringBytes.fetch_sub(ring_.size() * sizeof(int16_t));
+}
+
+// 相手が待っているときだけロックを取って起こす
+// 位置の更新と待機フラグはどちらも seq_cst なので、待機に入る直前の確認と行き違っても取りこぼさない
+void
+PcmStream::WakeConsumer()
+{
+    if (!consumerWaiting_.load()) return;
+    { std::lock_guard<std::mutex> lk(mtx_); }
+    cv_.notify_all();
+}
+
+void
+PcmStream::WakeProducer(std::uint64_t freeSpace)
+{
+    if (!producerWaiting_.load() || freeSpace < ring_.size() / kProducerWakeDiv) return;
+    { std::lock_guard<std::mutex> lk(mtx_); }
+    cv_.notify_all();
+}
+
+void
+PcmStream::Append(const int16_t* data, size_t count)
+{
+    const std::uint64_t cap = ring_.size();
+    auto& t = Totals();
+    while (count > 0) {
+        if (cancelled_.load() || closed_.load(std::memory_order_relaxed)) return;
+
+        const std::uint64_t tail  = tail_.load(std::memory_order_relaxed);
+        const std::uint64_t space = cap - (tail - head_.load(std::memory_order_acquire));
+        if (space == 0) {
+            // 満杯: 容量の 1/4（残りがそれより少なければ残り全部）が空くまで待つ
+            const std::uint64_t want = std::min<std::uint64_t>(count, std::max<std::uint64_t>(cap / kProducerWakeDiv, 1));
+            auto t0 = std::chrono::steady_clock::now();
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                producerWaiting_.store(true);
+                // 通知の取りこぼしに備えて時間でも抜ける
+                cv_.wait_for(lk, std::chrono::milliseconds(50), [&] {
+                    return cap - (tail - head_.load()) >= want || cancelled_.load();
+                });
+                producerWaiting_.store(false);
+            }
+            auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+            producerWaits_.fetch_add(1, std::memory_order_relaxed);
+            producerWaitUs_.fetch_add(us, std::memory_order_relaxed);
+            t.producerWaits.fetch_add(1, std::memory_order_relaxed);
+            t.producerWaitUs.fetch_add(us, std::memory_order_relaxed);
+            continue;
+        }
+
+        const size_t n   = static_cast<size_t>(std::min<std::uint64_t>(space, count));
+        const size_t pos = static_cast<size_t>(tail % cap);
+        const size_t n1  = std::min(n, static_cast<size_t>(cap) - pos);
+        std::memcpy(ring_.data() + pos, data, n1 * sizeof(int16_t));
+        if (n1 < n) std::memcpy(ring_.data(), data + n1, (n - n1) * sizeof(int16_t));
+        tail_.store(tail + n);
+
+        const std::uint64_t fill = cap - space + n;
+        if (fill > peakFill_.load(std::memory_order_relaxed)) {
+            peakFill_.store(fill, std::memory_order_relaxed);
+            RaiseTo(t.peakFill, fill);
+        }
+        t.written.fetch_add(n, std::memory_order_relaxed);
+        WakeConsumer();
+        data  += n;
+        count -= n;
+    }
+}
+
+void
+PcmStream::Append(const AudioClip& clip)
+{
+    if (clip.sampleRate == sampleRate_ && clip.channels == channels_) {
+        Append(clip.samples.data(), clip.samples.size());
+        return;
+    }
+    auto conv = ConvertFormat(clip, sampleRate_, channels_);
+    Append(conv.samples.data(), conv.samples.size());
+}
+
+void
+PcmStream::Close()
+{
+    closed_.store(true);
+    { std::lock_guard<std::mutex> lk(mtx_); }
+    cv_.notify_all();
+}
+
+// 残りは捨てる（リングは消費側のものなので消さずに、以降の Read を 0 にする）
+void
+PcmStream::Cancel()
+{
+    cancelled_.store(true);
+    { std::lock_guard<std::mutex> lk(mtx_); }
+    cv_.notify_all();
+}
+
+size_t
+PcmStream::Read(int16_t* dst, size_t count, std::chrono::milliseconds timeout)
+{
+    const std::uint64_t cap  = ring_.size();
+    const std::uint64_t head = head_.load(std::memory_order_relaxed);
+    std::uint64_t       tail = tail_.load(std::memory_order_acquire);
+    if (tail == head && !cancelled_.load()) {
+        // 閉じる前に尽きたら途切れ（続けて空のあいだは 1 回と数える）
+        if (primed_ && !starved_ && !closed_.load()) {
+            starved_ = true;
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            Totals().underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (timeout.count() > 0) {
+            std::unique_lock<std::mutex> lk(mtx_);
+            consumerWaiting_.store(true);
+            cv_.wait_for(lk, timeout, [&] {
+                return tail_.load() != head || closed_.load() || cancelled_.load();
+            });
+            consumerWaiting_.store(false);
+        }
+        tail = tail_.load(std::memory_order_acquire);
+    }
+    if (cancelled_.load()) return 0;
+
+    const size_t n = static_cast<size_t>(std::min<std::uint64_t>(count, tail - head));
+    if (n == 0) return 0;
+    const size_t pos = static_cast<size_t>(head % cap);
+    const size_t n1  = std::min(n, static_cast<size_t>(cap) - pos);
+    std::memcpy(dst, ring_.data() + pos, n1 * sizeof(int16_t));
+    if (n1 < n) std::memcpy(dst + n1, ring_.data(), (n - n1) * sizeof(int16_t));
+    head_.store(head + n);
+
+    primed_  = true;
+    starved_ = false;
+    Totals().read.fetch_add(n, std::memory_order_relaxed);
+    WakeProducer(cap - (tail - head - n));
+    return n;
+}
+
+bool
+PcmStream::Finished() const
+{
+    if (cancelled_.load()) return true;
+    // closed_ は最後の書き込みの後に立つので、先に見てから位置を比べる
+    return closed_.load() && tail_.load() == head_.load();
+}
+
+bool
+PcmStream::Cancelled() const
+{
+    return cancelled_.load();
+}
+
+PcmStreamStats
+PcmStream::Stats() const
+{
+    PcmStreamStats st;
+    st.ringBytes      = ring_.size() * sizeof(int16_t);
+    st.capacity       = ring_.size();
+    st.written        = tail_.load(std::memory_order_relaxed);
+    st.read           = head_.load(std::memory_order_relaxed);
+    st.peakFill       = peakFill_.load(std::memory_order_relaxed);
+    st.underruns      = underruns_.load(std::memory_order_relaxed);
+    st.producerWaits  = producerWaits_.load(std::memory_order_relaxed);
+    st.producerWaitMs = producerWaitUs_.load(std::memory_order_relaxed) / 1000.0;
+    return st;
+}
+
+PcmStreamStats
+krkrvoice::GetPcmStreamStats()
+{
+    const auto& t = Totals();
+    PcmStreamStats st;
+    st.streams        = t.streams.load(std::memory_order_relaxed);
+    st.active         = t.active.load(std::memory_order_relaxed);
+    st.ringBytes      = t.ringBytes.load(std::memory_order_relaxed);
+    st.peakRingBytes  = t.peakRingBytes.load(std::memory_order_relaxed);
+    st.written        = t.written.load(std::memory_order_relaxed);
+    st.read           = t.read.load(std::memory_order_relaxed);
+    st.peakFill       = t.peakFill.load(std::memory_order_relaxed);
+    st.underruns      = t.underruns.load(std::memory_order_relaxed);
+    st.producerWaits  = t.producerWaits.load(std::memory_order_relaxed);
+    st.producerWaitMs = t.producerWaitUs.load(std::memory_order_relaxed) / 1000.0;
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// 再生（Windows 版は krkrvoice_win.cpp）
+// -----------------------------------------------------------------------------
+#ifndef _WIN32
+// 出力プレイヤーを持たないので上限設定は記録のみ
+void
+krkrvoice::SetPlayerPoolLimits(size_t maxPolyphony, VoiceStealPolicy policy)
+{
+    (void)maxPolyphony; (void)policy;
+}
+
+PlayerPoolStats
+krkrvoice::GetPlayerPoolStats()
+{
+    PlayerPoolStats st;
+    struct rusage ru{};
+    if (::getrusage(RUSAGE_SELF, &ru) == 0)
+        st.peakWorkingSet = static_cast<std::uint64_t>(ru.ru_maxrss) * 1024;   // Linux は KiB 単位
+    return st;
+}
+
+bool
+krkrvoice::PlayAudioClip(std::shared_ptr<const AudioClip> clip,
+                         bool sync,
+                         bool overlap,
+                         std::function<void()> onFinish)
+{
+    (void)sync; (void)overlap;
+    if (onFinish) onFinish();
+    return clip != nullptr;
+}
+
+// 出力先が無いので読み捨てる（生産側の流量制御はそのまま働く）
+bool
+krkrvoice::PlayPcmStream(std::shared_ptr<PcmStream> stream,
+                         bool sync,
+                         bool overlap,
+                         std::function<void()> onFinish)
+{
+    (void)overlap;
+    if (!stream) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    auto drain = [stream, onFinish = std::move(onFinish)] {
+        std::vector<int16_t> tmp(4096);
+        while (!stream->Finished())
+            stream->Read(tmp.data(), tmp.size(), std::chrono::milliseconds(50));
+        if (onFinish) onFinish();
+    };
+    if (sync) drain();
+    else      std::thread(std::move(drain)).detach();
+    return true;
+}
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+#include "krkrvoice_memory.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace krkrvoice {
+
+// 合成済み音声（16bit 符号付き PCM、チャンネルはインターリーブ）
+struct AudioClip {
+    int                  sampleRate = 24000;
+    int                  channels   = 1;
+    std::vector<int16_t> samples;
+
+    size_t Frames()  const { return channels > 0 ? samples.size() / channels : 0; }
+    double Seconds() const { return sampleRate > 0 ? double(Frames()) / sampleRate : 0.0; }
+    size_t Bytes()   const { return samples.size() * sizeof(int16_t); }
+};
+
+// PcmStream の統計（サンプル数はチャンネル込み）
+struct PcmStreamStats {
+    std::uint64_t streams        = 0;   // 作ったストリーム（GetPcmStreamStats のみ）
+    std::uint64_t active         = 0;   // 生きているストリーム（GetPcmStreamStats のみ）
+    std::uint64_t ringBytes      = 0;   // リングバッファの確保量（全体では生きているものの合計）
+    std::uint64_t peakRingBytes  = 0;   // ringBytes の最大（GetPcmStreamStats のみ）
+    std::uint64_t capacity       = 0;   // リングの容量（サンプル）
+    std::uint64_t written        = 0;   // 書いたサンプル
+    std::uint64_t read           = 0;   // 読んだサンプル
+    std::uint64_t peakFill       = 0;   // 溜まったサンプルの最大（全体では各ストリームの最大）
+    std::uint64_t underruns      = 0;   // 再生が始まった後、閉じる前にデータが尽きた回数
+    std::uint64_t producerWaits  = 0;   // リングが満杯で生産側が待った回数
+    double        producerWaitMs = 0;   // その合計時間
+};
+
+// 生産側（合成）と消費側（再生）をつなぐ PCM ストリーム
+//  - 生産側は Append → 最後に Close
+//  - 消費側は Read で取り出し、停止時は Cancel（以降の Append は捨てられる）
+//  - 固定容量のリングバッファ（生産 1・消費 1 のロックフリー）なので、発話が長くてもメモリは一定
+//    満杯なら Append は空きができるまで待つ（合成が再生より先に進みすぎない）
+//  - mutex / condition_variable は相手を待つときだけ使う
+//  - リングはメモリ予算（MemoryGovernor）の Playback として数える
+class PcmStream {
+public:
+    static constexpr int kDefaultMs = 2000;   // 容量を省略したときのリングの長さ
+
+    // capacityFrames は 0 なら kDefaultMs 分
+    PcmStream(int sampleRate, int channels, size_t capacityFrames = 0);
+    ~PcmStream();
+
+    PcmStream(const PcmStream&)            = delete;
+    PcmStream& operator=(const PcmStream&) = delete;
+
+    int    SampleRate() const { return sampleRate_; }
+    int    Channels()   const { return channels_; }
+    size_t Capacity()   const { return ring_.size(); }   // サンプル
+
+    // 全て書くまで戻らない（Close / Cancel 済みなら捨てて戻る）
+    void Append(const int16_t* data, size_t count);
+    void Append(const AudioClip& clip);   // 形式が違えば変換して追加
+    void Close();
+    void Cancel();
+
+    // 最大 count サンプル読む。データが無ければ timeout まで待つ
+    // 0 が返り Finished() なら終端
+    size_t Read(int16_t* dst, size_t count, std::chrono::milliseconds timeout);
+
+    bool Finished()  const;
+    bool Cancelled() const;
+
+    PcmStreamStats Stats() const;
+
+private:
+    void WakeConsumer();
+    void WakeProducer(std::uint64_t freeSpace);
+
+    const int            sampleRate_;
+    const int            channels_;
+    std::vector<int16_t> ring_;
+
+    // 位置は単調増加（リング上の位置は % 容量）。head_ は消費側、tail_ は生産側だけが進める
+    std::atomic<std::uint64_t> head_{0};
+    std::atomic<std::uint64_t> tail_{0};
+    std::atomic<bool>          closed_{false};
+    std::atomic<bool>          cancelled_{false};
+    std::atomic<bool>          producerWaiting_{false};
+    std::atomic<bool>          consumerWaiting_{false};
+
+    bool primed_  = false;   // 1 度でも読めた（消費側のみ）
+    bool starved_ = false;   // データ切れを数えた後、まだ読めていない（消費側のみ）
+
+    std::atomic<std::uint64_t> peakFill_{0};
+    std::atomic<std::uint64_t> underruns_{0};
+    std::atomic<std::uint64_t> producerWaits_{0};
+    std::atomic<std::uint64_t> producerWaitUs_{0};
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    MemoryAccount           memory_{MemoryClass::Playback};   // リングの分
+};
+
+// プロセス全体の PcmStream の統計
+PcmStreamStats GetPcmStreamStats();
+
+// RIFF/WAVE（PCM 8/16/24/32bit・IEEE float 32bit）→ AudioClip
+bool ParseWav(const uint8_t* data, size_t size, AudioClip& out);
+
+// AudioClip → 16bit PCM の RIFF/WAVE
+std::vector<uint8_t> EncodeWav(const AudioClip& clip);
+
+// サンプルレート・チャンネル数を変換（線形補間）
+AudioClip ConvertFormat(const AudioClip& in, int sampleRate, int channels);
+
+// 先頭・末尾の無音を keepLeadMs / keepTailMs まで詰め、切り口に短いフェードをかける
+void TrimSilence(AudioClip& clip, int keepLeadMs, int keepTailMs, int threshold = 256);
+
+// 同時発音数を使い切ったときの扱い
+enum class VoiceStealPolicy {
+    Oldest = 0,   // 最も古い再生を止めて譲る（既定）
+    Reject = 1,   // 新しい再生は鳴らさずに完了扱い
+};
+
+// 出力プレイヤープールの統計
+struct PlayerPoolStats {
+    std::uint64_t active         = 0;   // 再生中のプレイヤー
+    std::uint64_t idle           = 0;   // 再利用待ちのプレイヤー
+    std::uint64_t peakActive     = 0;
+    std::uint64_t created        = 0;
+    std::uint64_t reused         = 0;
+    std::uint64_t stolen         = 0;   // 発音数上限で止めた再生
+    std::uint64_t rejected       = 0;   // 発音数上限で鳴らさなかった再生
+    std::uint64_t peakWorkingSet = 0;   // プロセスのピークメモリ（バイト）
+};
+
+// 同時発音数（overlap 再生を含む）の上限と、溢れたときの扱い
+void SetPlayerPoolLimits(size_t maxPolyphony, VoiceStealPolicy policy = VoiceStealPolicy::Oldest);
+PlayerPoolStats GetPlayerPoolStats();
+
+// 合成済み音声を既定の出力で再生（Windows は MediaPlayer、それ以外は出力なしで即完了）
+bool PlayAudioClip(std::shared_ptr<const AudioClip> clip,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {});
+
+// ストリームを既定の出力で途切れなく再生（Windows は MediaStreamSource）
+bool PlayPcmStream(std::shared_ptr<PcmStream> stream,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {});
+
+} // namespace krkrvoice
@@ -0,0 +1,431 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_balance.cpp   ―  複数エンジンへの振り分け・追加送信・切り離し
+// -----------------------------------------------------------------------------
+#include "krkrvoice_balance.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+
+using namespace krkrvoice;
+
+using BalanceClock = std::chrono::steady_clock;
+
+struct BalancedTTSService::Backend {
+    std::wstring                 name;
+    std::shared_ptr<ITTSService> svc;
+    std::atomic_bool             prepared{ false };   // 音声の対応表を読み込んだか
+
+    // 以下は BalancedTTSService::mtx_ で保護
+    size_t                   outstanding = 0;
+    int                      failStreak  = 0;
+    bool                     ejected     = false;
+    bool                     probing     = false;   // 切り離し中に試しの 1 件を送っている
+    BalanceClock::time_point retryAt;
+    BalancerEndpointStats    stats;
+};
+
+// 1 要求ぶんの競争。先に成功した試行の結果を使う
+struct BalancedTTSService::Race {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    size_t                  running = 0;
+    bool                    ok      = false;
+    bool                    byHedge = false;
+    AudioClip               clip;
+};
+
+// -----------------------------------------------------------------------------
+// 構築・音声一覧
+// -----------------------------------------------------------------------------
+BalancedTTSService::BalancedTTSService(std::vector<Endpoint> endpoints, BalancerOptions opt)
+    : catalog_(endpoints.size())
+    , opt_(opt)
+    // 試行は HTTP 応答待ちでほぼ寝ているので、追加送信ぶんも含めて多めに用意する
+    , sched_(std::max<size_t>(4, endpoints.size() * 4))
+{
+    for (auto& e : endpoints) {
+        auto b   = std::make_unique<Backend>();
+        b->name  = std::move(e.name);
+        b->svc   = std::move(e.service);
+        b->stats.name = b->name;
+        backends_.push_back(std::move(b));
+    }
+    // 同じ一覧から作った複数のインスタンス（一括書き出しのワーカーごとなど）が同じエンジンから埋めないように
+    static std::atomic<size_t> seed{ 0 };
+    rr_ = backends_.empty() ? 0 : seed.fetch_add(1) % backends_.size();
+}
+
+BalancedTTSService::~BalancedTTSService() = default;
+
+std::shared_ptr<ITTSService>
+BalancedTTSService::Service(size_t i) const
+{
+    return i < backends_.size() ? backends_[i]->svc : nullptr;
+}
+
+// 最初に音声を返したエンジンを一覧の基準にする（ハンドルはエンジンごとに採番されるため固定する）
+ITTSService&
+BalancedTTSService::CatalogService()
+{
+    size_t c = catalog_.load();
+    if (c < backends_.size()) return *backends_[c]->svc;
+    for (size_t i = 0; i < backends_.size(); ++i) {
+        if (backends_[i]->svc->GetVoiceList().empty()) continue;
+        size_t expected = backends_.size();
+        catalog_.compare_exchange_strong(expected, i);
+        return *backends_[catalog_.load()]->svc;
+    }
+    return *backends_.front()->svc;
+}
+
+VoiceCatalog*
+BalancedTTSService::Catalog()
+{
+    return backends_.empty() ? nullptr : backends_.front()->svc->Catalog();
+}
+
+std::vector<VoiceInfo>
+BalancedTTSService::GetVoiceList(const std::wstring& lang, const std::wstring& gender)
+{
+    return CatalogService().GetVoiceList(lang, gender);
+}
+
+bool
+BalancedTTSService::ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                                 size_t idx, VoiceInfo& out)
+{
+    return CatalogService().ResolveVoice(lang, gender, idx, out);
+}
+
+bool
+BalancedTTSService::FindVoice(VoiceHandle handle, VoiceInfo& out)
+{
+    return CatalogService().FindVoice(handle, out);
+}
+
+void
+BalancedTTSService::RefreshVoices()
+{
+    for (auto& b : backends_) {
+        b->svc->RefreshVoices();
+        b->prepared = false;
+    }
+}
+
+bool
+BalancedTTSService::GetCatalogStats(VoiceCatalogStats& out) const
+{
+    size_t c = catalog_.load();
+    return c < backends_.size() && backends_[c]->svc->GetCatalogStats(out);
+}
+
+// VoiceInfo は表示名で音声を指すので、送る前にそのエンジン自身にも一覧を読ませておく
+bool
+BalancedTTSService::Prepare(Backend& b)
+{
+    if (b.prepared.load()) return true;
+    if (b.svc->GetVoiceList().empty()) {
+        b.svc->RefreshVoices();   // 起動前に列挙して空だった結果を持っていれば捨てる
+        if (b.svc->GetVoiceList().empty()) return false;
+    }
+    b.prepared = true;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// 振り分け
+// -----------------------------------------------------------------------------
+size_t
+BalancedTTSService::Pick(const std::vector<size_t>& exclude, size_t weight, bool hedge)
+{
+    const size_t n   = backends_.size();
+    const auto   now = BalanceClock::now();
+    std::lock_guard<std::mutex> lk(mtx_);
+    size_t best = n, fallback = n;
+    for (size_t k = 0; k < n; ++k) {
+        size_t i = (rr_ + k) % n;
+        if (std::find(exclude.begin(), exclude.end(), i) != exclude.end()) continue;
+        const Backend& b = *backends_[i];
+        if (fallback == n || b.outstanding < backends_[fallback]->outstanding) fallback = i;
+        if (b.ejected && (b.probing || now < b.retryAt)) continue;
+        if (best == n || b.outstanding < backends_[best]->outstanding) best = i;
+    }
+    // 追加送信は健全なエンジンにだけ。通常の送信は全滅していても最も空いているエンジンに送る
+    if (best == n && !hedge) best = fallback;
+    rr_ = (rr_ + 1) % std::max<size_t>(n, 1);
+    if (best == n) return n;
+
+    Backend& b = *backends_[best];
+    if (b.ejected) b.probing = true;
+    b.outstanding += weight;
+    ++b.stats.requests;
+    if (hedge) ++b.stats.hedges;
+    return best;
+}
+
+void
+BalancedTTSService::Done(size_t i, bool ok, bool cancelled, double ms, size_t weight)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    Backend& b = *backends_[i];
+    b.outstanding -= std::min(b.outstanding, weight);
+    if (b.probing && (ok || cancelled)) b.probing = false;
+    if (ok) {
+        b.failStreak = 0;
+        if (b.ejected) {
+            b.ejected = false;
+            ++stats_.readmissions;
+        }
+        if (ms >= 0 && opt_.latencyWindow > 0) {
+            if (latency_.size() < opt_.latencyWindow) latency_.push_back(ms);
+            else latency_[latencyPos_++ % latency_.size()] = ms;
+        }
+        return;
+    }
+    if (cancelled) return;   // 追加送信に負けて取り消されたものは失敗に数えない
+
+    ++b.stats.failures;
+    b.probing = false;
+    if (b.ejected || ++b.failStreak >= opt_.ejectAfterFailures) {
+        if (!b.ejected) {
+            b.ejected = true;
+            ++b.stats.ejections;
+            ++stats_.ejections;
+        }
+        b.retryAt = BalanceClock::now() + std::chrono::milliseconds(opt_.ejectMs);
+    }
+}
+
+// 追加送信までの待ち（送らないなら負）
+double
+BalancedTTSService::HedgeDelayMs() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (opt_.hedgePercentile <= 0 || backends_.size() < 2 || latency_.size() < std::max<size_t>(opt_.minSamples, 1))
+        return -1;
+    std::vector<double> v = latency_;
+    size_t k = std::min(v.size() - 1, static_cast<size_t>(v.size() * std::min(opt_.hedgePercentile, 100.0) / 100.0));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+    return std::max(v[k], static_cast<double>(opt_.minHedgeDelayMs));
+}
+
+void
+BalancedTTSService::Launch(const std::shared_ptr<Race>& race, size_t i, const VoiceInfo& voice,
+                           const std::wstring& text, int speed, const CancelToken& cancel, bool hedge)
+{
+    auto finish = [this, race, i, hedge](bool ok, bool cancelled, double ms, AudioClip* clip) {
+        Done(i, ok, cancelled, ms, 1);
+        std::lock_guard<std::mutex> lk(race->mtx);
+        --race->running;
+        if (ok && !race->ok) {
+            race->ok      = true;
+            race->byHedge = hedge;
+            race->clip    = std::move(*clip);
+            if (hedge) {
+                std::lock_guard<std::mutex> sl(mtx_);
+                ++backends_[i]->stats.wins;
+            }
+        }
+        race->cv.notify_all();
+    };
+    sched_.Submit(SynthPriority::Current, cancel,
+        [this, i, voice, text, speed, finish](const CancelToken& tok) {
+            Backend& b = *backends_[i];
+            AudioClip clip;
+            auto t0 = BalanceClock::now();
+            bool ok = Prepare(b) && b.svc->Synthesize(voice, text, speed, clip, tok);
+            double ms = std::chrono::duration<double, std::milli>(BalanceClock::now() - t0).count();
+            finish(ok, !ok && tok.Cancelled(), ms, &clip);
+        },
+        [finish] { finish(false, true, -1, nullptr); });
+}
+
+// -----------------------------------------------------------------------------
+// 合成
+// -----------------------------------------------------------------------------
+bool
+BalancedTTSService::Synthesize(const VoiceInfo& voice, const std::wstring& text, int speed, AudioClip& out,
+                               const CancelToken& cancel)
+{
+    if (backends_.empty() || cancel.Cancelled()) return false;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++stats_.requests;
+    }
+
+    auto race = std::make_shared<Race>();
+    auto settled = CancelToken::Make();                  // 決着したら残りの試行を止める
+    auto tok     = CancelToken::Link(cancel, settled);
+    std::vector<size_t> tried;
+    auto launch = [&](size_t i, bool hedge) {
+        tried.push_back(i);
+        {
+            std::lock_guard<std::mutex> lk(race->mtx);
+            ++race->running;
+        }
+        Launch(race, i, voice, text, speed, tok, hedge);   // 溢れて即座に dropped が呼ばれることもあるのでロック外
+    };
+
+    size_t first = Pick(tried, 1, false);
+    if (first >= backends_.size()) return false;
+    const auto   t0    = BalanceClock::now();
+    const double delay = HedgeDelayMs();
+    launch(first, false);
+
+    bool hedged = delay < 0;
+    std::unique_lock<std::mutex> lk(race->mtx);
+    while (!race->ok) {
+        auto settledOrIdle = [&] { return race->ok || race->running == 0; };
+        if (!hedged) {
+            auto at = t0 + std::chrono::duration_cast<BalanceClock::duration>(std::chrono::duration<double, std::milli>(delay));
+            if (!race->cv.wait_until(lk, at, settledOrIdle)) {
+                hedged = true;
+                lk.unlock();
+                size_t h = Pick(tried, 1, true);
+                if (h < backends_.size()) {
+                    {
+                        std::lock_guard<std::mutex> sl(mtx_);
+                        ++stats_.hedged;
+                    }
+                    launch(h, true);
+                }
+                lk.lock();
+                continue;
+            }
+        } else {
+            race->cv.wait(lk, settledOrIdle);
+        }
+        if (race->ok || cancel.Cancelled()) break;
+        if (race->running == 0) {   // 送った先がすべて失敗した
+            lk.unlock();
+            size_t next = tried.size() < backends_.size() ? Pick(tried, 1, false) : backends_.size();
+            if (next >= backends_.size()) {
+                lk.lock();
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> sl(mtx_);
+                ++stats_.failovers;
+            }
+            launch(next, false);
+            lk.lock();
+        }
+    }
+    settled.Cancel();
+    if (!race->ok) return false;
+    if (race->byHedge) {
+        std::lock_guard<std::mutex> sl(mtx_);
+        ++stats_.hedgeWins;
+    }
+    out = std::move(race->clip);
+    return true;
+}
+
+void
+BalancedTTSService::SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                                    std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel)
+{
+    out.assign(texts.size(), nullptr);
+    if (texts.empty() || backends_.empty()) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stats_.requests += texts.size();
+    }
+    std::vector<size_t> tried;
+    while (!cancel.Cancelled() && tried.size() < backends_.size()) {
+        size_t i = Pick(tried, texts.size(), false);
+        if (i >= backends_.size()) return;
+        if (!tried.empty()) {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++stats_.failovers;
+        }
+        tried.push_back(i);
+        Backend& b = *backends_[i];
+        if (Prepare(b)) b.svc->SynthesizeBatch(voice, texts, speed, out, cancel);
+        bool any = std::any_of(out.begin(), out.end(), [](const auto& c) { return c != nullptr; });
+        Done(i, any, !any && cancel.Cancelled(), -1, texts.size());   // 一括の所要時間は分位に混ぜない
+        if (any) return;
+    }
+}
+
+bool
+BalancedTTSService::CanSynthesize(const VoiceInfo& voice) const
+{
+    return !backends_.empty() && backends_.front()->svc->CanSynthesize(voice);
+}
+
+std::uint64_t
+BalancedTTSService::SynthesisFingerprint() const
+{
+    return backends_.empty() ? 0 : backends_.front()->svc->SynthesisFingerprint();
+}
+
+size_t
+BalancedTTSService::BatchSize() const
+{
+    return backends_.empty() ? 1 : backends_.front()->svc->BatchSize();
+}
+
+bool
+BalancedTTSService::SpeakText(const VoiceInfo& voice,
+                              const std::wstring& text,
+                              int  speed,
+                              bool sync,
+                              bool overlap,
+                              std::function<void()> onFinish,
+                              const CancelToken& cancel)
+{
+    auto clip = std::make_shared<AudioClip>();
+    if (!Synthesize(voice, text, speed, *clip, cancel)) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    return PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+}
+
+// -----------------------------------------------------------------------------
+// 設定・統計
+// -----------------------------------------------------------------------------
+void
+BalancedTTSService::SetOptions(const BalancerOptions& opt)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    opt_ = opt;
+    if (latency_.size() > opt_.latencyWindow) {
+        latency_.resize(opt_.latencyWindow);
+        latencyPos_ = 0;
+    }
+}
+
+BalancerStats
+BalancedTTSService::Stats() const
+{
+    double delay = HedgeDelayMs();
+    std::lock_guard<std::mutex> lk(mtx_);
+    BalancerStats st = stats_;
+    st.hedgeDelayMs = std::max(delay, 0.0);
+    for (const auto& b : backends_) {
+        BalancerEndpointStats e = b->stats;
+        e.outstanding = b->outstanding;
+        e.healthy     = !b->ejected;
+        st.endpoints.push_back(std::move(e));
+    }
+    return st;
+}
+
+std::vector<std::wstring>
+krkrvoice::SplitEndpointList(const std::wstring& list)
+{
+    std::vector<std::wstring> out;
+    std::wstring cur;
+    auto flush = [&] {
+        if (!cur.empty()) out.push_back(std::move(cur));
+        cur.clear();
+    };
+    for (wchar_t c : list) {
+        if (c == L',' || c == L';') flush();
+        else if (c != L' ' && c != L'\t') cur += c;
+    }
+    flush();
+    return out;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_sched.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace krkrvoice {
+
+// 複数エンジンへの振り分け設定
+struct BalancerOptions {
+    double hedgePercentile    = 95.0;   // 応答がこの分位を超えたら別のエンジンにも送る（0 で送らない）
+    int    minHedgeDelayMs    = 10;     // 追加送信までの最短の待ち
+    size_t latencyWindow      = 128;    // 分位を求める直近の成功件数
+    size_t minSamples         = 16;     // これだけ溜まるまでは追加送信しない
+    int    ejectAfterFailures = 3;      // 連続してこの回数失敗したエンジンを外す
+    int    ejectMs            = 2000;   // 外しておく時間。過ぎたら 1 件だけ試し、成功すれば戻す
+};
+
+struct BalancerEndpointStats {
+    std::wstring  name;
+    std::uint64_t requests    = 0;   // 送った件数（追加送信を含む）
+    std::uint64_t failures    = 0;
+    std::uint64_t hedges      = 0;   // 追加送信として受けた件数
+    std::uint64_t wins        = 0;   // 追加送信で先に返した件数
+    std::uint64_t outstanding = 0;   // 現在処理中の件数
+    std::uint64_t ejections   = 0;
+    bool          healthy     = true;
+};
+
+struct BalancerStats {
+    std::uint64_t requests     = 0;   // 受けた合成要求
+    std::uint64_t hedged       = 0;   // 追加送信した要求
+    std::uint64_t hedgeWins    = 0;   // 追加送信のほうが先に返った要求
+    std::uint64_t failovers    = 0;   // 失敗して別のエンジンで合成し直した回数
+    std::uint64_t ejections    = 0;
+    std::uint64_t readmissions = 0;
+    double        hedgeDelayMs = 0;   // 現在の追加送信までの待ち（0 なら送らない）
+    std::vector<BalancerEndpointStats> endpoints;
+};
+
+// 同じ種類の複数エンジン（VOICEVOX を複数プロセス起動した場合など）に合成を振り分ける層
+//  - 処理中の件数が最も少ないエンジンに送る（同数なら開始位置を回す）
+//  - 応答が直近の分位を超えたら、まだ返っていない要求を別のエンジンにも送り、先に返った方を使う
+//    負けた側は取り消す（エンジン内で次の段に進む前に打ち切られる）
+//  - 連続して失敗したエンジンは一定時間外し、その後 1 件試して成功すれば戻す
+//  - 失敗した要求は別のエンジンで合成し直す
+// 音声一覧とハンドルは最初に一覧を返したエンジンのものを使う（全エンジンで同じ音声がある前提）
+class BalancedTTSService final : public ITTSService {
+public:
+    struct Endpoint {
+        std::wstring                 name;
+        std::shared_ptr<ITTSService> service;
+    };
+
+    explicit BalancedTTSService(std::vector<Endpoint> endpoints, BalancerOptions opt = {});
+    ~BalancedTTSService() override;
+
+    std::vector<VoiceInfo>
+    GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") override;
+
+    bool ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                      size_t idx, VoiceInfo& out) override;
+    bool FindVoice(VoiceHandle handle, VoiceInfo& out) override;
+    void RefreshVoices() override;
+    bool GetCatalogStats(VoiceCatalogStats& out) const override;
+    // スナップショットは先頭のエンジンのもの（一覧は先頭から順に、最初に音声を返したエンジンを使う）
+    VoiceCatalog* Catalog() override;
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool CanSynthesize(const VoiceInfo& voice) const override;
+    std::uint64_t SynthesisFingerprint() const override;
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    // 一括合成は 1 つのエンジンにまとめて送る（追加送信はせず、全行失敗なら別のエンジンで）
+    void SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                         std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {}) override;
+    size_t BatchSize() const override;
+
+    void          SetOptions(const BalancerOptions& opt);
+    BalancerStats Stats() const;
+
+    size_t                       Size() const { return backends_.size(); }
+    std::shared_ptr<ITTSService> Service(size_t i) const;
+
+private:
+    struct Backend;
+    struct Race;
+
+    size_t Pick(const std::vector<size_t>& exclude, size_t weight, bool hedge);
+    void   Done(size_t i, bool ok, bool cancelled, double ms, size_t weight);
+    double HedgeDelayMs() const;
+    void   Launch(const std::shared_ptr<Race>& race, size_t i, const VoiceInfo& voice,
+                  const std::wstring& text, int speed, const CancelToken& cancel, bool hedge);
+    bool   Prepare(Backend& b);
+    ITTSService& CatalogService();
+
+    std::vector<std::unique_ptr<Backend>> backends_;
+    std::atomic<size_t>                   catalog_;   // 音声一覧を引くエンジン（未定なら Size()）
+
+    mutable std::mutex  mtx_;
+    BalancerOptions     opt_;
+    BalancerStats       stats_;
+    std::vector<double> latency_;   // 直近の成功の所要時間（ms）。リングバッファ
+    size_t              latencyPos_ = 0;
+    size_t              rr_         = 0;
+
+    SynthScheduler sched_;          // 先に破棄（ワーカー停止）させるため末尾に置く
+};
+
+// "http://a:50021,http://b:50022" のようなエンドポイント一覧を分割する（, と ; 区切り、空白は除く）
+std::vector<std::wstring> SplitEndpointList(const std::wstring& list);
+
+} // namespace krkrvoice
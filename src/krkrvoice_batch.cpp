@@ -0,0 +1,321 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_batch.cpp   ―  シナリオ一括書き出し
+// -----------------------------------------------------------------------------
+#include "krkrvoice_batch.hpp"
+#include "krkrvoice_cache.hpp"
+#include "krkrvoice_json.hpp"
+
+#ifdef _WIN32
+#include <objbase.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace krkrvoice;
+namespace fs = std::filesystem;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr char kManifestName[] = "krkrvoice-batch.tsv";   // id<TAB>内容ハッシュ
+
+static bool ReadFile(const fs::path& path, std::string& out)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    out = ss.str();
+    if (out.size() >= 3 && out.compare(0, 3, "\xEF\xBB\xBF") == 0) out.erase(0, 3);   // BOM
+    return true;
+}
+
+static bool ParseEntries(const JsonValue& arr, std::vector<DictEntry>& out)
+{
+    if (!arr.isArray()) return false;
+    for (const auto& e : arr.Items()) {
+        const JsonValue* pat = e.Find("pattern");
+        const JsonValue* rep = e.Find("replacement");
+        if (!pat) continue;
+        out.push_back(DictEntry{ FromUtf8(pat->AsString()), rep ? FromUtf8(rep->AsString()) : L"" });
+    }
+    return true;
+}
+
+static std::unordered_map<std::wstring, std::string> ReadManifest(const fs::path& dir)
+{
+    std::unordered_map<std::wstring, std::string> m;
+    std::string body;
+    if (!ReadFile(dir / kManifestName, body)) return m;
+    std::istringstream ss(body);
+    std::string line;
+    while (std::getline(ss, line)) {
+        auto tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        m[FromUtf8(line.substr(0, tab))] = line.substr(tab + 1);
+    }
+    return m;
+}
+
+static bool WriteManifest(const fs::path& dir, const std::unordered_map<std::wstring, std::string>& m)
+{
+    std::vector<std::pair<std::string, std::string>> rows;
+    for (const auto& [id, h] : m) rows.push_back({ ToUtf8(id), h });
+    std::sort(rows.begin(), rows.end());
+
+    fs::path tmp = dir / kManifestName;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        for (const auto& [id, h] : rows) f << id << '\t' << h << '\n';
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, dir / kManifestName, ec);
+    return !ec;
+}
+
+static bool WriteWavFile(const fs::path& path, const AudioClip& clip)
+{
+    auto wav = EncodeWav(clip);
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        f.write(reinterpret_cast<const char*>(wav.data()), static_cast<std::streamsize>(wav.size()));
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+// 一括合成にまとめてよい同じ音声か（表示名だけでは別エンジンの同名の音声を取り違える）
+static bool SameVoice(const VoiceInfo& a, const VoiceInfo& b)
+{
+    return a.service == b.service && a.engine == b.engine && a.handle == b.handle &&
+           a.displayName == b.displayName && a.lang == b.lang;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 入力ファイル
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::LoadDictionaryFile(const fs::path& path,
+                              std::map<std::wstring, std::vector<DictEntry>>& out,
+                              std::wstring& error)
+{
+    std::string body;
+    JsonValue root;
+    if (!ReadFile(path, body)) { error = L"辞書ファイルを開けません: " + path.wstring(); return false; }
+    if (!JsonValue::Parse(body, root)) { error = L"辞書ファイルの JSON が不正です: " + path.wstring(); return false; }
+
+    if (root.isArray()) return ParseEntries(root, out[path.stem().wstring()]);
+    if (!root.isObject()) { error = L"辞書ファイルの形式が不正です: " + path.wstring(); return false; }
+    for (const auto& [name, arr] : root.Members())
+        if (!ParseEntries(arr, out[FromUtf8(name)])) {
+            error = L"辞書 " + FromUtf8(name) + L" がエントリ配列ではありません";
+            return false;
+        }
+    return true;
+}
+
+bool
+krkrvoice::LoadBatchLines(const fs::path& path, std::vector<BatchLine>& out, std::wstring& error)
+{
+    std::string body;
+    if (!ReadFile(path, body)) { error = L"行リストを開けません: " + path.wstring(); return false; }
+
+    std::istringstream ss(body);
+    std::string raw;
+    size_t lineNo = 0;
+    while (std::getline(ss, raw)) {
+        ++lineNo;
+        if (!raw.empty() && raw.back() == '\r') raw.pop_back();
+        if (raw.empty() || raw[0] == '#') continue;
+
+        std::wstring line = FromUtf8(raw);
+        std::vector<std::wstring> cols;
+        size_t pos = 0;
+        while (cols.size() < 2) {
+            auto tab = line.find(L'\t', pos);
+            if (tab == std::wstring::npos) break;
+            cols.push_back(line.substr(pos, tab - pos));
+            pos = tab + 1;
+        }
+        cols.push_back(line.substr(pos));
+
+        BatchLine bl;
+        if (cols.size() == 1) {
+            wchar_t id[16];
+            std::swprintf(id, 16, L"%05zu", lineNo);
+            bl.id   = id;
+            bl.text = cols[0];
+        } else {
+            bl.id   = cols[0];
+            bl.text = cols.back();
+            if (cols.size() == 3) {
+                try { bl.voice = std::stoi(cols[1]); }
+                catch (...) { error = L"音声番号が不正です（" + std::to_wstring(lineNo) + L" 行目）"; return false; }
+            }
+        }
+        if (bl.id.empty() || bl.id.find_first_of(L"/\\:") != std::wstring::npos) {
+            error = L"出力名が不正です（" + std::to_wstring(lineNo) + L" 行目）";
+            return false;
+        }
+        out.push_back(std::move(bl));
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// 一括書き出し
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::RunBatch(const BatchOptions& opt, BatchReport& report, std::wstring& error)
+{
+    std::vector<BatchLine> lines;
+    if (!LoadBatchLines(opt.lines, lines, error)) return false;
+
+    // TTSBridge と同じく、有効な辞書を名前順に連結して 1 つにコンパイルする
+    //  .kvdc は事前コンパイル済み辞書としてそのまま繋ぐ（辞書名はファイル名）
+    std::map<std::wstring, std::vector<DictEntry>> dicts;
+    std::map<std::wstring, CompiledDictionary>     precompiled;
+    for (const auto& p : opt.dictionaries) {
+        if (p.extension() == L".kvdc") {
+            if (!CompiledDictionary::Load(p, precompiled[p.stem().wstring()])) {
+                error = L"コンパイル済み辞書を読めません: " + p.wstring();
+                return false;
+            }
+            continue;
+        }
+        if (!LoadDictionaryFile(p, dicts, error)) return false;
+    }
+    CompiledDictionary dict;
+    std::vector<DictEntry> pending;
+    auto pi = precompiled.begin();
+    for (auto di = dicts.begin(); di != dicts.end() || pi != precompiled.end();) {
+        if (pi != precompiled.end() && (di == dicts.end() || pi->first < di->first)) {
+            if (!pending.empty()) { dict.Append(CompiledDictionary(pending)); pending.clear(); }
+            dict.Append((pi++)->second);
+        } else {
+            pending.insert(pending.end(), di->second.begin(), di->second.end());
+            ++di;
+        }
+    }
+    if (!pending.empty()) dict.Append(CompiledDictionary(pending));
+
+    std::error_code ec;
+    fs::create_directories(opt.outDir, ec);
+    if (!fs::is_directory(opt.outDir)) { error = L"出力先を作成できません: " + opt.outDir.wstring(); return false; }
+
+    auto manifest = ReadManifest(opt.outDir);
+    std::mutex mtx;   // manifest / report を保護
+
+    size_t jobs = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(lines.size(), 1));
+
+    report = BatchReport{};
+    report.total = lines.size();
+    std::atomic<size_t> next{ 0 };
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+#ifdef _WIN32
+        ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+        auto svc = GetTTSService(opt.service, opt.url, opt.port);   // ワーカーごとに 1 エンジン
+        auto fail = [&](const BatchLine& bl, const std::wstring& why) {
+            std::lock_guard<std::mutex> lk(mtx);
+            ++report.failed;
+            report.errors.push_back(bl.id + L": " + why);
+        };
+
+        // 一括合成に対応するエンジン（VOICEVOX）は BatchSize 行ずつ取り、同じ音声の行を 1 回で合成する
+        struct Todo {
+            const BatchLine* line;
+            VoiceInfo        vi;
+            std::wstring     text;
+            std::string      hash;
+            fs::path         dst;
+        };
+        const size_t chunk = svc ? std::max<size_t>(svc->BatchSize(), 1) : 1;
+        for (size_t first; (first = next.fetch_add(chunk)) < lines.size();) {
+            std::vector<Todo> todo;
+            for (size_t i = first; i < std::min(first + chunk, lines.size()); ++i) {
+                const auto& bl = lines[i];
+                VoiceInfo vi;
+                if (!svc) { fail(bl, L"TTS サービスを初期化できません"); continue; }
+                int idx = bl.voice >= 0 ? bl.voice : opt.voice;
+                if (idx < 0 || !svc->ResolveVoice(opt.lang, opt.gender, static_cast<size_t>(idx), vi)) {
+                    fail(bl, L"音声が見つかりません");
+                    continue;
+                }
+
+                std::wstring text = dict.Apply(bl.text);
+                std::string  hash = AudioCache::MakeKey(vi, text, opt.speed, svc->SynthesisFingerprint());
+                fs::path     dst  = opt.outDir / (bl.id + L".wav");
+                {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    auto it = manifest.find(bl.id);
+                    if (!opt.force && it != manifest.end() && it->second == hash && fs::exists(dst)) {
+                        ++report.skipped;
+                        continue;
+                    }
+                }
+                todo.push_back(Todo{ &bl, std::move(vi), std::move(text), std::move(hash), std::move(dst) });
+            }
+
+            for (size_t b = 0; b < todo.size();) {
+                size_t e = b + 1;
+                while (e < todo.size() && SameVoice(todo[e].vi, todo[b].vi)) ++e;
+                std::vector<std::wstring> texts;
+                for (size_t k = b; k < e; ++k) texts.push_back(todo[k].text);
+                std::vector<std::shared_ptr<const AudioClip>> clips;
+                svc->SynthesizeBatch(todo[b].vi, texts, opt.speed, clips);
+
+                for (size_t k = b; k < e; ++k) {
+                    const auto& t    = todo[k];
+                    const auto& clip = clips[k - b];
+                    if (!clip)                       { fail(*t.line, L"合成に失敗しました"); continue; }
+                    if (!WriteWavFile(t.dst, *clip)) { fail(*t.line, L"書き込みに失敗しました"); continue; }
+
+                    std::lock_guard<std::mutex> lk(mtx);
+                    manifest[t.line->id] = t.hash;
+                    ++report.rendered;
+                    report.audioSeconds += clip->Seconds();
+                }
+                b = e;
+            }
+        }
+        svc.reset();   // プールした COM オブジェクトはアパートメントを閉じる前に解放する
+#ifdef _WIN32
+        ::CoUninitialize();
+#endif
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < jobs; ++i) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!WriteManifest(opt.outDir, manifest)) {
+        error = L"管理ファイルを書き込めません";
+        return false;
+    }
+    return true;
+}
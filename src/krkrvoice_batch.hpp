@@ -0,0 +1,61 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_dict.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace krkrvoice {
+
+// 一括書き出しの 1 行
+struct BatchLine {
+    std::wstring id;          // 出力ファイル名（拡張子なし）
+    int          voice = -1;  // 行ごとの音声指定（-1 は既定）
+    std::wstring text;
+};
+
+struct BatchOptions {
+    std::wstring service = L"win";
+    std::wstring url     = L"http://127.0.0.1";
+    int          port    = 50021;
+    std::wstring lang;
+    std::wstring gender;
+    int          voice   = 0;
+    int          speed   = 0;
+    size_t       jobs    = 0;     // 0 ならハードウェアスレッド数
+    bool         force   = false; // 最新でも書き出し直す
+    std::filesystem::path              lines;
+    std::filesystem::path              outDir;
+    std::vector<std::filesystem::path> dictionaries;
+};
+
+struct BatchReport {
+    size_t total    = 0;
+    size_t rendered = 0;
+    size_t skipped  = 0;   // 内容ハッシュが一致し、書き出し不要だったもの
+    size_t failed   = 0;
+    double seconds  = 0;
+    double audioSeconds = 0;
+    std::vector<std::wstring> errors;
+
+    double LinesPerSecond() const { return seconds > 0 ? rendered / seconds : 0; }
+};
+
+// 辞書ファイル（JSON）を読む
+//  { "名前": [ { "pattern": ..., "replacement": ... }, ... ], ... } か、
+//  エントリ配列そのもの（ファイル名を辞書名とする）
+bool LoadDictionaryFile(const std::filesystem::path& path,
+                        std::map<std::wstring, std::vector<DictEntry>>& out,
+                        std::wstring& error);
+
+// 行リストを読む（UTF-8、# で始まる行と空行は無視）
+//  "id<TAB>text" / "id<TAB>voice<TAB>text" / "text"（id は行番号）
+bool LoadBatchLines(const std::filesystem::path& path, std::vector<BatchLine>& out, std::wstring& error);
+
+// 全行を WAV に書き出す。ワーカーごとにエンジンを 1 つずつ生成する
+bool RunBatch(const BatchOptions& opt, BatchReport& report, std::wstring& error);
+
+} // namespace krkrvoice
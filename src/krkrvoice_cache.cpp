@@ -0,0 +1,447 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_cache.cpp   ―  合成済み音声キャッシュ（メモリ LRU + ディスク mmap 層）
+// -----------------------------------------------------------------------------
+#include "krkrvoice_cache.hpp"
+#include "krkrvoice_json.hpp"
+#include "krkrvoice_mmap.hpp"
+#include "krkrvoice_trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace krkrvoice;
+namespace fs = std::filesystem;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr char     kMagic[4]   = { 'K', 'V', 'A', 'C' };
+constexpr uint32_t kVersionRaw = 1;   // ヘッダの後に PCM をそのまま（以前の形式。読むだけ）
+constexpr uint32_t kVersion    = 2;   // ヘッダの後に CompressedClip のバイト列
+constexpr wchar_t  kExt[]      = L".kvac";
+
+#pragma pack(push, 1)
+struct DiskHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint64_t sampleCount;
+};
+#pragma pack(pop)
+
+static uint64_t Mix64(uint64_t x)
+{
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t Hash64(const std::string& s, uint64_t seed)
+{
+    uint64_t h = 0xcbf29ce484222325ull ^ Mix64(seed);
+    for (unsigned char c : s) { h ^= c; h *= 0x100000001b3ull; }
+    return Mix64(h ^ s.size());
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// AudioCache 実装
+// -----------------------------------------------------------------------------
+AudioCache::AudioCache(size_t memoryBudget)
+    : memBudget_(memoryBudget)
+{
+}
+
+std::string
+AudioCache::MakeKey(const VoiceInfo& voice, const std::wstring& text, int speed, uint64_t fingerprint)
+{
+    std::string src = ToUtf8(voice.engine + L'\x1f' + voice.displayName + L'\x1f' +
+                             voice.lang + L'\x1f' + text);
+    src += '\x1f';
+    src += std::to_string(speed);
+    if (fingerprint) {   // 既定の設定のキーは変えない（既存のディスク層をそのまま使う）
+        src += '\x1f';
+        src += std::to_string(fingerprint);
+    }
+
+    char buf[33];
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx",
+                  static_cast<unsigned long long>(Hash64(src, 1)),
+                  static_cast<unsigned long long>(Hash64(src, 2)));
+    return buf;
+}
+
+fs::path
+AudioCache::PathOf(const std::string& key) const
+{
+    fs::path p = diskDir_ / key;
+    p += kExt;
+    return p;
+}
+
+void
+AudioCache::SetDiskStore(const fs::path& dir, uint64_t diskBudget)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    diskDir_    = dir;
+    diskBudget_ = diskBudget;
+    diskBytes_  = 0;
+    diskLru_.clear();
+    disk_.clear();
+    if (dir.empty()) return;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    // 既存ファイルを古い順に並べて索引化（先頭が最新）
+    std::vector<std::pair<fs::file_time_type, DiskEntry>> found;
+    for (const auto& e : fs::directory_iterator(dir, ec)) {
+        if (!e.is_regular_file(ec) || e.path().extension() != kExt) continue;
+        found.push_back({ e.last_write_time(ec),
+                          DiskEntry{ e.path().stem().string(), static_cast<uint64_t>(e.file_size(ec)) } });
+    }
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& [t, d] : found) {
+        diskBytes_ += d.bytes;
+        diskLru_.push_front(d);
+        disk_[d.key] = diskLru_.begin();
+    }
+    TrimDisk();
+}
+
+void
+AudioCache::SetMemoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    memBudget_ = bytes;
+    TrimMemory();
+}
+
+void
+AudioCache::SetTolerance(int tolerance)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    tolerance_ = std::max(tolerance, 0);
+}
+
+void
+AudioCache::EvictLast()
+{
+    auto& last = lru_.back();
+    memBytes_    -= last.bytes;
+    memPcmBytes_ -= last.packed->PcmBytes();
+    memory_.Release(last.bytes);
+    mem_.erase(last.key);
+    lru_.pop_back();
+    ++stats_.evictions;
+}
+
+void
+AudioCache::TrimMemory()
+{
+    while (memBytes_ > memBudget_ && !lru_.empty()) EvictLast();
+}
+
+size_t
+AudioCache::Reclaim(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    const size_t before = memBytes_;
+    while (before - memBytes_ < bytes && !lru_.empty()) EvictLast();
+    return before - memBytes_;
+}
+
+void
+AudioCache::TrimDisk()
+{
+    while (diskBytes_ > diskBudget_ && !diskLru_.empty()) {
+        auto& last = diskLru_.back();
+        std::error_code ec;
+        fs::remove(PathOf(last.key), ec);
+        diskBytes_ -= last.bytes;
+        disk_.erase(last.key);
+        diskLru_.pop_back();
+        ++stats_.diskEvictions;
+    }
+}
+
+bool
+AudioCache::ReadDisk(const std::string& key, AudioClip& out, CompressedClip& packed) const
+{
+    MappedFile mf;
+    if (!mf.Open(PathOf(key)) || mf.size() < sizeof(DiskHeader)) return false;
+    DiskHeader h;
+    std::memcpy(&h, mf.data(), sizeof(h));
+    if (std::memcmp(h.magic, kMagic, 4) || !h.channels) return false;
+    if (h.version == kVersionRaw) {
+        if (h.sampleCount > (mf.size() - sizeof(h)) / sizeof(int16_t)) return false;
+        out.sampleRate = static_cast<int>(h.sampleRate);
+        out.channels   = static_cast<int>(h.channels);
+        out.samples.resize(static_cast<size_t>(h.sampleCount));
+        std::memcpy(out.samples.data(), mf.data() + sizeof(h), out.Bytes());
+        packed = CompressedClip(out);
+        return true;
+    }
+    if (h.version != kVersion || !packed.Assign(mf.data() + sizeof(h), mf.size() - sizeof(h)) ||
+        packed.SampleRate() != static_cast<int>(h.sampleRate) ||
+        packed.Channels() != static_cast<int>(h.channels) ||
+        packed.Frames() * h.channels != h.sampleCount)
+        return false;
+    return packed.Decode(out);
+}
+
+bool
+AudioCache::WriteDisk(const std::string& key, const CompressedClip& packed) const
+{
+    fs::path dst = PathOf(key);
+    fs::path tmp = dst;
+    tmp += L".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        DiskHeader h{};
+        std::memcpy(h.magic, kMagic, 4);
+        h.version     = kVersion;
+        h.sampleRate  = static_cast<uint32_t>(packed.SampleRate());
+        h.channels    = static_cast<uint32_t>(packed.Channels());
+        h.sampleCount = packed.Frames() * static_cast<uint64_t>(packed.Channels());
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(reinterpret_cast<const char*>(packed.Data().data()), static_cast<std::streamsize>(packed.Bytes()));
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, dst, ec);                       // 書き込み途中のファイルを読ませない
+    if (ec) { fs::remove(tmp, ec); return false; }
+    return true;
+}
+
+void
+AudioCache::Remember(const std::string& key, std::shared_ptr<const CompressedClip> packed)
+{
+    const size_t bytes = packed->Bytes();
+    if (bytes > memBudget_) {
+        memory_.Release(bytes);
+        return;
+    }
+    memBytes_    += bytes;
+    memPcmBytes_ += packed->PcmBytes();
+    lru_.push_front(MemEntry{ key, std::move(packed), bytes });
+    mem_[key] = lru_.begin();
+    TrimMemory();
+}
+
+std::shared_ptr<const AudioClip>
+AudioCache::Get(const std::string& key)
+{
+    std::shared_ptr<const CompressedClip> hit;
+    fs::path dir;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = mem_.find(key);
+        if (it != mem_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            ++stats_.hits;
+            hit = it->second->packed;
+        } else {
+            auto dt = disk_.find(key);
+            if (dt == disk_.end()) { ++stats_.misses; return nullptr; }
+            diskLru_.splice(diskLru_.begin(), diskLru_, dt->second);
+            dir = diskDir_;
+        }
+    }
+
+    // 復号はロック外で、返す AudioClip へ直接
+    auto clip = std::make_shared<AudioClip>();
+    if (hit) return hit->Decode(*clip) ? clip : nullptr;
+
+    auto packed = std::make_shared<CompressedClip>();
+    bool ok = ReadDisk(key, *clip, *packed);
+    const bool charged = ok && memory_.Reserve(packed->Bytes());   // メモリ層にも載せる分
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!ok) {                                        // 壊れた・消えたファイルは索引から外す
+        auto dt = disk_.find(key);
+        if (dt != disk_.end() && diskDir_ == dir) {
+            diskBytes_ -= dt->second->bytes;
+            diskLru_.erase(dt->second);
+            disk_.erase(dt);
+        }
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    ++stats_.diskHits;
+    if (!charged) return clip;
+    if (mem_.count(key)) memory_.Release(packed->Bytes());
+    else                 Remember(key, std::move(packed));
+    return clip;
+}
+
+void
+AudioCache::Put(const std::string& key, std::shared_ptr<const AudioClip> clip)
+{
+    if (!clip) return;
+    int tolerance;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        tolerance = tolerance_;
+    }
+    // 圧縮はロック外で行う
+    auto packed = std::make_shared<const CompressedClip>(*clip, tolerance);
+    if (packed->empty()) return;
+    // メモリ予算が足りなければメモリ層には置かない（ディスク層には書く）
+    const bool charged = memory_.Reserve(packed->Bytes());
+
+    fs::path dir;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = mem_.find(key);
+        if (it != mem_.end()) {
+            memBytes_    -= it->second->bytes;
+            memPcmBytes_ -= it->second->packed->PcmBytes();
+            memory_.Release(it->second->bytes);
+            lru_.erase(it->second);
+            mem_.erase(it);
+        }
+        if (charged) Remember(key, packed);
+        if (diskDir_.empty() || disk_.count(key)) return;
+        dir = diskDir_;
+    }
+
+    // ディスク書き込みもロック外で行う
+    if (!WriteDisk(key, *packed)) return;
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (diskDir_ != dir || disk_.count(key)) return;
+    uint64_t bytes = sizeof(DiskHeader) + packed->Bytes();
+    diskLru_.push_front(DiskEntry{ key, bytes });
+    disk_[key] = diskLru_.begin();
+    diskBytes_ += bytes;
+    TrimDisk();
+}
+
+void
+AudioCache::Clear()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    memory_.Release(memBytes_);
+    lru_.clear();
+    mem_.clear();
+    memBytes_    = 0;
+    memPcmBytes_ = 0;
+    for (const auto& d : diskLru_) {
+        std::error_code ec;
+        fs::remove(PathOf(d.key), ec);
+    }
+    diskLru_.clear();
+    disk_.clear();
+    diskBytes_ = 0;
+}
+
+AudioCacheStats
+AudioCache::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    AudioCacheStats st = stats_;
+    st.memoryBytes    = memBytes_;
+    st.memoryPcmBytes = memPcmBytes_;
+    st.memoryEntries  = mem_.size();
+    st.diskBytes      = diskBytes_;
+    st.diskEntries    = disk_.size();
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// CachedTTSService 実装
+// -----------------------------------------------------------------------------
+CachedTTSService::CachedTTSService(std::shared_ptr<ITTSService> inner, size_t memoryBudget)
+    : ForwardingTTSService(std::move(inner)), cache_(memoryBudget)
+{
+}
+
+std::shared_ptr<const AudioClip>
+CachedTTSService::Fetch(const VoiceInfo& voice, const std::wstring& text, int speed,
+                        const CancelToken& cancel)
+{
+    auto key = AudioCache::MakeKey(voice, text, speed, inner_->SynthesisFingerprint());
+    if (auto hit = cache_.Get(key)) return hit;
+
+    auto clip = std::make_shared<AudioClip>();
+    {
+        StageTimer t(TraceStage::Synthesis);
+        if (!inner_->Synthesize(voice, text, speed, *clip, cancel)) return nullptr;
+    }
+    cache_.Put(key, clip);
+    return clip;
+}
+
+bool
+CachedTTSService::Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                             int speed, AudioClip& out, const CancelToken& cancel)
+{
+    auto clip = Fetch(voice, text, speed, cancel);
+    if (!clip) return false;
+    out = *clip;
+    return true;
+}
+
+// ヒットしなかった行だけを内側にまとめて渡す
+void
+CachedTTSService::SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                                  std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel)
+{
+    out.assign(texts.size(), nullptr);
+    const auto fingerprint = inner_->SynthesisFingerprint();
+    std::vector<std::string>  keys(texts.size());
+    std::vector<std::wstring> missText;
+    std::vector<size_t>       missIdx;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        keys[i] = AudioCache::MakeKey(voice, texts[i], speed, fingerprint);
+        if (auto hit = cache_.Get(keys[i])) {
+            out[i] = std::move(hit);
+        } else {
+            missText.push_back(texts[i]);
+            missIdx.push_back(i);
+        }
+    }
+    if (missText.empty()) return;
+
+    std::vector<std::shared_ptr<const AudioClip>> made;
+    {
+        StageTimer t(TraceStage::Synthesis);
+        inner_->SynthesizeBatch(voice, missText, speed, made, cancel);
+    }
+    for (size_t k = 0; k < missIdx.size() && k < made.size(); ++k) {
+        if (!made[k]) continue;
+        cache_.Put(keys[missIdx[k]], made[k]);
+        out[missIdx[k]] = std::move(made[k]);
+    }
+}
+
+bool
+CachedTTSService::SpeakText(const VoiceInfo& voice,
+                            const std::wstring& text,
+                            int  speed,
+                            bool sync,
+                            bool overlap,
+                            std::function<void()> onFinish,
+                            const CancelToken& cancel)
+{
+    if (!inner_->CanSynthesize(voice))   // 合成単体に対応しないサービス
+        return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel);
+
+    auto clip = Fetch(voice, text, speed, cancel);
+    if (!clip) {   // 取り消し・エンジン側の失敗（SpeakText で合成し直さない）
+        if (onFinish) onFinish();
+        return false;
+    }
+    return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_codec.hpp"
+#include "krkrvoice_memory.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace krkrvoice {
+
+struct AudioCacheStats {
+    std::uint64_t hits           = 0;   // メモリ + ディスク
+    std::uint64_t diskHits       = 0;
+    std::uint64_t misses         = 0;
+    std::uint64_t evictions      = 0;   // メモリ層からの追い出し
+    std::uint64_t diskEvictions  = 0;
+    std::uint64_t memoryBytes    = 0;   // 圧縮後
+    std::uint64_t memoryPcmBytes = 0;   // 同じ音声を PCM のまま持った場合
+    std::uint64_t memoryEntries  = 0;
+    std::uint64_t diskBytes      = 0;
+    std::uint64_t diskEntries    = 0;
+};
+
+// 合成済み音声のコンテンツアドレス型キャッシュ
+//  - キーは (engine, voice, 辞書適用後テキスト, speed) のハッシュ
+//  - メモリ層：バイト上限付き LRU
+//  - ディスク層：キーごとの .kvac ファイルをメモリマップで読む（再起動後も有効）
+//  どちらの層も CompressedClip で圧縮して持ち、取り出すたびに返す AudioClip へ直接復号する
+//  メモリ層はメモリ予算（MemoryGovernor）の Cache として数え、予算が足りなければ古いものから手放す
+class AudioCache {
+public:
+    explicit AudioCache(size_t memoryBudget = 64u << 20);
+
+    // ディスク層を有効化（空パスで無効）。既存ファイルを走査して索引を作る
+    void SetDiskStore(const std::filesystem::path& dir, std::uint64_t diskBudget);
+    void SetMemoryBudget(size_t bytes);
+    // 圧縮で許す誤差（0 で可逆）。以後に入れるものから効く
+    void SetTolerance(int tolerance);
+
+    // fingerprint は ITTSService::SynthesisFingerprint（0 なら混ぜない）
+    static std::string MakeKey(const VoiceInfo& voice, const std::wstring& text, int speed,
+                               std::uint64_t fingerprint = 0);
+
+    std::shared_ptr<const AudioClip> Get(const std::string& key);
+    void Put(const std::string& key, std::shared_ptr<const AudioClip> clip);
+    void Clear();
+
+    AudioCacheStats Stats() const;
+
+private:
+    struct MemEntry {
+        std::string                           key;
+        std::shared_ptr<const CompressedClip> packed;
+        size_t                                bytes;
+    };
+    struct DiskEntry {
+        std::string   key;
+        std::uint64_t bytes;
+    };
+
+    void TrimMemory();                       // mtx_ 保持中に呼ぶ
+    void EvictLast();                        // 同上
+    size_t Reclaim(size_t bytes);            // メモリ予算から呼ばれる
+    void TrimDisk();                         // 同上
+    std::filesystem::path PathOf(const std::string& key) const;
+    bool ReadDisk(const std::string& key, AudioClip& out, CompressedClip& packed) const;
+    bool WriteDisk(const std::string& key, const CompressedClip& packed) const;
+    // mtx_ 保持中に呼ぶ。packed->Bytes() は memory_ で確保済み（入れなければ返す）
+    void Remember(const std::string& key, std::shared_ptr<const CompressedClip> packed);
+
+    mutable std::mutex mtx_;
+    size_t memBudget_;
+    size_t memBytes_    = 0;
+    size_t memPcmBytes_ = 0;
+    int    tolerance_   = 0;
+    std::list<MemEntry> lru_;                // 先頭が最新
+    std::unordered_map<std::string, std::list<MemEntry>::iterator> mem_;
+
+    std::filesystem::path diskDir_;
+    std::uint64_t diskBudget_ = 0;
+    std::uint64_t diskBytes_  = 0;
+    std::list<DiskEntry> diskLru_;
+    std::unordered_map<std::string, std::list<DiskEntry>::iterator> disk_;
+
+    AudioCacheStats stats_;
+
+    MemoryAccount memory_{MemoryClass::Cache, [this](size_t bytes) { return Reclaim(bytes); }};
+};
+
+// 任意の ITTSService の前段に置くキャッシュ層
+//  ヒット時は合成を呼ばずに、ミス時は Synthesize した結果を、内側サービスの PlayAudio で再生する。
+//  合成単体に対応する音声は内側の SpeakText を通らないので、エンジン固有の再生経路
+//  （SAPI の完了通知、VOICEVOX の合成を待たない逐次再生など）は使わない。
+//  Synthesize 非対応（CanSynthesize が false）の音声はそのまま SpeakText に委譲する。
+class CachedTTSService final : public ForwardingTTSService {
+public:
+    CachedTTSService(std::shared_ptr<ITTSService> inner, size_t memoryBudget = 64u << 20);
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    void SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                         std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {}) override;
+
+    // キャッシュ経由で合成（ヒットなら合成しない）。失敗時は nullptr
+    std::shared_ptr<const AudioClip> Fetch(const VoiceInfo& voice, const std::wstring& text, int speed,
+                                           const CancelToken& cancel = {});
+
+    AudioCache& Cache() { return cache_; }
+
+private:
+    AudioCache cache_;
+};
+
+} // namespace krkrvoice
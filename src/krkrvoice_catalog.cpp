@@ -0,0 +1,380 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_catalog.cpp   ―  音声カタログ（列挙結果のキャッシュと索引）
+// -----------------------------------------------------------------------------
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_json.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <iterator>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+static std::wstring Lower(const std::wstring& s)
+{
+    std::wstring r(s);
+    for (auto& c : r) c = static_cast<wchar_t>(std::towlower(c));
+    return r;
+}
+
+// 索引キー（空文字列はワイルドカード）
+static std::wstring IndexKey(const std::wstring& lang, const std::wstring& gender)
+{
+    return Lower(lang) + L'\x1f' + Lower(gender);
+}
+
+static std::wstring IdentityKey(const VoiceInfo& v)
+{
+    return v.engine + L'\x1f' + v.displayName + L'\x1f' + v.lang;
+}
+
+// -----------------------------------------------------------------------------
+// スナップショット（.kvvc）
+//  ヘッダ: "KVVC" version 音声数 並び数（u32 LE）
+//  本体  : 指紋、音声（service u8, 列挙に含まれていたか u8, engine, displayName, lang, gender）、
+//          列挙順のハンドル（u32）。文字列は u32 のバイト数 + UTF-8
+// -----------------------------------------------------------------------------
+constexpr char     kSnapMagic[4] = { 'K', 'V', 'V', 'C' };
+constexpr uint32_t kSnapVersion  = 1;
+
+class SnapWriter {
+public:
+    void U8(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+    void U32(uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i) buf_.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+    void Str(std::string_view s)
+    {
+        U32(static_cast<uint32_t>(s.size()));
+        buf_.append(s);
+    }
+    void Str(const std::wstring& s) { Str(ToUtf8(s)); }
+    std::string& buf() { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+class SnapReader {
+public:
+    explicit SnapReader(std::string_view s) : s_(s) {}
+
+    bool U8(uint8_t& v)
+    {
+        if (pos_ + 1 > s_.size()) return false;
+        v = static_cast<uint8_t>(s_[pos_++]);
+        return true;
+    }
+    bool U32(uint32_t& v)
+    {
+        if (pos_ + 4 > s_.size()) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(s_[pos_ + i])) << (8 * i);
+        pos_ += 4;
+        return true;
+    }
+    bool Str(std::string& out)
+    {
+        uint32_t n;
+        if (!U32(n) || n > s_.size() - pos_) return false;
+        out.assign(s_.data() + pos_, n);
+        pos_ += n;
+        return true;
+    }
+    bool Str(std::wstring& out)
+    {
+        std::string s;
+        if (!Str(s)) return false;
+        out = FromUtf8(s);
+        return true;
+    }
+    bool AtEnd() const { return pos_ == s_.size(); }
+
+private:
+    std::string_view s_;
+    size_t           pos_ = 0;
+};
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// VoiceCatalog 実装
+// -----------------------------------------------------------------------------
+VoiceCatalog::VoiceCatalog(Enumerator enumerate, Fingerprint fingerprint)
+    : enumerate_(std::move(enumerate))
+    , fingerprint_(std::move(fingerprint))
+{
+}
+
+VoiceCatalog::~VoiceCatalog()
+{
+    Shutdown();
+}
+
+void
+VoiceCatalog::EnsureLoaded()
+{
+    if (loaded_) { ++avoided_; return; }
+    Load();
+}
+
+void
+VoiceCatalog::Load()
+{
+    // 指紋は列挙より先に取る（列挙中に変わっても、次回の起動で確認し直される）
+    std::string fp = !snapshot_.empty() && fingerprint_ ? fingerprint_() : std::string();
+    Apply(enumerate_ ? enumerate_() : std::vector<VoiceInfo>{});
+    ++enumerations_;
+    if (!snapshot_.empty()) WriteSnapshot(fp);
+}
+
+void
+VoiceCatalog::Apply(const std::vector<VoiceInfo>& list)
+{
+    index_.clear();
+    present_.assign(voices_.size(), false);
+    for (auto& v : list) {
+        auto key = IdentityKey(v);
+        auto it  = byIdentity_.find(key);
+        VoiceHandle h;
+        if (it == byIdentity_.end()) {
+            voices_.push_back(v);
+            present_.push_back(true);
+            h = static_cast<VoiceHandle>(voices_.size());
+            byIdentity_.emplace(std::move(key), h);
+        } else {
+            h = it->second;
+            voices_[h - 1]  = v;
+            present_[h - 1] = true;
+        }
+        voices_[h - 1].handle = h;
+
+        for (const auto& k : { IndexKey(v.lang, v.gender), IndexKey(v.lang, L""),
+                               IndexKey(L"", v.gender),    IndexKey(L"", L"") })
+            index_[k].push_back(h);
+    }
+    loaded_ = true;
+}
+
+void
+VoiceCatalog::Reindex(const std::vector<VoiceHandle>& order)
+{
+    index_.clear();
+    for (auto h : order) {
+        const auto& v = voices_[h - 1];
+        for (const auto& k : { IndexKey(v.lang, v.gender), IndexKey(v.lang, L""),
+                               IndexKey(L"", v.gender),    IndexKey(L"", L"") })
+            index_[k].push_back(h);
+    }
+}
+
+const std::vector<VoiceHandle>*
+VoiceCatalog::Lookup(const std::wstring& lang, const std::wstring& gender) const
+{
+    auto it = index_.find(IndexKey(lang, gender));
+    return it == index_.end() ? nullptr : &it->second;
+}
+
+std::vector<VoiceInfo>
+VoiceCatalog::List(const std::wstring& lang, const std::wstring& gender)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    EnsureLoaded();
+    std::vector<VoiceInfo> out;
+    if (auto hs = Lookup(lang, gender)) {
+        out.reserve(hs->size());
+        for (auto h : *hs) out.push_back(voices_[h - 1]);
+    }
+    return out;
+}
+
+bool
+VoiceCatalog::Resolve(const std::wstring& lang, const std::wstring& gender, size_t idx, VoiceInfo& out)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    EnsureLoaded();
+    auto hs = Lookup(lang, gender);
+    if (!hs || idx >= hs->size()) return false;
+    out = voices_[(*hs)[idx] - 1];
+    return true;
+}
+
+bool
+VoiceCatalog::Find(VoiceHandle handle, VoiceInfo& out)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    EnsureLoaded();
+    if (handle == kInvalidVoiceHandle || handle > voices_.size() || !present_[handle - 1])
+        return false;
+    out = voices_[handle - 1];
+    return true;
+}
+
+void
+VoiceCatalog::Refresh()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    Load();
+}
+
+VoiceCatalogStats
+VoiceCatalog::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    VoiceCatalogStats st;
+    st.enumerations = enumerations_;
+    st.avoided      = avoided_;
+    if (auto hs = Lookup(L"", L"")) st.voices = hs->size();
+    st.snapshotLoaded     = snapStats_.snapshotLoaded;
+    st.fingerprintMatches = snapStats_.fingerprintMatches;
+    st.snapshotWrites     = snapStats_.snapshotWrites;
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// スナップショット
+// -----------------------------------------------------------------------------
+bool
+VoiceCatalog::UseSnapshot(const std::filesystem::path& path)
+{
+    Shutdown();
+    std::lock_guard<std::mutex> lk(mtx_);
+    snapshot_ = path;
+    if (loaded_) {                       // 列挙済みなら今の一覧を書き出しておく
+        WriteSnapshot(fingerprint_ ? fingerprint_() : std::string());
+        return false;
+    }
+    std::string saved;
+    if (!ReadSnapshot(path, saved)) return false;
+
+    loaded_       = true;
+    revalidating_ = true;
+    snapStats_.snapshotLoaded = 1;
+    revalidator_ = std::thread([this, saved] { Revalidate(saved); });
+    return true;
+}
+
+// 裏での確認。指紋が一致すれば何もしない。違う・作れないときは列挙し直して差し替える
+//  列挙できなければ（エンジン未起動など）スナップショットのまま
+void
+VoiceCatalog::Revalidate(std::string snapshotFingerprint)
+{
+    std::string fp = fingerprint_ ? fingerprint_() : std::string();
+    const bool same = !fp.empty() && fp == snapshotFingerprint;
+    auto list = !same && enumerate_ ? enumerate_() : std::vector<VoiceInfo>{};
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (same) {
+        ++snapStats_.fingerprintMatches;
+    } else {
+        ++enumerations_;
+        if (!list.empty()) {
+            Apply(list);
+            WriteSnapshot(fp);
+        }
+    }
+    revalidating_ = false;
+    revalidated_.notify_all();
+}
+
+void
+VoiceCatalog::WaitRevalidated()
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    revalidated_.wait(lk, [&] { return !revalidating_; });
+}
+
+void
+VoiceCatalog::Shutdown()
+{
+    if (revalidator_.joinable()) revalidator_.join();
+}
+
+bool
+VoiceCatalog::ReadSnapshot(const std::filesystem::path& path, std::string& fingerprint)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::string body((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (body.size() < sizeof(kSnapMagic) || std::memcmp(body.data(), kSnapMagic, sizeof(kSnapMagic)) != 0)
+        return false;
+
+    SnapReader r(std::string_view(body).substr(sizeof(kSnapMagic)));
+    uint32_t version, count, orderCount;
+    if (!r.U32(version) || version != kSnapVersion || !r.U32(count) || !r.U32(orderCount) ||
+        !r.Str(fingerprint) || count > body.size() || orderCount > count)
+        return false;
+
+    std::vector<VoiceInfo> voices(count);
+    std::vector<bool>      present(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t service, here;
+        auto& v = voices[i];
+        if (!r.U8(service) || !r.U8(here) || service > static_cast<uint8_t>(TTSService::Mock) ||
+            !r.Str(v.engine) || !r.Str(v.displayName) || !r.Str(v.lang) || !r.Str(v.gender))
+            return false;
+        v.service  = static_cast<TTSService>(service);
+        v.handle   = static_cast<VoiceHandle>(i + 1);
+        present[i] = here != 0;
+    }
+    std::vector<VoiceHandle> order(orderCount);
+    for (auto& h : order)
+        if (!r.U32(h) || h == kInvalidVoiceHandle || h > count || !present[h - 1]) return false;
+    if (!r.AtEnd()) return false;
+
+    voices_  = std::move(voices);
+    present_ = std::move(present);
+    byIdentity_.clear();
+    for (const auto& v : voices_) byIdentity_.emplace(IdentityKey(v), v.handle);
+    Reindex(order);
+    return true;
+}
+
+bool
+VoiceCatalog::WriteSnapshot(const std::string& fingerprint)
+{
+    namespace fs = std::filesystem;
+    const std::vector<VoiceHandle> none;
+    const auto* order = Lookup(L"", L"");
+    if (!order) order = &none;
+
+    SnapWriter w;
+    w.buf().append(kSnapMagic, sizeof(kSnapMagic));
+    w.U32(kSnapVersion);
+    w.U32(static_cast<uint32_t>(voices_.size()));
+    w.U32(static_cast<uint32_t>(order->size()));
+    w.Str(fingerprint);
+    for (size_t i = 0; i < voices_.size(); ++i) {
+        const auto& v = voices_[i];
+        w.U8(static_cast<uint8_t>(v.service));
+        w.U8(present_[i] ? 1 : 0);
+        w.Str(v.engine);
+        w.Str(v.displayName);
+        w.Str(v.lang);
+        w.Str(v.gender);
+    }
+    for (auto h : *order) w.U32(h);
+
+    std::error_code ec;
+    if (snapshot_.has_parent_path()) fs::create_directories(snapshot_.parent_path(), ec);
+    fs::path tmp = snapshot_;
+    tmp += L".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        f.write(w.buf().data(), static_cast<std::streamsize>(w.buf().size()));
+        if (!f) return false;
+    }
+    fs::rename(tmp, snapshot_, ec);
+    if (ec) { fs::remove(tmp, ec); return false; }
+    ++snapStats_.snapshotWrites;
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "krkrvoice.hpp"
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace krkrvoice {
+
+// 一度だけ列挙して (lang, gender) で索引化した音声カタログ
+//  - 再列挙は Refresh() を呼んだときのみ
+//  - ハンドルは (engine, displayName, lang) ごとに固定で、Refresh 後も変わらない
+//  - スナップショットを指定すると、列挙結果とハンドルをファイルに残し、次回の起動では列挙せずに読み込む
+class VoiceCatalog {
+public:
+    using Enumerator = std::function<std::vector<VoiceInfo>()>;
+    // 音声の追加・削除で変わる、列挙よりずっと安い値（作れないサービスは空関数。空文字列は「不明」）
+    using Fingerprint = std::function<std::string()>;
+
+    explicit VoiceCatalog(Enumerator enumerate, Fingerprint fingerprint = {});
+    ~VoiceCatalog();
+
+    VoiceCatalog(const VoiceCatalog&)            = delete;
+    VoiceCatalog& operator=(const VoiceCatalog&) = delete;
+
+    // 空文字列のフィルタは無視（比較は大文字小文字を区別しない）
+    std::vector<VoiceInfo> List(const std::wstring& lang, const std::wstring& gender);
+    bool Resolve(const std::wstring& lang, const std::wstring& gender, size_t idx, VoiceInfo& out);
+    bool Find(VoiceHandle handle, VoiceInfo& out);
+
+    void Refresh();
+    VoiceCatalogStats Stats() const;
+
+    // スナップショットを使う（最初の一覧取得より前に呼ぶ）
+    //  読めればそれを一覧として即座に使い、裏で指紋を確かめる。指紋が違う・作れないときは
+    //  裏で列挙し直して差し替え、書き直す。読めなければ初回の列挙後に書き出す
+    bool UseSnapshot(const std::filesystem::path& path);
+    void WaitRevalidated();   // 裏での確認が終わるまで待つ
+    void Shutdown();          // 裏での確認を待って止める（列挙関数が使うメンバより先に呼ぶ）
+
+private:
+    void EnsureLoaded();   // mtx_ 保持中に呼ぶ
+    void Load();           // 同上
+    void Apply(const std::vector<VoiceInfo>& list);          // 同上
+    void Reindex(const std::vector<VoiceHandle>& order);     // 同上
+    bool ReadSnapshot(const std::filesystem::path& path, std::string& fingerprint);   // 同上
+    bool WriteSnapshot(const std::string& fingerprint);      // 同上
+    void Revalidate(std::string snapshotFingerprint);
+    const std::vector<VoiceHandle>* Lookup(const std::wstring& lang, const std::wstring& gender) const;
+
+    Enumerator  enumerate_;
+    Fingerprint fingerprint_;
+
+    mutable std::mutex mtx_;
+    bool loaded_ = false;
+    std::vector<VoiceInfo> voices_;                                    // handle - 1 → 音声（削除しない）
+    std::vector<bool>      present_;                                   // 直近の列挙に含まれていたか
+    std::unordered_map<std::wstring, VoiceHandle> byIdentity_;
+    std::unordered_map<std::wstring, std::vector<VoiceHandle>> index_; // 索引キー → 列挙順のハンドル
+
+    std::uint64_t enumerations_ = 0;
+    std::uint64_t avoided_      = 0;
+
+    std::filesystem::path   snapshot_;
+    VoiceCatalogStats       snapStats_;
+    bool                    revalidating_ = false;
+    std::condition_variable revalidated_;
+    std::thread             revalidator_;
+};
+
+} // namespace krkrvoice
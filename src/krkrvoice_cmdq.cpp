@@ -0,0 +1,73 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_cmdq.cpp   ―  呼び出し元を待たせないコマンドスレッド
+// -----------------------------------------------------------------------------
+#include "krkrvoice_cmdq.hpp"
+
+using namespace krkrvoice;
+
+CommandThread::CommandThread()
+    : thread_([this] { Loop(); })
+{
+}
+
+CommandThread::~CommandThread()
+{
+    {
+        std::lock_guard<std::mutex> lk(wakeMtx_);
+        stop_ = true;
+        sleeping_ = false;
+    }
+    wakeCv_.notify_one();
+    thread_.join();
+}
+
+void
+CommandThread::Post(Command cmd)
+{
+    posted_.fetch_add(1, std::memory_order_relaxed);
+    queue_.Push(std::move(cmd));
+    // 消費者が「空を確認して眠る」途中なら sleeping_ は既に true なので必ず起こせる
+    if (sleeping_.exchange(false)) {
+        { std::lock_guard<std::mutex> lk(wakeMtx_); }
+        wakeCv_.notify_one();
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void
+CommandThread::Drain()
+{
+    Command cmd;
+    while (queue_.TryPop(cmd)) {
+        cmd();
+        cmd = nullptr;
+        executed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void
+CommandThread::Loop()
+{
+    while (true) {
+        Drain();
+        std::unique_lock<std::mutex> lk(wakeMtx_);
+        if (stop_) break;
+        sleeping_ = true;
+        if (!queue_.Empty()) {            // 眠る直前に積まれたもの
+            sleeping_ = false;
+            continue;
+        }
+        wakeCv_.wait(lk, [&] { return !sleeping_ || stop_; });
+    }
+    Drain();
+}
+
+CommandQueueStats
+CommandThread::Stats() const
+{
+    CommandQueueStats st;
+    st.posted   = posted_.load(std::memory_order_relaxed);
+    st.executed = executed_.load(std::memory_order_relaxed);
+    st.wakeups  = wakeups_.load(std::memory_order_relaxed);
+    return st;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace krkrvoice {
+
+// 複数生産者・単一消費者のロックなしキュー（Vyukov 方式の連結リスト）
+//  Push は exchange 1 回 + store 1 回で、生産者同士も消費者も待たない
+template <class T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load()) {}
+    ~MpscQueue()
+    {
+        for (Node* n = tail_; n;) {
+            Node* next = n->next.load(std::memory_order_relaxed);
+            delete n;
+            n = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&)            = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T v)
+    {
+        Node* n = new Node(std::move(v));
+        Node* prev = head_.exchange(n);
+        prev->next.store(n);
+    }
+
+    // 消費者スレッドからのみ呼ぶ。生産者が繋ぎ終える前の要素は見えない（次回取れる）
+    bool TryPop(T& out)
+    {
+        Node* next = tail_->next.load();
+        if (!next) return false;
+        out = std::move(next->value);
+        delete tail_;
+        tail_ = next;   // 取り出した節点が新しい番兵になる
+        return true;
+    }
+
+    bool Empty() const { return tail_->next.load() == nullptr; }   // 消費者スレッド用
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node*> next{ nullptr };
+        T                  value{};
+    };
+
+    std::atomic<Node*> head_;   // 生産者が繋ぐ側
+    Node*              tail_;   // 消費者が読む側（番兵）
+};
+
+struct CommandQueueStats {
+    std::uint64_t posted   = 0;
+    std::uint64_t executed = 0;
+    std::uint64_t wakeups  = 0;   // 眠っていた消費者を起こした回数
+};
+
+// 専用スレッドでコマンドを投入順に実行する
+//  Post は MpscQueue に積むだけで、消費者が眠っているときだけ起床通知を送る
+class CommandThread {
+public:
+    using Command = std::function<void()>;
+
+    CommandThread();
+    ~CommandThread();   // 積まれているコマンドを実行し終えてから止まる
+
+    CommandThread(const CommandThread&)            = delete;
+    CommandThread& operator=(const CommandThread&) = delete;
+
+    void Post(Command cmd);
+
+    CommandQueueStats Stats() const;
+
+private:
+    void Loop();
+    void Drain();
+
+    MpscQueue<Command> queue_;
+    std::atomic_bool   sleeping_{ false };
+    std::atomic_bool   stop_{ false };
+    std::mutex              wakeMtx_;
+    std::condition_variable wakeCv_;
+
+    std::atomic<std::uint64_t> posted_{ 0 };
+    std::atomic<std::uint64_t> executed_{ 0 };
+    std::atomic<std::uint64_t> wakeups_{ 0 };
+
+    std::thread thread_;   // 他のメンバの初期化後に起動するため末尾に置く
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,599 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_codec.cpp   ―  音声 PCM の圧縮（固定予測 + Rice 符号）
+// -----------------------------------------------------------------------------
+#include "krkrvoice_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <stdlib.h>
+#endif
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 形式
+//  CodecHeader、各ブロックの開始位置 uint32[blockCount + 1]（本体先頭からのバイト数）、本体、余白 8 バイト
+//  ブロックはバイト境界から始まり、チャンネルごとに
+//    次数 3bit、先頭 order サンプル 16bit ずつ、
+//    残り（order 階差分。量子化時は刻みで割った値）を 256 サンプルの区画ごとに
+//    Rice パラメータ 5bit（31 は全て 0）+ 各値の zigzag を Rice 符号で
+//  Rice 符号は商を 0 の並び + 1、続けて下位 k bit。商が 24 以上なら 0 を 24 個並べて値を 24bit で書く
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr char     kMagic[4]     = { 'K', 'V', 'P', 'C' };
+constexpr uint8_t  kVersion      = 1;
+constexpr uint32_t kBlockFrames  = 4096;
+constexpr size_t   kPartition    = 256;
+constexpr int      kMaxOrder     = 4;
+constexpr int      kMaxRice      = 22;
+constexpr uint32_t kZeroPart     = 31;
+constexpr int      kEscapeZeros  = 24;
+constexpr int      kRawBits      = 24;
+constexpr int      kMaxTolerance = 1024;
+constexpr int      kMaxChannels  = 8;
+constexpr size_t   kPad          = 8;     // 8 バイト単位の先読みが末尾からはみ出さないように
+
+#pragma pack(push, 1)
+struct CodecHeader {
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  channels;
+    uint16_t tolerance;
+    uint32_t sampleRate;
+    uint32_t frames;
+    uint32_t blockFrames;
+    uint32_t blockCount;
+};
+#pragma pack(pop)
+
+// k 次の固定予測（予測誤差が k 階差分になる係数）
+constexpr int32_t kCoef[kMaxOrder + 1][kMaxOrder] = {
+    { 0,  0, 0,  0 },
+    { 1,  0, 0,  0 },
+    { 2, -1, 0,  0 },
+    { 3, -3, 1,  0 },
+    { 4, -6, 4, -1 },
+};
+
+static inline int CountLeadingZeros64(uint64_t v)   // v != 0
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return 63 - static_cast<int>(i);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    if (_BitScanReverse(&i, static_cast<unsigned long>(v >> 32))) return 31 - static_cast<int>(i);
+    _BitScanReverse(&i, static_cast<unsigned long>(v));
+    return 63 - static_cast<int>(i);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+static inline uint64_t LoadBE64(const uint8_t* p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(_MSC_VER)
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+static inline uint32_t ZigZag(int32_t v)   { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+static inline int32_t  UnZigZag(uint32_t u) { return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1); }
+
+static inline uint32_t RiceBits(uint32_t u, int k)
+{
+    uint32_t q = u >> k;
+    return q < kEscapeZeros ? q + 1 + static_cast<uint32_t>(k) : kEscapeZeros + kRawBits;
+}
+
+// 上位ビットから詰める
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void Put(uint32_t v, int n)   // n <= 32
+    {
+        acc_   = (acc_ << n) | (v & ((uint64_t(1) << n) - 1));
+        bits_ += n;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> bits_));
+        }
+    }
+
+    void Rice(uint32_t u, int k)
+    {
+        uint32_t q = u >> k;
+        if (q < kEscapeZeros) {
+            Put(1, static_cast<int>(q) + 1);
+            if (k) Put(u, k);
+        } else {
+            Put(0, kEscapeZeros);
+            Put(u, kRawBits);
+        }
+    }
+
+    void Flush() { if (bits_) Put(0, 8 - bits_); }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t              acc_  = 0;
+    int                   bits_ = 0;
+};
+
+// 読み出しのたびに現在位置から 8 バイトを読む（57bit 以上が揃う）
+//  呼び出し側は読む前に Ok() を確かめる。位置が終端以内なら先読みは余白に収まる
+class BitReader {
+public:
+    BitReader(const uint8_t* base, size_t beginBits, size_t endBits) : p_(base), pos_(beginBits), end_(endBits) {}
+
+    bool Ok() const { return pos_ <= end_; }
+
+    uint32_t Get(int n)   // 1 <= n <= 25
+    {
+        uint64_t w = LoadBE64(p_ + (pos_ >> 3)) << (pos_ & 7);
+        pos_ += static_cast<size_t>(n);
+        return static_cast<uint32_t>(w >> (64 - n));
+    }
+
+    // Rice 符号を n 個読んで符号付きに戻す（位置は局所変数に置いて回す）
+    bool Rice(int k, int32_t* dst, size_t n)
+    {
+        const uint8_t* p   = p_;
+        const size_t   end = end_;
+        size_t         pos = pos_;
+        for (size_t i = 0; i < n; ++i) {
+            if (pos > end) return false;
+            uint64_t w = LoadBE64(p + (pos >> 3)) << (pos & 7);
+            int      z = w ? CountLeadingZeros64(w) : 64;
+            uint32_t u;
+            if (z < kEscapeZeros) {
+                // 0 の並びと終端の 1 を捨て、下位 k bit を取る（k == 0 でも 64 bit シフトにならないよう 2 回に分ける）
+                uint32_t low = static_cast<uint32_t>(((w << (z + 1)) >> 1) >> (63 - k));
+                u    = (static_cast<uint32_t>(z) << k) | low;
+                pos += static_cast<size_t>(z + 1 + k);
+            } else {
+                u    = static_cast<uint32_t>((w << kEscapeZeros) >> (64 - kRawBits));
+                pos += kEscapeZeros + kRawBits;
+            }
+            dst[i] = UnZigZag(u);
+        }
+        pos_ = pos;
+        return true;
+    }
+
+private:
+    const uint8_t* p_;
+    size_t         pos_;
+    size_t         end_;
+};
+
+// -----------------------------------------------------------------------------
+// カーネル
+//  integrate : 差分を 1 段積分する（x[i] = carry += x[i]）
+//  scale     : 量子化の刻みを掛け戻す
+//  pack      : 16bit に飽和して詰める
+// -----------------------------------------------------------------------------
+struct Kernels {
+    void (*integrate)(int32_t* x, size_t n, int32_t carry);
+    void (*scale)(int32_t* x, size_t n, int32_t step);
+    void (*pack)(const int32_t* src, int16_t* dst, size_t n);
+};
+
+static void IntegrateScalar(int32_t* x, size_t n, int32_t carry)
+{
+    uint32_t c = static_cast<uint32_t>(carry);   // 壊れたデータでも未定義動作にしない
+    for (size_t i = 0; i < n; ++i) {
+        c   += static_cast<uint32_t>(x[i]);
+        x[i] = static_cast<int32_t>(c);
+    }
+}
+
+static void ScaleScalar(int32_t* x, size_t n, int32_t step)
+{
+    for (size_t i = 0; i < n; ++i)
+        x[i] = static_cast<int32_t>(static_cast<uint32_t>(x[i]) * static_cast<uint32_t>(step));
+}
+
+static void PackScalar(const int32_t* src, int16_t* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = static_cast<int16_t>(std::clamp<int32_t>(src[i], -32768, 32767));
+}
+
+#ifdef KRKRVOICE_X86
+KRKRVOICE_TARGET_SSE2
+static void IntegrateSSE2(int32_t* x, size_t n, int32_t carry)
+{
+    __m128i c = _mm_set1_epi32(carry);
+    size_t  i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(x + i), v);
+        c = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    IntegrateScalar(x + i, n - i, _mm_cvtsi128_si32(c));
+}
+
+// SSE2 には 32bit の乗算が無いので、偶数・奇数レーンを 64bit 積で求めて下位を集める
+KRKRVOICE_TARGET_SSE2
+static void ScaleSSE2(int32_t* x, size_t n, int32_t step)
+{
+    const __m128i s = _mm_set1_epi32(step);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        __m128i even = _mm_mul_epu32(v, s);
+        __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(v, 32), s);
+        v = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(x + i), v);
+    }
+    ScaleScalar(x + i, n - i, step);
+}
+
+KRKRVOICE_TARGET_SSE2
+static void PackSSE2(const int32_t* src, int16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+    }
+    PackScalar(src + i, dst + i, n - i);
+}
+
+// 128bit 内で累積した後、下半分の最後の値を上半分に足す
+KRKRVOICE_TARGET_AVX2
+static void IntegrateAVX2(int32_t* x, size_t n, int32_t carry)
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i lane3 = _mm256_set1_epi32(3);
+    const __m256i lane7 = _mm256_set1_epi32(7);
+    __m256i c = _mm256_set1_epi32(carry);
+    size_t  i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+        v = _mm256_add_epi32(v, _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(v, lane3), 0xF0));
+        v = _mm256_add_epi32(v, c);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), v);
+        c = _mm256_permutevar8x32_epi32(v, lane7);
+    }
+    IntegrateScalar(x + i, n - i, _mm_cvtsi128_si32(_mm256_castsi256_si128(c)));
+}
+
+KRKRVOICE_TARGET_AVX2
+static void ScaleAVX2(int32_t* x, size_t n, int32_t step)
+{
+    const __m256i s = _mm256_set1_epi32(step);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), _mm256_mullo_epi32(v, s));
+    }
+    ScaleScalar(x + i, n - i, step);
+}
+
+KRKRVOICE_TARGET_AVX2
+static void PackAVX2(const int32_t* src, int16_t* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8));
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+    }
+    PackScalar(src + i, dst + i, n - i);
+}
+#endif // KRKRVOICE_X86
+
+static const Kernels& KernelsFor(SimdLevel level)
+{
+    static const Kernels scalar = { IntegrateScalar, ScaleScalar, PackScalar };
+#ifdef KRKRVOICE_X86
+    static const Kernels sse2   = { IntegrateSSE2, ScaleSSE2, PackSSE2 };
+    static const Kernels avx2   = { IntegrateAVX2, ScaleAVX2, PackAVX2 };
+    switch (std::min(level, DetectSimd())) {
+    case SimdLevel::AVX2: return avx2;
+    case SimdLevel::SSE2: return sse2;
+    default:              break;
+    }
+#else
+    (void)level;
+#endif
+    return scalar;
+}
+
+// -----------------------------------------------------------------------------
+// 符号化
+// -----------------------------------------------------------------------------
+// 次数は開ループの差分の絶対値和で選び、量子化は復元値から予測する閉ループで行う
+static void EncodeChannel(BitWriter& bw, const int32_t* x, size_t n, int tolerance,
+                          std::vector<int32_t>& rec, std::vector<uint32_t>& res)
+{
+    uint64_t cost[kMaxOrder + 1] = {};
+    int32_t  last[kMaxOrder + 1] = {};
+    for (size_t i = 0; i < n; ++i) {
+        int32_t d = x[i];
+        for (int j = 0; j <= kMaxOrder; ++j) {
+            if (static_cast<size_t>(j) <= i) cost[j] += static_cast<uint64_t>(d < 0 ? -int64_t(d) : d);
+            int32_t next = d - last[j];
+            last[j] = d;
+            d = next;
+        }
+    }
+    int order = static_cast<int>(std::min_element(cost, cost + kMaxOrder + 1) - cost);
+    order     = static_cast<int>(std::min<size_t>(order, n));
+
+    const int32_t step = 2 * tolerance + 1;
+    rec.resize(n);
+    res.resize(n);
+    bw.Put(static_cast<uint32_t>(order), 3);
+    for (int i = 0; i < order; ++i) {
+        rec[i] = x[i];
+        bw.Put(static_cast<uint32_t>(x[i]), 16);
+    }
+    const int32_t* c = kCoef[order];
+    for (size_t i = order; i < n; ++i) {
+        int32_t pred = 0;
+        for (int j = 0; j < order; ++j) pred += c[j] * rec[i - 1 - j];
+        int32_t e = x[i] - pred;
+        int32_t q = e >= 0 ? (e + tolerance) / step : -((tolerance - e) / step);
+        rec[i] = pred + q * step;
+        res[i] = ZigZag(q);
+    }
+
+    for (size_t p = order; p < n; p += kPartition) {
+        const size_t e = std::min(n, p + kPartition);
+        uint64_t sum = 0;
+        for (size_t i = p; i < e; ++i) sum += res[i];
+        if (sum == 0) {
+            bw.Put(kZeroPart, 5);
+            continue;
+        }
+        const uint64_t mean = sum / (e - p);
+        int k0 = 0;
+        while (k0 < kMaxRice && (uint64_t(1) << (k0 + 1)) <= mean) ++k0;
+        int      best     = k0;
+        uint64_t bestBits = ~uint64_t(0);
+        for (int k = std::max(0, k0 - 1); k <= std::min(kMaxRice, k0 + 1); ++k) {
+            uint64_t bits = 0;
+            for (size_t i = p; i < e; ++i) bits += RiceBits(res[i], k);
+            if (bits < bestBits) { bestBits = bits; best = k; }
+        }
+        bw.Put(static_cast<uint32_t>(best), 5);
+        for (size_t i = p; i < e; ++i) bw.Rice(res[i], best);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// 復号
+// -----------------------------------------------------------------------------
+struct Layout {
+    CodecHeader    h;
+    const uint8_t* offsets;
+    const uint8_t* body;
+    size_t         bodyBytes;
+};
+
+static uint32_t Offset(const Layout& l, size_t i)
+{
+    uint32_t v;
+    std::memcpy(&v, l.offsets + i * sizeof(v), sizeof(v));
+    return v;
+}
+
+static size_t BlockLen(const Layout& l, size_t b)
+{
+    return std::min<size_t>(l.h.blockFrames, l.h.frames - b * l.h.blockFrames);
+}
+
+// verify == false はこのクラスで検証済みのバイト列（ブロック位置の確認を省く）
+static bool Parse(const uint8_t* data, size_t size, Layout& l, bool verify)
+{
+    if (!data || size < sizeof(CodecHeader)) return false;
+    std::memcpy(&l.h, data, sizeof(l.h));
+    const CodecHeader& h = l.h;
+    if (std::memcmp(h.magic, kMagic, 4) || h.version != kVersion || !h.channels || h.channels > kMaxChannels ||
+        !h.sampleRate || !h.blockFrames || h.blockFrames > (1u << 16) || h.tolerance > kMaxTolerance ||
+        h.blockCount != (uint64_t(h.frames) + h.blockFrames - 1) / h.blockFrames)
+        return false;
+    const uint64_t table = sizeof(h) + uint64_t(h.blockCount + 1) * sizeof(uint32_t);
+    if (table + kPad > size) return false;
+    l.offsets   = data + sizeof(h);
+    l.body      = data + table;
+    l.bodyBytes = static_cast<size_t>(size - table - kPad);
+    if (verify) {
+        uint32_t prev = 0;
+        for (size_t i = 0; i <= h.blockCount; ++i) {
+            uint32_t o = Offset(l, i);
+            if (o < prev || o > l.bodyBytes) return false;
+            prev = o;
+        }
+    }
+    return true;
+}
+
+static bool DecodeChannel(BitReader& br, int32_t* x, size_t n, int32_t step, const Kernels& kern)
+{
+    if (!br.Ok()) return false;
+    const int order = static_cast<int>(br.Get(3));
+    if (order > kMaxOrder || static_cast<size_t>(order) > n) return false;
+    for (int i = 0; i < order; ++i) {
+        if (!br.Ok()) return false;
+        x[i] = static_cast<int16_t>(br.Get(16));
+    }
+    for (size_t p = order; p < n; p += kPartition) {
+        const size_t e = std::min(n, p + kPartition);
+        if (!br.Ok()) return false;
+        const uint32_t k = br.Get(5);
+        if (k == kZeroPart) {
+            std::fill(x + p, x + e, 0);
+            continue;
+        }
+        if (k > kMaxRice || !br.Rice(static_cast<int>(k), x + p, e - p)) return false;
+    }
+    if (!br.Ok()) return false;
+    if (static_cast<size_t>(order) == n) return true;
+
+    // 先頭 order サンプルから、位置 order-1 における各階差分を求めて積分の初期値にする
+    int32_t w[kMaxOrder], d[kMaxOrder];
+    for (int i = 0; i < order; ++i) w[i] = x[i];
+    for (int j = 0; j < order; ++j) {
+        d[j] = w[order - 1];
+        for (int i = order - 1; i > j; --i) w[i] -= w[i - 1];
+    }
+    if (step > 1) kern.scale(x + order, n - order, step);
+    for (int j = order - 1; j >= 0; --j) kern.integrate(x + order, n - order, d[j]);
+    return true;
+}
+
+// planes はチャンネルごとに blockFrames ずつ
+static bool DecodeBlock(const Layout& l, size_t b, int32_t* planes, const Kernels& kern)
+{
+    const size_t  n    = BlockLen(l, b);
+    const int32_t step = 2 * static_cast<int32_t>(l.h.tolerance) + 1;
+    BitReader br(l.body, size_t(Offset(l, b)) * 8, size_t(Offset(l, b + 1)) * 8);
+    for (size_t c = 0; c < l.h.channels; ++c)
+        if (!DecodeChannel(br, planes + c * l.h.blockFrames, n, step, kern)) return false;
+    return true;
+}
+
+static void Emit(const Layout& l, const int32_t* planes, size_t from, size_t count, int16_t* dst,
+                 const Kernels& kern)
+{
+    const size_t ch = l.h.channels;
+    if (ch == 1) {
+        kern.pack(planes + from, dst, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+        for (size_t c = 0; c < ch; ++c)
+            dst[i * ch + c] = static_cast<int16_t>(
+                std::clamp<int32_t>(planes[c * l.h.blockFrames + from + i], -32768, 32767));
+}
+
+static int32_t* Scratch(const Layout& l)
+{
+    thread_local std::vector<int32_t> planes;
+    planes.resize(size_t(l.h.channels) * l.h.blockFrames);
+    return planes.data();
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// CompressedClip 実装
+// -----------------------------------------------------------------------------
+CompressedClip::CompressedClip(const AudioClip& clip, int tolerance)
+{
+    const size_t frames = clip.Frames();
+    if (clip.channels <= 0 || clip.channels > kMaxChannels || clip.sampleRate <= 0 || frames > UINT32_MAX)
+        return;
+    tolerance = std::clamp(tolerance, 0, kMaxTolerance);
+
+    const size_t   ch     = static_cast<size_t>(clip.channels);
+    const uint32_t blocks = static_cast<uint32_t>((frames + kBlockFrames - 1) / kBlockFrames);
+    const size_t   table  = sizeof(CodecHeader) + size_t(blocks + 1) * sizeof(uint32_t);
+    data_.reserve(table + clip.Bytes() / 2 + kPad);
+    data_.resize(table);
+
+    std::vector<uint32_t> offsets;
+    offsets.reserve(blocks + 1);
+    std::vector<int32_t>  x(kBlockFrames), rec;
+    std::vector<uint32_t> res;
+    BitWriter bw(data_);
+    for (uint32_t b = 0; b < blocks; ++b) {
+        offsets.push_back(static_cast<uint32_t>(data_.size() - table));
+        const size_t start = size_t(b) * kBlockFrames;
+        const size_t n     = std::min<size_t>(kBlockFrames, frames - start);
+        for (size_t c = 0; c < ch; ++c) {
+            for (size_t i = 0; i < n; ++i) x[i] = clip.samples[(start + i) * ch + c];
+            EncodeChannel(bw, x.data(), n, tolerance, rec, res);
+        }
+        bw.Flush();
+    }
+    offsets.push_back(static_cast<uint32_t>(data_.size() - table));
+    data_.insert(data_.end(), kPad, 0);
+
+    CodecHeader h{};
+    std::memcpy(h.magic, kMagic, 4);
+    h.version     = kVersion;
+    h.channels    = static_cast<uint8_t>(ch);
+    h.tolerance   = static_cast<uint16_t>(tolerance);
+    h.sampleRate  = static_cast<uint32_t>(clip.sampleRate);
+    h.frames      = static_cast<uint32_t>(frames);
+    h.blockFrames = kBlockFrames;
+    h.blockCount  = blocks;
+    std::memcpy(data_.data(), &h, sizeof(h));
+    std::memcpy(data_.data() + sizeof(h), offsets.data(), offsets.size() * sizeof(uint32_t));
+    data_.shrink_to_fit();
+
+    sampleRate_ = clip.sampleRate;
+    channels_   = clip.channels;
+    tolerance_  = tolerance;
+    frames_     = frames;
+}
+
+bool
+CompressedClip::Assign(const uint8_t* data, size_t size)
+{
+    Layout l;
+    if (!Parse(data, size, l, true)) return false;
+    data_.assign(data, data + size);
+    sampleRate_ = static_cast<int>(l.h.sampleRate);
+    channels_   = l.h.channels;
+    tolerance_  = l.h.tolerance;
+    frames_     = l.h.frames;
+    return true;
+}
+
+bool
+CompressedClip::Decode(AudioClip& out, SimdLevel simd) const
+{
+    if (data_.empty()) return false;
+    out.sampleRate = sampleRate_;
+    out.channels   = channels_;
+    out.samples.resize(frames_ * static_cast<size_t>(channels_));
+    if (Decode(0, out.samples.data(), frames_, simd) == frames_) return true;
+    out.samples.clear();
+    return false;
+}
+
+size_t
+CompressedClip::Decode(size_t frame, int16_t* dst, size_t frames, SimdLevel simd) const
+{
+    Layout l;
+    if (frame >= frames_ || !Parse(data_.data(), data_.size(), l, false)) return 0;
+    frames = std::min(frames, frames_ - frame);
+
+    const Kernels& kern   = KernelsFor(simd);
+    int32_t*       planes = Scratch(l);
+    const size_t   bf     = l.h.blockFrames;
+    size_t done = 0;
+    while (done < frames) {
+        const size_t pos   = frame + done;
+        const size_t b     = pos / bf;
+        const size_t from  = pos - b * bf;
+        const size_t count = std::min(BlockLen(l, b) - from, frames - done);
+        if (!DecodeBlock(l, b, planes, kern)) break;
+        Emit(l, planes, from, count, dst + done * l.h.channels, kern);
+        done += count;
+    }
+    return done;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace krkrvoice {
+
+// 合成音声向けの PCM 圧縮（外部ライブラリなし）
+//  - 4096 フレームのブロックごとに固定予測（0〜4 次の差分）を選び、残差を Rice 符号にする
+//  - 残差は 256 サンプルの区画ごとに Rice パラメータを選ぶ。全て 0 の区画（無音）は 5bit で済む
+//  - tolerance > 0 なら残差を 2*tolerance+1 刻みで量子化する（各サンプルの誤差は tolerance 以下）
+//  - ブロックは独立に復号できるので、途中のフレームからも取り出せる
+//  復号は Rice 符号の読み出しだけが逐次で、差分の積分・逆量子化・16bit への詰め直しは SSE2 / AVX2
+class CompressedClip {
+public:
+    CompressedClip() = default;
+    explicit CompressedClip(const AudioClip& clip, int tolerance = 0);
+
+    // 圧縮済みのバイト列（Data() の内容）を検証して取り込む
+    bool Assign(const uint8_t* data, size_t size);
+
+    bool   empty()      const { return data_.empty(); }
+    int    SampleRate() const { return sampleRate_; }
+    int    Channels()   const { return channels_; }
+    int    Tolerance()  const { return tolerance_; }
+    size_t Frames()     const { return frames_; }
+    double Seconds()    const { return sampleRate_ > 0 ? double(frames_) / sampleRate_ : 0.0; }
+    size_t Bytes()      const { return data_.size(); }
+    size_t PcmBytes()   const { return frames_ * static_cast<size_t>(channels_) * sizeof(int16_t); }
+
+    const std::vector<uint8_t>& Data() const { return data_; }
+
+    // 全体を out に復号する
+    bool Decode(AudioClip& out, SimdLevel simd = DetectSimd()) const;
+    // frame から最大 frames フレームを dst（インターリーブ）に復号し、書いたフレーム数を返す
+    size_t Decode(size_t frame, int16_t* dst, size_t frames, SimdLevel simd = DetectSimd()) const;
+
+private:
+    std::vector<uint8_t> data_;
+    int    sampleRate_ = 0;
+    int    channels_   = 0;
+    int    tolerance_  = 0;
+    size_t frames_     = 0;
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,633 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_dict.cpp   ―  読み辞書のコンパイルと一括置換
+// -----------------------------------------------------------------------------
+#include "krkrvoice_dict.hpp"
+#include "krkrvoice_json.hpp"
+#include "krkrvoice_mmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <unordered_set>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+// ECMAScript のメタ文字
+static bool IsRegexMeta(wchar_t c)
+{
+    switch (c) {
+    case L'^': case L'$': case L'\\': case L'.': case L'*': case L'+':
+    case L'?': case L'(': case L')': case L'[': case L']': case L'{':
+    case L'}': case L'|':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// regex_replace の書式指定（$&, $1 等）を含むか
+static bool HasFormatSpecifier(std::wstring_view rep)
+{
+    return rep.find(L'$') != std::wstring_view::npos;
+}
+
+// 置換結果と後続パターンの干渉を調べるための集合
+//  ステージ内の i < j について、rep_i と pattern_j が重なり得るなら
+//  1 パスにまとめると逐次適用と結果が変わるのでステージを分ける
+class StageConflictSet {
+public:
+    bool Conflicts(const std::wstring& p) const
+    {
+        if (hasEmptyRep_ && p.size() >= 2) return true;    // 削除で連結した箇所にマッチし得る
+        if (substr_.count(p)) return true;                 // p ⊂ rep
+        for (const auto& r : longReps_)
+            if (r.find(p) != std::wstring::npos) return true;
+        for (size_t k = 1; k < p.size(); ++k) {
+            if (suffix_.count(p.substr(0, k))) return true;           // rep の末尾 = p の先頭
+            if (prefix_.count(p.substr(p.size() - k))) return true;   // p の末尾 = rep の先頭
+        }
+        for (size_t b = 0; b < p.size(); ++b)                          // rep ⊂ p
+            for (size_t e = b + 1; e <= p.size() && e - b <= maxRepLen_; ++e)
+                if (whole_.count(p.substr(b, e - b))) return true;
+        return false;
+    }
+
+    void Add(const std::wstring& r)
+    {
+        if (r.empty()) { hasEmptyRep_ = true; return; }
+        whole_.insert(r);
+        maxRepLen_ = std::max(maxRepLen_, r.size());
+        for (size_t k = 1; k <= r.size(); ++k) {
+            prefix_.insert(r.substr(0, k));
+            suffix_.insert(r.substr(r.size() - k));
+        }
+        if (r.size() > kLongRep) { longReps_.push_back(r); return; }
+        for (size_t b = 0; b < r.size(); ++b)
+            for (size_t e = b + 1; e <= r.size(); ++e)
+                substr_.insert(r.substr(b, e - b));
+    }
+
+private:
+    static constexpr size_t kLongRep = 32;
+
+    std::unordered_set<std::wstring> whole_, prefix_, suffix_, substr_;
+    std::vector<std::wstring>        longReps_;
+    size_t                           maxRepLen_   = 0;
+    bool                             hasEmptyRep_ = false;
+};
+
+// Aho-Corasick オートマトン（辺は CSR 形式でソート済み）
+//  Build で作った配列か、Attach したマップ領域をそのまま参照する
+class AhoCorasick {
+public:
+    struct Node {
+        uint32_t fail      = 0;
+        uint32_t out       = kNone;   // このノードで終わるパターン番号
+        uint32_t dictLink  = kNone;   // fail 連鎖上で次に out を持つノード
+        uint32_t edgeBegin = 0;
+        uint32_t edgeEnd   = 0;
+    };
+    struct Edge {
+        uint32_t ch;                  // wchar_t の値（ファイル形式と共通にするため 32bit）
+        uint32_t next;
+    };
+
+    AhoCorasick() = default;
+    AhoCorasick(const AhoCorasick&)            = delete;   // nodes_/edges_ が自分の配列を指すため
+    AhoCorasick& operator=(const AhoCorasick&) = delete;
+
+    void Build(const std::vector<std::wstring>& patterns)
+    {
+        // 一旦 map で trie を組んでから平坦化
+        std::vector<std::map<wchar_t, uint32_t>> kids(1);
+        std::vector<uint32_t> out(1, kNone);
+        for (uint32_t id = 0; id < patterns.size(); ++id) {
+            uint32_t cur = 0;
+            for (wchar_t c : patterns[id]) {
+                auto it = kids[cur].find(c);
+                if (it == kids[cur].end()) {
+                    uint32_t n = static_cast<uint32_t>(kids.size());
+                    kids[cur].emplace(c, n);
+                    kids.emplace_back();
+                    out.push_back(kNone);
+                    cur = n;
+                } else {
+                    cur = it->second;
+                }
+            }
+            if (out[cur] == kNone) out[cur] = id;   // 同一パターンは先勝ち
+        }
+
+        ownNodes_.assign(kids.size(), Node{});
+        ownEdges_.clear();
+        for (uint32_t n = 0; n < kids.size(); ++n) {
+            ownNodes_[n].out       = out[n];
+            ownNodes_[n].edgeBegin = static_cast<uint32_t>(ownEdges_.size());
+            for (auto [c, nx] : kids[n]) ownEdges_.push_back(Edge{ static_cast<uint32_t>(c), nx });
+            ownNodes_[n].edgeEnd   = static_cast<uint32_t>(ownEdges_.size());
+        }
+        Attach(ownNodes_.data(), static_cast<uint32_t>(ownNodes_.size()),
+               ownEdges_.data(), static_cast<uint32_t>(ownEdges_.size()));
+
+        // BFS で fail / dictLink を設定
+        std::queue<uint32_t> q;
+        for (uint32_t e = nodes_[0].edgeBegin; e < nodes_[0].edgeEnd; ++e)
+            q.push(edges_[e].next);
+        while (!q.empty()) {
+            uint32_t n = q.front(); q.pop();
+            for (uint32_t e = nodes_[n].edgeBegin; e < nodes_[n].edgeEnd; ++e) {
+                uint32_t child = edges_[e].next;
+                uint32_t f = nodes_[n].fail;
+                uint32_t t;
+                while ((t = Child(f, edges_[e].ch)) == kNone && f != 0) f = nodes_[f].fail;
+                ownNodes_[child].fail = (t != kNone && t != child) ? t : 0;
+                uint32_t fl = nodes_[child].fail;
+                ownNodes_[child].dictLink = (nodes_[fl].out != kNone) ? fl : nodes_[fl].dictLink;
+                q.push(child);
+            }
+        }
+    }
+
+    void Attach(const Node* nodes, uint32_t nodeCount, const Edge* edges, uint32_t edgeCount)
+    {
+        nodes_     = nodes;
+        nodeCount_ = nodeCount;
+        edges_     = edges;
+        edgeCount_ = edgeCount;
+    }
+
+    // 外部の配列が壊れていないか（範囲外参照しないか）を確かめる
+    //  木構造であること、fail / dictLink が浅いノードを指すこと、
+    //  パターン長が出力ノードの深さと一致することを見る
+    bool Validate(const uint32_t* lens, uint32_t patternCount) const
+    {
+        if (!nodeCount_) return false;
+        std::vector<uint32_t> depth(nodeCount_, kNone);
+        depth[0] = 0;
+        std::vector<uint32_t> q{ 0 };
+        for (size_t h = 0; h < q.size(); ++h) {
+            const Node& x = nodes_[q[h]];
+            if (x.edgeBegin > x.edgeEnd || x.edgeEnd > edgeCount_) return false;
+            for (uint32_t e = x.edgeBegin; e < x.edgeEnd; ++e) {
+                uint32_t nx = edges_[e].next;
+                if (nx >= nodeCount_ || depth[nx] != kNone) return false;
+                if (e > x.edgeBegin && edges_[e - 1].ch >= edges_[e].ch) return false;
+                depth[nx] = depth[q[h]] + 1;
+                q.push_back(nx);
+            }
+        }
+        if (q.size() != nodeCount_) return false;
+        for (uint32_t n = 0; n < nodeCount_; ++n) {
+            const Node& x = nodes_[n];
+            if (x.fail >= nodeCount_ || (n && depth[x.fail] >= depth[n])) return false;
+            if (x.dictLink != kNone && (x.dictLink >= nodeCount_ || depth[x.dictLink] >= depth[n])) return false;
+            if (x.out != kNone && (x.out >= patternCount || lens[x.out] != depth[n])) return false;
+        }
+        return true;
+    }
+
+    const Node* Nodes()     const { return nodes_; }
+    const Edge* Edges()     const { return edges_; }
+    uint32_t    NodeCount() const { return nodeCount_; }
+    uint32_t    EdgeCount() const { return edgeCount_; }
+
+    // text 中の全出現位置を (開始位置, パターン番号) で列挙
+    template <class F>
+    void Scan(std::wstring_view text, const uint32_t* lens, F&& emit) const
+    {
+        uint32_t s = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            uint32_t c = static_cast<uint32_t>(text[i]);
+            uint32_t t;
+            while ((t = Child(s, c)) == kNone && s != 0) s = nodes_[s].fail;
+            s = (t == kNone) ? 0 : t;
+            for (uint32_t n = (nodes_[s].out != kNone) ? s : nodes_[s].dictLink;
+                 n != kNone; n = nodes_[n].dictLink) {
+                uint32_t id = nodes_[n].out;
+                emit(i + 1 - lens[id], id);
+            }
+        }
+    }
+
+private:
+    uint32_t Child(uint32_t n, uint32_t c) const
+    {
+        const Edge* b = edges_ + nodes_[n].edgeBegin;
+        const Edge* e = edges_ + nodes_[n].edgeEnd;
+        const Edge* it = std::lower_bound(b, e, c, [](const Edge& x, uint32_t v) { return x.ch < v; });
+        return (it != e && it->ch == c) ? it->next : kNone;
+    }
+
+    std::vector<Node> ownNodes_;
+    std::vector<Edge> ownEdges_;
+    const Node* nodes_     = nullptr;
+    const Edge* edges_     = nullptr;
+    uint32_t    nodeCount_ = 0;
+    uint32_t    edgeCount_ = 0;
+};
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// ステージ：連続するリテラル群（1 パス）または正規表現 1 件
+// -----------------------------------------------------------------------------
+struct CompiledDictionary::Stage {
+    bool literal = false;
+
+    // リテラル
+    AhoCorasick               ac;
+    std::vector<uint32_t>     ownLens;
+    const uint32_t*           lens = nullptr;    // ownLens かマップ領域
+    std::vector<std::wstring> reps;
+
+    // 正規表現（読み込んだ辞書では初回使用時にコンパイル）
+    std::wstring pattern;
+    std::wstring fmt;
+
+    std::shared_ptr<const MappedFile> backing;  // ac / lens が参照する領域
+
+    // 置換が起きた場合のみ out に結果を書いて true
+    bool Apply(std::wstring_view text, std::wstring& out) const;
+
+    // コンパイル済みの正規表現（不正なら nullptr）
+    const std::wregex* Regex() const
+    {
+        std::call_once(reOnce_, [&] {
+            try { re_.assign(pattern); reOk_ = true; }
+            catch (...) {}
+        });
+        return reOk_ ? &re_ : nullptr;
+    }
+
+    void SetRegex(std::wregex re)
+    {
+        std::call_once(reOnce_, [&] { re_ = std::move(re); reOk_ = true; });
+    }
+
+private:
+    mutable std::once_flag reOnce_;
+    mutable std::wregex    re_;
+    mutable bool           reOk_ = false;
+};
+
+// 逐次適用と同じ結果になるよう、エントリ番号の小さい順に
+// 左から重ならない出現を確保していく（先に確保した範囲と重なる出現は捨てる）
+bool
+CompiledDictionary::Stage::Apply(std::wstring_view text, std::wstring& out) const
+{
+    if (!literal) {
+        const std::wregex* re = Regex();
+        if (!re) return false;
+        out.clear();
+        std::regex_replace(std::back_inserter(out), text.begin(), text.end(), *re, fmt);
+        return true;
+    }
+
+    struct Occ { size_t pos; uint32_t id; };
+    std::vector<Occ> occ;
+    ac.Scan(text, lens, [&](size_t pos, uint32_t id) { occ.push_back(Occ{ pos, id }); });
+    if (occ.empty()) return false;
+
+    std::sort(occ.begin(), occ.end(), [](const Occ& a, const Occ& b) {
+        return a.id != b.id ? a.id < b.id : a.pos < b.pos;
+    });
+
+    std::vector<uint8_t> claimed(text.size(), 0);
+    std::vector<Occ>     taken;
+    size_t   lastEnd = 0;
+    uint32_t lastId  = kNone;
+    for (const auto& o : occ) {
+        if (o.id != lastId) { lastId = o.id; lastEnd = 0; }
+        size_t end = o.pos + lens[o.id];
+        if (o.pos < lastEnd) continue;
+        if (std::any_of(claimed.begin() + o.pos, claimed.begin() + end,
+                        [](uint8_t c) { return c != 0; }))
+            continue;
+        std::fill(claimed.begin() + o.pos, claimed.begin() + end, uint8_t{ 1 });
+        taken.push_back(o);
+        lastEnd = end;
+    }
+
+    std::sort(taken.begin(), taken.end(), [](const Occ& a, const Occ& b) { return a.pos < b.pos; });
+    out.clear();
+    out.reserve(text.size());
+    size_t cur = 0;
+    for (const auto& o : taken) {
+        out.append(text.substr(cur, o.pos - cur));
+        out.append(reps[o.id]);
+        cur = o.pos + lens[o.id];
+    }
+    out.append(text.substr(cur));
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// CompiledDictionary 実装
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::ParseLiteralPattern(std::wstring_view pattern, std::wstring& literal)
+{
+    literal.clear();
+    if (pattern.empty()) return false;                  // 空パターンは全位置にマッチする
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        wchar_t c = pattern[i];
+        if (c == L'\\') {
+            // \. \( 等の記号エスケープのみリテラル扱い（\d \n 等は不可）
+            if (i + 1 >= pattern.size()) return false;
+            wchar_t n = pattern[++i];
+            if (n >= 0x80 || std::iswalnum(n) || n == L'_' || std::iswspace(n)) return false;
+            literal += n;
+            continue;
+        }
+        if (IsRegexMeta(c)) return false;
+        literal += c;
+    }
+    return true;
+}
+
+CompiledDictionary::CompiledDictionary(const std::vector<DictEntry>& entries)
+{
+    std::vector<std::wstring> pats;
+    std::vector<std::wstring> reps;
+    StageConflictSet          conflicts;
+
+    auto flush = [&] {
+        if (pats.empty()) return;
+        auto st = std::make_shared<Stage>();
+        st->literal = true;
+        st->ac.Build(pats);
+        for (const auto& p : pats) st->ownLens.push_back(static_cast<uint32_t>(p.size()));
+        st->lens = st->ownLens.data();
+        st->reps = std::move(reps);
+        stages_.push_back(std::move(st));
+        pats.clear();
+        reps.clear();
+        conflicts = StageConflictSet{};
+    };
+
+    std::wstring lit;
+    for (const auto& e : entries) {
+        if (ParseLiteralPattern(e.pattern, lit) && !HasFormatSpecifier(e.replacement)) {
+            if (conflicts.Conflicts(lit)) flush();
+            pats.push_back(lit);
+            reps.push_back(e.replacement);
+            conflicts.Add(e.replacement);
+            ++literalCount_;
+            continue;
+        }
+
+        std::wregex re;
+        try { re.assign(e.pattern); }
+        catch (...) { continue; }                       // 不正な正規表現は従来どおり無視
+
+        flush();
+        auto st = std::make_shared<Stage>();
+        st->pattern = e.pattern;
+        st->fmt     = e.replacement;
+        st->SetRegex(std::move(re));
+        stages_.push_back(std::move(st));
+        ++regexCount_;
+    }
+    flush();
+}
+
+CompiledDictionary::~CompiledDictionary() = default;
+CompiledDictionary::CompiledDictionary(CompiledDictionary&&) noexcept = default;
+CompiledDictionary& CompiledDictionary::operator=(CompiledDictionary&&) noexcept = default;
+
+std::wstring
+CompiledDictionary::Apply(std::wstring_view text) const
+{
+    std::wstring cur(text), tmp;
+    for (const auto& st : stages_)
+        if (st->Apply(cur, tmp)) cur.swap(tmp);
+    return cur;
+}
+
+void
+CompiledDictionary::Append(const CompiledDictionary& other)
+{
+    stages_.insert(stages_.end(), other.stages_.begin(), other.stages_.end());
+    literalCount_ += other.literalCount_;
+    regexCount_   += other.regexCount_;
+}
+
+// -----------------------------------------------------------------------------
+// バイナリ形式（.kvdc）
+//  [FileHeader][StageRecord × stageCount][各ステージの領域（8 バイト境界）]
+//  リテラル：Node 配列 / Edge 配列 / パターン長 / 置換文字列表
+//  正規表現：文字列表 (pattern, replacement)
+//  文字列表は (u32 バイト長 + UTF-8) の並び
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr char     kDictMagic[4] = { 'K', 'V', 'D', 'C' };
+constexpr uint32_t kDictVersion  = 1;
+constexpr uint32_t kStageLiteral = 0;
+constexpr uint32_t kStageRegex   = 1;
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t wcharBits;
+    uint32_t stageCount;
+    uint32_t literalCount;
+    uint32_t regexCount;
+    uint64_t fileBytes;
+};
+struct StageRecord {
+    uint32_t kind;
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+    uint32_t stringCount;
+    uint64_t nodesOff;
+    uint64_t edgesOff;
+    uint64_t lensOff;
+    uint64_t stringsOff;
+    uint64_t stringsBytes;
+};
+#pragma pack(pop)
+
+constexpr uint64_t kRecordsOff = (sizeof(FileHeader) + 7) & ~uint64_t(7);
+
+static_assert(sizeof(AhoCorasick::Node) == 20 && sizeof(AhoCorasick::Edge) == 8,
+              "オートマトンの配置はファイル形式と一致している必要がある");
+
+class BlobWriter {
+public:
+    uint64_t Put(const void* p, size_t n)
+    {
+        Align();
+        uint64_t off = buf_.size();
+        auto b = static_cast<const uint8_t*>(p);
+        buf_.insert(buf_.end(), b, b + n);
+        return off;
+    }
+    uint64_t PutStrings(const std::vector<std::wstring>& strs, uint64_t& bytes)
+    {
+        Align();
+        uint64_t off = buf_.size();
+        for (const auto& w : strs) {
+            std::string u = ToUtf8(w);
+            uint32_t len = static_cast<uint32_t>(u.size());
+            auto lp = reinterpret_cast<const uint8_t*>(&len);
+            buf_.insert(buf_.end(), lp, lp + sizeof(len));
+            buf_.insert(buf_.end(), u.begin(), u.end());
+        }
+        bytes = buf_.size() - off;
+        return off;
+    }
+    void Align() { buf_.resize((buf_.size() + 7) & ~size_t(7), 0); }
+
+    std::vector<uint8_t>& buf() { return buf_; }
+
+private:
+    std::vector<uint8_t> buf_;
+};
+
+static bool InRange(uint64_t off, uint64_t count, uint64_t unit, uint64_t size)
+{
+    if (off % 8 || off > size) return false;
+    return count <= (size - off) / unit;
+}
+
+static bool ReadStrings(const uint8_t* base, uint64_t off, uint64_t bytes, uint32_t count,
+                        std::vector<std::wstring>& out)
+{
+    out.clear();
+    out.reserve(count);
+    uint64_t p = off, end = off + bytes;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (end - p < sizeof(uint32_t)) return false;
+        uint32_t len;
+        std::memcpy(&len, base + p, sizeof(len));
+        p += sizeof(len);
+        if (end - p < len) return false;
+        out.push_back(FromUtf8(std::string_view(reinterpret_cast<const char*>(base + p), len)));
+        p += len;
+    }
+    return true;
+}
+
+} // unnamed namespace
+
+bool
+CompiledDictionary::Save(const std::filesystem::path& path) const
+{
+    namespace fs = std::filesystem;
+
+    BlobWriter w;
+    FileHeader h{};
+    std::memcpy(h.magic, kDictMagic, 4);
+    h.version      = kDictVersion;
+    h.wcharBits    = static_cast<uint32_t>(sizeof(wchar_t) * 8);
+    h.stageCount   = static_cast<uint32_t>(stages_.size());
+    h.literalCount = static_cast<uint32_t>(literalCount_);
+    h.regexCount   = static_cast<uint32_t>(regexCount_);
+    w.Put(&h, sizeof(h));
+    std::vector<StageRecord> recs(stages_.size());
+    uint64_t recsOff = w.Put(recs.data(), recs.size() * sizeof(StageRecord));
+
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const Stage& st = *stages_[i];
+        StageRecord& r  = recs[i];
+        if (st.literal) {
+            r.kind        = kStageLiteral;
+            r.nodeCount   = st.ac.NodeCount();
+            r.edgeCount   = st.ac.EdgeCount();
+            r.stringCount = static_cast<uint32_t>(st.reps.size());
+            r.nodesOff    = w.Put(st.ac.Nodes(), r.nodeCount * sizeof(AhoCorasick::Node));
+            r.edgesOff    = w.Put(st.ac.Edges(), r.edgeCount * sizeof(AhoCorasick::Edge));
+            r.lensOff     = w.Put(st.lens, st.reps.size() * sizeof(uint32_t));
+            r.stringsOff  = w.PutStrings(st.reps, r.stringsBytes);
+        } else {
+            r.kind        = kStageRegex;
+            r.stringCount = 2;
+            r.stringsOff  = w.PutStrings({ st.pattern, st.fmt }, r.stringsBytes);
+        }
+    }
+    w.Align();
+
+    auto& buf = w.buf();
+    h.fileBytes = buf.size();
+    std::memcpy(buf.data(), &h, sizeof(h));
+    std::memcpy(buf.data() + recsOff, recs.data(), recs.size() * sizeof(StageRecord));
+
+    fs::path tmp = path;
+    tmp += L".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        f.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) { fs::remove(tmp, ec); return false; }
+    return true;
+}
+
+bool
+CompiledDictionary::Load(const std::filesystem::path& path, CompiledDictionary& out)
+{
+    auto mf = std::make_shared<MappedFile>();
+    if (!mf->Open(path) || mf->size() < sizeof(FileHeader)) return false;
+    const uint8_t* base = mf->data();
+    const uint64_t size = mf->size();
+
+    FileHeader h;
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, kDictMagic, 4) || h.version != kDictVersion ||
+        h.wcharBits != sizeof(wchar_t) * 8 || h.fileBytes != size ||
+        !InRange(kRecordsOff, h.stageCount, sizeof(StageRecord), size))
+        return false;
+
+    CompiledDictionary d;
+    std::shared_ptr<const MappedFile> backing = mf;
+    const uint8_t* recs = base + kRecordsOff;
+    for (uint32_t i = 0; i < h.stageCount; ++i) {
+        StageRecord r;
+        std::memcpy(&r, recs + i * sizeof(StageRecord), sizeof(r));
+        if (r.stringsOff > size || r.stringsBytes > size - r.stringsOff) return false;
+
+        auto st = std::make_shared<Stage>();
+        st->backing = backing;
+        if (r.kind == kStageLiteral) {
+            if (!InRange(r.nodesOff, r.nodeCount, sizeof(AhoCorasick::Node), size) ||
+                !InRange(r.edgesOff, r.edgeCount, sizeof(AhoCorasick::Edge), size) ||
+                !InRange(r.lensOff, r.stringCount, sizeof(uint32_t), size))
+                return false;
+            st->literal = true;
+            st->lens    = reinterpret_cast<const uint32_t*>(base + r.lensOff);
+            st->ac.Attach(reinterpret_cast<const AhoCorasick::Node*>(base + r.nodesOff), r.nodeCount,
+                          reinterpret_cast<const AhoCorasick::Edge*>(base + r.edgesOff), r.edgeCount);
+            if (!st->ac.Validate(st->lens, r.stringCount)) return false;
+            if (!ReadStrings(base, r.stringsOff, r.stringsBytes, r.stringCount, st->reps)) return false;
+        } else if (r.kind == kStageRegex) {
+            std::vector<std::wstring> strs;
+            if (r.stringCount != 2 || !ReadStrings(base, r.stringsOff, r.stringsBytes, 2, strs)) return false;
+            st->pattern = std::move(strs[0]);
+            st->fmt     = std::move(strs[1]);
+        } else {
+            return false;
+        }
+        d.stages_.push_back(std::move(st));
+    }
+    d.literalCount_ = h.literalCount;
+    d.regexCount_   = h.regexCount;
+    out = std::move(d);
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace krkrvoice {
+
+// 辞書 1 エントリ（pattern は ECMAScript 正規表現、replacement は regex_replace の書式）
+struct DictEntry {
+    std::wstring pattern;
+    std::wstring replacement;
+};
+
+// pattern が正規表現メタ文字を含まない（エスケープ済み記号のみの）リテラルなら
+// 展開した文字列を literal に入れて true を返す
+bool ParseLiteralPattern(std::wstring_view pattern, std::wstring& literal);
+
+// 有効な辞書群をまとめてコンパイルした置換器
+//  - リテラルエントリは Aho-Corasick オートマトンで 1 パス処理
+//  - 本物の正規表現エントリのみ std::wregex にフォールバック
+//  - 結果はエントリを先頭から順に regex_replace した場合と一致する
+//  - Save / Load でバイナリ形式（.kvdc）に保存・メモリマップで読み込みできる
+class CompiledDictionary {
+public:
+    CompiledDictionary() = default;
+    explicit CompiledDictionary(const std::vector<DictEntry>& entries);
+    ~CompiledDictionary();
+
+    CompiledDictionary(CompiledDictionary&&) noexcept;
+    CompiledDictionary& operator=(CompiledDictionary&&) noexcept;
+
+    std::wstring Apply(std::wstring_view text) const;
+
+    // other の後ろに続けて適用する（ステージを共有するのでコピーは軽い）
+    void Append(const CompiledDictionary& other);
+
+    // バイナリ形式で書き出す（一時ファイル経由で置き換える）
+    bool Save(const std::filesystem::path& path) const;
+
+    // バイナリ形式を読む。オートマトンはマップした領域をそのまま参照し、
+    // 正規表現は初めて使うときにコンパイルする。形式・版・wchar_t 幅が違えば false
+    static bool Load(const std::filesystem::path& path, CompiledDictionary& out);
+
+    bool   empty()        const { return stages_.empty(); }
+    size_t StageCount()   const { return stages_.size(); }
+    size_t LiteralCount() const { return literalCount_; }
+    size_t RegexCount()   const { return regexCount_; }
+
+private:
+    struct Stage;
+    std::vector<std::shared_ptr<const Stage>> stages_;
+    size_t literalCount_ = 0;
+    size_t regexCount_   = 0;
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,211 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_event.cpp   ―  完了通知
+// -----------------------------------------------------------------------------
+#include "krkrvoice_event.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <objbase.h>
+#endif
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+bool
+Completion::Signal()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (done_) return false;
+        done_ = true;
+    }
+    cv_.notify_all();
+    return true;
+}
+
+void
+Completion::Wait() const
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    cv_.wait(lk, [&] { return done_; });
+}
+
+bool
+Completion::WaitFor(std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    return cv_.wait_for(lk, timeout, [&] { return done_; });
+}
+
+bool
+Completion::Done() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return done_;
+}
+
+std::function<void()>
+krkrvoice::CallOnce(std::function<void()> f)
+{
+    auto called = std::make_shared<std::atomic_bool>(false);
+    return [called, f = std::move(f)] {
+        if (!called->exchange(true) && f) f();
+    };
+}
+
+std::function<void()>
+krkrvoice::ChainCompletion(std::shared_ptr<Completion> done, std::function<void()> onFinish)
+{
+    return [done = std::move(done), onFinish = std::move(onFinish)] {
+        if (onFinish) onFinish();
+        done->Signal();
+    };
+}
+
+// -----------------------------------------------------------------------------
+// EventDispatcher 実装
+// -----------------------------------------------------------------------------
+#ifndef _WIN32
+void
+EventDispatcher::Event::Set()
+{
+    set_.store(true);
+    if (auto d = owner_.load()) d->Wake();
+}
+#endif
+
+EventDispatcher::EventDispatcher()
+{
+#ifdef _WIN32
+    wake_ = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#endif
+    thread_ = std::thread([this] { Loop(); });
+}
+
+EventDispatcher::~EventDispatcher()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    Wake();
+    thread_.join();
+#ifdef _WIN32
+    ::CloseHandle(wake_);
+#endif
+}
+
+void
+EventDispatcher::Wake()
+{
+#ifdef _WIN32
+    ::SetEvent(wake_);
+#else
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        woken_ = true;
+    }
+    cv_.notify_one();
+#endif
+}
+
+std::uint64_t
+EventDispatcher::Watch(Handle ev, Check ended, std::function<void()> onDone)
+{
+    auto e = std::make_shared<Entry>();
+    e->ev     = ev;
+    e->ended  = std::move(ended);
+    e->onDone = std::move(onDone);
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        e->id = nextId_++;
+        entries_.push_back(e);
+    }
+#ifndef _WIN32
+    ev->owner_.store(this);
+#endif
+    Wake();
+    return e->id;
+}
+
+bool
+EventDispatcher::Unwatch(std::uint64_t id)
+{
+    std::shared_ptr<Entry> e;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = std::find_if(entries_.begin(), entries_.end(), [&](const auto& x) { return x->id == id; });
+        if (it == entries_.end()) return false;
+        e = *it;
+    }
+    if (e->closed.exchange(true)) return false;
+    Wake();   // 待機中のハンドルから外させる（持ち物は待機スレッドで手放す）
+    return true;
+}
+
+size_t
+EventDispatcher::Watched() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return static_cast<size_t>(std::count_if(entries_.begin(), entries_.end(),
+                                             [](const auto& e) { return !e->closed.load(); }));
+}
+
+// 閉じた登録は待機スレッドで外す（待っている最中のハンドルを他のスレッドで閉じさせない）
+void
+EventDispatcher::Loop()
+{
+#ifdef _WIN32
+    ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    std::vector<HANDLE> handles;
+#endif
+    std::vector<std::shared_ptr<Entry>> watching, closed;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (stop_) break;
+            auto mid = std::stable_partition(entries_.begin(), entries_.end(),
+                                             [](const auto& e) { return !e->closed.load(); });
+            closed.assign(std::make_move_iterator(mid), std::make_move_iterator(entries_.end()));
+            entries_.erase(mid, entries_.end());
+            watching.assign(entries_.begin(), entries_.begin() + std::min(entries_.size(), kMaxWatched));
+        }
+        closed.clear();                                  // 持ち物の解放はロック外
+
+        std::vector<std::shared_ptr<Entry>> fired;
+#ifdef _WIN32
+        handles.assign(1, wake_);
+        for (const auto& e : watching) handles.push_back(e->ev);
+        DWORD r = ::WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+        if (r == WAIT_OBJECT_0 || r < WAIT_OBJECT_0 || r >= WAIT_OBJECT_0 + handles.size())
+            continue;
+        fired.push_back(watching[r - WAIT_OBJECT_0 - 1]);
+#else
+        // 前回の起床時にまだ待っていなかった登録のイベントも、ここで拾う
+        auto collect = [&] {
+            for (const auto& e : watching)
+                if (e->ev->set_.exchange(false)) fired.push_back(e);
+        };
+        collect();
+        if (fired.empty()) {
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [&] { return stop_ || woken_; });
+                woken_ = false;
+            }
+            collect();
+        }
+#endif
+        for (const auto& e : fired) {
+            if (e->closed.load() || !e->ended()) continue;
+            if (e->closed.exchange(true)) continue;      // Unwatch と競った
+            auto f = std::move(e->onDone);
+            if (f) f();
+        }
+        watching.clear();
+    }
+#ifdef _WIN32
+    ::CoUninitialize();
+#endif
+}
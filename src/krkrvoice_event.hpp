@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace krkrvoice {
+
+// 一度だけ立つ完了通知（待機はタイムアウト指定可）
+class Completion {
+public:
+    // 初回のみ true を返し、待機中のスレッドを起こす
+    bool Signal();
+
+    void Wait() const;
+    bool WaitFor(std::chrono::milliseconds timeout) const;   // 完了していれば true
+    bool Done() const;
+
+private:
+    mutable std::mutex              mtx_;
+    mutable std::condition_variable cv_;
+    bool                            done_ = false;
+};
+
+// 合成・再生の取り消しトークン
+//  既定構築のトークンは取り消されない。コピーは同じ状態を共有する
+//  Child() / Link() で作ったトークンは親が取り消されると一緒に取り消される
+class CancelToken {
+public:
+    CancelToken() = default;
+    static CancelToken Make() { CancelToken t; t.state_ = std::make_shared<State>(); return t; }
+
+    CancelToken Child() const { return Link(*this, CancelToken()); }
+
+    // a・b どちらが取り消されても取り消される新しいトークン
+    static CancelToken Link(const CancelToken& a, const CancelToken& b)
+    {
+        CancelToken t = Make();
+        t.state_->parents[0] = a.state_;
+        t.state_->parents[1] = b.state_;
+        return t;
+    }
+
+    void Cancel() const { if (state_) state_->flag.store(true); }
+    bool Cancelled() const { return Cancelled(state_.get()); }
+
+private:
+    struct State {
+        std::atomic_bool       flag{ false };
+        std::shared_ptr<State> parents[2];
+    };
+    static bool Cancelled(const State* s)
+    {
+        return s && (s->flag.load() || Cancelled(s->parents[0].get()) || Cancelled(s->parents[1].get()));
+    }
+    std::shared_ptr<State> state_;
+};
+
+// 何度呼ばれても f を一度だけ呼ぶコールバックを作る（コピーは呼んだかどうかを共有する）
+std::function<void()> CallOnce(std::function<void()> f);
+
+// onFinish を呼んだ後に done を立てるコールバックを作る
+std::function<void()> ChainCompletion(std::shared_ptr<Completion> done,
+                                      std::function<void()>       onFinish);
+
+// 多数の完了イベントを 1 本のスレッドで待ち、完了したものの onDone を呼ぶ
+//  Windows はエンジンの通知イベント（HANDLE）を WaitForMultipleObjects で待つ。
+//  それ以外の環境では Event を Set して知らせる（計測・代替エンジン用）
+//  イベントが立つと ended を呼び、true なら登録を外して onDone を呼ぶ。
+//  Windows ではスレッドを COM の MTA に入れる（ended から COM を呼べる）
+class EventDispatcher {
+public:
+#ifdef _WIN32
+    using Handle = void*;                 // HANDLE（持ち主は登録側。外れるまで閉じない）
+#else
+    class Event {
+    public:
+        void Set();
+    private:
+        friend class EventDispatcher;
+        std::atomic_bool                  set_{ false };
+        std::atomic<EventDispatcher*>     owner_{ nullptr };
+    };
+    using Handle = Event*;                // 外れるまで破棄しない
+#endif
+    using Check = std::function<bool()>;
+
+    EventDispatcher();
+    ~EventDispatcher();                   // 待機スレッドと合流する（onDone は呼ばない）
+
+    EventDispatcher(const EventDispatcher&)            = delete;
+    EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+    // 登録して ID を返す。同時に待てるのは kMaxWatched 件まで（超えた分は空きが出てから待ち始める）
+    std::uint64_t Watch(Handle ev, Check ended, std::function<void()> onDone);
+
+    // まだ完了していなければ外して true（onDone は呼ばない）。完了済み・通知済みなら false
+    bool Unwatch(std::uint64_t id);
+
+    size_t Watched() const;
+
+    static constexpr size_t kMaxWatched = 63;   // WaitForMultipleObjects の上限 - 起床用
+
+private:
+    struct Entry {
+        std::uint64_t         id = 0;
+        Handle                ev;
+        Check                 ended;
+        std::function<void()> onDone;
+        std::atomic_bool      closed{ false };   // 完了または Unwatch 済み
+    };
+
+    void Loop();
+    void Wake();
+
+    mutable std::mutex                  mtx_;
+    std::vector<std::shared_ptr<Entry>> entries_;
+    std::uint64_t                       nextId_ = 1;
+    bool                                stop_   = false;
+#ifdef _WIN32
+    void*                               wake_ = nullptr;   // 自動リセットのイベント
+#else
+    std::condition_variable             cv_;
+    bool                                woken_ = false;
+#endif
+    std::thread                         thread_;
+};
+
+} // namespace krkrvoice
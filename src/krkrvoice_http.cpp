@@ -0,0 +1,387 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_http.cpp   ―  keep-alive HTTP/1.1 クライアント（接続プール付き）
+// -----------------------------------------------------------------------------
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "krkrvoice_http.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+constexpr socket_t kBadSocket = INVALID_SOCKET;
+static void CloseSocket(socket_t s) { ::closesocket(s); }
+
+struct WsaInit {
+    WsaInit()  { WSADATA d; ::WSAStartup(MAKEWORD(2, 2), &d); }
+    ~WsaInit() { ::WSACleanup(); }
+};
+static void EnsureNetwork() { static WsaInit init; }
+#else
+using socket_t = int;
+constexpr socket_t kBadSocket = -1;
+static void CloseSocket(socket_t s) { ::close(s); }
+static void EnsureNetwork() {}
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static bool IEquals(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+static std::string_view Trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back()  == ' ' || s.back()  == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+static void AppendRequest(std::string& out, const HttpRequest& req, const std::string& host, int port)
+{
+    out += req.method; out += ' '; out += req.target.empty() ? "/" : req.target; out += " HTTP/1.1\r\n";
+    out += "Host: "; out += host; out += ':'; out += std::to_string(port); out += "\r\n";
+    out += "Connection: keep-alive\r\n";
+    if (!req.contentType.empty()) { out += "Content-Type: "; out += req.contentType; out += "\r\n"; }
+    if (!req.body.empty() || req.method == "POST" || req.method == "PUT") {
+        out += "Content-Length: "; out += std::to_string(req.body.size()); out += "\r\n";
+    }
+    out += "\r\n";
+    out += req.body;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 1 本の TCP 接続
+// -----------------------------------------------------------------------------
+class HttpClient::Connection {
+public:
+    ~Connection() { if (s_ != kBadSocket) CloseSocket(s_); }
+
+    bool Open(const std::string& host, int port, int timeoutMs)
+    {
+        EnsureNetwork();
+        addrinfo hints{};
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res)
+            return false;
+        for (addrinfo* a = res; a; a = a->ai_next) {
+            socket_t s = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (s == kBadSocket) continue;
+            if (::connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) { s_ = s; break; }
+            CloseSocket(s);
+        }
+        ::freeaddrinfo(res);
+        if (s_ == kBadSocket) return false;
+
+        int one = 1;   // 小さな JSON リクエストを Nagle で待たせない
+        ::setsockopt(s_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+#ifdef _WIN32
+        DWORD tv = static_cast<DWORD>(timeoutMs);
+#else
+        timeval tv{ timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+#endif
+        ::setsockopt(s_, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+        ::setsockopt(s_, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+        return true;
+    }
+
+    bool Write(const std::string& data)
+    {
+        size_t off = 0;
+        while (off < data.size()) {
+            int n = ::send(s_, data.data() + off, static_cast<int>(data.size() - off), MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            off += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // 応答 1 件を読む。gotBytes は 1 バイトでも受信できたか（再送可否の判定用）
+    bool ReadResponse(const std::string& method, HttpResponse& res, bool& keepAlive, bool& gotBytes)
+    {
+        gotBytes  = !buf_.empty();
+        keepAlive = true;
+
+        size_t hdrEnd;
+        while ((hdrEnd = buf_.find("\r\n\r\n")) == std::string::npos)
+            if (!Fill(gotBytes)) return false;
+
+        std::string_view head(buf_.data(), hdrEnd);
+        size_t lineEnd = head.find("\r\n");
+        std::string_view status = head.substr(0, lineEnd);
+        if (status.size() < 12 || status.substr(0, 5) != "HTTP/") return false;
+        res.status = std::atoi(std::string(status.substr(9, 3)).c_str());
+        if (status.substr(0, 8) == "HTTP/1.0") keepAlive = false;
+
+        long long contentLength = -1;
+        bool chunked = false;
+        for (size_t p = lineEnd == std::string_view::npos ? head.size() : lineEnd + 2; p < head.size();) {
+            size_t e = head.find("\r\n", p);
+            if (e == std::string_view::npos) e = head.size();
+            std::string_view line = head.substr(p, e - p);
+            p = e + 2;
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+            std::string_view name = Trim(line.substr(0, colon));
+            std::string_view val  = Trim(line.substr(colon + 1));
+            if      (IEquals(name, "content-length"))    contentLength = std::atoll(std::string(val).c_str());
+            else if (IEquals(name, "content-type"))      res.contentType = std::string(val);
+            else if (IEquals(name, "transfer-encoding")) chunked = IEquals(val, "chunked");
+            else if (IEquals(name, "connection"))        keepAlive = !IEquals(val, "close");
+        }
+        buf_.erase(0, hdrEnd + 4);
+        res.body.clear();
+
+        bool noBody = method == "HEAD" || res.status == 204 || res.status == 304 || res.status / 100 == 1;
+        if (noBody) return true;
+
+        if (chunked) {
+            while (true) {
+                size_t e;
+                while ((e = buf_.find("\r\n")) == std::string::npos)
+                    if (!Fill(gotBytes)) return false;
+                size_t n = std::strtoul(buf_.substr(0, e).c_str(), nullptr, 16);
+                buf_.erase(0, e + 2);
+                if (n == 0) {                                   // トレーラを読み捨て
+                    while ((e = buf_.find("\r\n")) != 0) {
+                        if (e == std::string::npos) { if (!Fill(gotBytes)) return false; continue; }
+                        buf_.erase(0, e + 2);
+                    }
+                    buf_.erase(0, 2);
+                    return true;
+                }
+                while (buf_.size() < n + 2)
+                    if (!Fill(gotBytes)) return false;
+                res.body.append(buf_, 0, n);
+                buf_.erase(0, n + 2);
+            }
+        }
+
+        if (contentLength >= 0) {
+            while (buf_.size() < static_cast<size_t>(contentLength))
+                if (!Fill(gotBytes)) return false;
+            res.body.assign(buf_, 0, static_cast<size_t>(contentLength));
+            buf_.erase(0, static_cast<size_t>(contentLength));
+            return true;
+        }
+
+        // 長さ指定なし：切断まで読む
+        keepAlive = false;
+        while (Fill(gotBytes)) {}
+        res.body.swap(buf_);
+        buf_.clear();
+        return true;
+    }
+
+private:
+    bool Fill(bool& gotBytes)
+    {
+        char tmp[16384];
+        int n = ::recv(s_, tmp, sizeof(tmp), 0);
+        if (n <= 0) return false;
+        gotBytes = true;
+        buf_.append(tmp, static_cast<size_t>(n));
+        return true;
+    }
+
+    socket_t    s_ = kBadSocket;
+    std::string buf_;   // 読み過ぎた分（パイプライン時は次の応答の先頭）
+};
+
+// -----------------------------------------------------------------------------
+// URL ユーティリティ
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::ParseHttpUrl(std::string_view url, std::string& host, int& port)
+{
+    if (url.substr(0, 7) == "http://") url.remove_prefix(7);
+    else if (url.find("://") != std::string_view::npos) return false;   // https 等は非対応
+    url = url.substr(0, url.find('/'));
+    if (url.empty()) return false;
+
+    if (url.front() == '[') {                                           // [::1]:50021
+        size_t e = url.find(']');
+        if (e == std::string_view::npos) return false;
+        host = std::string(url.substr(1, e - 1));
+        url.remove_prefix(e + 1);
+        if (!url.empty() && url.front() == ':') port = std::atoi(std::string(url.substr(1)).c_str());
+        return true;
+    }
+    size_t colon = url.rfind(':');
+    host = std::string(url.substr(0, colon));
+    if (colon != std::string_view::npos) port = std::atoi(std::string(url.substr(colon + 1)).c_str());
+    return !host.empty();
+}
+
+std::string
+krkrvoice::UrlEncode(std::string_view s)
+{
+    static const char* hex = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(s.size() * 3);
+    for (unsigned char c : s) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// HttpClient 実装
+// -----------------------------------------------------------------------------
+HttpClient::HttpClient(std::string host, int port, size_t maxIdle, int timeoutMs)
+    : host_(std::move(host)), port_(port), maxIdle_(maxIdle), timeoutMs_(timeoutMs)
+{
+}
+
+HttpClient::~HttpClient() = default;
+
+std::unique_ptr<HttpClient::Connection>
+HttpClient::Acquire(bool fresh)
+{
+    if (!fresh) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!idle_.empty()) {
+            auto c = std::move(idle_.back());   // 直近に使った接続から再利用
+            idle_.pop_back();
+            ++stats_.reuses;
+            return c;
+        }
+    }
+    auto c = std::make_unique<Connection>();
+    if (!c->Open(host_, port_, timeoutMs_)) return nullptr;
+    std::lock_guard<std::mutex> lk(mtx_);
+    ++stats_.connects;
+    return c;
+}
+
+void
+HttpClient::Release(std::unique_ptr<Connection> c)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (idle_.size() < maxIdle_) idle_.push_back(std::move(c));
+}
+
+bool
+HttpClient::SendOnce(const HttpRequest& req, HttpResponse& res, bool fresh, bool& retryable)
+{
+    retryable = false;
+    auto c = Acquire(fresh);
+    if (!c) return false;
+
+    std::string wire;
+    AppendRequest(wire, req, host_, port_);
+    bool keepAlive = false, gotBytes = false;
+    if (!c->Write(wire) || !c->ReadResponse(req.method, res, keepAlive, gotBytes)) {
+        retryable = !fresh && !gotBytes;   // プール内で切れていた接続なら張り直して再送
+        return false;
+    }
+    if (keepAlive) Release(std::move(c));
+    return true;
+}
+
+bool
+HttpClient::Send(const HttpRequest& req, HttpResponse& res)
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ++stats_.requests;
+    }
+    bool retryable = false;
+    if (SendOnce(req, res, false, retryable)) return true;
+    return retryable && SendOnce(req, res, true, retryable);
+}
+
+bool
+HttpClient::SendPipelined(const std::vector<HttpRequest>& reqs, std::vector<HttpResponse>& res,
+                          const ResponseHandler& onResponse)
+{
+    res.assign(reqs.size(), HttpResponse{});
+    if (reqs.empty()) return true;
+    if (reqs.size() == 1) {
+        bool ok = Send(reqs[0], res[0]);
+        if (onResponse) onResponse(0, res[0]);
+        return ok;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stats_.requests  += reqs.size();
+        stats_.pipelined += reqs.size();
+    }
+
+    size_t done = 0;
+    if (auto c = Acquire(false)) {
+        std::string wire;
+        for (const auto& r : reqs) AppendRequest(wire, r, host_, port_);
+        bool keepAlive = true, gotBytes = false;
+        if (c->Write(wire)) {
+            while (done < reqs.size() && keepAlive &&
+                   c->ReadResponse(reqs[done].method, res[done], keepAlive, gotBytes)) {
+                if (onResponse) onResponse(done, res[done]);
+                ++done;
+            }
+        }
+        if (done == reqs.size() && keepAlive) Release(std::move(c));
+    }
+
+    // 接続断・Connection: close 等で読めなかった残りは 1 件ずつ送る
+    bool ok = true;
+    for (size_t i = done; i < reqs.size(); ++i) {
+        bool retryable = false;
+        if (!SendOnce(reqs[i], res[i], false, retryable) &&
+            !(retryable && SendOnce(reqs[i], res[i], true, retryable)))
+            ok = false;
+        if (onResponse) onResponse(i, res[i]);
+    }
+    return ok;
+}
+
+void
+HttpClient::CloseIdle()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    idle_.clear();
+}
+
+HttpClientStats
+HttpClient::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return stats_;
+}
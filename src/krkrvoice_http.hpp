@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace krkrvoice {
+
+struct HttpRequest {
+    std::string method = "GET";
+    std::string target;        // "/audio_query?text=..." 等
+    std::string contentType;   // body がある場合のみ
+    std::string body;
+};
+
+struct HttpResponse {
+    int         status = 0;
+    std::string contentType;
+    std::string body;
+    bool ok() const { return status >= 200 && status < 300; }
+};
+
+struct HttpClientStats {
+    std::uint64_t requests  = 0;   // 送信したリクエスト数
+    std::uint64_t connects  = 0;   // 新規 TCP 接続数
+    std::uint64_t reuses    = 0;   // プールから再利用した回数
+    std::uint64_t pipelined = 0;   // パイプラインで送ったリクエスト数
+};
+
+// "http://host[:port][/...]" を分解（ポート指定が無ければ port は変更しない）
+bool ParseHttpUrl(std::string_view url, std::string& host, int& port);
+
+// クエリ文字列用のパーセントエンコード（UTF-8 入力）
+std::string UrlEncode(std::string_view s);
+
+// 単一ホスト向けの keep-alive HTTP/1.1 クライアント
+//  - アイドル接続をプールして使い回し、TCP 確立を毎回行わない
+//  - 複数リクエストを 1 接続に続けて書き込むパイプライン送信に対応
+//  - スレッドセーフ（同時リクエストは別々の接続を使う）
+class HttpClient {
+public:
+    HttpClient(std::string host, int port, size_t maxIdle = 4, int timeoutMs = 60000);
+    ~HttpClient();
+
+    HttpClient(const HttpClient&)            = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    bool Send(const HttpRequest& req, HttpResponse& res);
+
+    // reqs を 1 接続にまとめて書き込み、応答を順に読む
+    // 途中で接続が切れた場合、残りは個別に再送する
+    // onResponse は応答を 1 件読むごとに（失敗した要求も含め）添字順に呼ぶ。全部読むのを待たずに使える
+    using ResponseHandler = std::function<void(size_t index, HttpResponse& res)>;
+    bool SendPipelined(const std::vector<HttpRequest>& reqs, std::vector<HttpResponse>& res,
+                       const ResponseHandler& onResponse = {});
+
+    void CloseIdle();
+    HttpClientStats Stats() const;
+
+    const std::string& Host() const { return host_; }
+    int                Port() const { return port_; }
+
+private:
+    class Connection;
+
+    std::unique_ptr<Connection> Acquire(bool fresh);
+    void Release(std::unique_ptr<Connection> c);
+    bool SendOnce(const HttpRequest& req, HttpResponse& res, bool fresh, bool& retryable);
+
+    std::string host_;
+    int         port_;
+    size_t      maxIdle_;
+    int         timeoutMs_;
+
+    mutable std::mutex mtx_;
+    std::vector<std::unique_ptr<Connection>> idle_;
+    HttpClientStats stats_;
+};
+
+} // namespace krkrvoice
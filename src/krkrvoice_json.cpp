@@ -0,0 +1,340 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_json.cpp   ―  最小限の JSON / UTF-8 変換
+// -----------------------------------------------------------------------------
+#include "krkrvoice_json.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// UTF-8 変換
+// -----------------------------------------------------------------------------
+namespace {
+
+static void AppendUtf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+static void AppendWide(std::wstring& out, uint32_t cp)
+{
+    if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+        cp -= 0x10000;
+        out += static_cast<wchar_t>(0xD800 | (cp >> 10));
+        out += static_cast<wchar_t>(0xDC00 | (cp & 0x3FF));
+    } else {
+        out += static_cast<wchar_t>(cp);
+    }
+}
+
+} // unnamed namespace
+
+std::string
+krkrvoice::ToUtf8(std::wstring_view s)
+{
+    std::string out;
+    out.reserve(s.size() * 3);
+    for (size_t i = 0; i < s.size(); ++i) {
+        uint32_t cp = static_cast<uint32_t>(s[i]);
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < s.size()) {     // サロゲートペア
+            uint32_t lo = static_cast<uint32_t>(s[i + 1]);
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                ++i;
+            }
+        }
+        AppendUtf8(out, cp);
+    }
+    return out;
+}
+
+std::wstring
+krkrvoice::FromUtf8(std::string_view s)
+{
+    std::wstring out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size();) {
+        uint8_t  c = static_cast<uint8_t>(s[i]);
+        uint32_t cp;
+        size_t   n;
+        if      (c < 0x80)           { cp = c;        n = 1; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; n = 2; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; n = 3; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; n = 4; }
+        else                         { ++i; AppendWide(out, 0xFFFD); continue; }
+        if (i + n > s.size()) { AppendWide(out, 0xFFFD); break; }
+        for (size_t k = 1; k < n; ++k) cp = (cp << 6) | (static_cast<uint8_t>(s[i + k]) & 0x3F);
+        AppendWide(out, cp);
+        i += n;
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// パーサ
+// -----------------------------------------------------------------------------
+namespace {
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view t) : t_(t) {}
+
+    bool ParseDocument(JsonValue& out)
+    {
+        if (!ParseValue(out, 0)) return false;
+        SkipWs();
+        return p_ == t_.size();
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    void SkipWs()
+    {
+        while (p_ < t_.size() && (t_[p_] == ' ' || t_[p_] == '\t' || t_[p_] == '\n' || t_[p_] == '\r')) ++p_;
+    }
+
+    bool Literal(std::string_view lit)
+    {
+        if (t_.substr(p_, lit.size()) != lit) return false;
+        p_ += lit.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue& out, int depth)
+    {
+        if (depth > kMaxDepth) return false;
+        SkipWs();
+        if (p_ >= t_.size()) return false;
+        switch (t_[p_]) {
+        case 'n': out = JsonValue();       return Literal("null");
+        case 't': out = JsonValue(true);   return Literal("true");
+        case 'f': out = JsonValue(false);  return Literal("false");
+        case '"': {
+            std::string s;
+            if (!ParseString(s)) return false;
+            out = JsonValue(std::move(s));
+            return true;
+        }
+        case '[': {
+            ++p_;
+            out = JsonValue::MakeArray();
+            SkipWs();
+            if (p_ < t_.size() && t_[p_] == ']') { ++p_; return true; }
+            while (true) {
+                JsonValue v;
+                if (!ParseValue(v, depth + 1)) return false;
+                out.Push(std::move(v));
+                SkipWs();
+                if (p_ >= t_.size()) return false;
+                if (t_[p_] == ',') { ++p_; continue; }
+                if (t_[p_] == ']') { ++p_; return true; }
+                return false;
+            }
+        }
+        case '{': {
+            ++p_;
+            out = JsonValue::MakeObject();
+            SkipWs();
+            if (p_ < t_.size() && t_[p_] == '}') { ++p_; return true; }
+            while (true) {
+                SkipWs();
+                std::string key;
+                if (p_ >= t_.size() || t_[p_] != '"' || !ParseString(key)) return false;
+                SkipWs();
+                if (p_ >= t_.size() || t_[p_] != ':') return false;
+                ++p_;
+                JsonValue v;
+                if (!ParseValue(v, depth + 1)) return false;
+                out.Set(key, std::move(v));
+                SkipWs();
+                if (p_ >= t_.size()) return false;
+                if (t_[p_] == ',') { ++p_; continue; }
+                if (t_[p_] == '}') { ++p_; return true; }
+                return false;
+            }
+        }
+        default: {
+            size_t b = p_;
+            while (p_ < t_.size() && std::string_view("+-0123456789.eE").find(t_[p_]) != std::string_view::npos) ++p_;
+            if (b == p_) return false;
+            std::string num(t_.substr(b, p_ - b));
+            char* end = nullptr;
+            double d = std::strtod(num.c_str(), &end);
+            if (end != num.c_str() + num.size()) return false;
+            out = JsonValue(d);
+            return true;
+        }
+        }
+    }
+
+    bool Hex4(uint32_t& v)
+    {
+        if (p_ + 4 > t_.size()) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = t_[p_++];
+            v <<= 4;
+            if      (c >= '0' && c <= '9') v |= c - '0';
+            else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool ParseString(std::string& s)
+    {
+        ++p_;                                            // 開き "
+        while (p_ < t_.size()) {
+            char c = t_[p_++];
+            if (c == '"') return true;
+            if (c != '\\') { s += c; continue; }
+            if (p_ >= t_.size()) return false;
+            switch (t_[p_++]) {
+            case '"':  s += '"';  break;
+            case '\\': s += '\\'; break;
+            case '/':  s += '/';  break;
+            case 'b':  s += '\b'; break;
+            case 'f':  s += '\f'; break;
+            case 'n':  s += '\n'; break;
+            case 'r':  s += '\r'; break;
+            case 't':  s += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!Hex4(cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00 && Literal("\\u")) {
+                    uint32_t lo;
+                    if (!Hex4(lo)) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                AppendUtf8(s, cp);
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    std::string_view t_;
+    size_t           p_ = 0;
+};
+
+static void DumpString(std::string& out, const std::string& s)
+{
+    out += '"';
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n";  break;
+        case '\r': out += "\\r";  break;
+        case '\t': out += "\\t";  break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// JsonValue 実装
+// -----------------------------------------------------------------------------
+bool
+JsonValue::Parse(std::string_view text, JsonValue& out)
+{
+    JsonParser p(text);
+    return p.ParseDocument(out);
+}
+
+std::string
+JsonValue::Dump() const
+{
+    std::string out;
+    DumpTo(out);
+    return out;
+}
+
+void
+JsonValue::DumpTo(std::string& out) const
+{
+    switch (type_) {
+    case Type::Null:   out += "null"; break;
+    case Type::Bool:   out += bool_ ? "true" : "false"; break;
+    case Type::Number: {
+        char buf[32];
+        auto r = std::to_chars(buf, buf + sizeof(buf), num_);
+        out.append(buf, r.ptr);
+        break;
+    }
+    case Type::String: DumpString(out, str_); break;
+    case Type::Array:
+        out += '[';
+        for (size_t i = 0; i < items_.size(); ++i) {
+            if (i) out += ',';
+            items_[i].DumpTo(out);
+        }
+        out += ']';
+        break;
+    case Type::Object:
+        out += '{';
+        for (size_t i = 0; i < members_.size(); ++i) {
+            if (i) out += ',';
+            DumpString(out, members_[i].first);
+            out += ':';
+            members_[i].second.DumpTo(out);
+        }
+        out += '}';
+        break;
+    }
+}
+
+const JsonValue*
+JsonValue::Find(std::string_view key) const
+{
+    for (const auto& [k, v] : members_)
+        if (k == key) return &v;
+    return nullptr;
+}
+
+JsonValue*
+JsonValue::Find(std::string_view key)
+{
+    for (auto& [k, v] : members_)
+        if (k == key) return &v;
+    return nullptr;
+}
+
+void
+JsonValue::Set(const std::string& key, JsonValue v)
+{
+    if (auto* cur = Find(key)) { *cur = std::move(v); return; }
+    members_.emplace_back(key, std::move(v));
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace krkrvoice {
+
+// UTF-16/32(wchar_t) ⇔ UTF-8
+std::string  ToUtf8(std::wstring_view s);
+std::wstring FromUtf8(std::string_view s);
+
+// VOICEVOX の応答程度を扱う最小限の JSON 値
+//  - オブジェクトのメンバ順は保持する（audio_query をそのまま送り返すため）
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    JsonValue() = default;
+    JsonValue(bool b)               : type_(Type::Bool),   bool_(b) {}
+    JsonValue(double n)             : type_(Type::Number), num_(n) {}
+    JsonValue(int n)                : type_(Type::Number), num_(n) {}
+    JsonValue(std::string s)        : type_(Type::String), str_(std::move(s)) {}
+    JsonValue(const char* s)        : type_(Type::String), str_(s) {}
+    static JsonValue MakeArray()    { JsonValue v; v.type_ = Type::Array;  return v; }
+    static JsonValue MakeObject()   { JsonValue v; v.type_ = Type::Object; return v; }
+
+    static bool Parse(std::string_view text, JsonValue& out);
+    std::string Dump() const;
+
+    Type type() const { return type_; }
+    bool isNull()   const { return type_ == Type::Null; }
+    bool isArray()  const { return type_ == Type::Array; }
+    bool isObject() const { return type_ == Type::Object; }
+
+    bool               AsBool(bool def = false)  const { return type_ == Type::Bool   ? bool_ : def; }
+    double             AsNumber(double def = 0)  const { return type_ == Type::Number ? num_  : def; }
+    const std::string& AsString()                const { return str_; }
+
+    // 配列
+    const std::vector<JsonValue>& Items() const { return items_; }
+    std::vector<JsonValue>&       Items()       { return items_; }
+    void Push(JsonValue v) { items_.push_back(std::move(v)); }
+
+    // オブジェクト（無ければ nullptr）
+    const JsonValue* Find(std::string_view key) const;
+    JsonValue*       Find(std::string_view key);
+    void Set(const std::string& key, JsonValue v);
+    const std::vector<std::pair<std::string, JsonValue>>& Members() const { return members_; }
+
+private:
+    void DumpTo(std::string& out) const;
+
+    Type        type_ = Type::Null;
+    bool        bool_ = false;
+    double      num_  = 0;
+    std::string str_;
+    std::vector<JsonValue> items_;
+    std::vector<std::pair<std::string, JsonValue>> members_;
+};
+
+} // namespace krkrvoice
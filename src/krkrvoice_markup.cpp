@@ -0,0 +1,249 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_markup.cpp   ―  シナリオ（KAG）タグの除去と休止記号
+// -----------------------------------------------------------------------------
+#include "krkrvoice_markup.hpp"
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+static bool IsSpace(wchar_t c)
+{
+    return c == L' ' || c == L'\t' || c == L'\r' || c == 0x3000;
+}
+
+// タグ名・属性名は ASCII の大文字小文字を区別しない
+static bool EqualsNoCase(std::wstring_view a, std::wstring_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        wchar_t x = a[i], y = b[i];
+        if (x >= L'A' && x <= L'Z') x = static_cast<wchar_t>(x - L'A' + L'a');
+        if (y >= L'A' && y <= L'Z') y = static_cast<wchar_t>(y - L'A' + L'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+// pos から見て引用符の外にある ] の位置。タグは行をまたがないので改行で打ち切る
+static size_t FindTagEnd(std::wstring_view s, size_t pos)
+{
+    wchar_t quote = 0;
+    for (size_t i = pos; i < s.size(); ++i) {
+        wchar_t c = s[i];
+        if (c == L'\n') return std::wstring_view::npos;
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == L'"' || c == L'\'') {
+            quote = c;
+        } else if (c == L']') {
+            return i;
+        }
+    }
+    return std::wstring_view::npos;
+}
+
+// タグ本体（[ と ] の内側）を名前と属性に分ける。値はコピーせず本体を指す
+class TagView {
+public:
+    explicit TagView(std::wstring_view body) : body_(body)
+    {
+        size_t i = 0;
+        while (i < body_.size() && IsSpace(body_[i])) ++i;
+        size_t b = i;
+        while (i < body_.size() && !IsSpace(body_[i])) ++i;
+        name_ = body_.substr(b, i - b);
+        rest_ = body_.substr(i);
+    }
+
+    std::wstring_view Name() const { return name_; }
+
+    bool Attr(std::wstring_view key, std::wstring_view& value) const
+    {
+        std::wstring_view s = rest_;
+        size_t i = 0;
+        while (i < s.size()) {
+            while (i < s.size() && IsSpace(s[i])) ++i;
+            size_t kb = i;
+            while (i < s.size() && !IsSpace(s[i]) && s[i] != L'=') ++i;
+            std::wstring_view k = s.substr(kb, i - kb);
+            while (i < s.size() && IsSpace(s[i])) ++i;
+            std::wstring_view v;
+            if (i < s.size() && s[i] == L'=') {
+                ++i;
+                while (i < s.size() && IsSpace(s[i])) ++i;
+                if (i < s.size() && (s[i] == L'"' || s[i] == L'\'')) {
+                    wchar_t q = s[i++];
+                    size_t vb = i;
+                    while (i < s.size() && s[i] != q) ++i;
+                    v = s.substr(vb, i - vb);
+                    if (i < s.size()) ++i;
+                } else {
+                    size_t vb = i;
+                    while (i < s.size() && !IsSpace(s[i])) ++i;
+                    v = s.substr(vb, i - vb);
+                }
+            }
+            if (!k.empty() && EqualsNoCase(k, key)) {
+                value = v;
+                return true;
+            }
+            if (k.empty()) ++i;   // 孤立した = など
+        }
+        return false;
+    }
+
+private:
+    std::wstring_view body_, name_, rest_;
+};
+
+static int ParseMs(std::wstring_view v)
+{
+    if (v.empty() || v.size() > 9) return -1;
+    int ms = 0;
+    for (wchar_t c : v) {
+        if (c < L'0' || c > L'9') return -1;
+        ms = ms * 10 + (c - L'0');
+    }
+    return ms;
+}
+
+// & で始まる属性値は TJS 式（ここでは評価できない）
+static bool IsExpression(std::wstring_view v)
+{
+    return !v.empty() && v[0] == L'&';
+}
+
+static bool HasMarkup(std::wstring_view s)
+{
+    wchar_t prev = L'\n';
+    for (wchar_t c : s) {
+        if (c == L'[' || (c == L'@' && prev == L'\n')) return true;
+        prev = c;
+    }
+    return false;
+}
+
+// 出力先。ルビが保留中なら、次に出る 1 文字（サロゲートペアは 1 文字）をよみに置き換える
+class MarkupWriter {
+public:
+    explicit MarkupWriter(std::wstring& out) : out_(out) {}
+
+    void Text(std::wstring_view s)
+    {
+        if (s.empty()) return;
+        if (hasRuby_) {
+            size_t base = (s.size() >= 2 && s[0] >= 0xD800 && s[0] <= 0xDBFF) ? 2 : 1;
+            out_.append(ruby_);
+            s.remove_prefix(base);
+            hasRuby_ = false;
+        }
+        out_.append(s);
+    }
+
+    void Ruby(std::wstring_view reading)
+    {
+        ruby_    = reading;
+        hasRuby_ = true;
+    }
+
+    void Pause(int ms) { AppendPause(out_, ms); }
+
+private:
+    std::wstring&     out_;
+    std::wstring_view ruby_;
+    bool              hasRuby_ = false;
+};
+
+static void HandleTag(const TagView& tag, MarkupWriter& w, const MarkupOptions& opt)
+{
+    std::wstring_view name = tag.Name(), v;
+    if (EqualsNoCase(name, L"l")) {
+        w.Pause(opt.clickPauseMs);
+    } else if (EqualsNoCase(name, L"p")) {
+        w.Pause(opt.pagePauseMs);
+    } else if (EqualsNoCase(name, L"wait")) {
+        if (tag.Attr(L"time", v)) w.Pause(ParseMs(v));
+    } else if (EqualsNoCase(name, L"ruby")) {
+        if (tag.Attr(L"text", v) && !v.empty() && !IsExpression(v)) w.Ruby(v);
+    } else if (EqualsNoCase(name, L"ch")) {
+        if (tag.Attr(L"text", v) && !IsExpression(v)) w.Text(v);
+    }
+    // それ以外（r, emb, font, style, locate, cm, er ...）は表示用なので読まない
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 休止記号
+// -----------------------------------------------------------------------------
+void
+krkrvoice::AppendPause(std::wstring& out, int ms)
+{
+    constexpr int kMaxSteps = kPauseMarkLast - kPauseMarkFirst + 1;
+    for (int steps = ms / kPauseMarkStepMs; steps > 0;) {
+        int n = std::min(steps, kMaxSteps);
+        out.push_back(static_cast<wchar_t>(kPauseMarkFirst + n - 1));
+        steps -= n;
+    }
+}
+
+std::wstring
+krkrvoice::PausesToText(std::wstring_view text, std::wstring_view separator)
+{
+    std::wstring out;
+    out.reserve(text.size());
+    ForEachPause(text,
+                 [&](std::wstring_view s) { out.append(s); },
+                 [&](int) { out.append(separator); });
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// KAG タグの除去
+//  タグの間の文字列はまとめて追記し、タグ本体は TagView で読むだけなのでコピーしない
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::StripScenarioMarkup(std::wstring_view in, std::wstring& out, const MarkupOptions& opt)
+{
+    if (!HasMarkup(in)) return false;
+
+    out.clear();
+    out.reserve(in.size());
+    MarkupWriter w(out);
+    const size_t n = in.size();
+    size_t run = 0, i = 0;
+    while (i < n) {
+        const wchar_t c = in[i];
+        if (c == L'@' && (i == 0 || in[i - 1] == L'\n')) {   // タグ行は改行ごと落とす
+            w.Text(in.substr(run, i - run));
+            size_t e = in.find(L'\n', i);
+            i = run = (e == std::wstring_view::npos) ? n : e + 1;
+            continue;
+        }
+        if (c != L'[') {
+            ++i;
+            continue;
+        }
+        w.Text(in.substr(run, i - run));
+        if (i + 1 < n && in[i + 1] == L'[') {
+            w.Text(in.substr(i, 1));
+            i = run = i + 2;
+            continue;
+        }
+        size_t close = FindTagEnd(in, i + 1);
+        if (close == std::wstring_view::npos) {   // 閉じていなければ残りは本文
+            run = i;
+            break;
+        }
+        HandleTag(TagView(in.substr(i + 1, close - i - 1)), w, opt);
+        i = run = close + 1;
+    }
+    w.Text(in.substr(std::min(run, n)));
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace krkrvoice {
+
+// シナリオ（KAG）のタグを読み上げ用に正規化する設定
+struct MarkupOptions {
+    int clickPauseMs = 300;   // [l]  クリック待ち
+    int pagePauseMs  = 600;   // [p]  改ページ待ち
+};
+
+// -----------------------------------------------------------------------------
+// 休止記号
+//  正規化後のテキスト中で休止を表す 1 文字。Unicode の内部用非文字 U+FDD0-U+FDEF を使い、
+//  1 文字で 50ms 単位・最大 1600ms。長い休止は複数並べる（エンジン側で合算する）
+//  辞書置換を通っても壊れないよう、数字などの通常の文字は使わない
+// -----------------------------------------------------------------------------
+constexpr wchar_t kPauseMarkFirst = 0xFDD0;
+constexpr wchar_t kPauseMarkLast  = 0xFDEF;
+constexpr int     kPauseMarkStepMs = 50;
+
+inline bool IsPauseMark(wchar_t c) { return c >= kPauseMarkFirst && c <= kPauseMarkLast; }
+inline int  PauseMarkMs(wchar_t c) { return (c - kPauseMarkFirst + 1) * kPauseMarkStepMs; }
+
+inline bool HasPauseMarks(std::wstring_view text)
+{
+    for (wchar_t c : text)
+        if (IsPauseMark(c)) return true;
+    return false;
+}
+
+// ms ぶんの休止記号を out に足す（50ms 未満は切り捨て）
+void AppendPause(std::wstring& out, int ms);
+
+// 休止記号を区切りに、文字列部分と休止（連続分は合算した ms）を順に渡す
+template <class OnText, class OnPause>
+void ForEachPause(std::wstring_view text, OnText&& onText, OnPause&& onPause)
+{
+    size_t i = 0;
+    while (i < text.size()) {
+        size_t j = i;
+        while (j < text.size() && !IsPauseMark(text[j])) ++j;
+        if (j > i) onText(text.substr(i, j - i));
+        int ms = 0;
+        for (; j < text.size() && IsPauseMark(text[j]); ++j) ms += PauseMarkMs(text[j]);
+        if (ms > 0) onPause(ms);
+        i = j;
+    }
+}
+
+// 休止記号を separator に置き換える（休止を表現できないエンジン向け。連続分は 1 つにまとめる）
+std::wstring PausesToText(std::wstring_view text, std::wstring_view separator);
+
+// -----------------------------------------------------------------------------
+// KAG タグの除去（1 パス）
+//  - 表示用のタグ（[r] [emb] [font] など未知のものを含む）と @ で始まるタグ行は落とす
+//    [emb exp=...] の式はここでは評価できないので、必要ならスクリプト側で展開しておく
+//  - [ruby text=よみ] は直後の 1 文字をよみに置き換える（text が & で始まる式なら元の文字のまま）
+//  - [ch text=...] は text を読む。[[ は [ 1 文字
+//  - [l] [p] [wait time=ms] は休止記号にする
+//  - 閉じていない [ 以降はそのまま残す
+// タグを含まない行は何もせず false を返す（out には触れず、確保も起きない）。
+// true のときだけ out に結果を入れる
+// -----------------------------------------------------------------------------
+bool StripScenarioMarkup(std::wstring_view in, std::wstring& out, const MarkupOptions& opt = {});
+
+} // namespace krkrvoice
@@ -0,0 +1,215 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_memory.cpp   ―  プロセス全体のメモリ予算
+// -----------------------------------------------------------------------------
+#include "krkrvoice_memory.hpp"
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+const char*
+krkrvoice::MemoryClassName(MemoryClass cls)
+{
+    switch (cls) {
+    case MemoryClass::Prefetch: return "prefetch";
+    case MemoryClass::Cache:    return "cache";
+    case MemoryClass::Engines:  return "engines";
+    default:                    return "playback";
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MemoryGovernor 実装
+// -----------------------------------------------------------------------------
+MemoryGovernor&
+MemoryGovernor::Instance()
+{
+    static MemoryGovernor inst;
+    return inst;
+}
+
+size_t
+MemoryGovernor::Need(size_t bytes) const
+{
+    const auto total = stats_.bytes + bytes;
+    return budget_ && total > budget_ ? static_cast<size_t>(total - budget_) : 0;
+}
+
+void
+MemoryGovernor::Charge(MemoryClass cls, size_t bytes)
+{
+    auto& c = stats_.classes[static_cast<size_t>(cls)];
+    c.bytes          += bytes;
+    c.peakBytes       = std::max(c.peakBytes, c.bytes);
+    stats_.bytes     += bytes;
+    stats_.peakBytes  = std::max(stats_.peakBytes, stats_.bytes);
+}
+
+void
+MemoryGovernor::SetBudget(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        budget_       = bytes;
+        stats_.budget = bytes;
+    }
+    Reclaim(MemoryClass::Playback, 0);
+}
+
+size_t
+MemoryGovernor::Budget() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return budget_;
+}
+
+bool
+MemoryGovernor::Reserve(MemoryClass cls, size_t bytes, bool force)
+{
+    auto& c = stats_.classes[static_cast<size_t>(cls)];
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (Need(bytes) == 0) {
+            Charge(cls, bytes);
+            return true;
+        }
+        if (!force && bytes > budget_) {             // 全部手放しても入らない
+            ++c.denied;
+            ++stats_.denied;
+            return false;
+        }
+    }
+    Reclaim(cls, bytes);
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (Need(bytes) > 0) {
+        if (!force) {
+            ++c.denied;
+            ++stats_.denied;
+            return false;
+        }
+        ++stats_.overBudget;
+    }
+    Charge(cls, bytes);
+    return true;
+}
+
+void
+MemoryGovernor::Release(MemoryClass cls, size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto& c = stats_.classes[static_cast<size_t>(cls)];
+    bytes = static_cast<size_t>(std::min<std::uint64_t>(bytes, c.bytes));
+    c.bytes      -= bytes;
+    stats_.bytes -= bytes;
+}
+
+// 種類ごとに、登録順に手放させる。Reclaimer はロック外で呼ぶ（中で Release するため）
+void
+MemoryGovernor::Reclaim(MemoryClass upTo, size_t bytes)
+{
+    const size_t last = std::min(static_cast<size_t>(upTo), static_cast<size_t>(MemoryClass::Engines));
+    for (size_t c = 0; c <= last; ++c) {
+        std::vector<std::shared_ptr<Slot>> targets;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (Need(bytes) == 0) return;
+            for (const auto& s : slots_)
+                if (static_cast<size_t>(s->cls) == c) {
+                    ++s->busy;
+                    targets.push_back(s);
+                }
+            if (targets.empty()) continue;
+            ++stats_.reclaims;
+        }
+        for (const auto& s : targets) {
+            size_t need;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                need = Need(bytes);
+            }
+            if (need == 0) break;
+            const size_t freed = s->reclaim(need);
+            std::lock_guard<std::mutex> lk(mtx_);
+            stats_.classes[c].reclaimedBytes += freed;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            for (const auto& s : targets) --s->busy;
+        }
+        idle_.notify_all();
+    }
+}
+
+std::uint64_t
+MemoryGovernor::Register(MemoryClass cls, Reclaimer reclaim)
+{
+    auto s = std::make_shared<Slot>();
+    s->cls     = cls;
+    s->reclaim = std::move(reclaim);
+    std::lock_guard<std::mutex> lk(mtx_);
+    s->id = nextId_++;
+    slots_.push_back(s);
+    return s->id;
+}
+
+void
+MemoryGovernor::Unregister(std::uint64_t id)
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    auto it = std::find_if(slots_.begin(), slots_.end(), [&](const auto& s) { return s->id == id; });
+    if (it == slots_.end()) return;
+    auto s = *it;
+    slots_.erase(it);
+    idle_.wait(lk, [&] { return s->busy == 0; });
+}
+
+MemoryGovernorStats
+MemoryGovernor::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return stats_;
+}
+
+void
+MemoryGovernor::ResetPeaks()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    stats_.peakBytes = stats_.bytes;
+    for (auto& c : stats_.classes) c.peakBytes = c.bytes;
+}
+
+// -----------------------------------------------------------------------------
+// MemoryAccount 実装
+// -----------------------------------------------------------------------------
+// 静的に持つ口座より先に MemoryGovernor を作っておく（破棄が後になるように）
+MemoryAccount::MemoryAccount(MemoryClass cls, MemoryGovernor::Reclaimer reclaim)
+    : cls_(cls)
+{
+    auto& gov = MemoryGovernor::Instance();
+    if (reclaim) id_ = gov.Register(cls, std::move(reclaim));
+}
+
+MemoryAccount::~MemoryAccount()
+{
+    auto& gov = MemoryGovernor::Instance();
+    if (id_) gov.Unregister(id_);
+    if (auto left = bytes_.exchange(0)) gov.Release(cls_, left);
+}
+
+bool
+MemoryAccount::Reserve(size_t bytes, bool force)
+{
+    if (!bytes) return true;
+    if (!MemoryGovernor::Instance().Reserve(cls_, bytes, force)) return false;
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+void
+MemoryAccount::Release(size_t bytes)
+{
+    if (!bytes) return;
+    bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    MemoryGovernor::Instance().Release(cls_, bytes);
+}
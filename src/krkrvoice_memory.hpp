@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace krkrvoice {
+
+// メモリの使い道。値の小さいものほど予算が足りないときに先に手放す
+enum class MemoryClass {
+    Prefetch = 0,   // 先読み結果（捨てても発話時に合成し直せる）
+    Cache    = 1,   // 合成済み音声のメモリ層
+    Engines  = 2,   // 待機中の合成器（使用中のものは手放せない）
+    Playback = 3,   // 再生中の音声・ストリームのリング（手放せない）
+};
+constexpr size_t kMemoryClassCount = 4;
+
+const char* MemoryClassName(MemoryClass cls);
+
+struct MemoryClassStats {
+    std::uint64_t bytes          = 0;
+    std::uint64_t peakBytes      = 0;
+    std::uint64_t reclaimedBytes = 0;   // 予算のために手放させた量
+    std::uint64_t denied         = 0;   // 予算が足りず確保を断った回数
+};
+
+struct MemoryGovernorStats {
+    std::uint64_t budget     = 0;   // 0 は無制限
+    std::uint64_t bytes      = 0;
+    std::uint64_t peakBytes  = 0;
+    std::uint64_t reclaims   = 0;   // 手放させに行った回数
+    std::uint64_t denied     = 0;
+    std::uint64_t overBudget = 0;   // 手放せる分が足りず、手放せない確保が予算を超えた回数
+    MemoryClassStats classes[kMemoryClassCount];
+};
+
+// プロセス全体のメモリ予算
+//  - 音声を持つ部品は確保の前に Reserve、手放したら Release する
+//  - 予算を超える Reserve は、自分と同じかそれより先に手放す種類（Prefetch → Cache → Engines）の
+//    部品に Reclaimer で手放させてから確保する。足りなければ断る（force なら超えても確保する）
+//  - Reclaimer は Reserve の呼び出し元スレッドでロック外に呼ぶ。部品は自分のロックを持ったまま
+//    Reserve してはいけない（Release はロック中でもよい）
+class MemoryGovernor {
+public:
+    // 最大 bytes 手放して、手放した量を返す（手放した分は Release 済みであること）
+    using Reclaimer = std::function<size_t(size_t bytes)>;
+
+    static MemoryGovernor& Instance();
+
+    MemoryGovernor() = default;
+    MemoryGovernor(const MemoryGovernor&)            = delete;
+    MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+    // 0 で無制限（既定）。縮めたときは超えた分をその場で手放させる
+    void   SetBudget(size_t bytes);
+    size_t Budget() const;
+
+    bool Reserve(MemoryClass cls, size_t bytes, bool force = false);
+    void Release(MemoryClass cls, size_t bytes);
+
+    // 手放せるものを持つ部品の登録。Unregister は実行中の Reclaimer が終わるまで待つ
+    std::uint64_t Register(MemoryClass cls, Reclaimer reclaim);
+    void          Unregister(std::uint64_t id);
+
+    MemoryGovernorStats Stats() const;
+    void                ResetPeaks();
+
+private:
+    struct Slot {
+        std::uint64_t id = 0;
+        MemoryClass   cls;
+        Reclaimer     reclaim;
+        int           busy = 0;   // 実行中の Reclaimer（mtx_ で保護）
+    };
+
+    // 合計が予算に bytes の空きを持つまで、upTo までの種類に手放させる
+    void Reclaim(MemoryClass upTo, size_t bytes);
+    void Charge(MemoryClass cls, size_t bytes);   // mtx_ 保持中に呼ぶ
+    size_t Need(size_t bytes) const;               // 同上
+
+    mutable std::mutex      mtx_;
+    std::condition_variable idle_;   // Slot::busy が 0 になった
+    size_t                  budget_ = 0;
+    std::uint64_t           nextId_ = 1;
+    std::vector<std::shared_ptr<Slot>> slots_;
+    MemoryGovernorStats     stats_;
+};
+
+// 部品ごとの確保量。破棄時に登録を外し、返し忘れた分もまとめて返す
+//  Reclaimer を持つ部品は、Reclaimer が触るメンバより後（最後）に宣言すること
+class MemoryAccount {
+public:
+    explicit MemoryAccount(MemoryClass cls, MemoryGovernor::Reclaimer reclaim = {});
+    ~MemoryAccount();
+
+    MemoryAccount(const MemoryAccount&)            = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    bool Reserve(size_t bytes, bool force = false);
+    void Release(size_t bytes);
+
+    MemoryClass Class() const { return cls_; }
+    size_t      Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+    const MemoryClass   cls_;
+    std::uint64_t       id_ = 0;
+    std::atomic<size_t> bytes_{0};
+};
+
+} // namespace krkrvoice
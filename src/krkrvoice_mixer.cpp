@@ -0,0 +1,731 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_mixer.cpp   ―  ソフトウェアミキサー（SSE2 / AVX2 カーネル）
+// -----------------------------------------------------------------------------
+#include "krkrvoice_mixer.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// カーネル
+//  toFloat   : int16 → float（±1.0）
+//  mixMono   : モノ入力を左右の音量（ブロック内で線形補間）でステレオ加算
+//  mixStereo : ステレオ入力を同様に加算
+//  toS16     : 主音量をかけて飽和付きで int16 に。クリップしたサンプル数を返す
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr float kToFloat = 1.0f / 32768.0f;
+
+struct Kernels {
+    void   (*toFloat)(const int16_t* src, float* dst, size_t n);
+    void   (*mixMono)(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr);
+    void   (*mixStereo)(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr);
+    size_t (*toS16)(const float* src, int16_t* dst, size_t n, float gain);
+};
+
+static void ToFloatScalar(const int16_t* src, float* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = src[i] * kToFloat;
+}
+
+static void MixMonoScalar(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    for (size_t f = 0; f < frames; ++f) {
+        float ff = static_cast<float>(f);
+        dst[2 * f]     += src[f] * (gl + dl * ff);
+        dst[2 * f + 1] += src[f] * (gr + dr * ff);
+    }
+}
+
+static void MixStereoScalar(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    for (size_t f = 0; f < frames; ++f) {
+        float ff = static_cast<float>(f);
+        dst[2 * f]     += src[2 * f]     * (gl + dl * ff);
+        dst[2 * f + 1] += src[2 * f + 1] * (gr + dr * ff);
+    }
+}
+
+static size_t ToS16Scalar(const float* src, int16_t* dst, size_t n, float gain)
+{
+    size_t clipped = 0;
+    const float scale = gain * 32768.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float v = src[i] * scale;
+        if (v > 32767.0f)       { v = 32767.0f;  ++clipped; }
+        else if (v < -32768.0f) { v = -32768.0f; ++clipped; }
+        dst[i] = static_cast<int16_t>(std::lrintf(v));
+    }
+    return clipped;
+}
+
+#ifdef KRKRVOICE_X86
+static int PopCount(unsigned m)
+{
+    int c = 0;
+    for (; m; m &= m - 1) ++c;
+    return c;
+}
+
+// ---- SSE2 -------------------------------------------------------------------
+KRKRVOICE_TARGET_SSE2
+static void ToFloatSSE2(const int16_t* src, float* dst, size_t n)
+{
+    const __m128 k = _mm_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);   // 符号拡張
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    ToFloatScalar(src + i, dst + i, n - i);
+}
+
+KRKRVOICE_TARGET_SSE2
+static void MixMonoSSE2(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    __m128 g01  = _mm_setr_ps(gl, gr, gl + dl, gr + dr);          // フレーム f, f+1 の音量
+    __m128 g23  = _mm_setr_ps(gl + 2 * dl, gr + 2 * dr, gl + 3 * dl, gr + 3 * dr);
+    __m128 step = _mm_setr_ps(4 * dl, 4 * dr, 4 * dl, 4 * dr);
+    size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        __m128 s  = _mm_loadu_ps(src + f);
+        __m128 lo = _mm_unpacklo_ps(s, s);                          // s0 s0 s1 s1
+        __m128 hi = _mm_unpackhi_ps(s, s);                          // s2 s2 s3 s3
+        float* d  = dst + 2 * f;
+        _mm_storeu_ps(d,     _mm_add_ps(_mm_loadu_ps(d),     _mm_mul_ps(lo, g01)));
+        _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(hi, g23)));
+        g01 = _mm_add_ps(g01, step);
+        g23 = _mm_add_ps(g23, step);
+    }
+    float ff = static_cast<float>(f);
+    MixMonoScalar(dst + 2 * f, src + f, frames - f, gl + dl * ff, gr + dr * ff, dl, dr);
+}
+
+KRKRVOICE_TARGET_SSE2
+static void MixStereoSSE2(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    __m128 g01  = _mm_setr_ps(gl, gr, gl + dl, gr + dr);
+    __m128 g23  = _mm_setr_ps(gl + 2 * dl, gr + 2 * dr, gl + 3 * dl, gr + 3 * dr);
+    __m128 step = _mm_setr_ps(4 * dl, 4 * dr, 4 * dl, 4 * dr);
+    size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        const float* s = src + 2 * f;
+        float*       d = dst + 2 * f;
+        _mm_storeu_ps(d,     _mm_add_ps(_mm_loadu_ps(d),     _mm_mul_ps(_mm_loadu_ps(s),     g01)));
+        _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(_mm_loadu_ps(s + 4), g23)));
+        g01 = _mm_add_ps(g01, step);
+        g23 = _mm_add_ps(g23, step);
+    }
+    float ff = static_cast<float>(f);
+    MixStereoScalar(dst + 2 * f, src + 2 * f, frames - f, gl + dl * ff, gr + dr * ff, dl, dr);
+}
+
+KRKRVOICE_TARGET_SSE2
+static size_t ToS16SSE2(const float* src, int16_t* dst, size_t n, float gain)
+{
+    const __m128 scale = _mm_set1_ps(gain * 32768.0f);
+    const __m128 hiLim = _mm_set1_ps(32767.0f);
+    const __m128 loLim = _mm_set1_ps(-32768.0f);
+    size_t clipped = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i),     scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        unsigned m = static_cast<unsigned>(
+            _mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(a, hiLim), _mm_cmplt_ps(a, loLim))) |
+            (_mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(b, hiLim), _mm_cmplt_ps(b, loLim))) << 4));
+        clipped += PopCount(m);
+        a = _mm_max_ps(_mm_min_ps(a, hiLim), loLim);
+        b = _mm_max_ps(_mm_min_ps(b, hiLim), loLim);
+        __m128i p = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), p);
+    }
+    return clipped + ToS16Scalar(src + i, dst + i, n - i, gain);
+}
+
+// ---- AVX2 -------------------------------------------------------------------
+KRKRVOICE_TARGET_AVX2
+static void ToFloatAVX2(const int16_t* src, float* dst, size_t n)
+{
+    const __m256 k = _mm256_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), k));
+    }
+    ToFloatScalar(src + i, dst + i, n - i);
+}
+
+KRKRVOICE_TARGET_AVX2
+static void MixMonoAVX2(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    __m256 g0   = _mm256_setr_ps(gl, gr, gl + dl, gr + dr, gl + 2 * dl, gr + 2 * dr, gl + 3 * dl, gr + 3 * dr);
+    __m256 g1   = _mm256_add_ps(g0, _mm256_setr_ps(4 * dl, 4 * dr, 4 * dl, 4 * dr, 4 * dl, 4 * dr, 4 * dl, 4 * dr));
+    __m256 step = _mm256_setr_ps(8 * dl, 8 * dr, 8 * dl, 8 * dr, 8 * dl, 8 * dr, 8 * dl, 8 * dr);
+    size_t f = 0;
+    for (; f + 8 <= frames; f += 8) {
+        __m256 s  = _mm256_loadu_ps(src + f);
+        __m256 lo = _mm256_unpacklo_ps(s, s);                       // s0 s0 s1 s1 | s4 s4 s5 s5
+        __m256 hi = _mm256_unpackhi_ps(s, s);                       // s2 s2 s3 s3 | s6 s6 s7 s7
+        __m256 a  = _mm256_permute2f128_ps(lo, hi, 0x20);           // s0 .. s3
+        __m256 b  = _mm256_permute2f128_ps(lo, hi, 0x31);           // s4 .. s7
+        float* d  = dst + 2 * f;
+        _mm256_storeu_ps(d,     _mm256_add_ps(_mm256_loadu_ps(d),     _mm256_mul_ps(a, g0)));
+        _mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8), _mm256_mul_ps(b, g1)));
+        g0 = _mm256_add_ps(g0, step);
+        g1 = _mm256_add_ps(g1, step);
+    }
+    float ff = static_cast<float>(f);
+    MixMonoScalar(dst + 2 * f, src + f, frames - f, gl + dl * ff, gr + dr * ff, dl, dr);
+}
+
+KRKRVOICE_TARGET_AVX2
+static void MixStereoAVX2(float* dst, const float* src, size_t frames, float gl, float gr, float dl, float dr)
+{
+    __m256 g0   = _mm256_setr_ps(gl, gr, gl + dl, gr + dr, gl + 2 * dl, gr + 2 * dr, gl + 3 * dl, gr + 3 * dr);
+    __m256 g1   = _mm256_add_ps(g0, _mm256_setr_ps(4 * dl, 4 * dr, 4 * dl, 4 * dr, 4 * dl, 4 * dr, 4 * dl, 4 * dr));
+    __m256 step = _mm256_setr_ps(8 * dl, 8 * dr, 8 * dl, 8 * dr, 8 * dl, 8 * dr, 8 * dl, 8 * dr);
+    size_t f = 0;
+    for (; f + 8 <= frames; f += 8) {
+        const float* s = src + 2 * f;
+        float*       d = dst + 2 * f;
+        _mm256_storeu_ps(d,     _mm256_add_ps(_mm256_loadu_ps(d),     _mm256_mul_ps(_mm256_loadu_ps(s),     g0)));
+        _mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8), _mm256_mul_ps(_mm256_loadu_ps(s + 8), g1)));
+        g0 = _mm256_add_ps(g0, step);
+        g1 = _mm256_add_ps(g1, step);
+    }
+    float ff = static_cast<float>(f);
+    MixStereoScalar(dst + 2 * f, src + 2 * f, frames - f, gl + dl * ff, gr + dr * ff, dl, dr);
+}
+
+KRKRVOICE_TARGET_AVX2
+static size_t ToS16AVX2(const float* src, int16_t* dst, size_t n, float gain)
+{
+    const __m256 scale = _mm256_set1_ps(gain * 32768.0f);
+    const __m256 hiLim = _mm256_set1_ps(32767.0f);
+    const __m256 loLim = _mm256_set1_ps(-32768.0f);
+    size_t clipped = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i),     scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+        unsigned m = static_cast<unsigned>(
+            _mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(a, hiLim, _CMP_GT_OQ), _mm256_cmp_ps(a, loLim, _CMP_LT_OQ))) |
+            (_mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(b, hiLim, _CMP_GT_OQ), _mm256_cmp_ps(b, loLim, _CMP_LT_OQ))) << 8));
+        clipped += PopCount(m);
+        a = _mm256_max_ps(_mm256_min_ps(a, hiLim), loLim);
+        b = _mm256_max_ps(_mm256_min_ps(b, hiLim), loLim);
+        __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));   // レーン単位で詰まる
+        p = _mm256_permute4x64_epi64(p, 0xD8);                                          // 順序を戻す
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+    }
+    return clipped + ToS16Scalar(src + i, dst + i, n - i, gain);
+}
+
+#endif // KRKRVOICE_X86
+
+static const Kernels& KernelsFor(MixKernel k)
+{
+    static const Kernels scalar = { ToFloatScalar, MixMonoScalar, MixStereoScalar, ToS16Scalar };
+#ifdef KRKRVOICE_X86
+    static const Kernels sse2   = { ToFloatSSE2, MixMonoSSE2, MixStereoSSE2, ToS16SSE2 };
+    static const Kernels avx2   = { ToFloatAVX2, MixMonoAVX2, MixStereoAVX2, ToS16AVX2 };
+    switch (k) {
+    case MixKernel::AVX2: return avx2;
+    case MixKernel::SSE2: return sse2;
+    default:              break;
+    }
+#else
+    (void)k;
+#endif
+    return scalar;
+}
+
+// バランス方式の定位（中央で左右とも等倍）
+static void PanGains(const MixVoiceParams& p, float scale, float& l, float& r)
+{
+    float pan = std::clamp(p.pan, -1.0f, 1.0f);
+    float g   = std::max(p.gain, 0.0f) * scale;
+    l = g * std::min(1.0f, 1.0f - pan);
+    r = g * std::min(1.0f, 1.0f + pan);
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 出力先
+// -----------------------------------------------------------------------------
+WavFileAudioSink::WavFileAudioSink(const std::filesystem::path& path, int sampleRate)
+    : file_(path, std::ios::binary | std::ios::trunc), sampleRate_(sampleRate)
+{
+    AudioClip empty;
+    empty.sampleRate = sampleRate;
+    empty.channels   = 2;
+    auto header = EncodeWav(empty);   // 長さ 0 のヘッダを書いておき Close で直す
+    file_.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+}
+
+void
+WavFileAudioSink::Write(const int16_t* frames, size_t count)
+{
+    if (!file_ || closed_) return;
+    file_.write(reinterpret_cast<const char*>(frames), static_cast<std::streamsize>(count * 2 * sizeof(int16_t)));
+    dataBytes_ += count * 2 * sizeof(int16_t);
+}
+
+void
+WavFileAudioSink::Close()
+{
+    if (closed_ || !file_) return;
+    closed_ = true;
+    auto put32 = [&](std::streamoff at, uint32_t v) {
+        uint8_t b[4] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24) };
+        file_.seekp(at);
+        file_.write(reinterpret_cast<const char*>(b), 4);
+    };
+    put32(4,  static_cast<uint32_t>(36 + dataBytes_));
+    put32(40, static_cast<uint32_t>(dataBytes_));
+    file_.close();
+}
+
+void
+DeviceAudioSink::Write(const int16_t* frames, size_t count)
+{
+    if (!stream_ || stream_->Cancelled()) {   // 初回か、プレイヤー側で止められた
+        stream_ = std::make_shared<PcmStream>(sampleRate_, 2);
+        PlayPcmStream(stream_, false, true);
+    }
+    stream_->Append(frames, count * 2);
+}
+
+void
+DeviceAudioSink::Close()
+{
+    if (stream_) stream_->Close();
+    stream_.reset();
+}
+
+// -----------------------------------------------------------------------------
+// AudioMixer 実装
+// -----------------------------------------------------------------------------
+AudioMixer::AudioMixer(int sampleRate, size_t maxVoices, size_t blockFrames)
+    : sampleRate_(sampleRate > 0 ? sampleRate : 24000),
+      blockFrames_(std::max<size_t>(blockFrames, 16)),
+      slots_(std::max<size_t>(maxVoices, 1)),
+      kernel_(BestKernel()),
+      mix_(blockFrames_ * 2),
+      src_(blockFrames_ * 2),
+      tmp_(blockFrames_ * 2)
+{
+    stats_.kernel = kernel_;
+}
+
+AudioMixer::~AudioMixer()
+{
+    StopOutput();
+    std::vector<std::function<void()>> done;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& s : slots_)
+            if (s.active) Release(s, done);
+    }
+    for (auto& f : done) f();
+}
+
+MixKernel
+AudioMixer::BestKernel()
+{
+    return DetectSimd();
+}
+
+MixKernel
+AudioMixer::SetKernel(MixKernel k)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    kernel_ = std::min(k, BestKernel());
+    stats_.kernel = kernel_;
+    return kernel_;
+}
+
+void
+AudioMixer::SetMasterGain(float gain)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    masterGain_ = std::max(gain, 0.0f);
+}
+
+void
+AudioMixer::SetDuckLevel(float level)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    duckLevel_ = std::clamp(level, 0.0f, 1.0f);
+}
+
+MixVoiceId
+AudioMixer::Attach(Slot&& s, std::vector<std::function<void()>>& done)
+{
+    if (s.single)
+        for (auto& o : slots_)
+            if (o.active && o.single) o.stopping = true;
+
+    auto it = std::find_if(slots_.begin(), slots_.end(), [](const Slot& o) { return !o.active; });
+    if (it == slots_.end()) {                    // 枠が無ければ最も古い音声を止める
+        it = std::min_element(slots_.begin(), slots_.end(),
+                              [](const Slot& a, const Slot& b) { return a.id < b.id; });
+        Release(*it, done);
+        ++stats_.stolen;
+    }
+    s.active = true;
+    s.id     = ++nextId_;
+    *it = std::move(s);
+    ++stats_.started;
+    ++stats_.active;
+    stats_.peakActive = std::max(stats_.peakActive, stats_.active);
+    return it->id;
+}
+
+void
+AudioMixer::Release(Slot& s, std::vector<std::function<void()>>& done)
+{
+    if (s.stream) s.stream->Cancel();            // 生産側も止める
+    if (s.clip)   memory_.Release(s.clip->Bytes());
+    if (s.onFinish) done.push_back(std::move(s.onFinish));
+    s = Slot{};
+    ++stats_.finished;
+    --stats_.active;
+}
+
+MixVoiceId
+AudioMixer::Play(std::shared_ptr<const AudioClip> clip, const MixVoiceParams& params,
+                 bool single, std::function<void()> onFinish)
+{
+    if (!clip || clip->samples.empty()) {
+        if (onFinish) onFinish();
+        return 0;
+    }
+    if (clip->sampleRate != sampleRate_ || clip->channels < 1 || clip->channels > 2)
+        clip = std::make_shared<AudioClip>(ConvertFormat(*clip, sampleRate_, clip->channels == 1 ? 1 : 2));
+
+    memory_.Reserve(clip->Bytes(), true);
+
+    Slot s;
+    s.channels = clip->channels;
+    s.clip     = std::move(clip);
+    s.params   = params;
+    s.single   = single;
+    s.onFinish = std::move(onFinish);
+
+    std::vector<std::function<void()>> done;
+    MixVoiceId id;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        id = Attach(std::move(s), done);
+    }
+    voiceCv_.notify_all();
+    for (auto& f : done) f();
+    return id;
+}
+
+MixVoiceId
+AudioMixer::Play(std::shared_ptr<PcmStream> stream, const MixVoiceParams& params,
+                 bool single, std::function<void()> onFinish)
+{
+    if (!stream) {
+        if (onFinish) onFinish();
+        return 0;
+    }
+    Slot s;
+    s.channels = stream->Channels() == 1 ? 1 : 2;
+    s.stream   = std::move(stream);
+    s.params   = params;
+    s.single   = single;
+    s.onFinish = std::move(onFinish);
+
+    std::vector<std::function<void()>> done;
+    MixVoiceId id;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        id = Attach(std::move(s), done);
+    }
+    voiceCv_.notify_all();
+    for (auto& f : done) f();
+    return id;
+}
+
+bool
+AudioMixer::SetVoiceParams(MixVoiceId id, float gain, float pan)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto& s : slots_)
+        if (s.active && s.id == id) {
+            s.params.gain = gain;
+            s.params.pan  = pan;
+            return true;
+        }
+    return false;
+}
+
+bool
+AudioMixer::StopVoice(MixVoiceId id)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto& s : slots_)
+        if (s.active && s.id == id) {
+            s.stopping = true;
+            return true;
+        }
+    return false;
+}
+
+void
+AudioMixer::StopAll()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto& s : slots_)
+        if (s.active) s.stopping = true;
+}
+
+// src_ に frames ぶん（不足はゼロ）読み、実際に読めたフレーム数を返す
+size_t
+AudioMixer::Fetch(Slot& s, size_t frames)
+{
+    const Kernels& k = KernelsFor(kernel_);
+    const size_t ch  = static_cast<size_t>(s.channels);
+    size_t got = 0;
+
+    if (s.clip) {
+        got = std::min(frames, (s.clip->samples.size() - s.pos) / ch);
+        k.toFloat(s.clip->samples.data() + s.pos, src_.data(), got * ch);
+        s.pos += got * ch;
+    } else if (s.stream) {
+        const int srcRate = s.stream->SampleRate();
+        const int srcCh   = s.stream->Channels();
+        if (srcRate == sampleRate_ && srcCh == s.channels) {
+            got = s.stream->Read(tmp_.data(), frames * ch, std::chrono::milliseconds(0)) / ch;
+            k.toFloat(tmp_.data(), src_.data(), got * ch);
+        } else {                                 // 形式が違えばこのブロックぶんだけ変換する
+            size_t want = (frames * static_cast<size_t>(srcRate) + sampleRate_ - 1) / sampleRate_;
+            AudioClip part;
+            part.sampleRate = srcRate;
+            part.channels   = srcCh;
+            part.samples.resize(want * static_cast<size_t>(srcCh));
+            part.samples.resize(s.stream->Read(part.samples.data(), part.samples.size(), std::chrono::milliseconds(0)));
+            AudioClip conv = ConvertFormat(part, sampleRate_, s.channels);
+            got = std::min(frames, conv.Frames());
+            k.toFloat(conv.samples.data(), src_.data(), got * ch);
+        }
+        if (got < frames && !s.stream->Finished()) ++stats_.underruns;
+    }
+    std::fill(src_.begin() + got * ch, src_.begin() + frames * ch, 0.0f);
+    return got;
+}
+
+void
+AudioMixer::Render(int16_t* out, size_t frames)
+{
+    for (size_t off = 0; off < frames; off += blockFrames_) {
+        const size_t n  = std::min(blockFrames_, frames - off);
+        auto         t0 = std::chrono::steady_clock::now();
+        std::vector<std::function<void()>> done;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            const Kernels& k = KernelsFor(kernel_);
+            std::fill(mix_.begin(), mix_.begin() + n * 2, 0.0f);
+
+            MixVoiceId duckFrom = 0;             // これより前に始まった音声を下げる
+            for (const auto& s : slots_)
+                if (s.active && !s.stopping && s.params.duckOthers) duckFrom = std::max(duckFrom, s.id);
+
+            for (auto& s : slots_) {
+                if (!s.active) continue;
+                size_t got   = Fetch(s, n);
+                bool   ended = s.clip ? s.pos >= s.clip->samples.size()
+                                      : (got == 0 && s.stream->Finished());
+
+                float tl = 0, tr = 0;
+                if (!s.stopping) PanGains(s.params, s.id < duckFrom ? duckLevel_ : 1.0f, tl, tr);
+                if (s.fresh && !s.stopping) { s.curL = tl; s.curR = tr; }
+                s.fresh = false;
+                float dl = (tl - s.curL) / static_cast<float>(n);
+                float dr = (tr - s.curR) / static_cast<float>(n);
+                if (s.channels == 1) k.mixMono(mix_.data(), src_.data(), n, s.curL, s.curR, dl, dr);
+                else                 k.mixStereo(mix_.data(), src_.data(), n, s.curL, s.curR, dl, dr);
+                s.curL = tl;
+                s.curR = tr;
+
+                if (ended || s.stopping) Release(s, done);
+            }
+            stats_.clippedSamples += k.toS16(mix_.data(), out + off * 2, n * 2, masterGain_);
+
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            ++stats_.blocks;
+            renderUsSum_ += us;
+            stats_.renderUsMax = std::max(stats_.renderUsMax, us);
+        }
+        for (auto& f : done) f();
+    }
+}
+
+void
+AudioMixer::StartOutput(std::shared_ptr<AudioSink> sink, bool realtime, int leadMs)
+{
+    StopOutput();
+    if (!sink) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopOutput_ = false;
+    }
+    output_ = std::thread([this, sink = std::move(sink), realtime, leadMs] { OutputLoop(sink, realtime, leadMs); });
+}
+
+void
+AudioMixer::StopOutput()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopOutput_ = true;
+    }
+    voiceCv_.notify_all();
+    if (!output_.joinable()) return;
+    output_.join();
+
+    // 出力が無ければ鳴り終わらないので、残りの音声は終了扱いにする（同期再生の待ちを解く）
+    std::vector<std::function<void()>> done;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (auto& s : slots_)
+            if (s.active) Release(s, done);
+    }
+    for (auto& f : done) f();
+}
+
+// 音声がある間だけ、実時間より lead ぶん先行して書き続ける
+void
+AudioMixer::OutputLoop(std::shared_ptr<AudioSink> sink, bool realtime, int leadMs)
+{
+    using Clock = std::chrono::steady_clock;
+    std::vector<int16_t> buf(blockFrames_ * 2);
+    const uint64_t lead = static_cast<uint64_t>(sampleRate_) * static_cast<uint64_t>(std::max(leadMs, 0)) / 1000;
+
+    bool stop = false;
+    while (!stop) {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            voiceCv_.wait(lk, [&] { return stopOutput_ || stats_.active > 0; });
+            if (stopOutput_) break;
+        }
+        auto     t0      = Clock::now();
+        uint64_t written = 0;
+        while (true) {
+            Render(buf.data(), blockFrames_);
+            sink->Write(buf.data(), blockFrames_);
+            written += blockFrames_;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (stopOutput_) { stop = true; break; }
+                if (stats_.active == 0) break;
+            }
+            if (realtime && written > lead)
+                std::this_thread::sleep_until(t0 + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(double(written - lead) / sampleRate_)));
+        }
+    }
+    sink->Close();
+}
+
+MixerStats
+AudioMixer::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    MixerStats st = stats_;
+    st.renderUsMean = st.blocks ? renderUsSum_ / static_cast<double>(st.blocks) : 0;
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// MixedTTSService 実装
+// -----------------------------------------------------------------------------
+MixedTTSService::MixedTTSService(std::shared_ptr<ITTSService> inner, std::shared_ptr<AudioMixer> mixer)
+    : ForwardingTTSService(std::move(inner)), mixer_(std::move(mixer))
+{
+}
+
+void
+MixedTTSService::SetVoiceParams(const MixVoiceParams& p)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    params_ = p;
+}
+
+bool
+MixedTTSService::SpeakText(const VoiceInfo& voice,
+                           const std::wstring& text,
+                           int  speed,
+                           bool sync,
+                           bool overlap,
+                           std::function<void()> onFinish,
+                           const CancelToken& cancel)
+{
+    if (enabled_ && inner_->CanSynthesize(voice)) {
+        auto clip = std::make_shared<AudioClip>();
+        if (!inner_->Synthesize(voice, text, speed, *clip, cancel)) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        return PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+    }
+    // ミキサー無効時と、合成単体に対応しないサービスは内側で再生する
+    return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel);
+}
+
+bool
+MixedTTSService::PlayAudio(std::shared_ptr<const AudioClip> clip, bool sync, bool overlap,
+                           std::function<void()> onFinish)
+{
+    if (!enabled_) return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+
+    MixVoiceParams p;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        p = params_;
+    }
+    if (!sync) return mixer_->Play(std::move(clip), p, !overlap, std::move(onFinish)) != 0;
+
+    Completion done;
+    bool ok = mixer_->Play(std::move(clip), p, !overlap, [&done, &onFinish] {
+        if (onFinish) onFinish();
+        done.Signal();
+    }) != 0;
+    done.Wait();
+    return ok;
+}
+
+bool
+MixedTTSService::PlayStream(std::shared_ptr<PcmStream> stream, bool sync, bool overlap,
+                            std::function<void()> onFinish)
+{
+    if (!enabled_) return inner_->PlayStream(std::move(stream), sync, overlap, std::move(onFinish));
+
+    MixVoiceParams p;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        p = params_;
+    }
+    if (!sync) return mixer_->Play(std::move(stream), p, !overlap, std::move(onFinish)) != 0;
+
+    Completion done;
+    bool ok = mixer_->Play(std::move(stream), p, !overlap, [&done, &onFinish] {
+        if (onFinish) onFinish();
+        done.Signal();
+    }) != 0;
+    done.Wait();
+    return ok;
+}
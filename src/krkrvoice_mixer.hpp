@@ -0,0 +1,212 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_simd.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace krkrvoice {
+
+// ミキサーの出力先（16bit ステレオ、インターリーブ）
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+    virtual void Write(const int16_t* frames, size_t count) = 0;   // count はフレーム数
+    virtual void Close() {}
+};
+
+// 捨てるだけの出力（計測・テスト用）
+class NullAudioSink final : public AudioSink {
+public:
+    void Write(const int16_t*, size_t count) override { frames_ += count; }
+    std::uint64_t Frames() const { return frames_; }
+
+private:
+    std::atomic<std::uint64_t> frames_{ 0 };
+};
+
+// WAV ファイルへの出力（Close でヘッダの長さを確定する）
+class WavFileAudioSink final : public AudioSink {
+public:
+    WavFileAudioSink(const std::filesystem::path& path, int sampleRate);
+    ~WavFileAudioSink() override { Close(); }
+
+    bool is_open() const { return static_cast<bool>(file_); }
+    void Write(const int16_t* frames, size_t count) override;
+    void Close() override;
+
+private:
+    std::ofstream file_;
+    int           sampleRate_;
+    std::uint64_t dataBytes_ = 0;
+    bool          closed_    = false;
+};
+
+// 既定の出力デバイス（PlayPcmStream の 1 本のストリームに流し続ける）
+class DeviceAudioSink final : public AudioSink {
+public:
+    explicit DeviceAudioSink(int sampleRate) : sampleRate_(sampleRate) {}
+    ~DeviceAudioSink() override { Close(); }
+
+    void Write(const int16_t* frames, size_t count) override;
+    void Close() override;
+
+private:
+    int                        sampleRate_;
+    std::shared_ptr<PcmStream> stream_;
+};
+
+// ミキシング演算の実装（命令セット別）
+using MixKernel = SimdLevel;
+
+// 1 音声ぶんの音量・定位
+struct MixVoiceParams {
+    float gain       = 1.0f;    // 0 以上（1 で等倍）
+    float pan        = 0.0f;    // -1（左）〜 +1（右）
+    bool  duckOthers = false;   // 鳴っている間、それより前に始まった音声を下げる
+};
+
+struct MixerStats {
+    std::uint64_t started        = 0;
+    std::uint64_t finished       = 0;
+    std::uint64_t stolen         = 0;   // 枠が足りず止めた音声
+    std::uint64_t active         = 0;
+    std::uint64_t peakActive     = 0;
+    std::uint64_t blocks         = 0;
+    std::uint64_t underruns      = 0;   // ストリームの供給が間に合わなかったブロック数
+    std::uint64_t clippedSamples = 0;
+    double        renderUsMean   = 0;   // 1 ブロックの合成時間
+    double        renderUsMax    = 0;
+    MixKernel     kernel         = MixKernel::Scalar;
+};
+
+using MixVoiceId = std::uint64_t;
+
+// プロセス内ソフトウェアミキサー
+//  - 固定数の音声枠に AudioClip / PcmStream を割り当て、float で加算して 16bit ステレオを出す
+//  - 音量・定位の変化はブロック内で線形補間する（ジッパーノイズ防止）
+//  - 枠が埋まっていれば最も古い音声を止めて譲る
+//  - 出力スレッドは実時間に合わせて先行量 leadMs ぶんだけ先に書く
+class AudioMixer {
+public:
+    explicit AudioMixer(int sampleRate = 24000, size_t maxVoices = 64, size_t blockFrames = 256);
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&)            = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // single=true の音声は前の single 音声を止める（overlap=false 相当）
+    MixVoiceId Play(std::shared_ptr<const AudioClip> clip, const MixVoiceParams& params,
+                    bool single, std::function<void()> onFinish = {});
+    MixVoiceId Play(std::shared_ptr<PcmStream> stream, const MixVoiceParams& params,
+                    bool single, std::function<void()> onFinish = {});
+
+    bool SetVoiceParams(MixVoiceId id, float gain, float pan);
+    bool StopVoice(MixVoiceId id);   // 1 ブロックでフェードアウトして止める
+    void StopAll();
+
+    void SetMasterGain(float gain);
+    void SetDuckLevel(float level);   // duckOthers で下げる先の倍率（既定 0.35）
+
+    static MixKernel BestKernel();
+    MixKernel SetKernel(MixKernel k);   // 非対応なら使える最良のものになる
+
+    // frames フレームを out（ステレオ）に合成する。出力スレッドを使わない場合に直接呼ぶ
+    void Render(int16_t* out, size_t frames);
+
+    void StartOutput(std::shared_ptr<AudioSink> sink, bool realtime = true, int leadMs = 60);
+    void StopOutput();   // 残っている音声は終了扱いになる
+
+    MixerStats Stats() const;
+    int        SampleRate()  const { return sampleRate_; }
+    size_t     BlockFrames() const { return blockFrames_; }
+
+private:
+    struct Slot {
+        bool       active   = false;
+        bool       stopping = false;
+        bool       single   = false;
+        bool       fresh    = true;     // 初回ブロックは補間せず目標音量から始める
+        MixVoiceId id       = 0;
+        int        channels = 1;
+        std::shared_ptr<const AudioClip> clip;
+        size_t                           pos = 0;      // clip 内のサンプル位置
+        std::shared_ptr<PcmStream>       stream;
+        MixVoiceParams        params;
+        float                 curL = 0, curR = 0;
+        std::function<void()> onFinish;
+    };
+
+    MixVoiceId Attach(Slot&& s, std::vector<std::function<void()>>& done);   // mtx_ 保持中
+    void Release(Slot& s, std::vector<std::function<void()>>& done);        // 同上
+    size_t Fetch(Slot& s, size_t frames);                                   // 同上。src_ に float で読む
+    void OutputLoop(std::shared_ptr<AudioSink> sink, bool realtime, int leadMs);
+
+    const int    sampleRate_;
+    const size_t blockFrames_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable voiceCv_;   // 出力スレッドの待機解除
+    std::vector<Slot>  slots_;
+    MixVoiceId         nextId_     = 0;
+    float              masterGain_ = 1.0f;
+    float              duckLevel_  = 0.35f;
+    MixKernel          kernel_;
+    MixerStats         stats_;
+    double             renderUsSum_ = 0;
+
+    std::vector<float>   mix_;   // ステレオの加算バッファ
+    std::vector<float>   src_;   // 1 音声ぶんの入力
+    std::vector<int16_t> tmp_;
+
+    std::thread output_;
+    bool        stopOutput_ = false;
+
+    MemoryAccount memory_{MemoryClass::Playback};   // 鳴らしている AudioClip の分
+};
+
+// 再生をミキサー経由にする層（Enabled=false なら内側の再生にそのまま渡す）
+class MixedTTSService final : public ForwardingTTSService {
+public:
+    MixedTTSService(std::shared_ptr<ITTSService> inner, std::shared_ptr<AudioMixer> mixer);
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool PlayAudio(std::shared_ptr<const AudioClip> clip, bool sync, bool overlap,
+                   std::function<void()> onFinish = {}) override;
+
+    bool PlayStream(std::shared_ptr<PcmStream> stream, bool sync, bool overlap,
+                    std::function<void()> onFinish = {}) override;
+
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    bool Enabled() const          { return enabled_; }
+
+    // 以降に鳴らす音声の既定値
+    void SetVoiceParams(const MixVoiceParams& p);
+
+    const std::shared_ptr<AudioMixer>& Mixer() const { return mixer_; }
+
+private:
+    std::shared_ptr<AudioMixer> mixer_;
+    std::atomic_bool            enabled_{ false };
+
+    std::mutex     mtx_;
+    MixVoiceParams params_;
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,86 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_mmap.cpp   ―  読み取り専用メモリマップ
+// -----------------------------------------------------------------------------
+#include "krkrvoice_mmap.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+using namespace krkrvoice;
+
+MappedFile&
+MappedFile::operator=(MappedFile&& o) noexcept
+{
+    if (this != &o) {
+        Close();
+        data_ = std::exchange(o.data_, nullptr);
+        size_ = std::exchange(o.size_, 0);
+#ifdef _WIN32
+        file_    = std::exchange(o.file_, nullptr);
+        mapping_ = std::exchange(o.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool
+MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+    HANDLE f = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz{};
+    if (!::GetFileSizeEx(f, &sz) || sz.QuadPart == 0) { ::CloseHandle(f); return false; }
+    HANDLE m = ::CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) { ::CloseHandle(f); return false; }
+    void* p = ::MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p) { ::CloseHandle(m); ::CloseHandle(f); return false; }
+    file_    = f;
+    mapping_ = m;
+    data_    = static_cast<const uint8_t*>(p);
+    size_    = static_cast<size_t>(sz.QuadPart);
+    return true;
+}
+
+void
+MappedFile::Close()
+{
+    if (data_)    ::UnmapViewOfFile(data_);
+    if (mapping_) ::CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_)    ::CloseHandle(static_cast<HANDLE>(file_));
+    data_ = nullptr; size_ = 0; mapping_ = nullptr; file_ = nullptr;
+}
+#else
+bool
+MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+    void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                                   // マップ後は fd 不要
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<const uint8_t*>(p);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void
+MappedFile::Close()
+{
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr; size_ = 0;
+}
+#endif
@@ -0,0 +1,158 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_mock.cpp   ―  決定的な擬似 TTS
+// -----------------------------------------------------------------------------
+#include "krkrvoice_mock.hpp"
+#include "krkrvoice_markup.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr double kPi        = 3.14159265358979323846;
+constexpr auto   kCostSlice = std::chrono::milliseconds(2);   // 取り消し確認の間隔
+
+static uint64_t HashText(const std::wstring& s, uint64_t seed)
+{
+    uint64_t h = 0xcbf29ce484222325ull ^ seed;
+    for (wchar_t c : s) { h ^= static_cast<uint64_t>(c); h *= 0x100000001b3ull; }
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdull; h ^= h >> 33;
+    return h;
+}
+
+// 合成コストを模擬。取り消されたら false
+static bool Spend(double ms, const CancelToken& cancel)
+{
+    auto until = std::chrono::steady_clock::now() +
+                 std::chrono::microseconds(static_cast<int64_t>(ms * 1000.0));
+    while (true) {
+        if (cancel.Cancelled()) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= until) return true;
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, kCostSlice));
+    }
+}
+
+// プールされる擬似合成器（中身はなく、初期化コストだけを模擬する）
+struct MockSynth final : SynthInstance {};
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// MockTTSService 実装
+// -----------------------------------------------------------------------------
+MockTTSService::MockTTSService(MockTTSOptions opt)
+    : opt_(opt)
+    , catalog_([n = opt.voices, enumMs = opt.enumMs] {
+          Spend(enumMs, CancelToken());
+          std::vector<VoiceInfo> v;
+          for (size_t i = 0; i < n; ++i)
+              v.push_back(VoiceInfo{ TTSService::Mock, L"Mock", L"Mock " + std::to_wstring(i + 1),
+                                     L"ja-JP", (i % 2) ? L"Male" : L"Female" });
+          return v;
+      },
+      [n = opt.voices] { return "mock:" + std::to_string(n); })   // 音声数が変われば指紋も変わる
+    , pool_([initMs = opt.initMs](const VoiceInfo&, bool) -> std::unique_ptr<SynthInstance> {
+          Spend(initMs, CancelToken());
+          return std::make_unique<MockSynth>();
+      })
+{
+}
+
+std::vector<VoiceInfo>
+MockTTSService::GetVoiceList(const std::wstring& lang, const std::wstring& gender)
+{
+    return catalog_.List(lang, gender);
+}
+
+bool
+MockTTSService::ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                             size_t idx, VoiceInfo& out)
+{
+    return catalog_.Resolve(lang, gender, idx, out);
+}
+
+bool
+MockTTSService::FindVoice(VoiceHandle handle, VoiceInfo& out)
+{
+    return catalog_.Find(handle, out);
+}
+
+void
+MockTTSService::RefreshVoices()
+{
+    catalog_.Refresh();
+}
+
+bool
+MockTTSService::GetCatalogStats(VoiceCatalogStats& out) const
+{
+    out = catalog_.Stats();
+    return true;
+}
+
+bool
+MockTTSService::Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                           int speed, AudioClip& out, const CancelToken& cancel)
+{
+    if (voice.engine != L"Mock") return false;
+    auto lease = pool_.Acquire(voice);
+    if (!lease) return false;
+
+    uint64_t h = HashText(voice.displayName + L'\x1f' + text, opt_.seed);
+    double jitter = opt_.jitterMs * ((static_cast<double>(h >> 11) / 9007199254740992.0) * 2.0 - 1.0);
+    double cost   = std::max(0.0, opt_.baseMs + opt_.perCharMs * static_cast<double>(text.size()) + jitter);
+    if (!Spend(cost, cancel)) return false;
+    if (opt_.failRate > 0 && static_cast<double>(h & 0xffff) / 65536.0 < opt_.failRate) return false;
+
+    // 1 文字ごとに文字コードから決まる音程の短い音を並べる。休止記号はその長さの無音
+    const double rate    = NormalizeSpeed(speed);
+    const size_t perChar = static_cast<size_t>(opt_.sampleRate * opt_.msPerChar / 1000 / rate);
+    const double base    = 180.0 + static_cast<double>(voice.handle % 8) * 20.0;
+    auto frames = [&](wchar_t c) {
+        return IsPauseMark(c) ? static_cast<size_t>(opt_.sampleRate / 1000.0 * PauseMarkMs(c) / rate) : perChar;
+    };
+    size_t total = 0;
+    for (wchar_t c : text) total += frames(c);
+    out.sampleRate = opt_.sampleRate;
+    out.channels   = 1;
+    out.samples.assign(total, 0);
+    size_t pos = 0;
+    for (wchar_t c : text) {
+        const size_t len = frames(c);
+        if (!IsPauseMark(c)) {
+            double freq = base + static_cast<double>(c % 24) * 15.0;
+            for (size_t i = 0; i < len; ++i) {
+                double env = std::min({ 1.0, i / 120.0, (len - i) / 120.0 });   // 継ぎ目のクリック防止
+                out.samples[pos + i] = static_cast<int16_t>(
+                    8000.0 * env * std::sin(2.0 * kPi * freq * static_cast<double>(i) / opt_.sampleRate));
+            }
+        }
+        pos += len;
+    }
+    return true;
+}
+
+bool
+MockTTSService::SpeakText(const VoiceInfo& voice,
+                          const std::wstring& text,
+                          int  speed,
+                          bool sync,
+                          bool overlap,
+                          std::function<void()> onFinish,
+                          const CancelToken& cancel)
+{
+    auto clip = std::make_shared<AudioClip>();
+    if (!Synthesize(voice, text, speed, *clip, cancel)) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    return PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+}
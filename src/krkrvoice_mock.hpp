@@ -0,0 +1,63 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_synthpool.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace krkrvoice {
+
+// 擬似エンジンの設定
+struct MockTTSOptions {
+    int      sampleRate = 24000;
+    size_t   voices     = 4;       // 用意する音声数
+    double   baseMs     = 5.0;     // 1 回の合成にかかる固定コスト
+    double   perCharMs  = 0.5;     // 1 文字あたりのコスト
+    double   jitterMs   = 0.0;     // コストの揺らぎ（± この幅、テキストから決定的に決まる）
+    double   failRate   = 0.0;     // 合成失敗の割合 0-1（テキストから決定的に決まる）
+    double   enumMs     = 0.0;     // 音声列挙 1 回のコスト
+    double   initMs     = 0.0;     // 合成器 1 個の初期化コスト（音声ごとにプールして再利用する）
+    int      msPerChar  = 90;      // 生成音声の 1 文字あたりの長さ
+    uint32_t seed       = 1;
+};
+
+// 外部エンジンを使わない決定的な TTS（オフライン実行・計測用）
+//  テキストから決まる音程の正弦波を実 PCM として返し、合成コストは待ち時間で模擬する
+class MockTTSService final : public ITTSService {
+public:
+    explicit MockTTSService(MockTTSOptions opt = {});
+
+    std::vector<VoiceInfo>
+    GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") override;
+
+    bool ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                      size_t idx, VoiceInfo& out) override;
+    bool FindVoice(VoiceHandle handle, VoiceInfo& out) override;
+    void RefreshVoices() override;
+    bool GetCatalogStats(VoiceCatalogStats& out) const override;
+    VoiceCatalog* Catalog() override { return &catalog_; }
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool CanSynthesize(const VoiceInfo&) const override { return true; }
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    SynthesizerPool* Synthesizers() override { return &pool_; }
+
+    const MockTTSOptions& Options() const { return opt_; }
+
+private:
+    const MockTTSOptions opt_;
+    VoiceCatalog         catalog_;
+    SynthesizerPool      pool_;
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,401 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_prefetch.cpp   ―  先読み合成
+// -----------------------------------------------------------------------------
+#include "krkrvoice_prefetch.hpp"
+#include "krkrvoice_cache.hpp"
+
+#include <algorithm>
+#include <utility>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr auto kWaitSlice = std::chrono::milliseconds(20);   // 合成中の先読みを待つ間の取り消し確認間隔
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// PrefetchStore 実装
+// -----------------------------------------------------------------------------
+PrefetchStore::PrefetchStore(size_t memoryBudget, std::chrono::milliseconds ttl)
+    : budget_(memoryBudget), ttl_(ttl)
+{
+}
+
+void
+PrefetchStore::SetLimits(size_t memoryBudget, std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    budget_ = memoryBudget;
+    ttl_    = ttl;
+    Expire(Clock::now());
+    Trim();
+}
+
+void
+PrefetchStore::SetTolerance(int tolerance)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    tolerance_ = std::max(tolerance, 0);
+}
+
+void
+PrefetchStore::Drop(List::iterator it)
+{
+    if (it->packed) {
+        bytes_ -= it->packed->Bytes();
+        memory_.Release(it->packed->Bytes());
+        stats_.wastedBytes += it->packed->PcmBytes();
+    }
+    it->cancel.Cancel();
+    if (it->done) it->done->Signal();   // 待っている Take を起こす
+    index_.erase(it->key);
+    order_.erase(it);
+}
+
+void
+PrefetchStore::Expire(Clock::time_point now)
+{
+    while (!order_.empty() && now - order_.front().created > ttl_) {
+        ++stats_.expired;
+        Drop(order_.begin());
+    }
+}
+
+void
+PrefetchStore::Trim()
+{
+    for (auto it = order_.begin(); bytes_ > budget_ && it != order_.end();) {
+        auto cur = it++;
+        if (!cur->packed) continue;          // 合成中のものは追い出さない
+        ++stats_.evicted;
+        Drop(cur);
+    }
+}
+
+size_t
+PrefetchStore::Reclaim(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    const size_t before = bytes_;
+    for (auto it = order_.begin(); before - bytes_ < bytes && it != order_.end();) {
+        auto cur = it++;
+        if (!cur->packed) continue;
+        ++stats_.evicted;
+        Drop(cur);
+    }
+    return before - bytes_;
+}
+
+PrefetchStore::List::iterator
+PrefetchStore::Find(const std::string& key, std::uint64_t id)
+{
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->id != id) return order_.end();
+    return it->second;
+}
+
+std::uint64_t
+PrefetchStore::Reserve(const std::string& key, CancelToken& cancel)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    Expire(Clock::now());
+    if (index_.count(key)) return 0;
+    Entry e;
+    e.key     = key;
+    e.id      = nextId_++;
+    e.cancel  = CancelToken::Make();
+    e.done    = std::make_shared<Completion>();
+    e.created = Clock::now();
+    cancel    = e.cancel;
+    order_.push_back(std::move(e));
+    index_[key] = std::prev(order_.end());
+    ++stats_.requested;
+    return order_.back().id;
+}
+
+bool
+PrefetchStore::Start(const std::string& key, std::uint64_t id)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = Find(key, id);
+    if (it == order_.end() || it->cancel.Cancelled()) return false;
+    it->started = true;
+    return true;
+}
+
+void
+PrefetchStore::Complete(const std::string& key, std::uint64_t id, std::shared_ptr<const AudioClip> clip)
+{
+    int tolerance;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        tolerance = tolerance_;
+    }
+    // 圧縮はロック外で行う
+    std::shared_ptr<const CompressedClip> packed;
+    if (clip) {
+        packed = std::make_shared<const CompressedClip>(*clip, tolerance);
+        if (packed->empty()) packed.reset();
+    }
+
+    // メモリ予算が足りなければ置かずに捨てる（発話時は普通に合成する）
+    bool evicted = false;
+    if (packed && !memory_.Reserve(packed->Bytes())) {
+        packed.reset();
+        evicted = true;
+    }
+
+    std::shared_ptr<Completion> done;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = Find(key, id);
+        if (it == order_.end()) {                     // 取り消し済み
+            if (packed) memory_.Release(packed->Bytes());
+            if (clip)   stats_.wastedBytes += clip->Bytes();
+            return;
+        }
+        done = it->done;
+        if (!packed) {
+            if (evicted) {
+                ++stats_.evicted;
+                stats_.wastedBytes += clip->Bytes();
+            }
+            index_.erase(key);
+            order_.erase(it);
+        } else {
+            ++stats_.completed;
+            bytes_ += packed->Bytes();
+            it->packed = std::move(packed);
+            Trim();
+        }
+    }
+    done->Signal();
+}
+
+void
+PrefetchStore::Abandon(const std::string& key, std::uint64_t id)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = Find(key, id);
+    if (it == order_.end() || it->started) return;
+    ++stats_.cancelled;
+    Drop(it);
+}
+
+std::shared_ptr<const AudioClip>
+PrefetchStore::Take(const std::string& key, const CancelToken& cancel)
+{
+    auto unpack = [](const std::shared_ptr<const CompressedClip>& packed) -> std::shared_ptr<const AudioClip> {
+        auto clip = std::make_shared<AudioClip>();
+        return packed->Decode(*clip) ? clip : nullptr;
+    };
+
+    std::shared_ptr<const CompressedClip> packed;
+    std::shared_ptr<Completion>           done;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        Expire(Clock::now());
+        auto it = index_.find(key);
+        if (it == index_.end()) { ++stats_.misses; return nullptr; }
+        auto& e = *it->second;
+        if (e.packed) {
+            packed  = std::move(e.packed);
+            bytes_ -= packed->Bytes();
+            memory_.Release(packed->Bytes());
+            order_.erase(it->second);
+            index_.erase(it);
+            ++stats_.hits;
+        } else if (!e.started) {                      // まだ待ち行列にある：自分で合成した方が早い
+            ++stats_.cancelled;
+            ++stats_.misses;
+            e.cancel.Cancel();
+            order_.erase(it->second);
+            index_.erase(it);
+            return nullptr;
+        } else {
+            done = e.done;
+        }
+    }
+    if (packed) return unpack(packed);    // 復号はロック外で
+
+    // 合成中：完了を待って引き取る
+    while (!done->WaitFor(kWaitSlice))
+        if (cancel.Cancelled()) return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = index_.find(key);
+        if (it == index_.end() || it->second->done != done || !it->second->packed) { ++stats_.misses; return nullptr; }
+        packed  = std::move(it->second->packed);
+        bytes_ -= packed->Bytes();
+        memory_.Release(packed->Bytes());
+        order_.erase(it->second);
+        index_.erase(it);
+        ++stats_.hits;
+        ++stats_.lateHits;
+    }
+    return unpack(packed);
+}
+
+void
+PrefetchStore::CancelAll()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    while (!order_.empty()) {
+        ++stats_.cancelled;
+        Drop(order_.begin());
+    }
+}
+
+PrefetchStats
+PrefetchStore::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    PrefetchStats st = stats_;
+    st.parkedBytes   = bytes_;
+    st.parkedEntries = 0;
+    for (const auto& e : order_) if (e.packed) ++st.parkedEntries;
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// PrefetchTTSService 実装
+// -----------------------------------------------------------------------------
+PrefetchTTSService::PrefetchTTSService(std::shared_ptr<ITTSService> inner)
+    : ForwardingTTSService(std::move(inner))
+{
+}
+
+void
+PrefetchTTSService::SetSubmitter(Submitter submit)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    submit_ = std::move(submit);
+}
+
+bool
+PrefetchTTSService::Prefetch(const VoiceInfo& voice, const std::wstring& text, int speed)
+{
+    auto key = AudioCache::MakeKey(voice, text, speed, inner_->SynthesisFingerprint());
+    CancelToken own;
+    std::uint64_t id = store_.Reserve(key, own);
+    if (!id) return false;
+
+    Submitter submit;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        submit = submit_;
+    }
+
+    if (submit && inner_->BatchSize() > 1) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            pending_.push_back(Pending{ voice, text, speed, key, id, own });
+        }
+        submit([this, key, id](const CancelToken& t) { RunPending(key, id, t); },
+               [this, key, id] { if (DropPending(key, id)) store_.Abandon(key, id); });
+        return true;
+    }
+
+    auto inner = inner_;
+    auto store = &store_;
+    SynthScheduler::Task run = [inner, store, key, id, own, voice, text, speed](const CancelToken& t) {
+        if (!store->Start(key, id)) return;
+        auto tok  = CancelToken::Link(own, t);
+        auto clip = std::make_shared<AudioClip>();
+        if (!inner->Synthesize(voice, text, speed, *clip, tok) || tok.Cancelled()) clip.reset();
+        store->Complete(key, id, std::move(clip));
+    };
+    if (submit) submit(std::move(run), [store, key, id] { store->Abandon(key, id); });
+    else        run(CancelToken());
+    return true;
+}
+
+bool
+PrefetchTTSService::DropPending(const std::string& key, std::uint64_t id)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = std::find_if(pending_.begin(), pending_.end(),
+                           [&](const Pending& p) { return p.id == id && p.key == key; });
+    if (it == pending_.end()) return false;   // 先に着手した別のジョブがまとめて処理した
+    pending_.erase(it);
+    return true;
+}
+
+// 自分の行に、待っている同じ音声・速度の行を足して一括合成する
+//  まとめて処理された行のジョブは、後で実行されても何もしない
+void
+PrefetchTTSService::RunPending(const std::string& key, std::uint64_t id, const CancelToken& cancel)
+{
+    const size_t limit = std::max<size_t>(inner_->BatchSize(), 1);
+    std::vector<Pending> group;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto self = std::find_if(pending_.begin(), pending_.end(),
+                                 [&](const Pending& p) { return p.id == id && p.key == key; });
+        if (self == pending_.end()) return;
+        group.push_back(std::move(*self));
+        pending_.erase(self);
+        const Pending& head = group.front();
+        for (auto it = pending_.begin(); it != pending_.end() && group.size() < limit;) {
+            if (it->speed == head.speed && it->voice.engine == head.voice.engine &&
+                it->voice.displayName == head.voice.displayName) {
+                group.push_back(std::move(*it));
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::vector<const Pending*> live;
+    std::vector<std::wstring>   texts;
+    for (const auto& p : group)
+        if (store_.Start(p.key, p.id)) {
+            live.push_back(&p);
+            texts.push_back(p.text);
+        }
+    if (live.empty()) return;
+
+    std::vector<std::shared_ptr<const AudioClip>> clips;
+    inner_->SynthesizeBatch(group.front().voice, texts, group.front().speed, clips, cancel);
+    for (size_t k = 0; k < live.size(); ++k) {
+        std::shared_ptr<const AudioClip> clip;
+        if (k < clips.size() && !cancel.Cancelled() && !live[k]->own.Cancelled()) clip = std::move(clips[k]);
+        store_.Complete(live[k]->key, live[k]->id, std::move(clip));
+    }
+}
+
+bool
+PrefetchTTSService::SpeakText(const VoiceInfo& voice,
+                              const std::wstring& text,
+                              int  speed,
+                              bool sync,
+                              bool overlap,
+                              std::function<void()> onFinish,
+                              const CancelToken& cancel)
+{
+    if (auto clip = store_.Take(AudioCache::MakeKey(voice, text, speed, inner_->SynthesisFingerprint()), cancel))
+        return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+    if (cancel.Cancelled()) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel);
+}
+
+bool
+PrefetchTTSService::Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                               int speed, AudioClip& out, const CancelToken& cancel)
+{
+    if (auto clip = store_.Take(AudioCache::MakeKey(voice, text, speed, inner_->SynthesisFingerprint()), cancel)) {
+        out = *clip;
+        return true;
+    }
+    return inner_->Synthesize(voice, text, speed, out, cancel);
+}
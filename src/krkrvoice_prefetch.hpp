@@ -0,0 +1,148 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_codec.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_memory.hpp"
+#include "krkrvoice_sched.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace krkrvoice {
+
+struct PrefetchStats {
+    std::uint64_t requested     = 0;   // 受け付けた先読み
+    std::uint64_t completed     = 0;   // 合成まで終わったもの
+    std::uint64_t hits          = 0;   // 発話時に使われた（待ち合わせ含む）
+    std::uint64_t lateHits      = 0;   // うち合成完了を待ったもの
+    std::uint64_t misses        = 0;   // 先読みが無かった発話
+    std::uint64_t cancelled     = 0;   // 取り消し・未着手で奪われたもの
+    std::uint64_t expired       = 0;   // TTL 切れで捨てたもの
+    std::uint64_t evicted       = 0;   // 予算超過で捨てたもの
+    std::uint64_t wastedBytes   = 0;   // 合成したが使われなかった PCM 量
+    std::uint64_t parkedBytes   = 0;   // 圧縮後
+    std::uint64_t parkedEntries = 0;
+};
+
+// 先読み結果の置き場
+//  - 発話で 1 度使われたら取り除く（通常キャッシュとは別の、使い捨ての予約領域）
+//  - メモリ予算を超えたら古いものから、TTL を過ぎたものは参照時に捨てる
+//  - 合成結果は CompressedClip で圧縮して置き、取り出すときに復号する
+//  - 置いている分はメモリ予算（MemoryGovernor）の Prefetch として数え、予算が足りなければ最初に手放す
+class PrefetchStore {
+public:
+    explicit PrefetchStore(size_t memoryBudget = 32u << 20,
+                           std::chrono::milliseconds ttl = std::chrono::seconds(120));
+
+    void SetLimits(size_t memoryBudget, std::chrono::milliseconds ttl);
+    // 圧縮で許す誤差（0 で可逆）
+    void SetTolerance(int tolerance);
+
+    // 先読みを予約し、予約番号（0 は失敗）を返す。既に予約・完了済みなら 0
+    //  以下の Start / Complete / Abandon は予約番号が一致するときだけ効く
+    std::uint64_t Reserve(const std::string& key, CancelToken& cancel);
+    // ワーカーで合成を始める直前に呼ぶ。取り消し済みなら false
+    bool Start(const std::string& key, std::uint64_t id);
+    // 合成結果を置く（失敗時は nullptr）
+    void Complete(const std::string& key, std::uint64_t id, std::shared_ptr<const AudioClip> clip);
+    // 実行されずに捨てられた予約を外す
+    void Abandon(const std::string& key, std::uint64_t id);
+
+    // 発話用に取り出す。合成中なら完了を待つ（cancel で打ち切り）
+    std::shared_ptr<const AudioClip> Take(const std::string& key, const CancelToken& cancel);
+
+    void CancelAll();
+    PrefetchStats Stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string                           key;
+        std::uint64_t                         id = 0;
+        CancelToken                           cancel;
+        std::shared_ptr<Completion>           done;
+        std::shared_ptr<const CompressedClip> packed;
+        bool                                  started = false;
+        Clock::time_point                     created;
+    };
+    using List = std::list<Entry>;
+
+    void Expire(Clock::time_point now);      // mtx_ 保持中に呼ぶ
+    void Trim();                             // 同上
+    void Drop(List::iterator it);            // 同上
+    size_t Reclaim(size_t bytes);            // メモリ予算から呼ばれる
+    List::iterator Find(const std::string& key, std::uint64_t id);   // 同上
+
+    mutable std::mutex mtx_;
+    size_t budget_;
+    std::chrono::milliseconds ttl_;
+    size_t bytes_ = 0;
+    int    tolerance_ = 0;
+    std::uint64_t nextId_ = 1;
+    List   order_;                           // 先頭が最古
+    std::unordered_map<std::string, List::iterator> index_;
+    PrefetchStats stats_;
+
+    MemoryAccount memory_{MemoryClass::Prefetch, [this](size_t bytes) { return Reclaim(bytes); }};
+};
+
+// 先読み結果を優先して再生する層
+//  Prefetch() は合成をスケジューラの Prefetch 優先度に流し、結果を PrefetchStore に置く。
+//  同じ (音声, テキスト, 速度) の発話が来たら合成を待たずに再生する。
+//  内側が一括合成に対応する（BatchSize() > 1）なら、ワーカーが着手する時点で溜まっている
+//  同じ音声・速度の先読みをまとめて SynthesizeBatch に渡す
+class PrefetchTTSService final : public ForwardingTTSService {
+public:
+    using Submitter = std::function<void(SynthScheduler::Task, std::function<void()> dropped)>;
+
+    explicit PrefetchTTSService(std::shared_ptr<ITTSService> inner);
+
+    // 先読みジョブの投入先（未設定ならその場で合成）
+    void SetSubmitter(Submitter submit);
+
+    // 受け付けたら true（既に先読み済み・合成中なら false）
+    bool Prefetch(const VoiceInfo& voice, const std::wstring& text, int speed);
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    PrefetchStore& Store() { return store_; }
+
+private:
+    // 着手待ちの先読み（一括合成用）
+    struct Pending {
+        VoiceInfo     voice;
+        std::wstring  text;
+        int           speed = 0;
+        std::string   key;
+        std::uint64_t id = 0;
+        CancelToken   own;
+    };
+
+    void RunPending(const std::string& key, std::uint64_t id, const CancelToken& cancel);
+    bool DropPending(const std::string& key, std::uint64_t id);
+
+    PrefetchStore                store_;
+
+    std::mutex          mtx_;
+    Submitter           submit_;
+    std::deque<Pending> pending_;
+};
+
+} // namespace krkrvoice
@@ -0,0 +1,194 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_sched.cpp   ―  優先度付き合成スケジューラ
+// -----------------------------------------------------------------------------
+#include "krkrvoice_sched.hpp"
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// SynthScheduler 実装
+// -----------------------------------------------------------------------------
+SynthScheduler::SynthScheduler(size_t workers, size_t maxQueuedPerClass)
+    : maxQueued_(std::max<size_t>(maxQueuedPerClass, 1))
+{
+    workers = std::max<size_t>(workers, 1);
+    for (size_t i = 0; i < workers; ++i)
+        workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+SynthScheduler::~SynthScheduler()
+{
+    std::vector<std::function<void()>> dropped;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+        for (auto& q : queues_) {
+            for (auto& it : q) if (it.dropped) dropped.push_back(std::move(it.dropped));
+            q.clear();
+        }
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+    for (auto& f : dropped) f();
+}
+
+void
+SynthScheduler::Submit(SynthPriority prio, CancelToken cancel, Task run, std::function<void()> dropped)
+{
+    std::function<void()> overflow;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (stop_) {
+            ++stats_.dropped;
+            overflow = std::move(dropped);
+        } else {
+            auto& q = queues_[static_cast<size_t>(prio)];
+            if (q.size() >= maxQueued_) {            // 溢れたら最も古いものを捨てる
+                overflow = std::move(q.front().dropped);
+                q.pop_front();
+                ++stats_.dropped;
+            }
+            q.push_back(Item{ std::move(cancel), std::move(run), std::move(dropped),
+                              TraceEnabled() ? TraceClock::now() : TraceClock::time_point{} });
+            ++stats_.submitted;
+        }
+    }
+    cv_.notify_one();
+    if (overflow) overflow();
+}
+
+void
+SynthScheduler::WorkerLoop()
+{
+    while (true) {
+        Item item;
+        bool have = false;
+        std::vector<std::function<void()>> dropped;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cv_.wait(lk, [&] {
+                return stop_ || std::any_of(queues_.begin(), queues_.end(),
+                                            [](const auto& q) { return !q.empty(); });
+            });
+            if (stop_) return;
+            for (auto& q : queues_) {
+                // 取り消し済みは先頭から読み捨てる
+                while (!q.empty() && q.front().cancel.Cancelled()) {
+                    if (q.front().dropped) dropped.push_back(std::move(q.front().dropped));
+                    q.pop_front();
+                    ++stats_.dropped;
+                }
+                if (q.empty()) continue;
+                item = std::move(q.front());
+                q.pop_front();
+                have = true;
+                ++stats_.started;
+                ++stats_.running;
+                break;
+            }
+        }
+
+        for (auto& f : dropped) f();
+        if (!have) continue;
+
+        if (item.enqueued != TraceClock::time_point{} && TraceEnabled())
+            RecordStage(TraceStage::Queue, item.enqueued, TraceClock::now());
+        item.run(item.cancel);
+        std::lock_guard<std::mutex> lk(mtx_);
+        --stats_.running;
+    }
+}
+
+SchedulerStats
+SynthScheduler::Stats() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    SchedulerStats st = stats_;
+    st.queued = 0;
+    for (const auto& q : queues_) st.queued += q.size();
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// ScheduledTTSService 実装
+// -----------------------------------------------------------------------------
+ScheduledTTSService::ScheduledTTSService(std::shared_ptr<ITTSService> inner, size_t workers)
+    : ForwardingTTSService(std::move(inner))
+    , generation_(CancelToken::Make())
+    , sched_(workers)
+{
+}
+
+void
+ScheduledTTSService::SetSupersedePolicy(SupersedePolicy p)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    policy_ = p;
+}
+
+void
+ScheduledTTSService::CancelAll()
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    generation_.Cancel();
+    generation_ = CancelToken::Make();
+    lastLine_.reset();
+}
+
+void
+ScheduledTTSService::Submit(SynthPriority prio, SynthScheduler::Task run, std::function<void()> dropped)
+{
+    CancelToken tok;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        tok = generation_.Child();
+    }
+    sched_.Submit(prio, std::move(tok), std::move(run), std::move(dropped));
+}
+
+bool
+ScheduledTTSService::SpeakText(const VoiceInfo& voice,
+                               const std::wstring& text,
+                               int  speed,
+                               bool sync,
+                               bool overlap,
+                               std::function<void()> onFinish,
+                               const CancelToken& cancel)
+{
+    auto line = std::make_shared<Line>();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        // 呼び出し側・CancelAll・後続行のいずれからでも取り消せるトークン
+        line->cancel = CancelToken::Link(generation_, cancel);
+        if (!overlap) {
+            if (lastLine_ && (policy_ == SupersedePolicy::All ||
+                              (policy_ == SupersedePolicy::Pending && !lastLine_->started.load())))
+                lastLine_->cancel.Cancel();
+            lastLine_ = line;
+        }
+    }
+    const CancelToken& tok = line->cancel;
+
+    if (sync) {   // 呼び出し側が待つので最優先でその場で処理する
+        line->started = true;
+        auto once = CallOnce(std::move(onFinish));
+        if (inner_->SpeakText(voice, text, speed, true, overlap, once, tok)) return true;
+        once();
+        return false;
+    }
+
+    // onFinish は実行・破棄のどちらか一方からだけ呼ばれる
+    auto finish = std::make_shared<std::function<void()>>(std::move(onFinish));
+    auto inner  = inner_;
+    sched_.Submit(SynthPriority::Current, tok,
+        [inner, line, voice, text, speed, overlap, finish](const CancelToken& t) {
+            line->started = true;
+            // 内側が失敗を onFinish なしで返しても完了待ちが残らないようにする
+            auto once = CallOnce(std::move(*finish));
+            if (!inner->SpeakText(voice, text, speed, false, overlap, once, t)) once();
+        },
+        [finish] { if (*finish) (*finish)(); });
+    return true;
+}
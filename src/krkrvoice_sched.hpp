@@ -0,0 +1,116 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_trace.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace krkrvoice {
+
+// 合成ジョブの優先度（小さいほど優先）
+enum class SynthPriority {
+    Current    = 0,   // いま表示中の行
+    Prefetch   = 1,   // 先読み
+    Background = 2,   // その他
+};
+
+// overlap=false の発話が来たとき、前の行の合成をどう扱うか
+enum class SupersedePolicy {
+    None    = 0,   // 取り消さない
+    Pending = 1,   // 未着手のものだけ取り消す
+    All     = 2,   // 合成中のものも取り消す（既定）
+};
+
+struct SchedulerStats {
+    std::uint64_t submitted = 0;
+    std::uint64_t started   = 0;
+    std::uint64_t dropped   = 0;   // 実行前に取り消された・溢れた
+    std::uint64_t queued    = 0;   // 現在の待ち件数
+    std::uint64_t running   = 0;   // 現在実行中の件数
+};
+
+// 優先度付きの固定ワーカープール
+//  同じ優先度の中では FIFO。各優先度の待ち行列は上限付きで、溢れたら古いものから捨てる
+class SynthScheduler {
+public:
+    using Task = std::function<void(const CancelToken&)>;
+
+    explicit SynthScheduler(size_t workers = 2, size_t maxQueuedPerClass = 256);
+    ~SynthScheduler();
+
+    SynthScheduler(const SynthScheduler&)            = delete;
+    SynthScheduler& operator=(const SynthScheduler&) = delete;
+
+    // run はワーカーで実行。実行前に取り消された・捨てられた場合は dropped を呼ぶ
+    void Submit(SynthPriority prio, CancelToken cancel, Task run, std::function<void()> dropped = {});
+
+    SchedulerStats Stats() const;
+
+private:
+    struct Item {
+        CancelToken           cancel;
+        Task                  run;
+        std::function<void()> dropped;
+        TraceClock::time_point enqueued;   // 計測有効時のみ設定
+    };
+
+    void WorkerLoop();
+
+    const size_t maxQueued_;
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::array<std::deque<Item>, 3> queues_;
+    bool stop_ = false;
+    SchedulerStats stats_;
+
+    std::vector<std::thread> workers_;
+};
+
+// 発話要求をスケジューラ経由で内側サービスに渡す層
+//  - 非同期発話は Current 優先度のジョブとしてワーカーで合成
+//  - overlap=false の発話は SupersedePolicy に従って前の行を取り消す
+//  - CancelAll で待ち・合成中のものを一括で取り消す
+class ScheduledTTSService final : public ForwardingTTSService {
+public:
+    explicit ScheduledTTSService(std::shared_ptr<ITTSService> inner, size_t workers = 2);
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    void SetSupersedePolicy(SupersedePolicy p);
+    void CancelAll();
+
+    // 同じトークン体系で任意のジョブを流す（先読みなど）
+    void Submit(SynthPriority prio, SynthScheduler::Task run, std::function<void()> dropped = {});
+
+    SynthScheduler& Scheduler() { return sched_; }
+
+private:
+    struct Line {
+        CancelToken      cancel;
+        std::atomic_bool started{ false };
+    };
+
+    std::mutex            mtx_;
+    SupersedePolicy       policy_ = SupersedePolicy::All;
+    CancelToken           generation_;   // CancelAll で取り消す親トークン
+    std::shared_ptr<Line> lastLine_;     // 直近の overlap=false の行
+
+    SynthScheduler sched_;               // 先に破棄（ワーカー停止）させるため末尾に置く
+};
+
+} // namespace krkrvoice
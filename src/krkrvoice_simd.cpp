@@ -0,0 +1,68 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_simd.cpp   ―  命令セットの実行時判定
+// -----------------------------------------------------------------------------
+#include "krkrvoice_simd.hpp"
+
+#if defined(KRKRVOICE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace krkrvoice;
+
+namespace {
+
+#ifdef KRKRVOICE_X86
+static bool CpuHasAVX2()
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    bool osxsave = (r[2] & (1 << 27)) != 0;
+    bool avx     = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;   // OS が YMM を保存するか
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool CpuHasSSE2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 1);
+    return (r[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif // KRKRVOICE_X86
+
+} // unnamed namespace
+
+SimdLevel
+krkrvoice::DetectSimd()
+{
+#ifdef KRKRVOICE_X86
+    static const SimdLevel level = CpuHasAVX2() ? SimdLevel::AVX2
+                                 : CpuHasSSE2() ? SimdLevel::SSE2 : SimdLevel::Scalar;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char*
+krkrvoice::SimdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE2: return "sse2";
+    default:              return "scalar";
+    }
+}
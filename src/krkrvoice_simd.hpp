@@ -0,0 +1,32 @@
+#pragma once
+
+// x86 では SSE2 / AVX2 の関数を個別にコンパイルし、実行時に CPU を見て選ぶ
+//  GCC / Clang は関数単位の target 属性で有効にする（全体のコンパイルオプションは変えない）
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KRKRVOICE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(KRKRVOICE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KRKRVOICE_TARGET_SSE2 __attribute__((target("sse2")))
+#define KRKRVOICE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KRKRVOICE_TARGET_SSE2
+#define KRKRVOICE_TARGET_AVX2
+#endif
+
+namespace krkrvoice {
+
+// 使う命令セット（大きいほど新しい）
+enum class SimdLevel {
+    Scalar = 0,
+    SSE2   = 1,
+    AVX2   = 2,
+};
+
+// この CPU / OS で使える最上位（初回に判定して以後は固定）
+SimdLevel DetectSimd();
+
+const char* SimdLevelName(SimdLevel level);
+
+} // namespace krkrvoice
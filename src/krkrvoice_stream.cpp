@@ -0,0 +1,212 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_stream.cpp   ―  文単位ストリーミング合成
+// -----------------------------------------------------------------------------
+#include "krkrvoice_stream.hpp"
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr size_t kFirstChunkMin = 4;     // 先頭片の最小文字数（これ未満は次とまとめる）
+constexpr size_t kChunkMin      = 24;    // 2 片目以降の目安
+constexpr int    kLeadMs        = 10;    // 片頭に残す無音
+constexpr int    kClauseTailMs  = 60;    // 読点で切った片の末尾に残す無音
+constexpr int    kSentenceTailMs = 180;  // 句点で切った片の末尾に残す無音
+
+static bool IsSentenceEnd(wchar_t c)
+{
+    return c == L'。' || c == L'！' || c == L'？' || c == L'!' || c == L'?' ||
+           c == L'…' || c == L'\n' || c == L'．';
+}
+
+static bool IsClauseEnd(wchar_t c)
+{
+    return c == L'、' || c == L'，' || c == L',' || c == L'；' || c == L';';
+}
+
+// 区切りの直後に付けて読む閉じ括弧類
+static bool IsCloser(wchar_t c)
+{
+    return c == L'」' || c == L'』' || c == L'）' || c == L')' || c == L'】' ||
+           c == L'〉' || c == L'》' || c == L'”' || c == L'’';
+}
+
+static bool IsBlank(const std::wstring& s)
+{
+    return std::all_of(s.begin(), s.end(), [](wchar_t c) {
+        return c == L' ' || c == L'　' || c == L'\t' || c == L'\r' || c == L'\n' ||
+               IsSentenceEnd(c) || IsClauseEnd(c) || IsCloser(c);
+    });
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 分割
+// -----------------------------------------------------------------------------
+std::vector<StreamChunk>
+krkrvoice::SplitForStreaming(const std::wstring& text)
+{
+    // まず区切りごとの素片に分ける
+    std::vector<StreamChunk> pieces;
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        wchar_t c = text[i];
+        if (!IsSentenceEnd(c) && !IsClauseEnd(c)) continue;
+        bool sentence = IsSentenceEnd(c);
+        while (i + 1 < text.size() && (IsSentenceEnd(text[i + 1]) || IsCloser(text[i + 1]))) {
+            sentence = sentence || IsSentenceEnd(text[i + 1]);
+            ++i;
+        }
+        pieces.push_back({ text.substr(start, i + 1 - start), sentence });
+        start = i + 1;
+    }
+    if (start < text.size()) pieces.push_back({ text.substr(start), true });
+
+    // 短い素片をまとめる（記号だけの片は前へ吸収）
+    std::vector<StreamChunk> out;
+    StreamChunk cur;
+    for (auto& p : pieces) {
+        if (IsBlank(p.text) && !out.empty() && cur.text.empty()) {
+            out.back().text += p.text;
+            out.back().sentenceEnd = out.back().sentenceEnd || p.sentenceEnd;
+            continue;
+        }
+        cur.text += p.text;
+        cur.sentenceEnd = p.sentenceEnd;
+        size_t need = out.empty() ? kFirstChunkMin : kChunkMin;
+        if (cur.text.size() >= need) {
+            out.push_back(std::move(cur));
+            cur = StreamChunk{};
+        }
+    }
+    if (!cur.text.empty()) {
+        if (!out.empty() && IsBlank(cur.text)) out.back().text += cur.text;
+        else                                   out.push_back(std::move(cur));
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// StreamingTTSService 実装
+// -----------------------------------------------------------------------------
+StreamingTTSService::StreamingTTSService(std::shared_ptr<ITTSService> inner)
+    : ForwardingTTSService(std::move(inner))
+{
+}
+
+// 再生中のストリームを止めると継ぎ足しも抜けるので、そのまま合流できる
+StreamingTTSService::~StreamingTTSService()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+        for (auto& w : live_)
+            if (auto s = w.lock()) s->Cancel();
+    }
+    cv_.notify_all();
+    for (auto& t : producers_) t.join();
+    for (auto& t : retired_) t.join();
+}
+
+size_t
+StreamingTTSService::ProducerThreads() const
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    return producers_.size();
+}
+
+// 止めるときも積まれた分は流して閉じる（取り消し済みなのですぐ終わる）
+void
+StreamingTTSService::ProducerLoop()
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    for (;;) {
+        if (jobs_.empty() && !stop_ && idleProducers_ >= kIdleProducers) {   // 残す数を超えた分は抜ける
+            auto self = std::find_if(producers_.begin(), producers_.end(), [](const std::thread& t) {
+                return t.get_id() == std::this_thread::get_id();
+            });
+            retired_.push_back(std::move(*self));
+            producers_.erase(self);
+            return;
+        }
+        ++idleProducers_;
+        cv_.wait(lk, [&] { return stop_ || !jobs_.empty(); });
+        --idleProducers_;
+        if (jobs_.empty()) return;
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lk.unlock();
+        Produce(job);
+        lk.lock();
+    }
+}
+
+void
+StreamingTTSService::Produce(Job& job)
+{
+    auto& stream = *job.stream;
+    for (const auto& c : job.chunks) {
+        if (stream.Cancelled() || job.cancel.Cancelled()) break;
+        AudioClip clip;
+        if (!inner_->Synthesize(job.voice, c.text, job.speed, clip, job.cancel)) break;
+        TrimSilence(clip, kLeadMs, c.sentenceEnd ? kSentenceTailMs : kClauseTailMs);
+        stream.Append(clip);
+    }
+    stream.Close();
+}
+
+bool
+StreamingTTSService::SpeakText(const VoiceInfo& voice,
+                               const std::wstring& text,
+                               int  speed,
+                               bool sync,
+                               bool overlap,
+                               std::function<void()> onFinish,
+                               const CancelToken& cancel)
+{
+    auto chunks = SplitForStreaming(text);
+    if (chunks.size() < 2 || !inner_->CanSynthesize(voice))
+        return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel);
+
+    AudioClip first;
+    if (!inner_->Synthesize(voice, chunks[0].text, speed, first, cancel)) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    TrimSilence(first, 0, chunks[0].sentenceEnd ? kSentenceTailMs : kClauseTailMs);
+
+    // 先頭の片はここで書き切る（リングは先頭の片＋再生のバッファ分なので待たない）
+    auto frames = static_cast<size_t>(first.sampleRate) * static_cast<size_t>(bufferMs_.load()) / 1000;
+    auto stream = std::make_shared<PcmStream>(first.sampleRate, first.channels, first.Frames() + frames);
+    stream->Append(first);
+
+    // 残りの片は継ぎ足し用スレッドで合成する（手の空いたものが足りなければ増やす）
+    chunks.erase(chunks.begin());
+    std::vector<std::thread> retired;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!overlap)
+            if (auto prev = current_.lock()) prev->Cancel();
+        current_ = stream;
+        live_.erase(std::remove_if(live_.begin(), live_.end(),
+                                   [](const auto& w) { return w.expired(); }),
+                    live_.end());
+        live_.push_back(stream);
+        if (stop_) stream->Cancel();
+
+        jobs_.push_back(Job{ stream, voice, speed, cancel, std::move(chunks) });
+        if (jobs_.size() > idleProducers_)
+            producers_.emplace_back([this] { ProducerLoop(); });
+        retired.swap(retired_);
+    }
+    cv_.notify_one();
+    for (auto& t : retired) t.join();
+
+    return inner_->PlayStream(stream, sync, overlap, std::move(onFinish));
+}
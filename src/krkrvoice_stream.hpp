@@ -0,0 +1,80 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_audio.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace krkrvoice {
+
+// ストリーミング合成用の分割片
+struct StreamChunk {
+    std::wstring text;
+    bool         sentenceEnd = false;   // 文末（。！？等）で切れたか
+};
+
+// 文・節の区切りで分割する。先頭片は短めに、以降は適度にまとめる
+std::vector<StreamChunk> SplitForStreaming(const std::wstring& text);
+
+// 文単位のストリーミング合成
+//  先頭の片だけを合成した時点で再生を始め、残りは裏で合成して
+//  同じ PcmStream に継ぎ足す。分割できない行や Synthesize 非対応の
+//  サービスは内側の SpeakText にそのまま委譲する。
+//  PcmStream は固定長のリングなので、合成は再生のバッファ分だけ先行して待つ
+//  （長文でもメモリは一定）。先頭の片はリングに収めてから再生に渡すので、継ぎ足しの
+//  スレッドを待たずに鳴り始める。継ぎ足しはサービスが持つスレッドで行い（待つ作業が
+//  あれば増やし、手が空いたものは kIdleProducers 本まで残す）、破棄時にストリームを止めて合流する。
+class StreamingTTSService final : public ForwardingTTSService {
+public:
+    explicit StreamingTTSService(std::shared_ptr<ITTSService> inner);
+    ~StreamingTTSService() override;
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    // 再生側に溜めておく長さ（ms。0 以下で PcmStream::kDefaultMs）
+    void SetBufferMs(int ms) { bufferMs_ = ms > 0 ? ms : PcmStream::kDefaultMs; }
+    int  BufferMs() const { return bufferMs_; }
+
+    // 手の空いた継ぎ足し用スレッドを残しておく数（これを超えた分は抜ける）
+    static constexpr size_t kIdleProducers = 4;
+    size_t ProducerThreads() const;
+
+private:
+    // 先頭の片を合成し終えたストリームの残りの作業
+    struct Job {
+        std::shared_ptr<PcmStream> stream;
+        VoiceInfo                  voice;
+        int                        speed = 0;
+        CancelToken                cancel;
+        std::vector<StreamChunk>   chunks;   // 先頭を除いた残り
+    };
+    void ProducerLoop();
+    void Produce(Job& job);
+
+    std::atomic<int> bufferMs_{PcmStream::kDefaultMs};
+
+    mutable std::mutex mtx_;
+    std::weak_ptr<PcmStream>              current_;   // 上書き対象のストリーム
+    std::vector<std::weak_ptr<PcmStream>> live_;      // 破棄時に止めるもの
+
+    std::condition_variable  cv_;
+    std::deque<Job>          jobs_;
+    std::vector<std::thread> producers_;
+    std::vector<std::thread> retired_;   // 抜けたスレッド（次の発話か破棄時に合流）
+    size_t                   idleProducers_ = 0;
+    bool                     stop_ = false;
+};
+
+} // namespace krkrvoice
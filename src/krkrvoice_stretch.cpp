@@ -0,0 +1,253 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_stretch.cpp   ―  WSOLA による音程を保った速度変更
+// -----------------------------------------------------------------------------
+#include "krkrvoice_stretch.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// カーネル
+//  dot    : 相関（候補位置ごとに呼ばれるので処理時間の大半）
+//  mulAdd : 窓をかけて重ね合わせる
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct Kernels {
+    float (*dot)(const float* a, const float* b, size_t n);
+    void  (*mulAdd)(float* dst, const float* src, const float* win, size_t n);
+};
+
+static float DotScalar(const float* a, const float* b, size_t n)
+{
+    float s = 0;
+    for (size_t i = 0; i < n; ++i) s += a[i] * b[i];
+    return s;
+}
+
+static void MulAddScalar(float* dst, const float* src, const float* win, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] += src[i] * win[i];
+}
+
+#ifdef KRKRVOICE_X86
+KRKRVOICE_TARGET_SSE2
+static float DotSSE2(const float* a, const float* b, size_t n)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i),     _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    alignas(16) float lane[4];
+    _mm_store_ps(lane, _mm_add_ps(s0, s1));
+    return lane[0] + lane[1] + lane[2] + lane[3] + DotScalar(a + i, b + i, n - i);
+}
+
+KRKRVOICE_TARGET_SSE2
+static void MulAddSSE2(float* dst, const float* src, const float* win, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+                                          _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(win + i))));
+    MulAddScalar(dst + i, src + i, win + i, n - i);
+}
+
+KRKRVOICE_TARGET_AVX2
+static float DotAVX2(const float* a, const float* b, size_t n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i),     _mm256_loadu_ps(b + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    __m256 s = _mm256_add_ps(s0, s1);
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+    alignas(16) float lane[4];
+    _mm_store_ps(lane, h);
+    return lane[0] + lane[1] + lane[2] + lane[3] + DotScalar(a + i, b + i, n - i);
+}
+
+KRKRVOICE_TARGET_AVX2
+static void MulAddAVX2(float* dst, const float* src, const float* win, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+                                                _mm256_mul_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(win + i))));
+    MulAddScalar(dst + i, src + i, win + i, n - i);
+}
+#endif // KRKRVOICE_X86
+
+static const Kernels& KernelsFor(SimdLevel level)
+{
+    static const Kernels scalar = { DotScalar, MulAddScalar };
+#ifdef KRKRVOICE_X86
+    static const Kernels sse2   = { DotSSE2, MulAddSSE2 };
+    static const Kernels avx2   = { DotAVX2, MulAddAVX2 };
+    switch (std::min(level, DetectSimd())) {
+    case SimdLevel::AVX2: return avx2;
+    case SimdLevel::SSE2: return sse2;
+    default:              break;
+    }
+#else
+    (void)level;
+#endif
+    return scalar;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// WSOLA
+//  出力は hop 間隔で窓（Hann, 半分重ねで和が 1）を重ねる。k 番目の窓の入力位置は
+//  名目位置 hop*rate*k の ±tol から、直前の窓の続き（prev + hop）と正規化相関が
+//  最大になる位置を選ぶ。位置合わせはモノラル化した信号で行い、全チャンネルに使う
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::TimeStretch(const AudioClip& in, float rate, AudioClip& out, SimdLevel simd)
+{
+    if (in.sampleRate <= 0 || in.channels <= 0) return false;
+    rate = std::clamp(rate, 0.25f, 4.0f);
+    const size_t frames = in.Frames();
+    if (frames == 0 || std::fabs(rate - 1.0f) < 1e-3f) {
+        if (&out != &in) out = in;
+        return true;
+    }
+
+    const Kernels& k   = KernelsFor(simd);
+    const size_t   ch  = static_cast<size_t>(in.channels);
+    const size_t   win = std::max<size_t>(64, static_cast<size_t>(in.sampleRate) / 50) & ~size_t(1);   // 20ms
+    const size_t   hop = win / 2;
+    const size_t   tol = std::max<size_t>(8, static_cast<size_t>(in.sampleRate) * 6 / 1000);
+
+    // 先頭に hop、末尾に窓と探索幅ぶんの無音を足した平面 float 配列
+    const size_t padded = hop + frames + win + tol + hop;
+    std::vector<std::vector<float>> x(ch, std::vector<float>(padded, 0.0f));
+    std::vector<float> mono(padded, 0.0f);
+    const float scale = 1.0f / 32768.0f;
+    for (size_t f = 0; f < frames; ++f) {
+        float sum = 0;
+        for (size_t c = 0; c < ch; ++c) {
+            float v = in.samples[f * ch + c] * scale;
+            x[c][hop + f] = v;
+            sum += v;
+        }
+        mono[hop + f] = sum / static_cast<float>(ch);
+    }
+
+    std::vector<float> w(win);
+    for (size_t i = 0; i < win; ++i)
+        w[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / static_cast<double>(win)));
+
+    const size_t outFrames = static_cast<size_t>(std::lround(static_cast<double>(frames) / rate));
+    const size_t outPadded = hop + outFrames + win;
+    std::vector<std::vector<float>> y(ch, std::vector<float>(outPadded, 0.0f));
+
+    const double ha     = static_cast<double>(hop) * rate;
+    const size_t maxPos = padded - win;
+    size_t prev = 0;
+    for (size_t kf = 0; kf * hop < hop + outFrames; ++kf) {
+        size_t pos = 0;
+        if (kf > 0) {
+            const size_t target  = prev + hop;   // 直前の窓の自然な続き
+            const size_t nominal = std::min(hop + static_cast<size_t>(std::lround(static_cast<double>(kf - 1) * ha)), maxPos);
+            const size_t lo = nominal > tol ? nominal - tol : 0;
+            const size_t hi = std::min(nominal + tol, maxPos);
+
+            double energy = k.dot(&mono[lo], &mono[lo], hop);
+            double best   = -std::numeric_limits<double>::infinity();
+            pos = nominal;
+            for (size_t c = lo; c <= hi; ++c) {
+                if (c > lo) {
+                    float in0 = mono[c + hop - 1], out0 = mono[c - 1];
+                    energy += double(in0) * in0 - double(out0) * out0;
+                }
+                double score = k.dot(&mono[c], &mono[target], hop) / std::sqrt(std::max(energy, 1e-9));
+                if (score > best) {
+                    best = score;
+                    pos  = c;
+                }
+            }
+        }
+        for (size_t c = 0; c < ch; ++c) k.mulAdd(&y[c][kf * hop], &x[c][pos], w.data(), win);
+        prev = pos;
+    }
+
+    AudioClip res;
+    res.sampleRate = in.sampleRate;
+    res.channels   = in.channels;
+    res.samples.resize(outFrames * ch);
+    for (size_t f = 0; f < outFrames; ++f)
+        for (size_t c = 0; c < ch; ++c) {
+            float v = std::clamp(y[c][hop + f] * 32768.0f, -32768.0f, 32767.0f);
+            res.samples[f * ch + c] = static_cast<int16_t>(std::lrintf(v));
+        }
+    out = std::move(res);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// TimeStretchTTSService 実装
+// -----------------------------------------------------------------------------
+bool
+TimeStretchTTSService::Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                                  int speed, AudioClip& out, const CancelToken& cancel)
+{
+    const float rate = NormalizeSpeed(speed);
+    if (!enabled_ || rate == 1.0f) return inner_->Synthesize(voice, text, speed, out, cancel);
+
+    AudioClip base;
+    if (!inner_->Synthesize(voice, text, 0, base, cancel)) return false;
+    StageTimer t(TraceStage::Stretch);
+    return TimeStretch(base, rate, out);
+}
+
+void
+TimeStretchTTSService::SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                                       std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel)
+{
+    const float rate = NormalizeSpeed(speed);
+    if (!enabled_ || rate == 1.0f) return inner_->SynthesizeBatch(voice, texts, speed, out, cancel);
+
+    inner_->SynthesizeBatch(voice, texts, 0, out, cancel);
+    StageTimer t(TraceStage::Stretch);
+    for (auto& clip : out) {
+        if (!clip) continue;
+        auto res = std::make_shared<AudioClip>();
+        if (TimeStretch(*clip, rate, *res)) clip = std::move(res);
+        else                                clip.reset();
+    }
+}
+
+bool
+TimeStretchTTSService::SpeakText(const VoiceInfo& voice,
+                                 const std::wstring& text,
+                                 int  speed,
+                                 bool sync,
+                                 bool overlap,
+                                 std::function<void()> onFinish,
+                                 const CancelToken& cancel)
+{
+    // 合成単体に対応しないサービスはエンジン側の速度指定で鳴らす
+    if (!enabled_ || NormalizeSpeed(speed) == 1.0f || !inner_->CanSynthesize(voice))
+        return inner_->SpeakText(voice, text, speed, sync, overlap, std::move(onFinish), cancel);
+
+    auto clip = std::make_shared<AudioClip>();
+    if (!Synthesize(voice, text, speed, *clip, cancel)) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    return inner_->PlayAudio(std::move(clip), sync, overlap, std::move(onFinish));
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_simd.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace krkrvoice {
+
+// 音程を変えずに再生速度を変える（WSOLA）
+//  rate > 1 で速く（短く）なる。0.25 〜 4 に丸める。rate == 1 はそのままコピー
+//  20ms 窓・半分重ねで、継ぎ目は直前の続きと最も相関の高い位置（±6ms）を選ぶ
+bool TimeStretch(const AudioClip& in, float rate, AudioClip& out, SimdLevel simd = DetectSimd());
+
+// 速度指定を合成済み PCM の伸縮で実現する層
+//  内側へは常に速度 0（等速）で合成を頼むので、キャッシュは速度ごとに分かれず
+//  速度を変えても再合成にならない。合成単体に対応しないサービスは元の速度で委譲する
+class TimeStretchTTSService final : public ForwardingTTSService {
+public:
+    explicit TimeStretchTTSService(std::shared_ptr<ITTSService> inner) : ForwardingTTSService(std::move(inner)) {}
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    void SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                         std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {}) override;
+
+    // false ならエンジン側の速度指定（再合成）に戻す
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    bool Enabled() const          { return enabled_; }
+
+private:
+    std::atomic_bool enabled_{ true };
+};
+
+} // namespace krkrvoice
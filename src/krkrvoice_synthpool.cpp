@@ -0,0 +1,259 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_synthpool.cpp   ―  音声ごとの合成器プール
+// -----------------------------------------------------------------------------
+#include "krkrvoice_synthpool.hpp"
+
+#include <algorithm>
+
+using namespace krkrvoice;
+
+using PoolClock = std::chrono::steady_clock;
+
+struct SynthesizerPool::Lease::Shared {
+    struct Idle {
+        std::unique_ptr<SynthInstance> inst;
+        PoolClock::time_point          since;
+        size_t                         charged = 0;
+    };
+
+    Factory               create;
+    std::function<bool()> pressure;
+
+    mutable std::mutex mtx;
+    std::unordered_map<VoiceHandle, std::vector<Idle>> idle;   // 末尾ほど最近返却された
+    size_t                    maxIdlePerVoice = 4;
+    std::chrono::milliseconds idleTtl{ 5 * 60 * 1000 };
+    PoolClock::time_point     lastTrim = PoolClock::now();
+    size_t                    instanceBytes = kDefaultInstanceBytes;
+    SynthPoolStats            stats;
+
+    // mtx 保持中。破棄は呼び出し側がロック外で行う
+    void TakeExpired(bool all, std::vector<std::unique_ptr<SynthInstance>>& out)
+    {
+        auto now = PoolClock::now();
+        size_t before = out.size();
+        for (auto it = idle.begin(); it != idle.end();) {
+            auto& v = it->second;
+            auto keep = std::stable_partition(v.begin(), v.end(), [&](const Idle& e) {
+                return !all && now - e.since < idleTtl;
+            });
+            for (auto e = keep; e != v.end(); ++e) {
+                memory.Release(e->charged);
+                out.push_back(std::move(e->inst));
+            }
+            v.erase(keep, v.end());
+            it = v.empty() ? idle.erase(it) : std::next(it);
+        }
+        stats.trimmed += out.size() - before;
+        stats.idle    -= out.size() - before;
+        lastTrim = now;
+    }
+
+    // メモリ予算から呼ばれる。待機中のものを最後に返却された時刻の古い順に手放す
+    size_t Reclaim(size_t bytes)
+    {
+        std::vector<std::unique_ptr<SynthInstance>> drop;   // 破棄はロック外
+        size_t freed = 0;
+        std::lock_guard<std::mutex> lk(mtx);
+        while (freed < bytes) {
+            auto oldest = idle.end();
+            for (auto it = idle.begin(); it != idle.end(); ++it)
+                if (!it->second.empty() &&
+                    (oldest == idle.end() || it->second.front().since < oldest->second.front().since))
+                    oldest = it;
+            if (oldest == idle.end()) break;
+            auto& v = oldest->second;
+            freed += v.front().charged;
+            memory.Release(v.front().charged);
+            drop.push_back(std::move(v.front().inst));
+            v.erase(v.begin());
+            if (v.empty()) idle.erase(oldest);
+            ++stats.trimmed;
+            --stats.idle;
+        }
+        return freed;
+    }
+
+    MemoryAccount memory{MemoryClass::Engines, [this](size_t bytes) { return Reclaim(bytes); }};
+};
+
+// -----------------------------------------------------------------------------
+// Lease
+// -----------------------------------------------------------------------------
+SynthesizerPool::Lease&
+SynthesizerPool::Lease::operator=(Lease&& o) noexcept
+{
+    if (this == &o) return *this;
+    Release();
+    pool_    = std::move(o.pool_);
+    handle_  = o.handle_;
+    inst_    = std::move(o.inst_);
+    charged_ = o.charged_;
+    counted_ = o.counted_;
+    o.charged_ = 0;
+    o.counted_ = false;
+    return *this;
+}
+
+void
+SynthesizerPool::Lease::Release()
+{
+    if (!counted_) return;
+    counted_ = false;
+    auto sp = pool_.lock();
+    if (!sp) { inst_.reset(); return; }
+
+    std::function<bool()> probe;
+    {
+        std::lock_guard<std::mutex> lk(sp->mtx);
+        probe = sp->pressure;
+    }
+    bool pressured = probe && probe();
+    std::vector<std::unique_ptr<SynthInstance>> drop;
+    {
+        std::lock_guard<std::mutex> lk(sp->mtx);
+        --sp->stats.inUse;
+        if (inst_ && handle_ != kInvalidVoiceHandle && !pressured) {
+            auto& v = sp->idle[handle_];
+            if (v.size() < sp->maxIdlePerVoice) {
+                v.push_back(Shared::Idle{ std::move(inst_), PoolClock::now(), charged_ });
+                charged_ = 0;
+                ++sp->stats.idle;
+            } else {
+                ++sp->stats.trimmed;
+            }
+        }
+        sp->memory.Release(charged_);                                   // 待機させずに破棄する分
+        if (pressured)                                                  // 待機分も手放す
+            sp->TakeExpired(true, drop);
+        else if (PoolClock::now() - sp->lastTrim > sp->idleTtl / 4)     // 期限切れはついでに掃除
+            sp->TakeExpired(false, drop);
+    }
+    inst_.reset();
+}
+
+// -----------------------------------------------------------------------------
+// SynthesizerPool 実装
+// -----------------------------------------------------------------------------
+SynthesizerPool::SynthesizerPool(Factory create)
+    : shared_(std::make_shared<Lease::Shared>())
+{
+    shared_->create = std::move(create);
+}
+
+SynthesizerPool::~SynthesizerPool() = default;
+
+SynthesizerPool::Lease
+SynthesizerPool::Acquire(const VoiceInfo& voice)
+{
+    Lease l;
+    l.pool_   = shared_;
+    l.handle_ = voice.handle;
+    {
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        if (voice.handle != kInvalidVoiceHandle) {
+            auto it = shared_->idle.find(voice.handle);
+            if (it != shared_->idle.end() && !it->second.empty()) {
+                l.inst_    = std::move(it->second.back().inst);
+                l.charged_ = it->second.back().charged;
+                it->second.pop_back();
+                if (it->second.empty()) shared_->idle.erase(it);   // 空の待機列は残さない
+                --shared_->stats.idle;
+                ++shared_->stats.reused;
+            }
+        }
+        ++shared_->stats.inUse;
+        shared_->stats.peakInUse = std::max(shared_->stats.peakInUse, shared_->stats.inUse);
+    }
+    l.counted_ = true;
+    if (l.inst_) return l;
+
+    // 初期化はロック外（同じ音声の同時要求も並行して作る）
+    //  合成に要るので予算を超えても作るが、先に先読み・キャッシュ・待機中の合成器を手放させる
+    {
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        l.charged_ = shared_->instanceBytes;
+    }
+    shared_->memory.Reserve(l.charged_, true);
+    l.inst_ = shared_->create(voice, false);
+    if (!l.inst_) {
+        l.Release();
+        return l;
+    }
+    std::lock_guard<std::mutex> lk(shared_->mtx);
+    ++shared_->stats.created;
+    return l;
+}
+
+size_t
+SynthesizerPool::Warm(const VoiceInfo& voice, size_t count)
+{
+    if (voice.handle == kInvalidVoiceHandle) return 0;
+    size_t have;
+    {
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        auto it = shared_->idle.find(voice.handle);
+        have = it != shared_->idle.end() ? it->second.size() : 0;
+    }
+    size_t made = 0;
+    for (; have + made < count; ++made) {
+        // 先行初期化は予算の範囲内だけ
+        size_t bytes;
+        {
+            std::lock_guard<std::mutex> lk(shared_->mtx);
+            bytes = shared_->instanceBytes;
+        }
+        if (!shared_->memory.Reserve(bytes)) break;
+        auto inst = shared_->create(voice, true);
+        if (!inst) {
+            shared_->memory.Release(bytes);
+            break;
+        }
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        shared_->idle[voice.handle].push_back(Lease::Shared::Idle{ std::move(inst), PoolClock::now(), bytes });
+        ++shared_->stats.idle;
+        ++shared_->stats.created;
+        ++shared_->stats.warmed;
+    }
+    return made;
+}
+
+void
+SynthesizerPool::SetLimits(size_t maxIdlePerVoice, std::chrono::milliseconds idleTtl)
+{
+    std::lock_guard<std::mutex> lk(shared_->mtx);
+    shared_->maxIdlePerVoice = maxIdlePerVoice;
+    shared_->idleTtl         = idleTtl;
+}
+
+void
+SynthesizerPool::SetInstanceBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(shared_->mtx);
+    shared_->instanceBytes = bytes;
+}
+
+void
+SynthesizerPool::SetPressureProbe(std::function<bool()> underPressure)
+{
+    std::lock_guard<std::mutex> lk(shared_->mtx);
+    shared_->pressure = std::move(underPressure);
+}
+
+size_t
+SynthesizerPool::Trim(bool all)
+{
+    std::vector<std::unique_ptr<SynthInstance>> drop;
+    {
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        shared_->TakeExpired(all, drop);
+    }
+    return drop.size();
+}
+
+SynthPoolStats
+SynthesizerPool::Stats() const
+{
+    std::lock_guard<std::mutex> lk(shared_->mtx);
+    return shared_->stats;
+}
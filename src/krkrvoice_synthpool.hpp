@@ -0,0 +1,103 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_memory.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace krkrvoice {
+
+// エンジン側の合成器 1 個（ISpVoice / SpeechSynthesizer など）。音声の設定まで済んだ状態で貸し出す
+class SynthInstance {
+public:
+    virtual ~SynthInstance() = default;
+};
+
+struct SynthPoolStats {
+    std::uint64_t created   = 0;   // 初期化した数（warmed を含む）
+    std::uint64_t warmed    = 0;   // Warm で先に用意した数
+    std::uint64_t reused    = 0;   // 待機中のものを貸し出した回数
+    std::uint64_t trimmed   = 0;   // 待機中に破棄した数（期限切れ・上限超過・メモリ不足）
+    std::uint64_t inUse     = 0;
+    std::uint64_t peakInUse = 0;
+    std::uint64_t idle      = 0;
+};
+
+// 音声ごとの合成器プール（エンジン非依存）
+//  - Acquire は待機中のものがあれば再利用し、なければロック外で新しく作る。
+//    重ね再生の同時要求は別々の合成器を受け取り、互いに待たない
+//  - 返却時、メモリ不足（SetPressureProbe）なら待機させずに破棄し、待機中のものも捨てる
+//  - 待機中のものは音声あたり maxIdlePerVoice 個、idleTtl を過ぎたものは Trim で破棄
+//  - ハンドル 0 の音声はプールせず毎回作って捨てる
+//  - 合成器は 1 個 SetInstanceBytes の見積もりでメモリ予算（MemoryGovernor）の Engines として数え、
+//    予算が足りなければ待機中のものを古い順に手放す
+class SynthesizerPool {
+public:
+    // 合成器 1 個のメモリの見積もり（エンジンから実測できないため）
+    static constexpr size_t kDefaultInstanceBytes = 8u << 20;
+
+    // warm=true は Warm からの呼び出し（エンジンの読み込みまで済ませるため空読みしてよい）
+    using Factory = std::function<std::unique_ptr<SynthInstance>(const VoiceInfo& voice, bool warm)>;
+
+    // 貸し出し中の合成器。破棄でプールに戻る（プールが先に消えていれば合成器ごと破棄）
+    class Lease {
+    public:
+        Lease() = default;
+        ~Lease() { Release(); }
+        Lease(Lease&& o) noexcept { *this = std::move(o); }
+        Lease& operator=(Lease&& o) noexcept;
+        Lease(const Lease&)            = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        explicit operator bool() const { return static_cast<bool>(inst_); }
+        template <class T> T* As() const { return static_cast<T*>(inst_.get()); }
+
+        // 使用中に壊れた合成器は戻さず捨てる
+        void Discard() { inst_.reset(); Release(); }
+
+    private:
+        friend class SynthesizerPool;
+        struct Shared;
+        void Release();
+
+        std::weak_ptr<Shared>          pool_;
+        VoiceHandle                    handle_ = kInvalidVoiceHandle;
+        std::unique_ptr<SynthInstance> inst_;
+        size_t                         charged_ = 0;   // inst_ の分としてメモリ予算に確保した量
+        bool                           counted_ = false;
+    };
+
+    explicit SynthesizerPool(Factory create);
+    ~SynthesizerPool();
+
+    SynthesizerPool(const SynthesizerPool&)            = delete;
+    SynthesizerPool& operator=(const SynthesizerPool&) = delete;
+
+    // 作成に失敗した場合は空の Lease
+    Lease Acquire(const VoiceInfo& voice);
+
+    // 待機中が count 個になるまで作っておく（プラグイン読み込み時の先行初期化）
+    size_t Warm(const VoiceInfo& voice, size_t count);
+
+    void SetLimits(size_t maxIdlePerVoice, std::chrono::milliseconds idleTtl);
+    // 以後に作る合成器の見積もり
+    void SetInstanceBytes(size_t bytes);
+
+    // true を返す間は返却された合成器を待機させない（Windows は低メモリ通知を見る）
+    void SetPressureProbe(std::function<bool()> underPressure);
+
+    // 期限切れの待機分を破棄（all=true なら全部）。破棄した数を返す
+    size_t Trim(bool all = false);
+
+    SynthPoolStats Stats() const;
+
+private:
+    std::shared_ptr<Lease::Shared> shared_;
+};
+
+} // namespace krkrvoice
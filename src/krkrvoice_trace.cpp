@@ -0,0 +1,231 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_trace.cpp   ―  区間計測（ロックなしヒストグラム + Chrome trace）
+// -----------------------------------------------------------------------------
+#include "krkrvoice_trace.hpp"
+#include "krkrvoice_json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace krkrvoice;
+
+std::atomic<unsigned> krkrvoice::detail::g_traceFlags{ detail::kTraceStats };
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr size_t kStages  = static_cast<size_t>(TraceStage::Count);
+constexpr size_t kSub     = 8;                   // 1 オクターブあたりの分割数
+constexpr size_t kBuckets = kSub + 48 * kSub;    // ns 単位で 2^51 まで
+constexpr size_t kEvents  = 16384;
+
+// ナノ秒 → バケット番号（8 未満はそのまま、以降は 1/8 オクターブ刻み）
+static size_t BucketOf(uint64_t ns)
+{
+    if (ns < kSub) return static_cast<size_t>(ns);
+    int e = 0;
+    for (uint64_t v = ns; v > 1; v >>= 1) ++e;
+    size_t sub = static_cast<size_t>((ns >> (e - 3)) & (kSub - 1));
+    return std::min(kBuckets - 1, kSub + static_cast<size_t>(e - 3) * kSub + sub);
+}
+
+// バケットの代表値（中央）
+static double BucketMid(size_t b)
+{
+    if (b < kSub) return static_cast<double>(b);
+    size_t e   = (b - kSub) / kSub + 3;
+    size_t sub = (b - kSub) % kSub;
+    double lo  = static_cast<double>((kSub + sub) << (e - 3));
+    return lo + static_cast<double>(uint64_t(1) << (e - 3)) * 0.5;
+}
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[kBuckets];
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> sumNs{ 0 };
+    std::atomic<uint64_t> maxNs{ 0 };
+
+    Histogram() { Reset(); }
+
+    void Add(uint64_t ns)
+    {
+        buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = maxNs.load(std::memory_order_relaxed);
+        while (ns > m && !maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+    }
+
+    void Reset()
+    {
+        for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        sumNs.store(0, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+    }
+};
+
+// イベント 1 件。seq はシーケンスロック（0=書き込み中、それ以外は書き込み番号+1）
+struct EventSlot {
+    std::atomic<uint64_t> seq{ 0 };
+    std::atomic<int>      stage{ 0 };
+    std::atomic<uint32_t> tid{ 0 };
+    std::atomic<int64_t>  beginNs{ 0 };
+    std::atomic<int64_t>  durNs{ 0 };
+};
+
+struct TraceState {
+    Histogram              hist[kStages];
+    EventSlot              events[kEvents];
+    std::atomic<uint64_t>  nextEvent{ 0 };
+    std::atomic<uint32_t>  nextTid{ 1 };
+    TraceClock::time_point epoch = TraceClock::now();
+};
+
+// 静的初期化順に依存しないよう関数内 static にする（終了時も参照されうるので解放しない）
+static TraceState& State()
+{
+    static TraceState* s = new TraceState;
+    return *s;
+}
+
+static uint32_t ThreadId()
+{
+    thread_local uint32_t id = State().nextTid.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+static const char* const kStageNames[kStages] = {
+    "call", "dictionary", "voiceResolve", "queue", "synthesis", "streamCreate", "playerStart", "stretch", "markup",
+};
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// 設定と記録
+// -----------------------------------------------------------------------------
+const char*
+krkrvoice::TraceStageName(TraceStage stage)
+{
+    auto i = static_cast<size_t>(stage);
+    return i < kStages ? kStageNames[i] : "unknown";
+}
+
+void
+krkrvoice::SetTraceOptions(bool stats, bool events)
+{
+    State();   // 有効化前に確保しておく
+    detail::g_traceFlags.store((stats ? detail::kTraceStats : 0u) | (events ? detail::kTraceEvents : 0u),
+                               std::memory_order_relaxed);
+}
+
+void
+krkrvoice::RecordStage(TraceStage stage, TraceClock::time_point begin, TraceClock::time_point end)
+{
+    auto i = static_cast<size_t>(stage);
+    if (i >= kStages) return;
+    unsigned flags = detail::g_traceFlags.load(std::memory_order_relaxed);
+    auto& st = State();
+    int64_t dur = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    if (dur < 0) dur = 0;
+
+    if (flags & detail::kTraceStats) st.hist[i].Add(static_cast<uint64_t>(dur));
+
+    if (flags & detail::kTraceEvents) {
+        uint64_t n = st.nextEvent.fetch_add(1, std::memory_order_relaxed);
+        auto& e = st.events[n % kEvents];
+        e.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.stage.store(static_cast<int>(i), std::memory_order_relaxed);
+        e.tid.store(ThreadId(), std::memory_order_relaxed);
+        e.beginNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - st.epoch).count(),
+                        std::memory_order_relaxed);
+        e.durNs.store(dur, std::memory_order_relaxed);
+        e.seq.store(n + 1, std::memory_order_release);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// 集計と書き出し
+// -----------------------------------------------------------------------------
+std::array<StageLatency, static_cast<size_t>(TraceStage::Count)>
+krkrvoice::GetStageLatency()
+{
+    std::array<StageLatency, kStages> out{};
+    auto& st = State();
+    std::vector<uint64_t> snap(kBuckets);
+    for (size_t i = 0; i < kStages; ++i) {
+        const auto& h = st.hist[i];
+        uint64_t total = 0;
+        for (size_t b = 0; b < kBuckets; ++b) total += snap[b] = h.buckets[b].load(std::memory_order_relaxed);
+        auto& r = out[i];
+        r.count = total;
+        if (!total) continue;
+        r.meanUs = static_cast<double>(h.sumNs.load(std::memory_order_relaxed)) /
+                   static_cast<double>(std::max<uint64_t>(h.count.load(std::memory_order_relaxed), 1)) / 1000.0;
+        r.maxUs  = static_cast<double>(h.maxNs.load(std::memory_order_relaxed)) / 1000.0;
+
+        auto pct = [&](double p) {
+            uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total - 1)) + 1;
+            uint64_t acc  = 0;
+            for (size_t b = 0; b < kBuckets; ++b)
+                if ((acc += snap[b]) >= rank) return std::min(BucketMid(b) / 1000.0, r.maxUs);
+            return r.maxUs;
+        };
+        r.p50Us = pct(0.50);
+        r.p95Us = pct(0.95);
+        r.p99Us = pct(0.99);
+    }
+    return out;
+}
+
+void
+krkrvoice::ResetStageLatency()
+{
+    auto& st = State();
+    for (auto& h : st.hist) h.Reset();
+    for (auto& e : st.events) e.seq.store(0, std::memory_order_relaxed);
+    st.nextEvent.store(0, std::memory_order_relaxed);
+}
+
+bool
+krkrvoice::DumpChromeTrace(const std::filesystem::path& path)
+{
+    struct Ev { int stage; uint32_t tid; int64_t beginNs, durNs; };
+    std::vector<Ev> evs;
+    auto& st = State();
+    for (auto& e : st.events) {
+        uint64_t s1 = e.seq.load(std::memory_order_acquire);
+        if (!s1) continue;
+        Ev v{ e.stage.load(std::memory_order_relaxed), e.tid.load(std::memory_order_relaxed),
+              e.beginNs.load(std::memory_order_relaxed), e.durNs.load(std::memory_order_relaxed) };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) != s1) continue;   // 読む間に上書きされた
+        evs.push_back(v);
+    }
+    std::sort(evs.begin(), evs.end(), [](const Ev& a, const Ev& b) { return a.beginNs < b.beginNs; });
+
+    JsonValue list = JsonValue::MakeArray();
+    for (const auto& v : evs) {
+        JsonValue e = JsonValue::MakeObject();
+        e.Set("name", JsonValue(TraceStageName(static_cast<TraceStage>(v.stage))));
+        e.Set("cat",  JsonValue("krkrvoice"));
+        e.Set("ph",   JsonValue("X"));
+        e.Set("ts",   JsonValue(static_cast<double>(v.beginNs) / 1000.0));
+        e.Set("dur",  JsonValue(static_cast<double>(v.durNs) / 1000.0));
+        e.Set("pid",  JsonValue(1));
+        e.Set("tid",  JsonValue(static_cast<double>(v.tid)));
+        list.Push(std::move(e));
+    }
+    JsonValue root = JsonValue::MakeObject();
+    root.Set("traceEvents",     std::move(list));
+    root.Set("displayTimeUnit", JsonValue("ms"));
+
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    f << root.Dump();
+    return static_cast<bool>(f);
+}
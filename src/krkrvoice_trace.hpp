@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+namespace krkrvoice {
+
+// 計測区間
+enum class TraceStage : int {
+    Call = 0,       // speakSync / speakAsync 呼び出し全体
+    Dictionary,     // 辞書置換
+    VoiceResolve,   // 音声の解決（初回は列挙を含む）
+    Queue,          // スケジューラの待ち行列に居た時間
+    Synthesis,      // エンジンでの合成
+    StreamCreate,   // 再生用ストリーム / MediaSource の作成
+    PlayerStart,    // プレイヤーの確保から Play() まで
+    Stretch,        // 速度変更の伸縮処理
+    Markup,         // シナリオタグの除去
+    Count
+};
+
+const char* TraceStageName(TraceStage stage);
+
+// 区間ごとの集計（マイクロ秒、百分位はバケット幅 1/8 オクターブの近似）
+struct StageLatency {
+    std::uint64_t count = 0;
+    double        meanUs = 0;
+    double        p50Us  = 0;
+    double        p95Us  = 0;
+    double        p99Us  = 0;
+    double        maxUs  = 0;
+};
+
+using TraceClock = std::chrono::steady_clock;
+
+namespace detail {
+constexpr unsigned kTraceStats  = 1;
+constexpr unsigned kTraceEvents = 2;
+extern std::atomic<unsigned> g_traceFlags;
+}
+
+// stats=区間ヒストグラム、events=Chrome trace 用のイベント記録（直近 16384 件）
+void SetTraceOptions(bool stats, bool events);
+
+// 無効時はこの読み出し 1 回で済む
+inline bool TraceEnabled()
+{
+    return detail::g_traceFlags.load(std::memory_order_relaxed) != 0;
+}
+
+// 区間を記録（ロックなし）
+void RecordStage(TraceStage stage, TraceClock::time_point begin, TraceClock::time_point end);
+
+std::array<StageLatency, static_cast<size_t>(TraceStage::Count)> GetStageLatency();
+void ResetStageLatency();
+
+// 記録済みイベントを Chrome trace-event 形式（chrome://tracing, Perfetto）で書き出す
+bool DumpChromeTrace(const std::filesystem::path& path);
+
+// スコープの所要時間を記録する
+class StageTimer {
+public:
+    explicit StageTimer(TraceStage stage)
+        : stage_(stage), on_(TraceEnabled())
+    {
+        if (on_) begin_ = TraceClock::now();
+    }
+    ~StageTimer() { Stop(); }
+
+    // スコープ終了を待たずに記録する（2 回目以降は何もしない）
+    void Stop()
+    {
+        if (on_) RecordStage(stage_, begin_, TraceClock::now());
+        on_ = false;
+    }
+
+    StageTimer(const StageTimer&)            = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    TraceStage             stage_;
+    bool                   on_;
+    TraceClock::time_point begin_;
+};
+
+} // namespace krkrvoice
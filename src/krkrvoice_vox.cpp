@@ -0,0 +1,581 @@
+// -----------------------------------------------------------------------------
+// krkrvoice_vox.cpp   ―  VOICEVOX (HTTP) 実装
+// -----------------------------------------------------------------------------
+#include "krkrvoice_vox.hpp"
+#include "krkrvoice_json.hpp"
+#include "krkrvoice_markup.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+using namespace krkrvoice;
+
+// -----------------------------------------------------------------------------
+// 内部ユーティリティ
+// -----------------------------------------------------------------------------
+namespace {
+
+constexpr size_t kMaxPipelineDepth = 8;   // 1 回のパイプライン送信でまとめる最大件数
+
+static std::string QueryKey(int speaker, const std::wstring& text)
+{
+    return std::to_string(speaker) + '\x1f' + ToUtf8(text);
+}
+
+static std::uint32_t Le16(const char* p)
+{
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(p[0])) |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(p[1])) << 8;
+}
+
+static std::uint32_t Le32(const char* p)
+{
+    return Le16(p) | Le16(p + 2) << 16;
+}
+
+// multi_synthesis の応答（無圧縮 ZIP）から WAV を名前順（001.wav, 002.wav, ...）に取り出す
+//  圧縮されたエントリがあれば false
+static bool ReadStoredZip(const std::string& zip, std::vector<std::string_view>& files)
+{
+    constexpr size_t kEocd = 22, kCentral = 46, kLocal = 30;
+    if (zip.size() < kEocd) return false;
+    size_t eocd = std::string::npos;
+    for (size_t i = zip.size() - kEocd + 1; i-- > 0 && zip.size() - i <= kEocd + 0xFFFF;)
+        if (Le32(&zip[i]) == 0x06054b50) { eocd = i; break; }
+    if (eocd == std::string::npos) return false;
+
+    const size_t count = Le16(&zip[eocd + 10]);
+    size_t p = Le32(&zip[eocd + 16]);
+    std::vector<std::pair<std::string_view, std::string_view>> entries;
+    for (size_t n = 0; n < count; ++n) {
+        if (p + kCentral > zip.size() || Le32(&zip[p]) != 0x02014b50) return false;
+        const std::uint32_t method = Le16(&zip[p + 10]);
+        const size_t csize = Le32(&zip[p + 20]), usize = Le32(&zip[p + 24]);
+        const size_t nlen  = Le16(&zip[p + 28]), xlen  = Le16(&zip[p + 30]), clen = Le16(&zip[p + 32]);
+        const size_t local = Le32(&zip[p + 42]);
+        if (method != 0 || csize != usize || p + kCentral + nlen > zip.size()) return false;
+        std::string_view name(&zip[p + kCentral], nlen);
+        if (local + kLocal > zip.size() || Le32(&zip[local]) != 0x04034b50) return false;
+        const size_t data = local + kLocal + Le16(&zip[local + 26]) + Le16(&zip[local + 28]);
+        if (data + csize > zip.size()) return false;
+        entries.emplace_back(name, std::string_view(&zip[data], csize));
+        p += kCentral + nlen + xlen + clen;
+    }
+    std::sort(entries.begin(), entries.end());
+    files.clear();
+    for (const auto& e : entries) files.push_back(e.second);
+    return true;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// VoiceVoxService 実装
+// -----------------------------------------------------------------------------
+VoiceVoxService::VoiceVoxService(const std::wstring& url, int port)
+    : http_([&] {
+          std::string host = "127.0.0.1";
+          int p = port;
+          ParseHttpUrl(ToUtf8(url), host, p);
+          return HttpClient(host, p);
+      }())
+    , catalog_([this] { return EnumSpeakers(); })
+{
+    queryThread_ = std::thread([this] { QueryLoop(); });
+    synthThread_ = std::thread([this] { SynthLoop(); });
+}
+
+VoiceVoxService::~VoiceVoxService()
+{
+    catalog_.Shutdown();   // 裏での再列挙は http_ と styles_ を使う
+    {
+        std::lock_guard<std::mutex> lk(qMtx_);
+        stop_ = true;
+    }
+    qCv_.notify_all();
+    if (queryThread_.joinable()) queryThread_.join();
+    if (synthThread_.joinable()) synthThread_.join();
+    for (auto& j : queryQ_) Finish(j);
+    for (auto& j : synthQ_) Finish(j);
+}
+
+std::vector<VoiceInfo>
+VoiceVoxService::EnumSpeakers()
+{
+    std::vector<VoiceInfo> out;
+    HttpRequest req;
+    req.target = "/speakers";
+    HttpResponse res;
+    JsonValue root;
+    if (!http_.Send(req, res) || !res.ok() || !JsonValue::Parse(res.body, root) || !root.isArray())
+        return out;
+
+    std::unordered_map<std::wstring, int> styles;
+    for (const auto& sp : root.Items()) {
+        const JsonValue* name = sp.Find("name");
+        const JsonValue* sts  = sp.Find("styles");
+        if (!name || !sts || !sts->isArray()) continue;
+        for (const auto& st : sts->Items()) {
+            const JsonValue* sname = st.Find("name");
+            const JsonValue* id    = st.Find("id");
+            if (!sname || !id) continue;
+            std::wstring disp = FromUtf8(name->AsString()) + L"（" + FromUtf8(sname->AsString()) + L"）";
+            styles[disp] = static_cast<int>(id->AsNumber());
+            out.push_back(VoiceInfo{ TTSService::VoiceVox, L"VOICEVOX", disp, L"ja-JP", L"Other" });
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(stylesMtx_);
+    for (auto& [k, v] : styles) styles_[k] = v;
+    return out;
+}
+
+std::vector<VoiceInfo>
+VoiceVoxService::GetVoiceList(const std::wstring& lang, const std::wstring& gender)
+{
+    return catalog_.List(lang, gender);
+}
+
+bool
+VoiceVoxService::ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                              size_t idx, VoiceInfo& out)
+{
+    return catalog_.Resolve(lang, gender, idx, out);
+}
+
+bool
+VoiceVoxService::FindVoice(VoiceHandle handle, VoiceInfo& out)
+{
+    return catalog_.Find(handle, out);
+}
+
+void
+VoiceVoxService::RefreshVoices()
+{
+    catalog_.Refresh();
+}
+
+bool
+VoiceVoxService::GetCatalogStats(VoiceCatalogStats& out) const
+{
+    out = catalog_.Stats();
+    return true;
+}
+
+bool
+VoiceVoxService::StyleId(const VoiceInfo& voice, int& id)
+{
+    if (voice.engine != L"VOICEVOX") return false;
+    {
+        std::lock_guard<std::mutex> lk(stylesMtx_);
+        auto it = styles_.find(voice.displayName);
+        if (it != styles_.end()) {
+            id = it->second;
+            return true;
+        }
+        if (!styles_.empty()) return false;
+    }
+    // 一覧をスナップショットから読んだ直後は対応表が空なので、ここで一度だけ引く
+    EnumSpeakers();
+    std::lock_guard<std::mutex> lk(stylesMtx_);
+    auto it = styles_.find(voice.displayName);
+    if (it == styles_.end()) return false;
+    id = it->second;
+    return true;
+}
+
+HttpRequest
+VoiceVoxService::QueryRequest(int speaker, const std::wstring& text)
+{
+    HttpRequest r;
+    r.method = "POST";
+    // 休止は読点にする（audio_query が pause_mora を入れる）
+    const std::wstring plain = HasPauseMarks(text) ? PausesToText(text, L"、") : std::wstring();
+    r.target = "/audio_query?text=" + UrlEncode(ToUtf8(plain.empty() ? text : plain)) + "&speaker=" + std::to_string(speaker);
+    return r;
+}
+
+HttpRequest
+VoiceVoxService::SynthesisRequest(int speaker, const std::string& query)
+{
+    HttpRequest r;
+    r.method      = "POST";
+    r.target      = "/synthesis?speaker=" + std::to_string(speaker);
+    r.contentType = "application/json";
+    r.body        = query;
+    return r;
+}
+
+// 速度 0-100 を speedScale に、VoxProsody を各項目に反映
+bool
+VoiceVoxService::PatchQuery(const std::string& body, int speed, std::string& out)
+{
+    VoxProsody pr;
+    {
+        std::lock_guard<std::mutex> lk(qcMtx_);
+        pr = prosody_;
+    }
+    const VoxProsody def;
+    if (speed == 0 && pr.pitchScale == def.pitchScale && pr.intonationScale == def.intonationScale &&
+        pr.volumeScale == def.volumeScale) {
+        out = body;
+        return true;
+    }
+    JsonValue q;
+    if (!JsonValue::Parse(body, q) || !q.isObject()) return false;
+    if (speed != 0) q.Set("speedScale", JsonValue(static_cast<double>(NormalizeSpeed(speed))));
+    if (pr.pitchScale != def.pitchScale)           q.Set("pitchScale",      JsonValue(pr.pitchScale));
+    if (pr.intonationScale != def.intonationScale) q.Set("intonationScale", JsonValue(pr.intonationScale));
+    if (pr.volumeScale != def.volumeScale)         q.Set("volumeScale",     JsonValue(pr.volumeScale));
+    out = q.Dump();
+    return true;
+}
+
+void
+VoiceVoxService::SetProsody(const VoxProsody& prosody)
+{
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    prosody_ = prosody;
+}
+
+std::uint64_t
+VoiceVoxService::SynthesisFingerprint() const
+{
+    VoxProsody pr;
+    {
+        std::lock_guard<std::mutex> lk(qcMtx_);
+        pr = prosody_;
+    }
+    const VoxProsody def;
+    if (pr.pitchScale == def.pitchScale && pr.intonationScale == def.intonationScale &&
+        pr.volumeScale == def.volumeScale)
+        return 0;
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (double v : { pr.pitchScale, pr.intonationScale, pr.volumeScale }) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        h = (h ^ bits) * 0x100000001b3ull;
+    }
+    return h ? h : 1;
+}
+
+// -----------------------------------------------------------------------------
+// audio_query キャッシュ（バイト上限付き LRU）
+// -----------------------------------------------------------------------------
+void
+VoiceVoxService::SetQueryCacheBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    qcBudget_ = bytes;
+    while (qcBytes_ > qcBudget_ && !qcLru_.empty()) {
+        qcBytes_ -= qcLru_.back().first.size() + qcLru_.back().second.size();
+        qcIndex_.erase(qcLru_.back().first);
+        qcLru_.pop_back();
+    }
+}
+
+bool
+VoiceVoxService::CachedQuery(const std::string& key, std::string& raw)
+{
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    auto it = qcIndex_.find(key);
+    if (it == qcIndex_.end()) {
+        ++stats_.queryMisses;
+        return false;
+    }
+    qcLru_.splice(qcLru_.begin(), qcLru_, it->second);
+    raw = it->second->second;
+    ++stats_.queryHits;
+    return true;
+}
+
+void
+VoiceVoxService::StoreQuery(const std::string& key, const std::string& raw)
+{
+    const size_t bytes = key.size() + raw.size();
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    if (bytes > qcBudget_ || qcIndex_.count(key)) return;
+    qcLru_.emplace_front(key, raw);
+    qcIndex_.emplace(key, qcLru_.begin());
+    qcBytes_ += bytes;
+    while (qcBytes_ > qcBudget_) {
+        qcBytes_ -= qcLru_.back().first.size() + qcLru_.back().second.size();
+        qcIndex_.erase(qcLru_.back().first);
+        qcLru_.pop_back();
+    }
+}
+
+void
+VoiceVoxService::Queries(int speaker, const std::vector<const std::wstring*>& texts, std::vector<std::string>& raw)
+{
+    raw.assign(texts.size(), std::string());
+    std::vector<std::string> keys(texts.size());
+    std::vector<HttpRequest> reqs;
+    std::vector<size_t>      idx;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        keys[i] = QueryKey(speaker, *texts[i]);
+        if (CachedQuery(keys[i], raw[i])) continue;
+        reqs.push_back(QueryRequest(speaker, *texts[i]));
+        idx.push_back(i);
+    }
+    if (reqs.empty()) return;
+
+    std::vector<HttpResponse> res;
+    http_.SendPipelined(reqs, res);
+    for (size_t k = 0; k < idx.size() && k < res.size(); ++k) {
+        if (!res[k].ok()) continue;
+        StoreQuery(keys[idx[k]], res[k].body);
+        raw[idx[k]] = std::move(res[k].body);
+    }
+}
+
+VoiceVoxStats
+VoiceVoxService::GetStats() const
+{
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    VoiceVoxStats st = stats_;
+    st.queryEntries = qcLru_.size();
+    st.queryBytes   = qcBytes_;
+    return st;
+}
+
+bool
+VoiceVoxService::Synthesize(const VoiceInfo& voice, const std::wstring& text, int speed, AudioClip& out,
+                            const CancelToken& cancel)
+{
+    int speaker;
+    if (cancel.Cancelled() || !StyleId(voice, speaker)) return false;
+
+    std::vector<std::string> raw;
+    std::string query;
+    Queries(speaker, { &text }, raw);
+    if (raw[0].empty() || !PatchQuery(raw[0], speed, query)) return false;
+    if (cancel.Cancelled()) return false;                // 重い synthesis の前に打ち切る
+    HttpResponse res;
+    if (!http_.Send(SynthesisRequest(speaker, query), res) || !res.ok())
+        return false;
+    return ParseWav(reinterpret_cast<const uint8_t*>(res.body.data()), res.body.size(), out);
+}
+
+// -----------------------------------------------------------------------------
+// 一括合成
+// -----------------------------------------------------------------------------
+size_t
+VoiceVoxService::BatchSize() const
+{
+    return kMaxPipelineDepth;
+}
+
+bool
+VoiceVoxService::MultiSynthesis(int speaker, const std::vector<std::string>& queries,
+                                std::vector<std::shared_ptr<const AudioClip>>& out)
+{
+    HttpRequest r;
+    r.method      = "POST";
+    r.target      = "/multi_synthesis?speaker=" + std::to_string(speaker);
+    r.contentType = "application/json";
+    r.body        = "[";
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (i) r.body += ',';
+        r.body += queries[i];
+    }
+    r.body += ']';
+
+    HttpResponse res;
+    if (!http_.Send(r, res)) return false;
+    if (res.status == 404 || res.status == 405) multiOk_ = false;   // 古いエンジン
+    std::vector<std::string_view> files;
+    if (!res.ok() || !ReadStoredZip(res.body, files) || files.size() != queries.size()) return false;
+
+    out.assign(queries.size(), nullptr);
+    for (size_t i = 0; i < files.size(); ++i) {
+        auto clip = std::make_shared<AudioClip>();
+        if (ParseWav(reinterpret_cast<const uint8_t*>(files[i].data()), files[i].size(), *clip))
+            out[i] = std::move(clip);
+    }
+    std::lock_guard<std::mutex> lk(qcMtx_);
+    ++stats_.multiRequests;
+    stats_.multiLines += queries.size();
+    return true;
+}
+
+void
+VoiceVoxService::SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                                 std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel)
+{
+    out.assign(texts.size(), nullptr);
+    int speaker;
+    if (texts.empty() || cancel.Cancelled() || !StyleId(voice, speaker)) return;
+
+    std::vector<const std::wstring*> ptrs;
+    for (const auto& t : texts) ptrs.push_back(&t);
+    std::vector<std::string> raw;
+    Queries(speaker, ptrs, raw);
+
+    std::vector<std::string> queries;
+    std::vector<size_t>      idx;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::string q;
+        if (raw[i].empty() || !PatchQuery(raw[i], speed, q)) continue;
+        queries.push_back(std::move(q));
+        idx.push_back(i);
+    }
+    if (queries.empty() || cancel.Cancelled()) return;
+
+    std::vector<std::shared_ptr<const AudioClip>> clips;
+    if (queries.size() > 1 && multiOk_ && MultiSynthesis(speaker, queries, clips)) {
+        for (size_t k = 0; k < idx.size(); ++k) out[idx[k]] = std::move(clips[k]);
+        return;
+    }
+
+    // multi_synthesis が使えなければ synthesis をパイプラインで送る
+    std::vector<HttpRequest> reqs;
+    for (const auto& q : queries) reqs.push_back(SynthesisRequest(speaker, q));
+    std::vector<HttpResponse> res;
+    http_.SendPipelined(reqs, res);
+    for (size_t k = 0; k < idx.size() && k < res.size(); ++k) {
+        auto clip = std::make_shared<AudioClip>();
+        const auto& body = res[k].body;
+        if (res[k].ok() && ParseWav(reinterpret_cast<const uint8_t*>(body.data()), body.size(), *clip))
+            out[idx[k]] = std::move(clip);
+    }
+}
+
+bool
+VoiceVoxService::SpeakText(const VoiceInfo& voice,
+                           const std::wstring& text,
+                           int  speed,
+                           bool sync,
+                           bool overlap,
+                           std::function<void()> onFinish,
+                           const CancelToken& cancel)
+{
+    if (sync) {
+        auto clip = std::make_shared<AudioClip>();
+        if (!Synthesize(voice, text, speed, *clip, cancel)) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        return PlayAudio(clip, true, overlap, std::move(onFinish));
+    }
+
+    Job job;
+    if (!StyleId(voice, job.speaker)) {
+        if (onFinish) onFinish();
+        return false;
+    }
+    job.text     = text;
+    job.speed    = speed;
+    job.overlap  = overlap;
+    job.onFinish = std::move(onFinish);
+    job.cancel   = cancel;
+    {
+        std::lock_guard<std::mutex> lk(qMtx_);
+        queryQ_.push_back(std::move(job));
+    }
+    qCv_.notify_all();
+    return true;
+}
+
+void
+VoiceVoxService::Finish(Job& job)
+{
+    if (job.onFinish) {
+        auto f = std::move(job.onFinish);
+        job.onFinish = nullptr;
+        f();
+    }
+}
+
+// クエリ段：溜まっている行の audio_query をまとめてパイプライン送信
+void
+VoiceVoxService::QueryLoop()
+{
+    while (true) {
+        std::vector<Job> batch;
+        {
+            std::unique_lock<std::mutex> lk(qMtx_);
+            qCv_.wait(lk, [&] { return stop_ || !queryQ_.empty(); });
+            if (stop_) return;
+            while (!queryQ_.empty() && batch.size() < kMaxPipelineDepth) {
+                batch.push_back(std::move(queryQ_.front()));
+                queryQ_.pop_front();
+            }
+        }
+
+        // 取り消し済みの行は送らない。キャッシュにあるものも送らない
+        std::vector<HttpRequest> reqs;
+        std::vector<size_t>      idx;
+        std::vector<std::string> keys(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            auto& j = batch[i];
+            if (j.cancel.Cancelled()) continue;
+            std::string raw;
+            keys[i] = QueryKey(j.speaker, j.text);
+            if (CachedQuery(keys[i], raw)) {
+                j.ok = PatchQuery(raw, j.speed, j.query);
+                continue;
+            }
+            reqs.push_back(QueryRequest(j.speaker, j.text));
+            idx.push_back(i);
+        }
+        std::vector<HttpResponse> res;
+        http_.SendPipelined(reqs, res);
+        for (size_t k = 0; k < idx.size(); ++k) {
+            auto& j = batch[idx[k]];
+            j.ok = res[k].ok() && PatchQuery(res[k].body, j.speed, j.query);
+            if (res[k].ok()) StoreQuery(keys[idx[k]], res[k].body);
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(qMtx_);
+            for (auto& j : batch) synthQ_.push_back(std::move(j));
+        }
+        qCv_.notify_all();
+    }
+}
+
+// 合成段：クエリ済みの行をまとめて synthesis し、応答が届いた行から順に再生を開始
+void
+VoiceVoxService::SynthLoop()
+{
+    while (true) {
+        std::vector<Job> batch;
+        {
+            std::unique_lock<std::mutex> lk(qMtx_);
+            qCv_.wait(lk, [&] { return stop_ || !synthQ_.empty(); });
+            if (stop_) return;
+            while (!synthQ_.empty() && batch.size() < kMaxPipelineDepth) {
+                batch.push_back(std::move(synthQ_.front()));
+                synthQ_.pop_front();
+            }
+        }
+
+        std::vector<HttpRequest> reqs;
+        std::vector<size_t>      idx;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!batch[i].ok || batch[i].cancel.Cancelled()) continue;
+            reqs.push_back(SynthesisRequest(batch[i].speaker, batch[i].query));
+            idx.push_back(i);
+        }
+        // 先頭の行は後続の応答を待たずに鳴らす。送らなかった行は並び順の位置で終える
+        size_t next = 0;
+        auto play = [&](size_t k, HttpResponse& r) {
+            for (; next < idx[k]; ++next) Finish(batch[next]);
+            auto& j = batch[next++];
+            auto clip = std::make_shared<AudioClip>();
+            if (j.cancel.Cancelled() || !r.ok() ||
+                !ParseWav(reinterpret_cast<const uint8_t*>(r.body.data()), r.body.size(), *clip)) {
+                Finish(j);
+                return;
+            }
+            r.body = std::string();                      // WAV はもう要らない
+            PlayAudio(std::move(clip), false, j.overlap, std::move(j.onFinish));
+        };
+        std::vector<HttpResponse> res;
+        http_.SendPipelined(reqs, res, play);
+        for (; next < batch.size(); ++next) Finish(batch[next]);
+    }
+}
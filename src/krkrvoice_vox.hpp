@@ -0,0 +1,139 @@
+#pragma once
+#include "krkrvoice.hpp"
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_http.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace krkrvoice {
+
+struct VoiceVoxStats {
+    std::uint64_t queryHits     = 0;   // audio_query をキャッシュで済ませた行
+    std::uint64_t queryMisses   = 0;   // エンジンに audio_query を送った行
+    std::uint64_t queryEntries  = 0;
+    std::uint64_t queryBytes    = 0;
+    std::uint64_t multiRequests = 0;   // multi_synthesis の送信回数
+    std::uint64_t multiLines    = 0;   // それで合成した行数
+};
+
+// 合成時にクエリへ書き込む値（意味は audio_query の同名項目。既定値のままなら書き換えない）
+struct VoxProsody {
+    double pitchScale      = 0.0;
+    double intonationScale = 1.0;
+    double volumeScale     = 1.0;
+};
+
+// VOICEVOX エンジン（HTTP）を使うサービス
+//  - keep-alive 接続プール上で audio_query → synthesis を行う
+//  - 非同期発話は「クエリ段」「合成段」の 2 段パイプラインで処理し、
+//    次の行の audio_query を前の行の synthesis と並行して送る
+//  - audio_query の結果は (style id, 辞書適用後テキスト) でキャッシュし、速度・音高・抑揚の
+//    違いは synthesis 前にクエリを書き換えて済ませる（重いテキスト解析をやり直さない）
+//  - SynthesizeBatch は multi_synthesis で 1 リクエストにまとめる（未対応のエンジンなら個別に送る）
+class VoiceVoxService final : public ITTSService {
+public:
+    VoiceVoxService(const std::wstring& url, int port);
+    ~VoiceVoxService() override;
+
+    std::vector<VoiceInfo>
+    GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") override;
+
+    bool ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                      size_t idx, VoiceInfo& out) override;
+    bool FindVoice(VoiceHandle handle, VoiceInfo& out) override;
+    void RefreshVoices() override;
+    bool GetCatalogStats(VoiceCatalogStats& out) const override;
+    VoiceCatalog* Catalog() override { return &catalog_; }
+
+    bool SpeakText(const VoiceInfo& voice,
+                   const std::wstring& text,
+                   int  speed,
+                   bool sync,
+                   bool overlap,
+                   std::function<void()> onFinish = {},
+                   const CancelToken& cancel = {}) override;
+
+    bool CanSynthesize(const VoiceInfo&) const override { return true; }
+
+    // audio_query → synthesis を同期で行い PCM を得る
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text, int speed, AudioClip& out,
+                    const CancelToken& cancel = {}) override;
+
+    void SynthesizeBatch(const VoiceInfo& voice, const std::vector<std::wstring>& texts, int speed,
+                         std::vector<std::shared_ptr<const AudioClip>>& out, const CancelToken& cancel = {}) override;
+    size_t BatchSize() const override;
+
+    // 既定値以外の VoxProsody はキャッシュ・先読みのキーを分ける
+    void          SetProsody(const VoxProsody& prosody);
+    std::uint64_t SynthesisFingerprint() const override;
+    void          SetQueryCacheBudget(size_t bytes);
+
+    HttpClientStats GetHttpStats() const { return http_.Stats(); }
+    VoiceVoxStats   GetStats() const;
+
+private:
+    struct Job {
+        int                   speaker = 0;
+        std::wstring          text;
+        int                   speed   = 0;
+        bool                  overlap = false;
+        std::function<void()> onFinish;
+        CancelToken           cancel;
+        std::string           query;     // audio_query の結果（speedScale 反映済み）
+        bool                  ok = false;
+    };
+
+    std::vector<VoiceInfo> EnumSpeakers();
+    bool StyleId(const VoiceInfo& voice, int& id);
+
+    static HttpRequest QueryRequest(int speaker, const std::wstring& text);
+    static HttpRequest SynthesisRequest(int speaker, const std::string& query);
+    bool               PatchQuery(const std::string& body, int speed, std::string& out);
+
+    // audio_query キャッシュ（raw[i] が空なら失敗）。ミスした行はパイプラインでまとめて送る
+    void Queries(int speaker, const std::vector<const std::wstring*>& texts, std::vector<std::string>& raw);
+    bool CachedQuery(const std::string& key, std::string& raw);
+    void StoreQuery(const std::string& key, const std::string& raw);
+    bool MultiSynthesis(int speaker, const std::vector<std::string>& queries,
+                        std::vector<std::shared_ptr<const AudioClip>>& out);
+
+    void QueryLoop();
+    void SynthLoop();
+    static void Finish(Job& job);
+
+    HttpClient   http_;
+    VoiceCatalog catalog_;
+
+    std::mutex stylesMtx_;
+    std::unordered_map<std::wstring, int> styles_;   // displayName → style id
+
+    using QueryLru = std::list<std::pair<std::string, std::string>>;   // (キー, audio_query) 先頭が最新
+    mutable std::mutex qcMtx_;
+    size_t             qcBudget_ = 8u << 20;
+    size_t             qcBytes_  = 0;
+    QueryLru           qcLru_;
+    std::unordered_map<std::string, QueryLru::iterator> qcIndex_;
+    VoxProsody         prosody_;
+    VoiceVoxStats      stats_;
+    std::atomic_bool   multiOk_{ true };   // multi_synthesis が使えるか（404 なら以後使わない）
+
+    std::mutex              qMtx_;
+    std::condition_variable qCv_;
+    std::deque<Job>         queryQ_;
+    std::deque<Job>         synthQ_;
+    bool                    stop_ = false;
+    std::thread             queryThread_;
+    std::thread             synthThread_;
+};
+
+} // namespace krkrvoice
@@ -2,19 +2,28 @@
 // krkrvoice_win.cpp   ―  WinTTS (SAPI + WinRT) 実装
 // -----------------------------------------------------------------------------
 #include "krkrvoice_win.hpp"
+#include "krkrvoice_audio.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_markup.hpp"
+#include "krkrvoice_trace.hpp"
+#include "krkrvoice_synthpool.hpp"
 
 #include <windows.h>
+#include <psapi.h>
 #include <sapi.h>
 #include <sphelper.h>
 #include <atlbase.h>
 
 #include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <mutex>
 #include <atomic>
 #include <functional>
 #include <thread>
+#include <chrono>
 
 #include <winrt/base.h>
 #include <winrt/Windows.Foundation.Collections.h>
@@ -22,6 +31,7 @@
 #include <winrt/Windows.Media.SpeechSynthesis.h>
 #include <winrt/Windows.Media.Playback.h>
 #include <winrt/Windows.Media.Core.h>
+#include <winrt/Windows.Media.MediaProperties.h>
 
 using namespace krkrvoice;
 
@@ -31,15 +41,6 @@ using namespace krkrvoice;
 namespace {
 
 std::mutex g_mutex;
-winrt::Windows::Media::Playback::MediaPlayer g_singlePlayer{ nullptr };   // 上書き用
-std::vector<winrt::Windows::Media::Playback::MediaPlayer> g_players;      // 重ね再生保持
-
-// 速度 0–100 → 0.5×–2.0×
-static float NormalizeSpeed(int s)
-{
-    s = std::clamp(s, 0, 100);
-    return s == 0 ? 1.0f : (0.5f + (s - 1) * (1.5f / 99.0f));
-}
 
 // 文字列 LCID → BCP-47
 static std::wstring LocaleNameToHexLCID(std::wstring_view name)
@@ -110,6 +111,54 @@ static void EnumSapiVoices(std::vector<VoiceInfo>& out,
     }
 }
 
+// 表示名から SAPI トークンを探す
+static CComPtr<ISpObjectToken> FindSapiToken(const std::wstring& displayName)
+{
+    CComPtr<IEnumSpObjectTokens> en;
+    SpEnumTokens(SPCAT_VOICES, nullptr, nullptr, &en);
+    if (!en) return nullptr;
+
+    ULONG f = 0;
+    while (true) {
+        CComPtr<ISpObjectToken> tok;
+        if (en->Next(1, &tok, &f) != S_OK || !tok) break;
+        WCHAR* desc = nullptr; SpGetDescription(tok, &desc);
+        bool hit = desc && displayName == desc;
+        ::CoTaskMemFree(desc);
+        if (hit) return tok;
+    }
+    return nullptr;
+}
+
+// 表示名から SAPI トークン ID を探す（ID からの再取得は列挙より軽い）
+static std::wstring FindSapiTokenId(const std::wstring& displayName)
+{
+    auto tok = FindSapiToken(displayName);
+    if (!tok) return L"";
+    WCHAR* id = nullptr;
+    if (FAILED(tok->GetId(&id)) || !id) return L"";
+    std::wstring out = id;
+    ::CoTaskMemFree(id);
+    return out;
+}
+
+// プールする合成器
+struct SapiSynth final : SynthInstance {
+    CComPtr<ISpVoice> sp;
+};
+
+struct WinRTSynth final : SynthInstance {
+    winrt::Windows::Media::SpeechSynthesis::SpeechSynthesizer sy;   // アジャイル
+};
+
+// OS の低メモリ通知（待機中の合成器を手放す目安）
+static bool LowMemory()
+{
+    static HANDLE h = ::CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    BOOL low = FALSE;
+    return h && ::QueryMemoryResourceNotification(h, &low) && low;
+}
+
 // WinRT 音声列挙
 static void EnumWinRTVoices(std::vector<VoiceInfo>& out,
                             const std::wstring& langF,
@@ -130,18 +179,539 @@ static void EnumWinRTVoices(std::vector<VoiceInfo>& out,
     }
 }
 
+// 音声カタログの指紋：音声トークンのレジストリキーのサブキー数と最終更新時刻、UI 言語
+//  音声の追加・削除でキーが書き換わる。トークンを開いて属性を読む列挙よりずっと軽い
+static std::string VoiceRegistryFingerprint()
+{
+    static const struct { HKEY root; const wchar_t* path; } kKeys[] = {
+        { HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Speech\\Voices\\Tokens" },
+        { HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Speech_OneCore\\Voices\\Tokens" },
+        { HKEY_CURRENT_USER,  L"SOFTWARE\\Microsoft\\Speech\\Voices\\Tokens" },
+    };
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "win1;ui=%04x;", static_cast<unsigned>(::GetUserDefaultUILanguage()));
+    std::string fp = buf;
+    for (const auto& k : kKeys) {
+        HKEY h = nullptr;
+        DWORD subkeys = 0;
+        FILETIME ft{};
+        if (::RegOpenKeyExW(k.root, k.path, 0, KEY_READ, &h) == ERROR_SUCCESS) {
+            ::RegQueryInfoKeyW(h, nullptr, nullptr, nullptr, &subkeys, nullptr, nullptr,
+                               nullptr, nullptr, nullptr, nullptr, &ft);
+            ::RegCloseKey(h);
+        }
+        std::snprintf(buf, sizeof(buf), "%lu:%08lx%08lx;", static_cast<unsigned long>(subkeys),
+                      static_cast<unsigned long>(ft.dwHighDateTime), static_cast<unsigned long>(ft.dwLowDateTime));
+        fp += buf;
+    }
+    return fp;
+}
+
+// プレイヤーに渡した音声（WAV）の分。メモリ予算の Playback として数える
+static MemoryAccount& PlayerMemory()
+{
+    static MemoryAccount account{ MemoryClass::Playback };
+    return account;
+}
+
+// 1 回の再生の完了状態。MediaEnded / MediaFailed / 上書き停止のいずれかで 1 度だけ終わる
+struct PlayState {
+    Completion            done;
+    std::function<void()> onFinish;
+    size_t                bytes = 0;   // PlayerMemory に確保した量
+    std::atomic_bool      claimed{ false };
+    winrt::Windows::Media::Playback::MediaPlayer::MediaEnded_revoker  endedRev;
+    winrt::Windows::Media::Playback::MediaPlayer::MediaFailed_revoker failedRev;
+
+    void Finish()
+    {
+        if (claimed.exchange(true)) return;
+        PlayerMemory().Release(bytes);
+        if (onFinish) onFinish();
+        done.Signal();
+    }
+};
+
+// 出力プレイヤープール（g_mutex で保護）
+//  再生中のプレイヤーは g_active、終わったものは g_idle に戻して次の再生で使い回す
+struct ActiveVoice {
+    winrt::Windows::Media::Playback::MediaPlayer player{ nullptr };
+    std::shared_ptr<PlayState>                   state;
+    uint64_t                                     seq    = 0;       // 開始順
+    bool                                         single = false;   // overlap=false の再生
+};
+
+std::vector<ActiveVoice>                                  g_active;
+std::vector<winrt::Windows::Media::Playback::MediaPlayer> g_idle;
+size_t           g_maxPolyphony = 16;
+VoiceStealPolicy g_stealPolicy  = VoiceStealPolicy::Oldest;
+uint64_t         g_voiceSeq     = 0;
+PlayerPoolStats  g_poolStats;
+
+// g_active[i] を止めてプレイヤーをプールに戻す。完了通知は呼び出し側がロック外で行う
+static std::shared_ptr<PlayState> ReleaseVoice(size_t i)
+{
+    ActiveVoice v = std::move(g_active[i]);
+    g_active.erase(g_active.begin() + i);
+    v.state->endedRev.revoke();
+    v.state->failedRev.revoke();
+    v.player.Source(nullptr);
+    if (g_idle.size() < g_maxPolyphony) g_idle.push_back(std::move(v.player));
+    return v.state;
+}
+
+static winrt::Windows::Media::Playback::MediaPlayer AcquirePlayer()
+{
+    if (!g_idle.empty()) {
+        auto pl = std::move(g_idle.back());
+        g_idle.pop_back();
+        ++g_poolStats.reused;
+        return pl;
+    }
+    ++g_poolStats.created;
+    return winrt::Windows::Media::Playback::MediaPlayer();
+}
+
+// MediaSource をプールのプレイヤーで再生（overlap=false は前の overlap=false 再生を上書き）
+//  完了はプレイヤーのイベントで通知し、sync はそれを待つだけ（ポーリングしない）
+//  bytes はソースが抱える音声の量（再生が終わるまでメモリ予算に数える）
+static bool PlaySource(winrt::Windows::Media::Core::MediaSource const& source,
+                       float rate,
+                       bool  sync,
+                       bool  overlap,
+                       std::function<void()> onFinish,
+                       size_t bytes = 0)
+{
+    namespace WP  = winrt::Windows::Media::Playback;
+
+    auto state = std::make_shared<PlayState>();
+    state->onFinish = std::move(onFinish);
+    state->bytes    = bytes;
+    PlayerMemory().Reserve(bytes, true);
+    std::vector<std::shared_ptr<PlayState>> stopped;   // 上書き・横取りで止めた再生
+    bool rejected = false;
+
+    {   // クリティカル領域
+        StageTimer t(TraceStage::PlayerStart);
+        std::lock_guard<std::mutex> lk(g_mutex);
+
+        if (!overlap) {
+            for (size_t i = 0; i < g_active.size(); ++i)
+                if (g_active[i].single) { stopped.push_back(ReleaseVoice(i)); break; }
+        }
+        if (g_active.size() >= g_maxPolyphony) {
+            if (g_stealPolicy == VoiceStealPolicy::Reject) {
+                ++g_poolStats.rejected;
+                rejected = true;
+            } else {
+                auto oldest = std::min_element(g_active.begin(), g_active.end(),
+                    [](const auto& a, const auto& b) { return a.seq < b.seq; });
+                stopped.push_back(ReleaseVoice(static_cast<size_t>(oldest - g_active.begin())));
+                ++g_poolStats.stolen;
+            }
+        }
+
+        if (!rejected) {
+            WP::MediaPlayer pl = AcquirePlayer();
+
+            auto onEnd = [state] {
+                {
+                    std::lock_guard<std::mutex> lk(g_mutex);
+                    for (size_t i = 0; i < g_active.size(); ++i)
+                        if (g_active[i].state == state) { ReleaseVoice(i); break; }
+                }
+                state->Finish();
+            };
+            state->endedRev  = pl.MediaEnded(winrt::auto_revoke, [onEnd](auto&&, auto&&) { onEnd(); });
+            state->failedRev = pl.MediaFailed(winrt::auto_revoke, [onEnd](auto&&, auto&&) { onEnd(); });
+
+            pl.Source(source);
+            pl.PlaybackSession().PlaybackRate(rate);
+            pl.Play();
+
+            g_active.push_back(ActiveVoice{ pl, state, ++g_voiceSeq, !overlap });
+            g_poolStats.peakActive = std::max<uint64_t>(g_poolStats.peakActive, g_active.size());
+        }
+    }
+
+    for (auto& s : stopped) s->Finish();
+    if (rejected) {
+        state->Finish();
+        return false;
+    }
+    if (sync) state->done.Wait();
+    return true;
+}
+
+// 合成済み WAV ストリームを再生
+static bool PlayStream(winrt::Windows::Storage::Streams::IRandomAccessStream const& stream,
+                       float rate,
+                       bool  sync,
+                       bool  overlap,
+                       std::function<void()> onFinish)
+{
+    namespace WC = winrt::Windows::Media::Core;
+    WC::MediaSource source{ nullptr };
+    {
+        StageTimer t(TraceStage::StreamCreate);
+        source = WC::MediaSource::CreateFromStream(stream, L"audio/wav");
+    }
+    return PlaySource(source, rate, sync, overlap, std::move(onFinish), static_cast<size_t>(stream.Size()));
+}
+
+// SAPI 非同期発話の完了ディスパッチャ
+//  各 ISpVoice の通知イベントを EventDispatcher の 1 本のスレッドで待ち、
+//  SPEI_END_INPUT_STREAM を受けたら完了コールバックを呼ぶ
+class SapiNotifier {
+public:
+    static SapiNotifier& Instance()
+    {
+        // DLL 解放時の join を避けるため意図的に破棄しない
+        static SapiNotifier* inst = new SapiNotifier();
+        return *inst;
+    }
+
+    // Speak(SPF_ASYNC) 前に呼ぶ。通知を受けられなければ 0
+    std::uint64_t Watch(CComPtr<ISpVoice> sp, std::function<void()> onDone)
+    {
+        if (FAILED(sp->SetInterest(SPFEI(SPEI_END_INPUT_STREAM), SPFEI(SPEI_END_INPUT_STREAM))) ||
+            FAILED(sp->SetNotifyWin32Event()))
+            return 0;
+        HANDLE ev = sp->GetNotifyEventHandle();
+        if (!ev || ev == INVALID_HANDLE_VALUE) return 0;
+        // ハンドルは sp の持ち物なので、外れるまで sp を離さない
+        return dispatcher_.Watch(ev, [sp] {
+            bool     ended = false;
+            CSpEvent e;
+            while (e.GetFrom(sp) == S_OK)
+                if (e.eEventId == SPEI_END_INPUT_STREAM) ended = true;
+            return ended;
+        }, std::move(onDone));
+    }
+
+    // Speak が失敗したときに外す（true なら onDone は呼ばれない）
+    bool Unwatch(std::uint64_t id) { return dispatcher_.Unwatch(id); }
+
+private:
+    SapiNotifier() = default;
+
+    EventDispatcher dispatcher_;
+};
+
+// 合成完了を待つ。取り消されたら非同期操作ごと止めて nullptr
+constexpr DWORD kCancelCheckMs = 20;
+
+template <class Op>
+static auto WaitCancellable(Op const& op, const CancelToken& cancel) -> decltype(op.get())
+{
+    namespace WF = winrt::Windows::Foundation;
+    while (op.wait_for(std::chrono::milliseconds(kCancelCheckMs)) == WF::AsyncStatus::Started) {
+        if (cancel.Cancelled()) {
+            op.Cancel();
+            return nullptr;
+        }
+    }
+    if (op.Status() != WF::AsyncStatus::Completed) return nullptr;
+    return op.GetResults();
+}
+
+// WinRT の合成結果ストリームを読み切る
+static std::vector<uint8_t>
+ReadAllBytes(winrt::Windows::Storage::Streams::IRandomAccessStream const& stream)
+{
+    namespace WS = winrt::Windows::Storage::Streams;
+    auto size = static_cast<uint32_t>(stream.Size());
+    std::vector<uint8_t> buf(size);
+    WS::DataReader rd(stream.GetInputStreamAt(0));
+    rd.LoadAsync(size).get();
+    rd.ReadBytes(buf);
+    return buf;
+}
+
+// -----------------------------------------------------------------------------
+// 休止記号（シナリオタグ由来）をエンジンの休止指定にする
+//  SAPI は XML の <silence>、WinRT は SSML の <break>。含まなければ平文のまま渡す
+// -----------------------------------------------------------------------------
+static void AppendXmlEscaped(std::wstring& out, std::wstring_view s)
+{
+    for (wchar_t c : s) {
+        switch (c) {
+        case L'&':  out += L"&amp;";  break;
+        case L'<':  out += L"&lt;";   break;
+        case L'>':  out += L"&gt;";   break;
+        case L'"':  out += L"&quot;"; break;
+        case L'\'': out += L"&apos;"; break;
+        default:    out += c;         break;
+        }
+    }
+}
+
+static HRESULT SapiSpeak(ISpVoice* sp, const std::wstring& text, DWORD flags)
+{
+    if (!HasPauseMarks(text)) return sp->Speak(text.c_str(), flags, nullptr);
+    std::wstring xml;
+    ForEachPause(text,
+                 [&](std::wstring_view s) { AppendXmlEscaped(xml, s); },
+                 [&](int ms) { xml += L"<silence msec=\"" + std::to_wstring(ms) + L"\"/>"; });
+    return sp->Speak(xml.c_str(), flags | SPF_IS_XML, nullptr);
+}
+
+static winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Media::SpeechSynthesis::SpeechSynthesisStream>
+WinRTSynthesize(winrt::Windows::Media::SpeechSynthesis::SpeechSynthesizer const& sy,
+                const std::wstring& text, const std::wstring& lang)
+{
+    if (!HasPauseMarks(text)) return sy.SynthesizeTextToStreamAsync(text);
+    std::wstring ssml = L"<speak version='1.0' xmlns='http://www.w3.org/2001/10/synthesis' xml:lang='" +
+                        lang + L"'>";
+    ForEachPause(text,
+                 [&](std::wstring_view s) { AppendXmlEscaped(ssml, s); },
+                 [&](int ms) { ssml += L"<break time='" + std::to_wstring(ms) + L"ms'/>"; });
+    ssml += L"</speak>";
+    return sy.SynthesizeSsmlToStreamAsync(ssml);
+}
+
 } // unnamed namespace
 
+// -----------------------------------------------------------------------------
+// 出力プレイヤープール
+// -----------------------------------------------------------------------------
+void
+krkrvoice::SetPlayerPoolLimits(size_t maxPolyphony, VoiceStealPolicy policy)
+{
+    std::lock_guard<std::mutex> lk(g_mutex);
+    g_maxPolyphony = std::max<size_t>(maxPolyphony, 1);
+    g_stealPolicy  = policy;
+    if (g_idle.size() > g_maxPolyphony) g_idle.resize(g_maxPolyphony);
+}
+
+PlayerPoolStats
+krkrvoice::GetPlayerPoolStats()
+{
+    PlayerPoolStats st;
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        st        = g_poolStats;
+        st.active = g_active.size();
+        st.idle   = g_idle.size();
+    }
+    PROCESS_MEMORY_COUNTERS pmc{};
+    pmc.cb = sizeof(pmc);
+    if (::GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof(pmc)))
+        st.peakWorkingSet = pmc.PeakWorkingSetSize;
+    return st;
+}
+
+// -----------------------------------------------------------------------------
+// 合成済み PCM の再生
+// -----------------------------------------------------------------------------
+bool
+krkrvoice::PlayAudioClip(std::shared_ptr<const AudioClip> clip,
+                         bool sync,
+                         bool overlap,
+                         std::function<void()> onFinish)
+{
+    namespace WC = winrt::Windows::Media::Core;
+    namespace WS = winrt::Windows::Storage::Streams;
+    if (!clip) {
+        if (onFinish) onFinish();
+        return false;
+    }
+
+    WC::MediaSource source{ nullptr };
+    size_t          bytes = 0;
+    {
+        StageTimer t(TraceStage::StreamCreate);
+        auto wav = EncodeWav(*clip);
+        bytes    = wav.size();
+        WS::InMemoryRandomAccessStream stream;
+        WS::DataWriter writer(stream);
+        writer.WriteBytes(winrt::array_view<const uint8_t>(wav.data(), wav.data() + wav.size()));
+        writer.StoreAsync().get();
+        writer.DetachStream();
+        stream.Seek(0);
+        source = WC::MediaSource::CreateFromStream(stream, L"audio/wav");
+    }
+    return PlaySource(source, 1.0f, sync, overlap, std::move(onFinish), bytes);
+}
+
+// 逐次追加される PCM を MediaStreamSource で再生
+//  SampleRequested は Media Foundation のスレッドで呼ばれるので待たない。溜まっている分を返し、
+//  空なら短い無音でつなぐ（合成待ちの途切れや、開いたままのミキサー出力の待機中）。終端で null サンプルを返す
+bool
+krkrvoice::PlayPcmStream(std::shared_ptr<PcmStream> stream,
+                         bool sync,
+                         bool overlap,
+                         std::function<void()> onFinish)
+{
+    namespace WC = winrt::Windows::Media::Core;
+    namespace WM = winrt::Windows::Media::MediaProperties;
+    namespace WS = winrt::Windows::Storage::Streams;
+    namespace WF = winrt::Windows::Foundation;
+    if (!stream) {
+        if (onFinish) onFinish();
+        return false;
+    }
+
+    StageTimer create(TraceStage::StreamCreate);
+    const uint32_t rate = static_cast<uint32_t>(stream->SampleRate());
+    const uint32_t ch   = static_cast<uint32_t>(stream->Channels());
+    WC::AudioStreamDescriptor desc(WM::AudioEncodingProperties::CreatePcm(rate, ch, 16));
+    WC::MediaStreamSource src(desc);
+    src.CanSeek(false);
+    src.BufferTime(WF::TimeSpan{ 0 });
+
+    const size_t chunk   = rate * ch / 50;               // 20ms 単位で供給
+    const size_t silence = rate / 100 * ch;              // 空のときは 10ms の無音
+    auto pos = std::make_shared<int64_t>(0);             // 100ns 単位
+    src.SampleRequested([stream, chunk, silence, rate, ch, pos](WC::MediaStreamSource const&,
+                                                                WC::MediaStreamSourceSampleRequestedEventArgs const& args) {
+        std::vector<int16_t> tmp(chunk);
+        size_t n = stream->Read(tmp.data(), tmp.size(), std::chrono::milliseconds(0));
+        if (n == 0) {
+            if (stream->Finished()) return;              // 終端：Sample 未設定で EOS
+            n = silence;                                 // tmp は 0 のまま
+        }
+
+        WS::Buffer buf(static_cast<uint32_t>(n * sizeof(int16_t)));
+        std::memcpy(buf.data(), tmp.data(), n * sizeof(int16_t));
+        buf.Length(static_cast<uint32_t>(n * sizeof(int16_t)));
+        auto sample = WC::MediaStreamSample::CreateFromBuffer(buf, WF::TimeSpan{ *pos });
+        int64_t dur = static_cast<int64_t>(n / ch) * 10000000 / rate;
+        sample.Duration(WF::TimeSpan{ dur });
+        *pos += dur;
+        args.Request().Sample(sample);
+    });
+
+    auto source = WC::MediaSource::CreateFromMediaStreamSource(src);
+    create.Stop();
+    return PlaySource(source, 1.0f, sync, overlap,
+                      [stream, onFinish = std::move(onFinish)] {
+                          stream->Cancel();              // 上書き停止時は生産側も止める
+                          if (onFinish) onFinish();
+                      });
+}
+
 // -----------------------------------------------------------------------------
 // WinTTSService 実装
 // -----------------------------------------------------------------------------
+WinTTSService::WinTTSService()
+    : catalog_([] {
+          // スナップショットの確認で裏のスレッドからも呼ばれる
+          HRESULT hr = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+          std::vector<VoiceInfo> v;
+          EnumSapiVoices(v, L"", L"");
+          EnumWinRTVoices(v, L"", L"");
+          if (SUCCEEDED(hr)) ::CoUninitialize();
+          return v;
+      },
+      VoiceRegistryFingerprint),
+      pool_([this](const VoiceInfo& v, bool warm) { return CreateSynth(v, warm); })
+{
+    pool_.SetPressureProbe(LowMemory);
+}
+
 std::vector<VoiceInfo>
 WinTTSService::GetVoiceList(const std::wstring& lang, const std::wstring& gen)
 {
-    std::vector<VoiceInfo> v;
-    EnumSapiVoices(v, lang, gen);
-    EnumWinRTVoices(v, lang, gen);
-    return v;
+    return catalog_.List(lang, gen);
+}
+
+bool
+WinTTSService::ResolveVoice(const std::wstring& lang, const std::wstring& gen,
+                            size_t idx, VoiceInfo& out)
+{
+    return catalog_.Resolve(lang, gen, idx, out);
+}
+
+bool
+WinTTSService::FindVoice(VoiceHandle handle, VoiceInfo& out)
+{
+    return catalog_.Find(handle, out);
+}
+
+void
+WinTTSService::RefreshVoices()
+{
+    catalog_.Refresh();
+    {
+        std::lock_guard<std::mutex> lk(boundMtx_);
+        bound_.clear();
+    }
+    pool_.Trim(true);   // 旧い結び付けで作った合成器も捨てる
+}
+
+struct WinTTSService::BoundVoice {
+    std::wstring sapiTokenId;                                                  // SAPI
+    winrt::Windows::Media::SpeechSynthesis::VoiceInformation winrt{ nullptr }; // WinRT（アジャイル）
+};
+
+std::shared_ptr<const WinTTSService::BoundVoice>
+WinTTSService::Bind(const VoiceInfo& voice)
+{
+    if (voice.handle != kInvalidVoiceHandle) {
+        std::lock_guard<std::mutex> lk(boundMtx_);
+        if (auto it = bound_.find(voice.handle); it != bound_.end()) return it->second;
+    }
+
+    // 初回のみ走査する（ロック外。競合しても結果は同じ）
+    auto b = std::make_shared<BoundVoice>();
+    if (voice.engine == L"SAPI") {
+        b->sapiTokenId = FindSapiTokenId(voice.displayName);
+    } else if (voice.engine == L"WinRT") {
+        namespace SS = winrt::Windows::Media::SpeechSynthesis;
+        for (auto const& vi : SS::SpeechSynthesizer::AllVoices())
+            if (vi.DisplayName() == voice.displayName &&
+                vi.Language()   == voice.lang) { b->winrt = vi; break; }
+    }
+    if (voice.handle != kInvalidVoiceHandle) {
+        std::lock_guard<std::mutex> lk(boundMtx_);
+        bound_.emplace(voice.handle, b);
+    }
+    return b;
+}
+
+std::unique_ptr<SynthInstance>
+WinTTSService::CreateSynth(const VoiceInfo& voice, bool warm)
+{
+    auto bound = Bind(voice);
+    if (voice.engine == L"SAPI") {
+        auto s = std::make_unique<SapiSynth>();
+        if (FAILED(s->sp.CoCreateInstance(CLSID_SpVoice))) return nullptr;
+        CComPtr<ISpObjectToken> tok;
+        if (!bound->sapiTokenId.empty() && SUCCEEDED(SpGetTokenFromId(bound->sapiTokenId.c_str(), &tok)))
+            s->sp->SetVoice(tok);
+        if (warm) {                                  // 無音を 1 回読ませてエンジンを読み込ませる
+            CComPtr<IStream> mem;
+            CComPtr<ISpStream> sps;
+            CSpStreamFormat fmt;
+            fmt.AssignFormat(SPSF_24kHz16BitMono);
+            if (SUCCEEDED(::CreateStreamOnHGlobal(nullptr, TRUE, &mem)) &&
+                SUCCEEDED(sps.CoCreateInstance(CLSID_SpStream)) &&
+                SUCCEEDED(sps->SetBaseStream(mem, SPDFID_WaveFormatEx, fmt.WaveFormatExPtr())) &&
+                SUCCEEDED(s->sp->SetOutput(sps, TRUE)))
+                s->sp->Speak(L"<silence msec=\"1\"/>", SPF_IS_XML, nullptr);
+            s->sp->SetOutput(nullptr, TRUE);
+        }
+        return s;
+    }
+    if (voice.engine == L"WinRT") {
+        auto s = std::make_unique<WinRTSynth>();
+        if (bound->winrt) s->sy.Voice(bound->winrt);
+        if (warm) {
+            std::wstring ssml = L"<speak version='1.0' xmlns='http://www.w3.org/2001/10/synthesis' xml:lang='" +
+                                voice.lang + L"'><break time='1ms'/></speak>";
+            try { s->sy.SynthesizeSsmlToStreamAsync(ssml).get(); } catch (...) {}
+        }
+        return s;
+    }
+    return nullptr;
+}
+
+bool
+WinTTSService::GetCatalogStats(VoiceCatalogStats& out) const
+{
+    out = catalog_.Stats();
+    return true;
 }
 
 bool
@@ -150,31 +720,45 @@ WinTTSService::SpeakText(const VoiceInfo& voice,
                          int  speed,
                          bool sync,
                          bool overlap,
-                         std::function<void()> onFinish)
+                         std::function<void()> onFinish,
+                         const CancelToken& cancel)
 {
     float rate = NormalizeSpeed(speed);
+    if (cancel.Cancelled()) {
+        if (onFinish) onFinish();
+        return false;
+    }
 
     //--------------------------- SAPI ----------------------------------
     if (voice.engine == L"SAPI") {
-        CComPtr<ISpVoice> sp; sp.CoCreateInstance(CLSID_SpVoice);
+        auto lease = pool_.Acquire(voice);
+        if (!lease) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        CComPtr<ISpVoice> sp = lease.As<SapiSynth>()->sp;
+        sp->SetOutput(nullptr, TRUE);                // Synthesize で付けたメモリ出力を外す
         sp->SetRate(static_cast<long>((rate - 1.0f) * 10));
 
         if (sync) {                                  // 同期
-            HRESULT hr = sp->Speak(text.c_str(), SPF_DEFAULT, nullptr);
+            HRESULT hr = SapiSpeak(sp, text, SPF_DEFAULT);
             if (onFinish) onFinish();
             return SUCCEEDED(hr);
         }
 
-        // 非同期
-        sp->Speak(text.c_str(), SPF_ASYNC, nullptr);
-
-        if (onFinish) {
-            std::thread([sp, onFinish] {
-                SPVOICESTATUS st{};
-                do { sp->GetStatus(&st, nullptr); ::Sleep(40); }
-                while (st.dwRunningState != SPRS_DONE);
-                onFinish();
-            }).detach();
+        // 非同期：完了は SapiNotifier がイベントで通知する（sp と貸し出しもそこで保持）
+        auto held = std::make_shared<SynthesizerPool::Lease>(std::move(lease));
+        auto& notifier = SapiNotifier::Instance();
+        const auto watch = notifier.Watch(sp, [held, onFinish] { if (onFinish) onFinish(); });
+        if (!watch) {
+            HRESULT hr = SapiSpeak(sp, text, SPF_DEFAULT);
+            if (onFinish) onFinish();
+            return SUCCEEDED(hr);
+        }
+        if (FAILED(SapiSpeak(sp, text, SPF_ASYNC))) {
+            // 完了イベントは来ないので登録を外し、ここで一度だけ通知する
+            if (notifier.Unwatch(watch) && onFinish) onFinish();
+            return false;
         }
         return true;
     }
@@ -182,46 +766,91 @@ WinTTSService::SpeakText(const VoiceInfo& voice,
     //--------------------------- WinRT ---------------------------------
     if (voice.engine == L"WinRT") {
         namespace SS  = winrt::Windows::Media::SpeechSynthesis;
-        namespace WP  = winrt::Windows::Media::Playback;
-        namespace WC  = winrt::Windows::Media::Core;
-
-        SS::SpeechSynthesizer sy;
-        for (auto const& vi : sy.AllVoices())
-            if (vi.DisplayName() == voice.displayName &&
-                vi.Language()   == voice.lang) { sy.Voice(vi); break; }
 
-        auto stream = sy.SynthesizeTextToStreamAsync(text).get();
-        WP::MediaPlayer pl = overlap ? WP::MediaPlayer() : g_singlePlayer;
+        auto lease = pool_.Acquire(voice);
+        if (!lease) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        auto& sy = lease.As<WinRTSynth>()->sy;
+        sy.Options().SpeakingRate(1.0);                 // 速度は再生レートで付ける
+
+        StageTimer synth(TraceStage::Synthesis);
+        auto stream = WaitCancellable(WinRTSynthesize(sy, text, voice.lang), cancel);
+        synth.Stop();
+        lease = {};
+        if (!stream) {
+            if (onFinish) onFinish();
+            return false;
+        }
+        return PlayStream(stream, rate, sync, overlap, std::move(onFinish));
+    }
 
-        std::atomic_bool ended{ false };
+    if (onFinish) onFinish();                        // 未知のエンジン
+    return false;
+}
+bool
+WinTTSService::Synthesize(const VoiceInfo& voice,
+                          const std::wstring& text,
+                          int  speed,
+                          AudioClip& out,
+                          const CancelToken& cancel)
+{
+    float rate = NormalizeSpeed(speed);
 
-        {   // クリティカル領域
-            std::lock_guard<std::mutex> lk(g_mutex);
+    //--------------------------- SAPI ----------------------------------
+    if (voice.engine == L"SAPI") {
+        auto lease = pool_.Acquire(voice);
+        if (!lease) return false;
+        CComPtr<ISpVoice> sp = lease.As<SapiSynth>()->sp;
+        sp->SetRate(static_cast<long>((rate - 1.0f) * 10));
 
-            if (!overlap) {
-                if (!pl) pl = g_singlePlayer = WP::MediaPlayer();
-                pl.Source(nullptr);                       // 旧再生停止
-            } else {
-                g_players.emplace_back(pl);               // 保持して破棄防止
+        // 24kHz/16bit/mono の生 PCM をメモリストリームへ出力
+        CSpStreamFormat fmt;
+        fmt.AssignFormat(SPSF_24kHz16BitMono);
+        CComPtr<IStream> mem;
+        if (FAILED(::CreateStreamOnHGlobal(nullptr, TRUE, &mem))) return false;
+        CComPtr<ISpStream> sps; sps.CoCreateInstance(CLSID_SpStream);
+        if (!sps || FAILED(sps->SetBaseStream(mem, SPDFID_WaveFormatEx, fmt.WaveFormatExPtr())))
+            return false;
+        sp->SetOutput(sps, TRUE);
+        if (FAILED(SapiSpeak(sp, text, SPF_ASYNC))) return false;
+        while (sp->WaitUntilDone(kCancelCheckMs) == S_FALSE) {
+            if (cancel.Cancelled()) {                // 合成途中でも打ち切る
+                sp->Speak(nullptr, SPF_PURGEBEFORESPEAK, nullptr);
+                return false;
             }
+        }
 
-            pl.Source(WC::MediaSource::CreateFromStream(stream, L"audio/wav"));
-            pl.PlaybackSession().PlaybackRate(rate);
+        STATSTG st{};
+        HGLOBAL h = nullptr;
+        if (FAILED(mem->Stat(&st, STATFLAG_NONAME)) || FAILED(::GetHGlobalFromStream(mem, &h)))
+            return false;
+        size_t bytes = static_cast<size_t>(st.cbSize.QuadPart);
+        out.sampleRate = 24000;
+        out.channels   = 1;
+        out.samples.resize(bytes / sizeof(int16_t));
+        if (auto p = ::GlobalLock(h)) {
+            std::memcpy(out.samples.data(), p, out.Bytes());
+            ::GlobalUnlock(h);
+        }
+        return true;
+    }
 
-            pl.PlaybackSession().PlaybackStateChanged(
-                [pl, &ended, onFinish](auto&&, auto&&) {
-                    auto st = pl.PlaybackSession().PlaybackState();
-                    if (st == WP::MediaPlaybackState::Paused || st == WP::MediaPlaybackState::None) {
-                        if (!ended.exchange(true) && onFinish) onFinish();
-                    }
-                });
+    //--------------------------- WinRT ---------------------------------
+    if (voice.engine == L"WinRT") {
+        namespace SS  = winrt::Windows::Media::SpeechSynthesis;
 
-            pl.Play();
-        }
+        auto lease = pool_.Acquire(voice);
+        if (!lease) return false;
+        auto& sy = lease.As<WinRTSynth>()->sy;
+        sy.Options().SpeakingRate(rate);                // 再生レートではなく合成側で速度を反映
 
-        if (sync) while (!ended.load()) ::Sleep(40);
-        return true;
+        auto stream = WaitCancellable(WinRTSynthesize(sy, text, voice.lang), cancel);
+        if (!stream) return false;
+        auto wav    = ReadAllBytes(stream);
+        return ParseWav(wav.data(), wav.size(), out);
     }
 
     return false;
-}
\ No newline at end of file
+}
@@ -1,21 +1,57 @@
 #pragma once
 #include "krkrvoice.hpp"
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_synthpool.hpp"
 #include <functional> 
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace krkrvoice {
 
 // SAPI + WinRT をまとめて扱うサービス
 class WinTTSService final : public ITTSService {
 public:
+    WinTTSService();
+
     std::vector<VoiceInfo>
     GetVoiceList(const std::wstring& lang = L"", const std::wstring& gender = L"") override;
 
+    bool ResolveVoice(const std::wstring& lang, const std::wstring& gender,
+                      size_t idx, VoiceInfo& out) override;
+    bool FindVoice(VoiceHandle handle, VoiceInfo& out) override;
+    void RefreshVoices() override;
+    bool GetCatalogStats(VoiceCatalogStats& out) const override;
+    VoiceCatalog* Catalog() override { return &catalog_; }
+
     bool SpeakText(const VoiceInfo& voice,
         const std::wstring& text,
         int  speed,
         bool sync,
         bool overlap,
-        std::function<void()> onFinish = {});
+        std::function<void()> onFinish = {},
+        const CancelToken& cancel = {}) override;
+
+    bool CanSynthesize(const VoiceInfo& voice) const override
+    { return voice.engine == L"SAPI" || voice.engine == L"WinRT"; }
+    bool Synthesize(const VoiceInfo& voice, const std::wstring& text,
+                    int speed, AudioClip& out, const CancelToken& cancel = {}) override;
+
+    SynthesizerPool* Synthesizers() override { return &pool_; }
+
+private:
+    // ハンドルごとに一度だけ探したエンジン側の音声（発話のたびに全音声を走査しない）
+    struct BoundVoice;
+    std::shared_ptr<const BoundVoice> Bind(const VoiceInfo& voice);
+
+    VoiceCatalog catalog_;   // SAPI + WinRT の列挙結果（初回のみ列挙）
+
+    std::mutex boundMtx_;
+    std::unordered_map<VoiceHandle, std::shared_ptr<const BoundVoice>> bound_;   // RefreshVoices で破棄
+
+    // 音声設定済みの ISpVoice / SpeechSynthesizer（発話ごとの生成・初期化を避ける）
+    std::unique_ptr<SynthInstance> CreateSynth(const VoiceInfo& voice, bool warm);
+    SynthesizerPool pool_;
 };
 
 } // namespace krkrvoice
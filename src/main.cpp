@@ -1,17 +1,25 @@
 #include "krkrvoice.hpp"
+#include "krkrvoice_batch.hpp"
+#include "krkrvoice_dict.hpp"
+#ifdef _WIN32
 #include "krkrvoice_win.hpp"
 #include <windows.h>
 #include <winrt/base.h>
+#endif
 
 #include <algorithm>
+#include <chrono>
+#include <clocale>
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <codecvt>
 #include <locale>
 #include <cctype>
 
+#ifdef _WIN32
 // COM／WinRT 初期化
 struct ComInit {
     ComInit() {
@@ -23,11 +31,7 @@ struct ComInit {
         ::CoUninitialize();
     }
 };
-
-// 大文字小文字を区別しない比較
-static bool ieq(std::wstring_view a, std::wstring_view b) {
-    return _wcsicmp(a.data(), b.data()) == 0;
-}
+#endif
 
 // UTF-8 → UTF-16
 static std::wstring WStringFromUTF8(const std::string& s) {
@@ -46,6 +50,7 @@ static std::string toLower(std::string_view s) {
 // コマンドライン解析結果
 struct Options {
     std::wstring ttsType = L"win";   // /tts=win, /tts=vox
+    std::wstring url     = L"http://127.0.0.1";   // /url=http://127.0.0.1:50021,http://127.0.0.1:50022 で複数エンジンに振り分け
     std::wstring lang;
     std::wstring gender;
     int          voiceIdx = -1;
@@ -54,6 +59,16 @@ struct Options {
     bool         async    = false;
     bool         overlap  = false;
     bool         listOnly = false;
+
+    // 一括書き出し（/batch=行リスト /out=出力先 /jobs=N /dict=a.json;b.json /force）
+    std::wstring batchFile;
+    std::wstring outDir   = L"voice";
+    std::wstring dicts;
+    int          jobs     = 0;
+    bool         force    = false;
+
+    // 辞書の事前コンパイル（/compile=出力.kvdc /dict=a.json;b.json）
+    std::wstring compileOut;
 };
 
 // 引数解析
@@ -78,6 +93,7 @@ static Options ParseArgs(int argc, wchar_t* argv[]) {
         }
     }
     if (opts.count("tts"))     o.ttsType  = WStringFromUTF8(opts["tts"]);
+    if (opts.count("url"))     o.url      = WStringFromUTF8(opts["url"]);
     if (opts.count("lang"))    o.lang     = WStringFromUTF8(opts["lang"]);
     if (opts.count("gender"))  o.gender   = WStringFromUTF8(opts["gender"]);
     if (opts.count("voice")||opts.count("v")) {
@@ -90,6 +106,12 @@ static Options ParseArgs(int argc, wchar_t* argv[]) {
     if (opts.count("overlap"))  o.overlap  = true;
     if (opts.count("stop")||opts.count("replace")) o.overlap = false;
     if (opts.count("list"))     o.listOnly = true;
+    if (opts.count("batch"))    o.batchFile = WStringFromUTF8(opts["batch"]);
+    if (opts.count("out"))      o.outDir    = WStringFromUTF8(opts["out"]);
+    if (opts.count("dict"))     o.dicts     = WStringFromUTF8(opts["dict"]);
+    if (opts.count("jobs"))     o.jobs      = std::max(0, std::stoi(opts["jobs"]));
+    if (opts.count("force"))    o.force     = true;
+    if (opts.count("compile"))  o.compileOut = WStringFromUTF8(opts["compile"]);
 
     if (!freeArgs.empty()) {
         std::wstring txt;
@@ -102,12 +124,82 @@ static Options ParseArgs(int argc, wchar_t* argv[]) {
     return o;
 }
 
-int wmain(int argc, wchar_t* argv[]) {
-    ComInit comInit;
+// "a;b;c" を分割
+static std::vector<std::wstring> SplitList(const std::wstring& s) {
+    std::vector<std::wstring> out;
+    for (size_t pos = 0; pos < s.size();) {
+        auto sep = s.find(L';', pos);
+        if (sep == std::wstring::npos) sep = s.size();
+        if (sep > pos) out.push_back(s.substr(pos, sep - pos));
+        pos = sep + 1;
+    }
+    return out;
+}
+
+// 辞書 JSON 群を名前順に連結して .kvdc に書き出す
+static int RunCompileMode(const Options& opt) {
+    std::map<std::wstring, std::vector<krkrvoice::DictEntry>> dicts;
+    std::wstring err;
+    for (const auto& p : SplitList(opt.dicts))
+        if (!krkrvoice::LoadDictionaryFile(p, dicts, err)) {
+            std::wcerr << err << L"\n";
+            return -1;
+        }
+    std::vector<krkrvoice::DictEntry> all;
+    for (const auto& [name, entries] : dicts) all.insert(all.end(), entries.begin(), entries.end());
+
+    auto t0 = std::chrono::steady_clock::now();
+    krkrvoice::CompiledDictionary dict(all);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (!dict.Save(opt.compileOut)) {
+        std::wcerr << L"書き出せません: " << opt.compileOut << L"\n";
+        return -1;
+    }
+    std::wcout << L"entries=" << all.size() << L" literal=" << dict.LiteralCount()
+               << L" regex=" << dict.RegexCount() << L" stages=" << dict.StageCount()
+               << L" compile-ms=" << ms << L"\n";
+    return 0;
+}
+
+// 一括書き出し
+static int RunBatchMode(const Options& opt) {
+    krkrvoice::BatchOptions bo;
+    bo.service = opt.ttsType;
+    bo.url     = opt.url;
+    bo.lang    = opt.lang;
+    bo.gender  = opt.gender;
+    bo.voice   = std::max(opt.voiceIdx, 0);
+    bo.speed   = opt.speed;
+    bo.jobs    = static_cast<size_t>(opt.jobs);
+    bo.force   = opt.force;
+    bo.lines   = opt.batchFile;
+    bo.outDir  = opt.outDir;
+    for (const auto& d : SplitList(opt.dicts)) bo.dictionaries.emplace_back(d);
+
+    krkrvoice::BatchReport rep;
+    std::wstring err;
+    if (!krkrvoice::RunBatch(bo, rep, err)) {
+        std::wcerr << err << L"\n";
+        return -1;
+    }
+    for (const auto& e : rep.errors)
+        std::wcerr << e << L"\n";
+    std::wcout << L"lines=" << rep.total << L" rendered=" << rep.rendered
+               << L" skipped=" << rep.skipped << L" failed=" << rep.failed
+               << L" seconds=" << rep.seconds << L" lines/sec=" << rep.LinesPerSecond()
+               << L" audio-seconds=" << rep.audioSeconds << L"\n";
+    return rep.failed ? 1 : 0;
+}
+
+static int Run(int argc, wchar_t* argv[]) {
     auto opt = ParseArgs(argc, argv);
+    if (!opt.compileOut.empty())
+        return RunCompileMode(opt);
+    if (!opt.batchFile.empty())
+        return RunBatchMode(opt);
 
     // TTS サービス取得（文字列版ファクトリを利用）
-    auto svc = krkrvoice::GetTTSService(opt.ttsType);
+    auto svc = krkrvoice::GetTTSService(opt.ttsType, opt.url);
     if (!svc) {
         std::wcerr << L"TTS サービスを初期化できません\n";
         return -1;
@@ -125,16 +217,15 @@ int wmain(int argc, wchar_t* argv[]) {
         return 0;
     }
 
-    // 再度リスト取得して範囲チェック
-    auto voices = svc->GetVoiceList(opt.lang, opt.gender);
-    if (static_cast<size_t>(opt.voiceIdx) >= voices.size()) {
+    // カタログから解決して範囲チェック
+    krkrvoice::VoiceInfo vi;
+    if (!svc->ResolveVoice(opt.lang, opt.gender, static_cast<size_t>(opt.voiceIdx), vi)) {
         std::wcerr << L"インデックスが範囲外です\n";
         return -1;
     }
     if (opt.text.empty())
         opt.text = L"(テキスト未指定)";
 
-    const auto& vi = voices[opt.voiceIdx];
     bool ok = false;
     if (opt.async) {
         svc->SpeakText(vi, opt.text, opt.speed, false, opt.overlap, []{ /* onFinish */ });
@@ -146,4 +237,20 @@ int wmain(int argc, wchar_t* argv[]) {
             std::wcerr << L"再生に失敗しました\n";
     }
     return ok ? 0 : -1;
-}
\ No newline at end of file
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[]) {
+    ComInit comInit;
+    return Run(argc, argv);
+}
+#else
+int main(int argc, char* argv[]) {
+    std::setlocale(LC_ALL, "");
+    std::vector<std::wstring> args;
+    for (int i = 0; i < argc; ++i) args.push_back(WStringFromUTF8(argv[i]));
+    std::vector<wchar_t*> wargv;
+    for (auto& a : args) wargv.push_back(a.data());
+    return Run(argc, wargv.data());
+}
+#endif
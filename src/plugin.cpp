@@ -1,14 +1,33 @@
 // -----------------------------------------------------------------------------
-// plugin.cpp ― TTSBridge with multi-dictionary + regex replace
+// plugin.cpp ― TTSBridge with multi-dictionary + compiled literal/regex replace
 // -----------------------------------------------------------------------------
 #include "ncbind.hpp"
 #include "krkrvoice.hpp"
 #include "krkrvoice_win.hpp"
+#include "krkrvoice_dict.hpp"
+#include "krkrvoice_cache.hpp"
+#include "krkrvoice_stream.hpp"
+#include "krkrvoice_event.hpp"
+#include "krkrvoice_sched.hpp"
+#include "krkrvoice_prefetch.hpp"
+#include "krkrvoice_trace.hpp"
+#include "krkrvoice_cmdq.hpp"
+#include "krkrvoice_markup.hpp"
+#include "krkrvoice_mixer.hpp"
+#include "krkrvoice_stretch.hpp"
+#include "krkrvoice_synthpool.hpp"
+#include "krkrvoice_vox.hpp"
+#include "krkrvoice_balance.hpp"
+#include "krkrvoice_catalog.hpp"
+#include "krkrvoice_memory.hpp"
 
 #include <windows.h>
 #include <winrt/base.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <initializer_list>
 #include <memory>
 #include <vector>
 #include <string>
@@ -43,12 +62,16 @@ static tjs_error TJS_INTF_METHOD EnumDictCallback(
 
 class TTSToken {
 public:
-    TTSToken() : flag_(std::make_shared<std::atomic_bool>(false)) {}
-    std::shared_ptr<std::atomic_bool> flag() { return flag_; }
-    void wait() const { while (!flag_->load()) ::Sleep(30); }
-    bool done() const { return flag_->load(); }
+    TTSToken() : done_(std::make_shared<Completion>()) {}
+    std::shared_ptr<Completion> completion() { return done_; }
+    // timeoutMs < 0 で無期限。完了していれば true
+    bool wait(tjs_int timeoutMs = -1) const {
+        if (timeoutMs < 0) { done_->Wait(); return true; }
+        return done_->WaitFor(std::chrono::milliseconds(timeoutMs));
+    }
+    bool done() const { return done_->Done(); }
 private:
-    std::shared_ptr<std::atomic_bool> flag_;
+    std::shared_ptr<Completion> done_;
 };
 
 class TTSBridge {
@@ -59,8 +82,22 @@ public:
         std::wstring name = (serviceStr.Type() != tvtVoid) ? std::wstring(serviceStr.GetString()) : L"win";
         std::wstring endpoint = (url.Type() != tvtVoid) ? std::wstring(url.GetString()) : L"http://127.0.0.1";
         int portnum = (port.Type() != tvtVoid) ? static_cast<int>((tjs_int)port) : 50021;
-        svc_ = GetServiceByName(name, endpoint, portnum);
-        if (!svc_) throw std::runtime_error("TTS service not available");
+        auto inner = GetServiceByName(name, endpoint, portnum);
+        if (!inner) throw std::runtime_error("TTS service not available");
+        engine_ = inner;
+        mixed_ = std::make_shared<MixedTTSService>(inner, std::make_shared<AudioMixer>());
+        cache_ = std::make_shared<CachedTTSService>(mixed_);
+        stretch_  = std::make_shared<TimeStretchTTSService>(cache_);
+        streaming_ = std::make_shared<StreamingTTSService>(stretch_);
+        prefetch_ = std::make_shared<PrefetchTTSService>(streaming_);
+        sched_    = std::make_shared<ScheduledTTSService>(prefetch_);
+        svc_      = sched_;
+        // 先読みはスケジューラの Prefetch 優先度で流す（sched_ が prefetch_ を所有するので弱参照）
+        std::weak_ptr<ScheduledTTSService> weak = sched_;
+        prefetch_->SetSubmitter([weak](SynthScheduler::Task run, std::function<void()> dropped) {
+            if (auto s = weak.lock()) s->Submit(SynthPriority::Prefetch, std::move(run), std::move(dropped));
+            else if (dropped)         dropped();
+        });
     }
 
     std::vector<std::wstring> list(const tjs_char* lang = L"", const tjs_char* gender = L"") {
@@ -74,62 +111,422 @@ public:
         return out;
     }
 
+    // 呼び出し元（TJS のメインスレッド）では要求をコマンドスレッドに積むだけにする。
+    // 音声解決・辞書適用・合成の投入はすべてコマンドスレッドで行う
     bool speakSync(int idx, const tjs_char* lang, const tjs_char* gender,
                    const tjs_char* text, int speed = 0, bool overlap = false) {
-        auto v = svc_->GetVoiceList(lang, gender);
-        if (idx < 0 || static_cast<size_t>(idx) >= v.size()) return false;
-        std::wstring processed = applyDictionary(text ? text : L"");
-        return svc_->SpeakText(v[idx], processed, speed, true, overlap);
+        StageTimer call(TraceStage::Call);
+        if (idx < 0) return false;
+        return postSpeakWait(makeRequest(idx, lang, gender, text, speed, overlap));
     }
 
     TTSToken speakAsync(int idx, const tjs_char* lang, const tjs_char* gender,
                         const tjs_char* text, int speed = 0, bool overlap = false) {
-        TTSToken tok;
-        auto flag = tok.flag();
-        auto v = svc_->GetVoiceList(lang, gender);
-        if (idx < 0 || static_cast<size_t>(idx) >= v.size()) {
-            flag->store(true);
+        StageTimer call(TraceStage::Call);
+        if (idx < 0) {
+            TTSToken tok;
+            tok.completion()->Signal();
             return tok;
         }
-        std::wstring processed = applyDictionary(text ? text : L"");
-        svc_->SpeakText(v[idx], processed, speed, false, overlap, [flag] { flag->store(true); });
-        return tok;
+        return postSpeak(makeRequest(idx, lang, gender, text, speed, overlap));
+    }
+
+    // フィルタ後の idx 番目の音声のハンドル（見つからなければ 0）
+    //  ハンドルは一覧の並びやフィルタが変わっても同じ音声を指す
+    tjs_int resolveVoice(int idx, const tjs_char* lang, const tjs_char* gender) {
+        VoiceInfo vi;
+        if (idx < 0 || !svc_->ResolveVoice(lang ? lang : L"", gender ? gender : L"", static_cast<size_t>(idx), vi))
+            return 0;
+        return static_cast<tjs_int>(vi.handle);
+    }
+
+    // resolveVoice のハンドルで発話（完了は返り値のトークンで待てる）
+    TTSToken speak(tjs_int handle, const tjs_char* text, int speed = 0, bool overlap = false) {
+        StageTimer call(TraceStage::Call);
+        if (handle <= 0) {
+            TTSToken tok;
+            tok.completion()->Signal();
+            return tok;
+        }
+        return postSpeak(makeRequest(static_cast<VoiceHandle>(handle), text, speed, overlap));
+    }
+
+    // 後で表示する行を先に合成しておく。同じ引数の speakAsync は合成を待たずに鳴る
+    //  要求を積めたら true（音声が見つからない場合は何もしない）
+    bool prefetch(int idx, const tjs_char* lang, const tjs_char* gender,
+                  const tjs_char* text, int speed = 0) {
+        if (idx < 0) return false;
+        postPrefetch(makeRequest(idx, lang, gender, text, speed, false));
+        return true;
+    }
+
+    // resolveVoice のハンドルで先読み
+    bool prefetchVoice(tjs_int handle, const tjs_char* text, int speed = 0) {
+        if (handle <= 0) return false;
+        postPrefetch(makeRequest(static_cast<VoiceHandle>(handle), text, speed, false));
+        return true;
+    }
+
+    void cancelPrefetch() {
+        ++prefetchEpoch_;
+        prefetch_->Store().CancelAll();
+    }
+
+    void setPrefetchOptions(tjs_int memoryBytes, tjs_int ttlMs) {
+        prefetch_->Store().SetLimits(static_cast<size_t>(std::max<tjs_int>(memoryBytes, 0)),
+                                     std::chrono::milliseconds(std::max<tjs_int>(ttlMs, 0)));
+    }
+
+    PrefetchStats prefetchStats() const { return prefetch_->Store().Stats(); }
+
+    // 同時発音数の上限。policy 0=古い再生を止める 1=新しい再生を鳴らさない
+    void setPolyphony(tjs_int maxVoices, tjs_int policy) {
+        SetPlayerPoolLimits(static_cast<size_t>(std::max<tjs_int>(maxVoices, 1)),
+                            policy == 1 ? VoiceStealPolicy::Reject : VoiceStealPolicy::Oldest);
+    }
+
+    // true（既定）=速度は等速の合成結果を伸縮して作る、false=エンジンに速度を渡して合成し直す
+    void setTimeStretch(bool enable) { stretch_->SetEnabled(enable); }
+
+    // 長文の逐次再生で合成が先行してよい長さ（ms、既定 2000）。バッファはこの長さで固定
+    void setStreamBufferMs(tjs_int ms) {
+        streaming_->SetBufferMs(static_cast<int>(std::clamp<tjs_int>(ms, 0, 60000)));
+    }
+
+    // 作品で使う音声の合成器を count 個ずつ先に初期化しておく（起動時に呼ぶ）
+    //  初期化は合成スレッドで先読みと同じ低優先度で行い、呼び出し元は待たない
+    bool warmVoice(tjs_int handle, tjs_int count) {
+        auto* pool = engine_->Synthesizers();
+        VoiceInfo vi;
+        if (!pool || handle <= 0 || !svc_->FindVoice(static_cast<VoiceHandle>(handle), vi)) return false;
+        auto n = static_cast<size_t>(std::max<tjs_int>(count, 1));
+        sched_->Submit(SynthPriority::Prefetch, [engine = engine_, pool, vi, n](const CancelToken&) {
+            pool->Warm(vi, n);   // engine_ が pool を所有するので一緒に捕捉する
+        });
+        return true;
     }
 
-    void registerDictionary(const std::wstring& name,
-        const std::vector<std::pair<std::wregex, std::wstring>>& dict) {
-        dictionaries_[name] = dict;
+    // 音声あたりの待機数の上限と、使われないまま破棄するまでの時間
+    void setSynthPoolOptions(tjs_int maxIdlePerVoice, tjs_int idleTtlMs) {
+        if (auto* pool = engine_->Synthesizers())
+            pool->SetLimits(static_cast<size_t>(std::max<tjs_int>(maxIdlePerVoice, 0)),
+                            std::chrono::milliseconds(std::max<tjs_int>(idleTtlMs, 0)));
+    }
+
+    // 待機中の合成器をすべて破棄（メモリを空けたいとき）
+    void trimSynthesizers() {
+        if (auto* pool = engine_->Synthesizers()) pool->Trim(true);
+    }
+
+    bool synthPoolStats(SynthPoolStats& out) const {
+        auto* pool = engine_->Synthesizers();
+        if (pool) out = pool->Stats();
+        return pool != nullptr;
+    }
+
+    // VOICEVOX のエンジン（url に複数指定して振り分けている場合はそのすべて）
+    std::vector<std::shared_ptr<VoiceVoxService>> voiceVoxEngines() const {
+        std::vector<std::shared_ptr<VoiceVoxService>> out;
+        if (auto vox = std::dynamic_pointer_cast<VoiceVoxService>(engine_)) out.push_back(vox);
+        if (auto bal = std::dynamic_pointer_cast<BalancedTTSService>(engine_))
+            for (size_t i = 0; i < bal->Size(); ++i)
+                if (auto vox = std::dynamic_pointer_cast<VoiceVoxService>(bal->Service(i))) out.push_back(vox);
+        return out;
+    }
+
+    // VOICEVOX の抑揚・音高・音量（audio_query はキャッシュを使い回し、値だけ差し替える）
+    void setVoiceVoxProsody(tTVReal pitchScale, tTVReal intonationScale, tTVReal volumeScale) {
+        VoxProsody p;
+        p.pitchScale      = pitchScale;
+        p.intonationScale = intonationScale;
+        p.volumeScale     = volumeScale;
+        for (auto& vox : voiceVoxEngines()) vox->SetProsody(p);
+    }
+
+    bool voiceVoxStats(VoiceVoxStats& out) const {
+        auto engines = voiceVoxEngines();
+        out = VoiceVoxStats{};
+        for (auto& vox : engines) {
+            auto st = vox->GetStats();
+            out.queryHits     += st.queryHits;
+            out.queryMisses   += st.queryMisses;
+            out.queryEntries  += st.queryEntries;
+            out.queryBytes    += st.queryBytes;
+            out.multiRequests += st.multiRequests;
+            out.multiLines    += st.multiLines;
+        }
+        return !engines.empty();
+    }
+
+    // 複数エンジンへの振り分け（追加送信の分位 0 で無効、連続失敗で外す回数・外しておく時間）
+    void setBalancerOptions(tTVReal hedgePercentile, tjs_int ejectAfterFailures, tjs_int ejectMs) {
+        if (auto bal = std::dynamic_pointer_cast<BalancedTTSService>(engine_)) {
+            BalancerOptions o;
+            o.hedgePercentile    = std::clamp<double>(hedgePercentile, 0.0, 100.0);
+            o.ejectAfterFailures = std::max<tjs_int>(ejectAfterFailures, 1);
+            o.ejectMs            = std::max<tjs_int>(ejectMs, 0);
+            bal->SetOptions(o);
+        }
+    }
+
+    bool balancerStats(BalancerStats& out) const {
+        auto bal = std::dynamic_pointer_cast<BalancedTTSService>(engine_);
+        if (bal) out = bal->Stats();
+        return bal != nullptr;
+    }
+
+    // インストール音声の変化を取り込む（通常は初回列挙結果を使い続ける）
+    void refreshVoices() { svc_->RefreshVoices(); }
+
+    // 音声一覧のスナップショット（生成直後、list() より前に呼ぶ）
+    //  次回からは起動時の列挙を省いてファイルから読み、変化がないかは裏で確かめる
+    bool setCatalogSnapshot(const tjs_char* path) {
+        auto* catalog = engine_->Catalog();
+        return catalog && path && *path && catalog->UseSnapshot(path);
+    }
+
+    bool catalogStats(VoiceCatalogStats& out) const { return svc_->GetCatalogStats(out); }
+
+    // キャッシュ設定（diskPath が空ならディスク層なし）
+    void setCacheOptions(tjs_int memoryBytes, const tjs_char* diskPath, tjs_int diskBytes) {
+        cache_->Cache().SetMemoryBudget(static_cast<size_t>(std::max<tjs_int>(memoryBytes, 0)));
+        cache_->Cache().SetDiskStore(diskPath ? diskPath : L"",
+                                     static_cast<std::uint64_t>(std::max<tjs_int>(diskBytes, 0)));
+    }
+
+    void clearCache() { cache_->Cache().Clear(); }
+
+    // キャッシュ・先読みの音声を圧縮するときに許す誤差（サンプル値。0 で可逆、既定）
+    void setCompressionTolerance(tjs_int tolerance) {
+        const int tol = static_cast<int>(std::clamp<tjs_int>(tolerance, 0, 1024));
+        cache_->Cache().SetTolerance(tol);
+        prefetch_->Store().SetTolerance(tol);
+    }
+
+    AudioCacheStats cacheStats() const { return cache_->Cache().Stats(); }
+
+    // プロセス全体のメモリ予算（バイト、0 で無制限）。超えそうなら先読み → キャッシュ → 待機中の合成器の順に手放す
+    //  engineBytes > 0 なら合成器 1 個の見積もりも変える（以後に作るものから）
+    void setMemoryBudget(tjs_int bytes, tjs_int engineBytes) {
+        if (engineBytes > 0)
+            if (auto* pool = engine_->Synthesizers()) pool->SetInstanceBytes(static_cast<size_t>(engineBytes));
+        MemoryGovernor::Instance().SetBudget(static_cast<size_t>(std::max<tjs_int>(bytes, 0)));
+    }
+
+    // 待ち・合成中の発話をすべて取り消す（スキップ開始時など）
+    void cancelAll() {
+        ++speakEpoch_;
+        sched_->CancelAll();
+    }
+
+    // 0=取り消さない 1=未着手のみ 2=合成中も（既定）
+    void setSupersedePolicy(tjs_int policy) {
+        sched_->SetSupersedePolicy(static_cast<SupersedePolicy>(std::clamp<tjs_int>(policy, 0, 2)));
+    }
+
+    SchedulerStats schedulerStats() const { return sched_->Scheduler().Stats(); }
+
+    // 区間計測の切り替え（stats=ヒストグラム、trace=dumpTrace 用のイベント記録）
+    void setStatsOptions(bool stats, bool trace) { SetTraceOptions(stats, trace); }
+    void resetStats() { ResetStageLatency(); }
+    bool dumpTrace(const tjs_char* path) { return path && DumpChromeTrace(path); }
+
+    // 重ね再生をプロセス内ミキサーで合成し、出力デバイスへは 1 本のストリームで流す
+    void enableMixer(bool enable) {
+        if (enable == mixed_->Enabled()) return;
+        const auto& mixer = mixed_->Mixer();
+        if (enable) mixer->StartOutput(std::make_shared<DeviceAudioSink>(mixer->SampleRate()));
+        mixed_->SetEnabled(enable);
+        if (!enable) mixer->StopOutput();   // 鳴っている音声も終了する
+    }
+
+    // masterGain=全体の音量、duckLevel=duck 指定の音声が鳴っている間の他音声の倍率
+    void setMixerOptions(tTVReal masterGain, tTVReal duckLevel) {
+        mixed_->Mixer()->SetMasterGain(static_cast<float>(masterGain));
+        mixed_->Mixer()->SetDuckLevel(static_cast<float>(duckLevel));
+    }
+
+    // 以降の発話の音量・定位（-1=左〜1=右）。duck=true なら鳴っている間ほかの音声を下げる
+    void setVoiceMix(tTVReal gain, tTVReal pan, bool duck) {
+        MixVoiceParams p;
+        p.gain       = static_cast<float>(gain);
+        p.pan        = static_cast<float>(pan);
+        p.duckOthers = duck;
+        mixed_->SetVoiceParams(p);
+    }
+
+    MixerStats mixerStats() const { return mixed_->Mixer()->Stats(); }
+
+    void registerDictionary(const std::wstring& name, std::vector<DictEntry> dict) {
+        dictionaries_[name] = std::move(dict);
+        precompiled_.erase(name);
+        if (enabledDictionaries_.count(name)) rebuildDictionary();
+    }
+
+    // 事前コンパイル済み辞書（.kvdc）を読み込んで name として登録する
+    bool loadCompiledDictionary(const tjs_char* name, const tjs_char* path) {
+        if (!name || !path) return false;
+        auto dict = std::make_shared<CompiledDictionary>();
+        if (!CompiledDictionary::Load(path, *dict)) return false;
+        precompiled_[name] = std::move(dict);
+        dictionaries_.erase(name);
+        if (enabledDictionaries_.count(name)) rebuildDictionary();
+        return true;
+    }
+
+    // 登録済み辞書を .kvdc に書き出す（次回以降は loadCompiledDictionary で読める）
+    bool saveCompiledDictionary(const tjs_char* name, const tjs_char* path) {
+        if (!name || !path) return false;
+        if (auto it = precompiled_.find(name); it != precompiled_.end()) return it->second->Save(path);
+        auto it = dictionaries_.find(name);
+        return it != dictionaries_.end() && CompiledDictionary(it->second).Save(path);
     }
 
     void enableDictionary(const std::wstring& name, bool enable) {
-        if (enable) enabledDictionaries_.insert(name);
-        else enabledDictionaries_.erase(name);
+        bool changed = enable ? enabledDictionaries_.insert(name).second
+                              : enabledDictionaries_.erase(name) > 0;
+        if (changed) rebuildDictionary();
+    }
+
+    // 発話テキストの KAG タグ（[r] [l] [ruby text=...] など）を辞書置換の前に取り除く
+    //  [l] [p] は clickPauseMs / pagePauseMs の休止、[wait time=...] はその長さの休止になる
+    void setScenarioMarkup(bool enable, tjs_int clickPauseMs, tjs_int pagePauseMs) {
+        if (!enable) {
+            markup_.reset();
+            return;
+        }
+        MarkupOptions opt;
+        opt.clickPauseMs = std::max<tjs_int>(clickPauseMs, 0);
+        opt.pagePauseMs  = std::max<tjs_int>(pagePauseMs, 0);
+        markup_ = std::make_shared<const MarkupOptions>(opt);
     }
 
 private:
     std::shared_ptr<ITTSService> svc_;
-    std::map<std::wstring, std::vector<std::pair<std::wregex, std::wstring>>> dictionaries_;
+    std::shared_ptr<ITTSService> engine_;   // 層を重ねる前のエンジン本体
+    std::shared_ptr<MixedTTSService> mixed_;
+    std::shared_ptr<CachedTTSService> cache_;
+    std::shared_ptr<TimeStretchTTSService> stretch_;
+    std::shared_ptr<StreamingTTSService> streaming_;
+    std::shared_ptr<ScheduledTTSService> sched_;
+    std::shared_ptr<PrefetchTTSService> prefetch_;
+    std::map<std::wstring, std::vector<DictEntry>> dictionaries_;
+    std::map<std::wstring, std::shared_ptr<const CompiledDictionary>> precompiled_;
     std::set<std::wstring> enabledDictionaries_;
+    std::shared_ptr<const CompiledDictionary> compiled_ = std::make_shared<CompiledDictionary>();
+    std::shared_ptr<const MarkupOptions> markup_;     // null ならタグを除去しない
+    std::atomic<std::uint64_t> speakEpoch_{ 0 };      // cancelAll ごとに進める
+    std::atomic<std::uint64_t> prefetchEpoch_{ 0 };   // cancelPrefetch ごとに進める
+    // 最後に宣言する（最初に破棄される）。サービスがまだ生きているうちに積み残しを実行して止まる
+    CommandThread cmdq_;
 
-    std::wstring applyDictionary(const std::wstring& text) const {
-        std::wstring result = text;
+    // 有効な辞書を名前順に連結して 1 つの置換器にコンパイルし直す
+    //  事前コンパイル済みの辞書はステージをそのまま繋ぐ
+    void rebuildDictionary() {
+        auto out = std::make_shared<CompiledDictionary>();
+        std::vector<DictEntry> pending;
+        auto flush = [&] {
+            if (pending.empty()) return;
+            out->Append(CompiledDictionary(pending));
+            pending.clear();
+        };
         for (const auto& name : enabledDictionaries_) {
+            if (auto pc = precompiled_.find(name); pc != precompiled_.end()) {
+                flush();
+                out->Append(*pc->second);
+                continue;
+            }
             auto it = dictionaries_.find(name);
             if (it == dictionaries_.end()) continue;
-            for (const auto& [pattern, replacement] : it->second) {
-                result = std::regex_replace(result, pattern, replacement);
+            pending.insert(pending.end(), it->second.begin(), it->second.end());
+        }
+        flush();
+        compiled_ = std::move(out);
+    }
+
+    // コマンドスレッドへ渡す発話要求（TJS の文字列は呼び出し中しか有効でないので複製する）
+    // 音声は handle があればそれで、なければ (lang, gender, idx) で解決する
+    struct SpeakRequest {
+        size_t       idx;
+        std::wstring lang, gender, text;
+        int          speed;
+        bool         overlap;
+        VoiceHandle  handle = kInvalidVoiceHandle;
+    };
+
+    static SpeakRequest makeRequest(int idx, const tjs_char* lang, const tjs_char* gender,
+                                    const tjs_char* text, int speed, bool overlap) {
+        return SpeakRequest{ static_cast<size_t>(idx), lang ? lang : L"", gender ? gender : L"",
+                             text ? text : L"", speed, overlap };
+    }
+
+    static SpeakRequest makeRequest(VoiceHandle handle, const tjs_char* text, int speed, bool overlap) {
+        return SpeakRequest{ 0, L"", L"", text ? text : L"", speed, overlap, handle };
+    }
+
+    // 先に積んだ非同期発話より後に鳴るよう、同じスレッドで実行して待つ
+    bool postSpeakWait(SpeakRequest req) {
+        bool ok = false;
+        Completion done;
+        cmdq_.Post([this, &ok, &done, req = std::move(req), dict = compiled_, markup = markup_, epoch = speakEpoch_.load()] {
+            VoiceInfo vi;
+            if (epoch == speakEpoch_.load() && lookupVoice(req, vi))
+                ok = svc_->SpeakText(vi, normalizeText(markup.get(), *dict, req.text), req.speed, true, req.overlap);
+            done.Signal();
+        });
+        done.Wait();
+        return ok;
+    }
+
+    TTSToken postSpeak(SpeakRequest req) {
+        TTSToken tok;
+        cmdq_.Post([this, done = tok.completion(), req = std::move(req),
+                    dict = compiled_, markup = markup_, epoch = speakEpoch_.load()] {
+            VoiceInfo vi;
+            if (epoch != speakEpoch_.load() || !lookupVoice(req, vi)) {   // 積んだ後に cancelAll された
+                done->Signal();
+                return;
             }
+            // 失敗時も完了にする（Signal は二度目以降は何もしない）
+            if (!svc_->SpeakText(vi, normalizeText(markup.get(), *dict, req.text), req.speed, false, req.overlap,
+                                 [done] { done->Signal(); }))
+                done->Signal();
+        });
+        return tok;
+    }
+
+    void postPrefetch(SpeakRequest req) {
+        cmdq_.Post([this, req = std::move(req), dict = compiled_, markup = markup_, epoch = prefetchEpoch_.load()] {
+            VoiceInfo vi;
+            if (epoch != prefetchEpoch_.load() || !lookupVoice(req, vi)) return;
+            prefetch_->Prefetch(vi, normalizeText(markup.get(), *dict, req.text), req.speed);
+        });
+    }
+
+    // シナリオタグの除去（有効時）→ 辞書置換。タグのない行はコピーせずそのまま辞書へ渡す
+    static std::wstring normalizeText(const MarkupOptions* markup, const CompiledDictionary& dict,
+                                      const std::wstring& text) {
+        std::wstring_view src = text;
+        std::wstring stripped;
+        if (markup) {
+            StageTimer t(TraceStage::Markup);
+            if (StripScenarioMarkup(src, stripped, *markup)) src = stripped;
         }
-        return result;
+        StageTimer t(TraceStage::Dictionary);
+        return dict.Apply(src);
+    }
+
+    bool lookupVoice(const SpeakRequest& req, VoiceInfo& vi) {
+        StageTimer t(TraceStage::VoiceResolve);
+        if (req.handle != kInvalidVoiceHandle) return svc_->FindVoice(req.handle, vi);
+        return svc_->ResolveVoice(req.lang, req.gender, req.idx, vi);
     }
 
     static std::shared_ptr<ITTSService>
     GetServiceByName(const std::wstring& name,
                      const std::wstring& endpoint,
                      int port) {
-        if (name == L"win" || name == L"wintts")
-            return std::make_shared<WinTTSService>();
-        return nullptr;
+        return GetTTSService(name, endpoint, port);
     }
 };
 
@@ -169,7 +566,8 @@ tjs_error TJS_INTF_METHOD RegisterDictionaryCallback(
     tTJSVariant lenVar;
     arrObj->PropGet(TJS_IGNOREPROP, TJS_W("length"), nullptr, &lenVar, arrObj);
     int len = static_cast<int>(lenVar);
-    std::vector<std::pair<std::wregex, std::wstring>> dict;
+    std::vector<DictEntry> dict;
+    dict.reserve(len > 0 ? len : 0);
     for (int i = 0; i < len; ++i) {
         tTJSVariant elemVar;
         arrObj->PropGetByNum(TJS_IGNOREPROP, i, &elemVar, arrObj);
@@ -177,11 +575,339 @@ tjs_error TJS_INTF_METHOD RegisterDictionaryCallback(
         tTJSVariant patVar, repVar;
         entryObj->PropGet(TJS_IGNOREPROP, TJS_W("pattern"), nullptr, &patVar, entryObj);
         entryObj->PropGet(TJS_IGNOREPROP, TJS_W("replacement"), nullptr, &repVar, entryObj);
-        try {
-            dict.emplace_back(std::wregex(patVar.GetString()), repVar.GetString());
-        } catch (...) {}
+        if (patVar.Type() == tvtVoid) continue;
+        // 正規表現の検証・コンパイルは有効化時にまとめて行う
+        dict.push_back(DictEntry{ patVar.GetString(), repVar.GetString() });
     }
-    self->registerDictionary(name, dict);
+    self->registerDictionary(name, std::move(dict));
+    return TJS_S_OK;
+}
+
+// 統計値を TJS 辞書にして返す
+static void SetStatsResult(tTJSVariant* result,
+    std::initializer_list<std::pair<const tjs_char*, std::uint64_t>> items)
+{
+    if (!result) return;
+    iTJSDispatch2* dict = TJSCreateDictionaryObject();
+    for (const auto& [key, v] : items) {
+        tTJSVariant val(static_cast<tTVInteger>(v));
+        dict->PropSet(TJS_MEMBERENSURE, key, nullptr, &val, dict);
+    }
+    *result = tTJSVariant(dict, dict);
+    dict->Release();
+}
+
+// catalogStats() -> %[enumerations, avoided, voices, snapshotLoaded, fingerprintMatches, snapshotWrites]
+tjs_error TJS_INTF_METHOD CatalogStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    VoiceCatalogStats st;
+    self->catalogStats(st);
+    SetStatsResult(result, {
+        { TJS_W("enumerations"),       st.enumerations },
+        { TJS_W("avoided"),            st.avoided },
+        { TJS_W("voices"),             st.voices },
+        { TJS_W("snapshotLoaded"),     st.snapshotLoaded },
+        { TJS_W("fingerprintMatches"), st.fingerprintMatches },
+        { TJS_W("snapshotWrites"),     st.snapshotWrites },
+    });
+    return TJS_S_OK;
+}
+
+// cacheStats() -> %[hits, diskHits, misses, evictions, ...]
+tjs_error TJS_INTF_METHOD CacheStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    auto st = self->cacheStats();
+    SetStatsResult(result, {
+        { TJS_W("hits"),           st.hits },
+        { TJS_W("diskHits"),       st.diskHits },
+        { TJS_W("misses"),         st.misses },
+        { TJS_W("evictions"),      st.evictions },
+        { TJS_W("diskEvictions"),  st.diskEvictions },
+        { TJS_W("memoryBytes"),    st.memoryBytes },
+        { TJS_W("memoryPcmBytes"), st.memoryPcmBytes },
+        { TJS_W("memoryEntries"),  st.memoryEntries },
+        { TJS_W("diskBytes"),      st.diskBytes },
+        { TJS_W("diskEntries"),    st.diskEntries },
+    });
+    return TJS_S_OK;
+}
+
+// schedulerStats() -> %[submitted, started, dropped, queued, running]
+tjs_error TJS_INTF_METHOD SchedulerStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    auto st = self->schedulerStats();
+    SetStatsResult(result, {
+        { TJS_W("submitted"), st.submitted },
+        { TJS_W("started"),   st.started },
+        { TJS_W("dropped"),   st.dropped },
+        { TJS_W("queued"),    st.queued },
+        { TJS_W("running"),   st.running },
+    });
+    return TJS_S_OK;
+}
+
+// prefetchMany([%[voice, lang, gender, text, speed], ...]) -> 受け付けた件数
+tjs_error TJS_INTF_METHOD PrefetchManyCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    if (numparams < 1) return TJS_E_BADPARAMCOUNT;
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    if (params[0]->Type() != tvtObject) return TJS_E_INVALIDPARAM;
+    iTJSDispatch2* arrObj = (*params[0]).AsObjectNoAddRef();
+    tTJSVariant lenVar;
+    arrObj->PropGet(TJS_IGNOREPROP, TJS_W("length"), nullptr, &lenVar, arrObj);
+    int len = static_cast<int>(lenVar);
+    tjs_int accepted = 0;
+    for (int i = 0; i < len; ++i) {
+        tTJSVariant elemVar;
+        arrObj->PropGetByNum(TJS_IGNOREPROP, i, &elemVar, arrObj);
+        if (elemVar.Type() != tvtObject) continue;
+        iTJSDispatch2* e = elemVar.AsObjectNoAddRef();
+        tTJSVariant voiceVar, langVar, genderVar, textVar, speedVar;
+        e->PropGet(TJS_IGNOREPROP, TJS_W("voice"),  nullptr, &voiceVar,  e);
+        e->PropGet(TJS_IGNOREPROP, TJS_W("lang"),   nullptr, &langVar,   e);
+        e->PropGet(TJS_IGNOREPROP, TJS_W("gender"), nullptr, &genderVar, e);
+        e->PropGet(TJS_IGNOREPROP, TJS_W("text"),   nullptr, &textVar,   e);
+        e->PropGet(TJS_IGNOREPROP, TJS_W("speed"),  nullptr, &speedVar,  e);
+        if (textVar.Type() == tvtVoid) continue;
+        int idx   = voiceVar.Type() != tvtVoid ? static_cast<int>((tjs_int)voiceVar) : 0;
+        int speed = speedVar.Type() != tvtVoid ? static_cast<int>((tjs_int)speedVar) : 0;
+        const tjs_char* lang   = langVar.Type()   != tvtVoid ? langVar.GetString()   : L"";
+        const tjs_char* gender = genderVar.Type() != tvtVoid ? genderVar.GetString() : L"";
+        if (self->prefetch(idx, lang, gender, textVar.GetString(), speed)) ++accepted;
+    }
+    if (result) *result = tTJSVariant(accepted);
+    return TJS_S_OK;
+}
+
+// prefetchStats() -> %[requested, completed, hits, lateHits, misses, ...]
+tjs_error TJS_INTF_METHOD PrefetchStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    auto st = self->prefetchStats();
+    SetStatsResult(result, {
+        { TJS_W("requested"),     st.requested },
+        { TJS_W("completed"),     st.completed },
+        { TJS_W("hits"),          st.hits },
+        { TJS_W("lateHits"),      st.lateHits },
+        { TJS_W("misses"),        st.misses },
+        { TJS_W("cancelled"),     st.cancelled },
+        { TJS_W("expired"),       st.expired },
+        { TJS_W("evicted"),       st.evicted },
+        { TJS_W("wastedBytes"),   st.wastedBytes },
+        { TJS_W("parkedBytes"),   st.parkedBytes },
+        { TJS_W("parkedEntries"), st.parkedEntries },
+    });
+    return TJS_S_OK;
+}
+
+// playerStats() -> %[active, idle, peakActive, created, reused, stolen, rejected, peakWorkingSet]
+tjs_error TJS_INTF_METHOD PlayerStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    auto st = GetPlayerPoolStats();
+    SetStatsResult(result, {
+        { TJS_W("active"),         st.active },
+        { TJS_W("idle"),           st.idle },
+        { TJS_W("peakActive"),     st.peakActive },
+        { TJS_W("created"),        st.created },
+        { TJS_W("reused"),         st.reused },
+        { TJS_W("stolen"),         st.stolen },
+        { TJS_W("rejected"),       st.rejected },
+        { TJS_W("peakWorkingSet"), st.peakWorkingSet },
+    });
+    return TJS_S_OK;
+}
+
+// streamStats() -> %[streams, active, ringBytes, peakRingBytes, written, read, peakFill, underruns, ...]
+tjs_error TJS_INTF_METHOD StreamStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    auto st = GetPcmStreamStats();
+    SetStatsResult(result, {
+        { TJS_W("streams"),        st.streams },
+        { TJS_W("active"),         st.active },
+        { TJS_W("ringBytes"),      st.ringBytes },
+        { TJS_W("peakRingBytes"),  st.peakRingBytes },
+        { TJS_W("written"),        st.written },
+        { TJS_W("read"),           st.read },
+        { TJS_W("peakFill"),       st.peakFill },
+        { TJS_W("underruns"),      st.underruns },
+        { TJS_W("producerWaits"),  st.producerWaits },
+        { TJS_W("producerWaitMs"), static_cast<std::uint64_t>(st.producerWaitMs + 0.5) },
+    });
+    return TJS_S_OK;
+}
+
+// memoryStats() -> %[budget, bytes, peakBytes, prefetchBytes, prefetchPeak, cacheBytes, ...]（バイト）
+tjs_error TJS_INTF_METHOD MemoryStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    auto st = MemoryGovernor::Instance().Stats();
+    const auto& pf = st.classes[static_cast<size_t>(MemoryClass::Prefetch)];
+    const auto& ca = st.classes[static_cast<size_t>(MemoryClass::Cache)];
+    const auto& en = st.classes[static_cast<size_t>(MemoryClass::Engines)];
+    const auto& pb = st.classes[static_cast<size_t>(MemoryClass::Playback)];
+    SetStatsResult(result, {
+        { TJS_W("budget"),            st.budget },
+        { TJS_W("bytes"),             st.bytes },
+        { TJS_W("peakBytes"),         st.peakBytes },
+        { TJS_W("reclaims"),          st.reclaims },
+        { TJS_W("denied"),            st.denied },
+        { TJS_W("overBudget"),        st.overBudget },
+        { TJS_W("prefetchBytes"),     pf.bytes },
+        { TJS_W("prefetchPeak"),      pf.peakBytes },
+        { TJS_W("prefetchReclaimed"), pf.reclaimedBytes },
+        { TJS_W("cacheBytes"),        ca.bytes },
+        { TJS_W("cachePeak"),         ca.peakBytes },
+        { TJS_W("cacheReclaimed"),    ca.reclaimedBytes },
+        { TJS_W("enginesBytes"),      en.bytes },
+        { TJS_W("enginesPeak"),       en.peakBytes },
+        { TJS_W("enginesReclaimed"),  en.reclaimedBytes },
+        { TJS_W("playbackBytes"),     pb.bytes },
+        { TJS_W("playbackPeak"),      pb.peakBytes },
+    });
+    return TJS_S_OK;
+}
+
+// synthPoolStats() -> %[created, warmed, reused, trimmed, inUse, peakInUse, idle]
+tjs_error TJS_INTF_METHOD SynthPoolStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    SynthPoolStats st;
+    self->synthPoolStats(st);
+    SetStatsResult(result, {
+        { TJS_W("created"),   st.created },
+        { TJS_W("warmed"),    st.warmed },
+        { TJS_W("reused"),    st.reused },
+        { TJS_W("trimmed"),   st.trimmed },
+        { TJS_W("inUse"),     st.inUse },
+        { TJS_W("peakInUse"), st.peakInUse },
+        { TJS_W("idle"),      st.idle },
+    });
+    return TJS_S_OK;
+}
+
+// voiceVoxStats() -> %[queryHits, queryMisses, queryEntries, queryBytes, multiRequests, multiLines]
+tjs_error TJS_INTF_METHOD VoiceVoxStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    VoiceVoxStats st;
+    self->voiceVoxStats(st);
+    SetStatsResult(result, {
+        { TJS_W("queryHits"),     st.queryHits },
+        { TJS_W("queryMisses"),   st.queryMisses },
+        { TJS_W("queryEntries"),  st.queryEntries },
+        { TJS_W("queryBytes"),    st.queryBytes },
+        { TJS_W("multiRequests"), st.multiRequests },
+        { TJS_W("multiLines"),    st.multiLines },
+    });
+    return TJS_S_OK;
+}
+
+// balancerStats() -> %[requests, hedged, hedgeWins, failovers, ejections, readmissions, endpoints, healthy]
+tjs_error TJS_INTF_METHOD BalancerStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    BalancerStats st;
+    self->balancerStats(st);
+    std::uint64_t healthy = 0;
+    for (const auto& e : st.endpoints) healthy += e.healthy;
+    SetStatsResult(result, {
+        { TJS_W("requests"),     st.requests },
+        { TJS_W("hedged"),       st.hedged },
+        { TJS_W("hedgeWins"),    st.hedgeWins },
+        { TJS_W("failovers"),    st.failovers },
+        { TJS_W("ejections"),    st.ejections },
+        { TJS_W("readmissions"), st.readmissions },
+        { TJS_W("endpoints"),    st.endpoints.size() },
+        { TJS_W("healthy"),      healthy },
+    });
+    return TJS_S_OK;
+}
+
+// mixerStats() -> %[started, finished, stolen, active, peakActive, blocks, underruns, ...]
+tjs_error TJS_INTF_METHOD MixerStatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSBridge* self = ncbInstanceAdaptor<TTSBridge>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    auto st = self->mixerStats();
+    SetStatsResult(result, {
+        { TJS_W("started"),        st.started },
+        { TJS_W("finished"),       st.finished },
+        { TJS_W("stolen"),         st.stolen },
+        { TJS_W("active"),         st.active },
+        { TJS_W("peakActive"),     st.peakActive },
+        { TJS_W("blocks"),         st.blocks },
+        { TJS_W("underruns"),      st.underruns },
+        { TJS_W("clippedSamples"), st.clippedSamples },
+        { TJS_W("renderUsMean"),   static_cast<std::uint64_t>(st.renderUsMean + 0.5) },
+        { TJS_W("renderUsMax"),    static_cast<std::uint64_t>(st.renderUsMax + 0.5) },
+        { TJS_W("kernel"),         static_cast<std::uint64_t>(st.kernel) },   // 0=scalar 1=sse2 2=avx2
+    });
+    return TJS_S_OK;
+}
+
+// stats() -> %[call: %[count, mean, p50, p95, p99, max], dictionary: ..., ...]（マイクロ秒）
+tjs_error TJS_INTF_METHOD StatsCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    if (!result) return TJS_S_OK;
+    auto all = GetStageLatency();
+    iTJSDispatch2* dict = TJSCreateDictionaryObject();
+    for (size_t i = 0; i < all.size(); ++i) {
+        const auto& st = all[i];
+        iTJSDispatch2* stage = TJSCreateDictionaryObject();
+        auto put = [stage](const tjs_char* key, tTJSVariant val) {
+            stage->PropSet(TJS_MEMBERENSURE, key, nullptr, &val, stage);
+        };
+        put(TJS_W("count"), tTJSVariant(static_cast<tTVInteger>(st.count)));
+        put(TJS_W("mean"),  tTJSVariant(static_cast<tTVReal>(st.meanUs)));
+        put(TJS_W("p50"),   tTJSVariant(static_cast<tTVReal>(st.p50Us)));
+        put(TJS_W("p95"),   tTJSVariant(static_cast<tTVReal>(st.p95Us)));
+        put(TJS_W("p99"),   tTJSVariant(static_cast<tTVReal>(st.p99Us)));
+        put(TJS_W("max"),   tTJSVariant(static_cast<tTVReal>(st.maxUs)));
+
+        std::string name = TraceStageName(static_cast<TraceStage>(i));
+        std::wstring wname(name.begin(), name.end());
+        tTJSVariant val(stage, stage);
+        dict->PropSet(TJS_MEMBERENSURE, wname.c_str(), nullptr, &val, dict);
+        stage->Release();
+    }
+    *result = tTJSVariant(dict, dict);
+    dict->Release();
     return TJS_S_OK;
 }
 
@@ -199,10 +925,24 @@ tjs_error TJS_INTF_METHOD EnableDictionaryCallback(
     return TJS_S_OK;
 }
 
+// wait(timeoutMs?) -> 完了したか
+tjs_error TJS_INTF_METHOD TokenWaitCallback(
+    tTJSVariant *result, tjs_int numparams,
+    tTJSVariant **params, iTJSDispatch2 *objthis)
+{
+    TTSToken* self = ncbInstanceAdaptor<TTSToken>::GetNativeInstance(objthis);
+    if (!self) return TJS_E_INVALIDPARAM;
+    tjs_int timeout = (numparams >= 1 && params[0] && params[0]->Type() != tvtVoid)
+                      ? static_cast<tjs_int>(*params[0]) : -1;
+    bool ok = self->wait(timeout);
+    if (result) *result = tTJSVariant(ok);
+    return TJS_S_OK;
+}
+
 // ---------------------------- ncbind ----------------------------
 NCB_REGISTER_CLASS(TTSToken) {
     NCB_CONSTRUCTOR(());
-    NCB_METHOD(wait);
+    RawCallback("wait", &TokenWaitCallback, 0);
     NCB_METHOD(done);
 }
 
@@ -211,6 +951,50 @@ NCB_REGISTER_CLASS(TTSBridge) {
     RawCallback("list", &ListWrapper, 0);
     RawCallback("registerDictionary", &RegisterDictionaryCallback, 0);
     RawCallback("enableDictionary", &EnableDictionaryCallback, 0);
+    RawCallback("catalogStats", &CatalogStatsCallback, 0);
+    RawCallback("cacheStats", &CacheStatsCallback, 0);
+    RawCallback("schedulerStats", &SchedulerStatsCallback, 0);
+    RawCallback("prefetchMany", &PrefetchManyCallback, 0);
+    RawCallback("prefetchStats", &PrefetchStatsCallback, 0);
+    RawCallback("playerStats", &PlayerStatsCallback, 0);
+    RawCallback("streamStats", &StreamStatsCallback, 0);
+    RawCallback("memoryStats", &MemoryStatsCallback, 0);
+    RawCallback("stats", &StatsCallback, 0);
+    RawCallback("mixerStats", &MixerStatsCallback, 0);
+    RawCallback("synthPoolStats", &SynthPoolStatsCallback, 0);
+    RawCallback("voiceVoxStats", &VoiceVoxStatsCallback, 0);
+    RawCallback("balancerStats", &BalancerStatsCallback, 0);
     NCB_METHOD(speakSync);
     NCB_METHOD(speakAsync);
+    NCB_METHOD(resolveVoice);
+    NCB_METHOD(speak);
+    NCB_METHOD(prefetchVoice);
+    NCB_METHOD(refreshVoices);
+    NCB_METHOD(setCatalogSnapshot);
+    NCB_METHOD(setCacheOptions);
+    NCB_METHOD(clearCache);
+    NCB_METHOD(setCompressionTolerance);
+    NCB_METHOD(setMemoryBudget);
+    NCB_METHOD(cancelAll);
+    NCB_METHOD(setSupersedePolicy);
+    NCB_METHOD(prefetch);
+    NCB_METHOD(cancelPrefetch);
+    NCB_METHOD(setPrefetchOptions);
+    NCB_METHOD(setPolyphony);
+    NCB_METHOD(loadCompiledDictionary);
+    NCB_METHOD(saveCompiledDictionary);
+    NCB_METHOD(setScenarioMarkup);
+    NCB_METHOD(setStatsOptions);
+    NCB_METHOD(resetStats);
+    NCB_METHOD(dumpTrace);
+    NCB_METHOD(enableMixer);
+    NCB_METHOD(setMixerOptions);
+    NCB_METHOD(setVoiceMix);
+    NCB_METHOD(setTimeStretch);
+    NCB_METHOD(setStreamBufferMs);
+    NCB_METHOD(warmVoice);
+    NCB_METHOD(setSynthPoolOptions);
+    NCB_METHOD(trimSynthesizers);
+    NCB_METHOD(setVoiceVoxProsody);
+    NCB_METHOD(setBalancerOptions);
 }
\ No newline at end of file